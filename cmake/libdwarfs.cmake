@@ -60,6 +60,7 @@ add_library(
   src/varint.cpp
   src/xattr.cpp
 
+  src/internal/elias_fano.cpp
   src/internal/features.cpp
   src/internal/file_status_conv.cpp
   src/internal/fs_section.cpp
@@ -68,6 +69,7 @@ add_library(
   src/internal/glob_to_regex.cpp
   src/internal/malloc_buffer.cpp
   src/internal/mappable_file.cpp
+  src/internal/memory_page_stats.cpp
   src/internal/io_ops_$<IF:$<BOOL:${WIN32}>,win,posix>.cpp
   src/internal/io_ops_helpers.cpp
   src/internal/metadata_utils.cpp
@@ -87,6 +89,7 @@ add_library(
   $<IF:${DWARFS_GIT_BUILD},${CMAKE_CURRENT_BINARY_DIR},${CMAKE_CURRENT_SOURCE_DIR}>/src/version.cpp
 
   src/compression/base.cpp
+  src/compression/framed.cpp
   src/compression/null.cpp
   src/compression/zstd.cpp
   $<$<BOOL:${LIBLZMA_FOUND}>:src/compression/lzma.cpp>
@@ -114,6 +117,7 @@ add_library(
 add_library(
   dwarfs_reader
 
+  src/reader/block_cache_arena.cpp
   src/reader/block_cache_options.cpp
   src/reader/block_range.cpp
   src/reader/detail/file_reader.cpp
@@ -123,12 +127,19 @@ add_library(
   src/reader/metadata_types.cpp
   src/reader/mlock_mode.cpp
 
+  src/reader/internal/block_access_trace.cpp
+  src/reader/internal/block_arena.cpp
   src/reader/internal/block_cache.cpp
   src/reader/internal/block_cache_byte_buffer_factory.cpp
+  src/reader/internal/block_prefetcher.cpp
   src/reader/internal/cached_block.cpp
+  src/reader/internal/dir_lookup_index.cpp
+  src/reader/internal/disk_block_cache.cpp
   src/reader/internal/filesystem_parser.cpp
   src/reader/internal/inode_reader_v2.cpp
+  src/reader/internal/lazy_unpacked_table.cpp
   src/reader/internal/metadata_analyzer.cpp
+  src/reader/internal/metadata_cache.cpp
   src/reader/internal/metadata_types.cpp
   src/reader/internal/metadata_v2.cpp
   src/reader/internal/periodic_executor.cpp
@@ -158,9 +169,12 @@ add_library(
   src/writer/writer_progress.cpp
 
   src/writer/internal/block_manager.cpp
+  src/writer/internal/cdc_segmenter.cpp
   src/writer/internal/chmod_transformer.cpp
+  src/writer/internal/cyclic_hash.cpp
   src/writer/internal/entry.cpp
   src/writer/internal/file_scanner.cpp
+  src/writer/internal/fingerprint_index.cpp
   src/writer/internal/fragment_chunkable.cpp
   src/writer/internal/global_entry_data.cpp
   src/writer/internal/inode_element_view.cpp
@@ -172,6 +186,7 @@ add_library(
   src/writer/internal/nilsimsa.cpp
   src/writer/internal/progress.cpp
   src/writer/internal/scanner_progress.cpp
+  src/writer/internal/segmenter_progress.cpp
   src/writer/internal/similarity.cpp
   src/writer/internal/similarity_ordering.cpp
   src/writer/internal/time_resolution_converter.cpp
@@ -268,7 +283,7 @@ target_link_libraries(dwarfs_compressor PRIVATE dwarfs_common)
 target_link_libraries(dwarfs_decompressor PRIVATE dwarfs_common)
 target_link_libraries(dwarfs_reader PUBLIC dwarfs_common dwarfs_decompressor)
 target_link_libraries(dwarfs_writer PUBLIC dwarfs_common dwarfs_compressor dwarfs_decompressor)
-target_link_libraries(dwarfs_writer PRIVATE zstd::preferred)
+target_link_libraries(dwarfs_writer PRIVATE zstd::preferred PkgConfig::XXHASH)
 target_link_libraries(dwarfs_extractor PUBLIC dwarfs_reader)
 target_link_libraries(dwarfs_rewrite PUBLIC dwarfs_reader dwarfs_writer)
 
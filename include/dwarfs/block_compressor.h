@@ -82,6 +82,11 @@ class block_compressor {
     return impl_->estimate_memory_usage(data_size);
   }
 
+  // Returns a compressor that splits blocks into independently
+  // decompressible sub-frames of `subframe_size` bytes, each of which
+  // is compressed using this compressor.
+  block_compressor with_subframes(size_t subframe_size) const;
+
   explicit operator bool() const { return static_cast<bool>(impl_); }
 
   class impl {
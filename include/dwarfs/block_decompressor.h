@@ -60,6 +60,16 @@ class block_decompressor {
 
   std::optional<std::string> metadata() const { return impl_->metadata(); }
 
+  // Framed blocks consist of independently decompressible sub-frames.
+  // Once decompression has been started, these can be decompressed in
+  // any order and concurrently from multiple threads. For all other
+  // blocks, num_subframes() returns zero.
+  size_t num_subframes() const { return impl_->num_subframes(); }
+
+  size_t subframe_size() const { return impl_->subframe_size(); }
+
+  void decompress_subframe(size_t index) { impl_->decompress_subframe(index); }
+
   static shared_byte_buffer
   decompress(compression_type type, std::span<uint8_t const> data);
 
@@ -71,6 +81,9 @@ class block_decompressor {
     virtual bool decompress_frame(size_t frame_size) = 0;
     virtual size_t uncompressed_size() const = 0;
     virtual std::optional<std::string> metadata() const = 0;
+    virtual size_t num_subframes() const = 0;
+    virtual size_t subframe_size() const = 0;
+    virtual void decompress_subframe(size_t index) = 0;
 
     virtual compression_type type() const = 0;
   };
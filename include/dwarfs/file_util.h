@@ -29,6 +29,8 @@
 #pragma once
 
 #include <filesystem>
+#include <functional>
+#include <iosfwd>
 #include <string>
 #include <string_view>
 #include <system_error>
@@ -42,10 +44,31 @@ void write_file(std::filesystem::path const& path, std::string_view content,
                 std::error_code& ec);
 void write_file(std::filesystem::path const& path, std::string_view content);
 
+// Returns a path in the same directory as `path` that is unique across
+// threads and processes. Useful for writing a file that is atomically
+// renamed to `path` once complete.
+std::filesystem::path
+unique_temporary_path(std::filesystem::path const& path,
+                      std::string_view suffix = ".tmp");
+
+// Writes `path` by passing a stream for a temporary file to `write` and
+// renaming the file to `path` once it is complete. Concurrent writers,
+// possibly in other processes, don't clobber each other and readers never
+// see a partially written file. The temporary file, whose name ends in
+// `tmp_suffix`, is removed if anything fails.
+void replace_file(std::filesystem::path const& path,
+                  std::string_view tmp_suffix,
+                  std::function<void(std::ostream&)> const& write,
+                  std::error_code& ec);
+
 class temporary_directory {
  public:
   temporary_directory();
   explicit temporary_directory(std::string_view prefix);
+  // Creates the directory in `parent` instead of the system temporary
+  // directory
+  temporary_directory(std::string_view prefix,
+                      std::filesystem::path const& parent);
   ~temporary_directory();
 
   temporary_directory(temporary_directory&&) = default;
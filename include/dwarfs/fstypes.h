@@ -45,7 +45,11 @@ namespace dwarfs {
 
 constexpr uint8_t MAJOR_VERSION = 2;
 constexpr uint8_t MINOR_VERSION = 5;
-constexpr uint8_t MINOR_VERSION_ACCEPTED = 6;
+// Images containing FRAMED blocks are written with this minor version,
+// so older readers reject them when opening the image rather than on
+// the first block read. Readers accepted minor version 6 before.
+constexpr uint8_t MINOR_VERSION_FRAMED = 7;
+constexpr uint8_t MINOR_VERSION_ACCEPTED = 7;
 
 enum class section_type : uint16_t {
   BLOCK = 0,
@@ -0,0 +1,131 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <dwarfs/internal/packed_int_vector.h>
+
+namespace dwarfs::internal {
+
+/**
+ * Elias-Fano encoding of a non-decreasing sequence of 32-bit integers.
+ *
+ * Values are stored relative to the first value. The lower `low_bits` of
+ * each value are stored in a packed array, the upper bits are stored in
+ * unary in a bit vector. This takes roughly `2 + log2(range / size)` bits
+ * per value. Random access needs a select on the upper bits, which is
+ * sped up by sampling the position of every `select_sample`-th value.
+ */
+class elias_fano {
+ public:
+  static constexpr size_t select_sample{128};
+
+  class builder;
+
+  elias_fano() = default;
+  explicit elias_fano(std::span<uint32_t const> values);
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t low_bits() const { return low_bits_; }
+  size_t size_in_bytes() const;
+
+  uint32_t operator[](size_t i) const {
+    assert(i < size_);
+    auto const high = select(i) - i;
+    return base_ + static_cast<uint32_t>((high << low_bits_) | lower_[i]);
+  }
+
+  std::vector<uint32_t> unpack() const;
+
+ private:
+  static size_t select_in_word(uint64_t word, size_t rank) {
+    size_t pos = 0;
+    for (size_t width : {32, 16, 8}) {
+      auto const count = static_cast<size_t>(
+          std::popcount(word & ((uint64_t{1} << width) - 1)));
+      if (rank >= count) {
+        rank -= count;
+        word >>= width;
+        pos += width;
+      }
+    }
+    for (; rank > 0; --rank) {
+      word &= word - 1;
+    }
+    return pos + std::countr_zero(word);
+  }
+
+  // Returns the position of the i-th set bit in `upper_`
+  size_t select(size_t i) const {
+    auto bit = samples_[i / select_sample];
+    auto rank = i % select_sample;
+    auto w = bit / 64;
+    auto word = upper_[w] & (~uint64_t{0} << (bit % 64));
+
+    for (;;) {
+      auto const count = static_cast<size_t>(std::popcount(word));
+      if (rank < count) {
+        return w * 64 + select_in_word(word, rank);
+      }
+      rank -= count;
+      word = upper_[++w];
+    }
+  }
+
+  size_t size_{0};
+  size_t low_bits_{0};
+  uint32_t base_{0};
+  std::vector<uint64_t> upper_;
+  packed_int_vector<uint32_t> lower_;
+  std::vector<uint32_t> samples_;
+};
+
+class elias_fano::builder {
+ public:
+  // All values must be in `[first, last]`
+  builder(size_t size, uint32_t first, uint32_t last);
+
+  void push_back(uint32_t value);
+
+  elias_fano build();
+
+ private:
+  elias_fano ef_;
+  size_t pos_{0};
+  uint32_t prev_{0};
+};
+
+} // namespace dwarfs::internal
@@ -59,11 +59,31 @@ class fsst_decoder {
     return impl_->decompress(data);
   }
 
+  // Decompresses into `buffer`, which is only grown, never shrunk, so
+  // repeated calls with the same buffer do not allocate once warmed up.
+  std::string_view
+  decompress(std::string_view data, std::string& buffer) const {
+    return impl_->decompress(data, buffer);
+  }
+
+  // Decompresses a batch of strings back to back into `buffer` and stores
+  // views of the decompressed strings in `out`. This is considerably faster
+  // than decompressing the strings one by one.
+  void decompress(std::span<std::string_view const> data, std::string& buffer,
+                  std::vector<std::string_view>& out) const {
+    impl_->decompress(data, buffer, out);
+  }
+
   class impl {
    public:
     virtual ~impl() = default;
 
     virtual std::string decompress(std::string_view data) const = 0;
+    virtual std::string_view
+    decompress(std::string_view data, std::string& buffer) const = 0;
+    virtual void
+    decompress(std::span<std::string_view const> data, std::string& buffer,
+               std::vector<std::string_view>& out) const = 0;
   };
 
  private:
@@ -0,0 +1,70 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <span>
+
+namespace dwarfs::internal {
+
+/**
+ * Page-level statistics for an address range
+ *
+ * These are the numbers that matter for TLB pressure: how much of the
+ * range is resident, how much of it is backed by huge pages, and how
+ * much of it is locked. All sizes are in bytes.
+ */
+struct memory_page_stats {
+  size_t size{0};
+  size_t resident{0};
+  size_t huge{0};
+  size_t locked{0};
+  size_t page_size{0};
+  size_t huge_page_size{0};
+
+  // Number of page table entries needed to map the resident part
+  size_t tlb_entries() const;
+};
+
+// Accumulates stats for [begin, end) from `/proc/<pid>/smaps` formatted
+// input. Returns std::nullopt if no mapping overlaps the range.
+std::optional<memory_page_stats>
+parse_memory_page_stats(std::istream& smaps, uintptr_t begin, uintptr_t end,
+                        size_t huge_page_size);
+
+// Returns std::nullopt if the stats aren't available on this platform.
+std::optional<memory_page_stats>
+get_memory_page_stats(std::span<std::byte const> range);
+
+std::ostream& operator<<(std::ostream& os, memory_page_stats const& st);
+
+} // namespace dwarfs::internal
@@ -31,6 +31,7 @@
 #include <concepts>
 #include <cstdint>
 #include <limits>
+#include <span>
 #include <type_traits>
 #include <vector>
 
@@ -168,6 +169,9 @@ class packed_int_vector {
 
   value_proxy front() { return this->operator[](0); }
 
+  std::span<underlying_type const> raw_data() const { return data_; }
+  std::span<underlying_type> raw_data() { return data_; }
+
   std::vector<T> unpack() const {
     std::vector<T> result(size_);
     for (size_type i = 0; i < size_; ++i) {
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <span>
 #include <string>
@@ -67,6 +68,34 @@ class string_table {
 
   std::string operator[](size_t index) const { return impl_->lookup(index); }
 
+  // Returns a view of the string at `index` without allocating on the hot
+  // path. The view either points into the table itself or into `scratch`,
+  // which is only (re-)allocated when it is too small. The view is valid
+  // until `scratch` is modified or destroyed.
+  std::string_view lookup(size_t index, std::string& scratch) const {
+    return impl_->lookup(index, scratch);
+  }
+
+  // Reusable state for batched lookups. After a lookup, `strings` holds
+  // views of the requested strings, which stay valid until the batch is
+  // reused or destroyed. The other members are internal scratch space.
+  struct lookup_batch {
+    std::vector<std::string_view> strings;
+    std::vector<std::string_view> packed;
+    std::string buffer;
+  };
+
+  // Looks up all strings at `indices` in one go. For packed tables, this
+  // decodes all strings with a single call into the FSST decoder.
+  void lookup(std::span<uint32_t const> indices, lookup_batch& batch) const {
+    impl_->lookup(indices, batch);
+  }
+
+  // Same as above, but for the contiguous index range [begin, end).
+  void lookup(size_t begin, size_t end, lookup_batch& batch) const {
+    impl_->lookup(begin, end, batch);
+  }
+
   std::vector<std::string> unpack() const { return impl_->unpack(); }
 
   bool is_packed() const { return impl_->is_packed(); }
@@ -99,6 +128,11 @@ class string_table {
     virtual ~impl() = default;
 
     virtual std::string lookup(size_t index) const = 0;
+    virtual std::string_view
+    lookup(size_t index, std::string& scratch) const = 0;
+    virtual void
+    lookup(std::span<uint32_t const> indices, lookup_batch& batch) const = 0;
+    virtual void lookup(size_t begin, size_t end, lookup_batch& batch) const = 0;
     virtual std::vector<std::string> unpack() const = 0;
     virtual bool is_packed() const = 0;
     virtual size_t unpacked_size() const = 0;
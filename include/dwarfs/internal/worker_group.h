@@ -53,6 +53,14 @@ class os_access;
 
 namespace internal {
 
+struct job_queue_stats {
+  size_t jobs{0};
+  std::chrono::nanoseconds total_wait{};
+  std::chrono::nanoseconds max_wait{};
+};
+
+std::string_view job_priority_name(job_priority prio);
+
 struct worker_group_options {
   size_t num_workers = 1;
   size_t max_queue_len = std::numeric_limits<size_t>::max();
@@ -95,11 +103,12 @@ class worker_group_impl {
   virtual void stop() = 0;
   virtual void wait() = 0;
   virtual bool running() const = 0;
-  virtual bool add_job(queued_job&& job) = 0;
+  virtual bool add_job(queued_job&& job, job_priority prio) = 0;
   virtual size_t size() const = 0;
   virtual std::chrono::nanoseconds get_cpu_time(std::error_code& ec) const = 0;
   virtual std::optional<std::chrono::nanoseconds> try_get_cpu_time() const = 0;
   virtual bool set_affinity(std::vector<int> const& cpus) = 0;
+  virtual job_queue_stats get_queue_stats(job_priority prio) const = 0;
 };
 
 std::unique_ptr<worker_group_impl>
@@ -207,6 +216,11 @@ class basic_worker_group {
 
   template <detail::forwards_to_job<job_type> F>
   bool add_job(F&& job) {
+    return add_job(job_priority::DEMAND, std::forward<F>(job));
+  }
+
+  template <detail::forwards_to_job<job_type> F>
+  bool add_job(job_priority prio, F&& job) {
     auto wrapped = job_type(std::forward<F>(job));
 
     return impl_->add_job(
@@ -214,7 +228,8 @@ class basic_worker_group {
           auto& typed_ctx =
               static_cast<detail::worker_context_model<Args...>&>(ctx);
           std::apply(wrapped, typed_ctx.args());
-        });
+        },
+        prio);
   }
 
   template <typename T>
@@ -237,6 +252,14 @@ class basic_worker_group {
     return impl_->set_affinity(cpus);
   }
 
+  /**
+   * Time jobs of the given class spent in the queue before being picked
+   * up by a worker.
+   */
+  job_queue_stats get_queue_stats(job_priority prio) const {
+    return impl_->get_queue_stats(prio);
+  }
+
  private:
   template <typename Factory>
   static detail::worker_group_impl::state_factory
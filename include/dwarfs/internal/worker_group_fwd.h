@@ -28,8 +28,27 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 namespace dwarfs::internal {
 
+/**
+ * Scheduling class of a worker group job.
+ *
+ * Workers always pick the oldest job of the most urgent non-empty class,
+ * so queued jobs of a less urgent class are overtaken by more urgent jobs
+ * that are added later. Running jobs are never interrupted.
+ */
+enum class job_priority : uint8_t {
+  DEMAND,
+  READAHEAD,
+  PREFETCH,
+  PRELOAD,
+};
+
+inline constexpr size_t num_job_priorities{4};
+
 template <typename...>
 class basic_worker_group;
 
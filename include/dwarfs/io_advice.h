@@ -36,6 +36,7 @@ enum class io_advice {
   sequential,
   willneed,
   dontneed,
+  hugepage,
 };
 
 enum class io_advice_range {
@@ -0,0 +1,70 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include <dwarfs/reader/block_cache_options.h>
+
+namespace dwarfs::reader {
+
+namespace internal {
+
+class block_arena;
+
+}
+
+struct block_cache_arena_options {
+  size_t max_bytes{static_cast<size_t>(512) << 20};
+  size_t num_shards{0};
+  block_cache_eviction_policy eviction_policy{block_cache_eviction_policy::LRU};
+};
+
+// A block cache memory budget that can be shared by multiple file system
+// instances in the same process. Blocks of all attached file systems are
+// subject to a single eviction policy, so memory is distributed according
+// to the actual access pattern instead of being split statically.
+class block_cache_arena {
+ public:
+  explicit block_cache_arena(block_cache_arena_options const& options = {});
+
+  size_t max_bytes() const;
+  size_t cached_bytes() const;
+  size_t num_images() const;
+
+  std::shared_ptr<internal::block_arena const> const& get_arena() const {
+    return arena_;
+  }
+
+ private:
+  std::shared_ptr<internal::block_arena const> arena_;
+};
+
+} // namespace dwarfs::reader
@@ -36,6 +36,12 @@ namespace dwarfs::reader {
 enum class block_cache_allocation_mode {
   MALLOC,
   MMAP,
+  HUGEPAGE,
+};
+
+enum class block_cache_eviction_policy {
+  LRU,
+  TINYLFU,
 };
 
 struct block_cache_options {
@@ -44,8 +50,11 @@ struct block_cache_options {
   double decompress_ratio{1.0};
   bool disable_block_integrity_check{false};
   size_t sequential_access_detector_threshold{0};
+  size_t max_prefetch_depth{0};
   block_cache_allocation_mode allocation_mode{
       block_cache_allocation_mode::MALLOC};
+  size_t num_shards{0};
+  block_cache_eviction_policy eviction_policy{block_cache_eviction_policy::LRU};
 };
 
 std::ostream& operator<<(std::ostream& os, block_cache_options const& opts);
@@ -30,8 +30,11 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <span>
 
+#include <dwarfs/types.h>
+
 namespace dwarfs::reader {
 
 namespace internal {
@@ -46,6 +49,8 @@ class block_range {
   explicit block_range(std::span<uint8_t const> span)
       : span_{span} {}
   block_range(uint8_t const* data, size_t offset, size_t size);
+  block_range(uint8_t const* data, size_t offset, size_t size,
+              file_off_t image_offset);
   block_range(std::shared_ptr<internal::cached_block const> block,
               size_t offset, size_t size);
 
@@ -54,8 +59,14 @@ class block_range {
   auto end() const { return span_.end(); }
   auto size() const { return span_.size(); }
 
+  // If the data is stored as-is in the file system image, this is its
+  // offset in the image file. Such ranges can be read (or spliced)
+  // directly from the image file instead of from memory.
+  std::optional<file_off_t> image_offset() const { return image_offset_; }
+
  private:
   std::span<uint8_t const> span_;
+  std::optional<file_off_t> image_offset_;
   std::shared_ptr<internal::cached_block const> block_;
 };
 
@@ -28,9 +28,12 @@
 
 #pragma once
 
+#include <filesystem>
 #include <limits>
+#include <memory>
 
 #include <dwarfs/reader/block_cache_options.h>
+#include <dwarfs/reader/disk_cache_options.h>
 #include <dwarfs/reader/inode_reader_options.h>
 #include <dwarfs/reader/metadata_options.h>
 #include <dwarfs/reader/mlock_mode.h>
@@ -38,14 +41,30 @@
 
 namespace dwarfs::reader {
 
+class block_cache_arena;
+
 struct filesystem_options {
   static constexpr file_off_t IMAGE_OFFSET_AUTO{-1};
 
+  // Locks the metadata and, if used, the metadata cache file in memory.
   mlock_mode lock_mode{mlock_mode::NONE};
+  // If set, the metadata is copied to anonymous memory that the kernel is
+  // asked to back with transparent huge pages, reducing TLB misses for
+  // lookups in large metadata.
+  bool metadata_hugepages{false};
   file_off_t image_offset{0};
   file_off_t image_size{std::numeric_limits<file_off_t>::max()};
   block_cache_options block_cache{};
+  // If set, the block cache memory budget, number of shards and eviction
+  // policy are taken from the arena instead of `block_cache`.
+  std::shared_ptr<block_cache_arena const> block_cache_arena{};
+  disk_cache_options disk_cache{};
   metadata_options metadata{};
+  // If set, tables derived from the metadata are loaded from this file
+  // instead of being rebuilt, and the file is (re)written in the background
+  // if it is missing or doesn't match the file system. A file that could
+  // not be written is not retried until the process restarts.
+  std::filesystem::path metadata_cache_file{};
   inode_reader_options inode_reader{};
   int inode_offset{0};
 };
@@ -31,6 +31,7 @@
 #include <concepts>
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>
 #include <functional>
 #include <future>
 #include <iosfwd>
@@ -116,6 +117,19 @@ class filesystem_v2_lite {
     lite_->walk_data_order(func);
   }
 
+  // Like walk() / walk_data_order(), but also passes the entry's unix path.
+  // Names are decoded in batches, which is much faster than calling
+  // `unix_path()` on each entry. The path is only valid during the call.
+  void walk_with_path(
+      std::function<void(dir_entry_view, std::string_view)> const& func) const {
+    lite_->walk_with_path(func);
+  }
+
+  void walk_data_order_with_path(
+      std::function<void(dir_entry_view, std::string_view)> const& func) const {
+    lite_->walk_data_order_with_path(func);
+  }
+
   dir_entry_view_iterable directory_entries() const {
     return lite_->directory_entries();
   }
@@ -172,6 +186,31 @@ class filesystem_v2_lite {
     return lite_->readdir(dir, offset);
   }
 
+  // Calls `func` for all entries of `dir` starting at `offset`, passing the
+  // entry and its name, until `func` returns false. Names are decoded in
+  // batches and are only valid during the call.
+  void readdir(
+      directory_view dir, size_t offset,
+      std::function<bool(dir_entry_view, std::string_view)> const& func) const {
+    lite_->readdir(dir, offset, func);
+  }
+
+  // Like readdir(), but also passes the attributes of each entry. This is
+  // much cheaper than calling getattr() for each entry individually. Stops
+  // at the first entry whose attributes cannot be determined.
+  void readdirplus(directory_view dir, size_t offset,
+                   std::function<bool(dir_entry_view, std::string_view,
+                                      file_stat const&)> const& func,
+                   std::error_code& ec) const {
+    lite_->readdirplus(dir, offset, func, ec);
+  }
+
+  void readdirplus(directory_view dir, size_t offset,
+                   std::function<bool(dir_entry_view, std::string_view,
+                                      file_stat const&)> const& func) const {
+    lite_->readdirplus(dir, offset, func);
+  }
+
   size_t dirsize(directory_view dir) const { return lite_->dirsize(dir); }
 
   std::string
@@ -360,6 +399,17 @@ class filesystem_v2_lite {
 
   void cache_all_blocks() const { lite_->cache_all_blocks(); }
 
+  // Record the order in which blocks are first accessed to a trace file
+  void record_block_trace(std::filesystem::path const& path) {
+    lite_->record_block_trace(path);
+  }
+
+  // Preload blocks in the order recorded in a trace file; this happens
+  // in the background and is limited by the block cache size
+  void cache_blocks_from_trace(std::filesystem::path const& path) const {
+    lite_->cache_blocks_from_trace(path);
+  }
+
   std::shared_ptr<internal::filesystem_parser> get_parser() const {
     return lite_->get_parser();
   }
@@ -374,6 +424,12 @@ class filesystem_v2_lite {
     walk(std::function<void(dir_entry_view)> const& func) const = 0;
     virtual void
     walk_data_order(std::function<void(dir_entry_view)> const& func) const = 0;
+    virtual void walk_with_path(
+        std::function<void(dir_entry_view, std::string_view)> const& func)
+        const = 0;
+    virtual void walk_data_order_with_path(
+        std::function<void(dir_entry_view, std::string_view)> const& func)
+        const = 0;
     virtual dir_entry_view_iterable directory_entries() const = 0;
     virtual dir_entry_view_iterable entries_in_data_order() const = 0;
     virtual dir_entry_view root() const = 0;
@@ -394,6 +450,19 @@ class filesystem_v2_lite {
     virtual std::optional<directory_view> opendir(inode_view entry) const = 0;
     virtual std::optional<dir_entry_view>
     readdir(directory_view dir, size_t offset) const = 0;
+    virtual void
+    readdir(directory_view dir, size_t offset,
+            std::function<bool(dir_entry_view, std::string_view)> const& func)
+        const = 0;
+    virtual void readdirplus(
+        directory_view dir, size_t offset,
+        std::function<bool(dir_entry_view, std::string_view,
+                           file_stat const&)> const& func,
+        std::error_code& ec) const = 0;
+    virtual void readdirplus(
+        directory_view dir, size_t offset,
+        std::function<bool(dir_entry_view, std::string_view,
+                           file_stat const&)> const& func) const = 0;
     virtual size_t dirsize(directory_view dir) const = 0;
     virtual std::string readlink(inode_view entry, readlink_mode mode,
                                  std::error_code& ec) const = 0;
@@ -463,6 +532,9 @@ class filesystem_v2_lite {
     get_block_category_metadata(size_t block_number) const = 0;
     virtual void cache_blocks_by_category(std::string_view category) const = 0;
     virtual void cache_all_blocks() const = 0;
+    virtual void record_block_trace(std::filesystem::path const& path) = 0;
+    virtual void
+    cache_blocks_from_trace(std::filesystem::path const& path) const = 0;
     virtual std::shared_ptr<internal::filesystem_parser> get_parser() const = 0;
   };
 
@@ -49,6 +49,7 @@ constexpr size_t default_hole_data_size() {
 
 struct inode_reader_options {
   size_t readahead{0};
+  size_t max_readahead{0};
   size_t hole_data_size{detail::default_hole_data_size()};
 };
 
@@ -0,0 +1,92 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace dwarfs::reader::internal {
+
+/**
+ * Block access traces
+ *
+ * A trace records the order in which the blocks of a file system image
+ * are first accessed, along with the time of each access relative to the
+ * start of the recording. Traces can be replayed to warm up the block
+ * cache right after mounting an image.
+ *
+ * The file format is a magic string, followed by a varint-encoded format
+ * version and the number of blocks in the image. Each access is stored
+ * as a pair of varints: the time in microseconds since the previous
+ * access and the block number.
+ */
+struct block_access_trace {
+  struct entry {
+    std::chrono::microseconds time;
+    size_t block_no;
+  };
+
+  size_t num_blocks{0};
+  std::vector<entry> entries;
+
+  static block_access_trace read(std::filesystem::path const& path);
+};
+
+// Records the first access to each block. Subsequent accesses to the same
+// block are ignored, so the trace size is bounded by the number of blocks.
+class block_access_recorder {
+ public:
+  block_access_recorder(std::filesystem::path const& path, size_t num_blocks);
+  ~block_access_recorder();
+
+  block_access_recorder(block_access_recorder const&) = delete;
+  block_access_recorder& operator=(block_access_recorder const&) = delete;
+
+  void record(size_t block_no);
+
+  size_t num_recorded() const;
+
+ private:
+  void write_buffer();
+
+  std::mutex mutable mx_;
+  std::ofstream ofs_;
+  std::vector<bool> seen_;
+  std::vector<uint8_t> buffer_;
+  std::chrono::steady_clock::time_point const start_;
+  std::chrono::microseconds last_{0};
+  size_t num_recorded_{0};
+};
+
+} // namespace dwarfs::reader::internal
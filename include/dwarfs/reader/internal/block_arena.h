@@ -0,0 +1,181 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace dwarfs {
+
+namespace internal {
+
+class fs_section;
+
+}
+
+namespace reader {
+
+struct block_cache_arena_options;
+
+namespace internal {
+
+class cached_block;
+
+// Identifies a compressed block by the checksums stored in its section
+// header. Blocks with the same content id are identical, even if they
+// belong to different images.
+struct block_content_id {
+  uint64_t xxh3_64{0};
+  std::array<uint8_t, 32> sha2_512_256{};
+
+  bool operator==(block_content_id const&) const = default;
+
+  static std::optional<block_content_id>
+  from_section(dwarfs::internal::fs_section const& section);
+};
+
+// Storage for decompressed blocks that is shared by one or more block
+// caches. All blocks compete for a single memory budget and are subject
+// to a single eviction policy, regardless of which image they belong to.
+// Each attached block cache is identified by an image id.
+//
+// Blocks with a content id are stored only once, no matter how many
+// images contain them. Such a block is removed from the arena once it
+// is evicted or no longer used by any image.
+class block_arena {
+ public:
+  using block_ptr = std::shared_ptr<cached_block>;
+
+  // Called with the corresponding arena shard locked whenever a block
+  // is removed from the arena
+  using removal_hook = std::function<void(size_t block_no, block_ptr&& block)>;
+  using block_predicate = std::function<bool(cached_block const&)>;
+  using block_visitor =
+      std::function<void(size_t block_no, cached_block const&)>;
+
+  using content_id = std::optional<block_content_id>;
+
+  struct image_stats {
+    // bytes of all blocks referenced by the image, including shared ones
+    size_t cached_bytes{0};
+    // number of lookups satisfied by a block cached for another image
+    size_t shared_hits{0};
+  };
+
+  struct lock_stats {
+    size_t acquired{0};
+    size_t contended{0};
+    std::chrono::nanoseconds wait{0};
+  };
+
+  explicit block_arena(block_cache_arena_options const& options);
+
+  uint32_t attach(removal_hook hook) const {
+    return impl_->attach(std::move(hook));
+  }
+
+  // Removes all references to blocks of this image without calling
+  // its removal hook
+  void detach(uint32_t image_id) const { impl_->detach(image_id); }
+
+  void set_block_size(uint32_t image_id, size_t block_size,
+                      size_t num_blocks) const {
+    impl_->set_block_size(image_id, block_size, num_blocks);
+  }
+
+  block_ptr find(uint32_t image_id, size_t block_no, content_id const& content,
+                 bool promote = true) const {
+    return impl_->find(image_id, block_no, content, promote);
+  }
+
+  // Returns true if the block was not yet in the arena. If a block with
+  // the same content is already present, it is kept and `block` is
+  // discarded.
+  bool insert(uint32_t image_id, size_t block_no, content_id const& content,
+              block_ptr block) const {
+    return impl_->insert(image_id, block_no, content, std::move(block));
+  }
+
+  void remove_if(uint32_t image_id, block_predicate const& pred,
+                 removal_hook const& hook) const {
+    impl_->remove_if(image_id, pred, hook);
+  }
+
+  void for_each(uint32_t image_id, block_visitor const& visitor) const {
+    impl_->for_each(image_id, visitor);
+  }
+
+  size_t max_bytes() const { return impl_->max_bytes(); }
+  size_t cached_bytes() const { return impl_->cached_bytes(); }
+  image_stats get_image_stats(uint32_t image_id) const {
+    return impl_->get_image_stats(image_id);
+  }
+  size_t num_images() const { return impl_->num_images(); }
+  size_t num_shards() const { return impl_->num_shards(); }
+  std::string_view policy_name() const { return impl_->policy_name(); }
+  lock_stats get_lock_stats() const { return impl_->get_lock_stats(); }
+
+  class impl {
+   public:
+    virtual ~impl() = default;
+
+    virtual uint32_t attach(removal_hook hook) = 0;
+    virtual void detach(uint32_t image_id) = 0;
+    virtual void
+    set_block_size(uint32_t image_id, size_t block_size, size_t num_blocks) = 0;
+    virtual block_ptr find(uint32_t image_id, size_t block_no,
+                           content_id const& content, bool promote) const = 0;
+    virtual bool insert(uint32_t image_id, size_t block_no,
+                        content_id const& content, block_ptr block) const = 0;
+    virtual void remove_if(uint32_t image_id, block_predicate const& pred,
+                           removal_hook const& hook) const = 0;
+    virtual void
+    for_each(uint32_t image_id, block_visitor const& visitor) const = 0;
+    virtual size_t max_bytes() const = 0;
+    virtual size_t cached_bytes() const = 0;
+    virtual image_stats get_image_stats(uint32_t image_id) const = 0;
+    virtual size_t num_images() const = 0;
+    virtual size_t num_shards() const = 0;
+    virtual std::string_view policy_name() const = 0;
+    virtual lock_stats get_lock_stats() const = 0;
+  };
+
+ private:
+  std::unique_ptr<impl> impl_;
+};
+
+} // namespace internal
+} // namespace reader
+} // namespace dwarfs
@@ -33,12 +33,16 @@
 
 #include <future>
 #include <memory>
+#include <span>
+#include <utility>
 
 #include <dwarfs/block_compressor.h>
 #include <dwarfs/file_view.h>
 #include <dwarfs/fstypes.h>
 #include <dwarfs/reader/block_range.h>
 
+#include <dwarfs/internal/worker_group_fwd.h>
+
 namespace dwarfs {
 
 class logger;
@@ -58,10 +62,15 @@ struct cache_tidy_config;
 
 namespace internal {
 
+class block_access_recorder;
+class block_arena;
+class disk_block_cache;
+
 class block_cache {
  public:
   block_cache(logger& lgr, os_access const& os, file_view const& mm,
               block_cache_options const& options,
+              std::shared_ptr<block_arena const> arena,
               std::shared_ptr<performance_monitor const> const& perfmon);
 
   size_t block_count() const { return impl_->block_count(); }
@@ -78,9 +87,29 @@ class block_cache {
     impl_->set_tidy_config(cfg);
   }
 
+  // Blocks evicted from memory will be spilled to the disk cache and
+  // cache misses will be looked up there before decompressing
+  void set_disk_cache(std::shared_ptr<disk_block_cache const> cache) {
+    impl_->set_disk_cache(std::move(cache));
+  }
+
+  // Demand accesses to blocks will be recorded
+  void set_access_recorder(std::shared_ptr<block_access_recorder> recorder) {
+    impl_->set_access_recorder(std::move(recorder));
+  }
+
+  // Only demand accesses are recorded and drive the prefetcher; other
+  // classes just determine how urgently the block is decompressed
   std::future<block_range>
-  get(size_t block_no, size_t offset, size_t size) const {
-    return impl_->get(block_no, offset, size);
+  get(size_t block_no, size_t offset, size_t size,
+      dwarfs::internal::job_priority prio =
+          dwarfs::internal::job_priority::DEMAND) const {
+    return impl_->get(block_no, offset, size, prio);
+  }
+
+  // Fully decompress blocks in the given order using only idle workers
+  void preload(std::span<size_t const> blocks) const {
+    impl_->preload(blocks);
   }
 
   class impl {
@@ -92,8 +121,14 @@ class block_cache {
     virtual void set_block_size(size_t size) = 0;
     virtual void set_num_workers(size_t num) = 0;
     virtual void set_tidy_config(cache_tidy_config const& cfg) = 0;
+    virtual void
+    set_disk_cache(std::shared_ptr<disk_block_cache const> cache) = 0;
+    virtual void
+    set_access_recorder(std::shared_ptr<block_access_recorder> recorder) = 0;
     virtual std::future<block_range>
-    get(size_t block_no, size_t offset, size_t length) const = 0;
+    get(size_t block_no, size_t offset, size_t length,
+        dwarfs::internal::job_priority prio) const = 0;
+    virtual void preload(std::span<size_t const> blocks) const = 0;
   };
 
  private:
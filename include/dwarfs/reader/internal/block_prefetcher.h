@@ -0,0 +1,121 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <dwarfs/small_vector.h>
+
+namespace dwarfs::reader::internal {
+
+struct block_prefetcher_options {
+  // Number of blocks that must be accessed in a regular pattern before
+  // any prefetching takes place
+  size_t threshold{4};
+  size_t max_depth{16};
+  size_t max_streams{16};
+  size_t max_stride{64};
+};
+
+// How a demand access to a block was satisfied by the block cache
+enum class block_access_result {
+  CACHE_HIT,
+  IN_FLIGHT,
+  MISS,
+};
+
+/**
+ * Detects regular block access patterns and decides what to prefetch.
+ *
+ * Up to `max_streams` independent access streams are tracked, so that
+ * multiple concurrent sequential or strided readers can be recognized.
+ * Once a stream has seen `threshold` accesses with a constant, positive
+ * stride, blocks ahead of the stream are returned for prefetching.
+ *
+ * The prefetch depth of each stream adapts to the feedback from the
+ * block cache: if the stream catches up with blocks that are still
+ * being decompressed, or with blocks that could not be prefetched due to
+ * lack of worker capacity, the depth is doubled. If a prefetched block
+ * has already been evicted again by the time it is accessed, the depth
+ * is halved.
+ */
+class block_prefetcher {
+ public:
+  using block_list = small_vector<size_t, 16>;
+
+  struct stats {
+    size_t streams_detected{0};
+    size_t prefetches_issued{0};
+    size_t prefetch_hits{0};
+    size_t late_prefetches{0};
+    size_t evicted_prefetches{0};
+    size_t abandoned_prefetches{0};
+    size_t max_depth_reached{0};
+  };
+
+  explicit block_prefetcher(block_prefetcher_options const& options);
+
+  void set_block_count(size_t num_blocks);
+  void set_max_depth(size_t max_depth);
+
+  // Record a demand access and add up to `capacity` blocks that should
+  // be prefetched to `prefetch`
+  void access(size_t block_no, block_access_result result, size_t capacity,
+              block_list& prefetch);
+
+  stats get_stats() const;
+
+ private:
+  struct stream {
+    size_t last{0};
+    size_t stride{0};
+    size_t length{0};
+    size_t depth{1};
+    size_t next_issue{0};
+    uint64_t last_used{0};
+  };
+
+  stream* find_stream(size_t block_no);
+  stream& new_stream(size_t block_no);
+  void feedback(stream& s, size_t block_no, block_access_result result);
+  void issue(stream& s, size_t capacity, block_list& prefetch);
+
+  std::mutex mutable mx_;
+  std::vector<stream> streams_;
+  uint64_t clock_{0};
+  size_t num_blocks_{0};
+  size_t max_depth_;
+  stats stats_;
+  block_prefetcher_options const options_;
+};
+
+} // namespace dwarfs::reader::internal
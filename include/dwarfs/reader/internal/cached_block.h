@@ -30,6 +30,7 @@
 
 #include <chrono>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -37,6 +38,7 @@ namespace dwarfs {
 
 class byte_buffer_factory;
 class file_segment;
+class file_view;
 class logger;
 
 namespace internal {
@@ -54,14 +56,38 @@ class cached_block {
          file_segment const& seg, byte_buffer_factory const& bbf,
          bool disable_integrity_check);
 
+  // Create a block from already decompressed data that lives in `mm`.
+  // The mapping is kept alive for as long as the block exists.
+  static std::unique_ptr<cached_block>
+  create(file_view const& mm, size_t offset, size_t size);
+
   // TODO: have a create method for an uncompressed block,
   //       or (preferably) just handle this case internally
 
+  // Runs `task` on up to `count` additional threads. This is used to
+  // decompress the sub-frames of a single block in parallel.
+  using task_spawner =
+      std::function<void(size_t count, std::function<void()> const& task)>;
+
   virtual ~cached_block() = default;
 
   virtual size_t range_end() const = 0;
   virtual uint8_t const* data() const = 0;
   virtual void decompress_until(size_t end) = 0;
+
+  // Blocks with sub-frames can be decompressed in any order, so the range
+  // [begin, end) may be available even if range_end() is below `end`.
+  virtual bool has_subframes() const { return false; }
+
+  virtual bool is_available(size_t /*begin*/, size_t end) const {
+    return end <= range_end();
+  }
+
+  virtual void decompress_range(size_t /*begin*/, size_t end,
+                                task_spawner const& /*spawn*/) {
+    decompress_until(end);
+  }
+
   virtual size_t uncompressed_size() const = 0;
   virtual void touch() = 0;
   virtual bool
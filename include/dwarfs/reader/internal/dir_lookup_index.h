@@ -0,0 +1,97 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <dwarfs/internal/packed_int_vector.h>
+#include <dwarfs/reader/internal/lazy_dir_cache.h>
+
+namespace dwarfs::reader::internal {
+
+/**
+ * Open-addressing hash table mapping the names of a directory's entries
+ * to their position in the directory.
+ *
+ * Each slot stores the entry position along with a few bits of the name
+ * hash. With a load factor of at most 50%, a successful lookup almost
+ * always takes a single probe and a single name comparison, compared to
+ * `log2(n)` name decodes for a binary search.
+ */
+class dir_lookup_index {
+ public:
+  dir_lookup_index() = default;
+  explicit dir_lookup_index(std::vector<uint64_t> const& hashes);
+
+  static uint64_t hash(std::string_view name);
+
+  // `is_match(pos)` must return true if the entry at `pos` has the name
+  // that was used to compute `hash`.
+  template <typename Pred>
+  std::optional<size_t> find(uint64_t hash, Pred const& is_match) const {
+    if (slots_.empty()) {
+      return std::nullopt;
+    }
+
+    auto const tag = tag_of(hash);
+
+    for (auto slot = hash & mask_;; slot = (slot + 1) & mask_) {
+      auto const value = slots_[slot];
+
+      if (value == 0) {
+        return std::nullopt;
+      }
+
+      if (tags_[slot] == tag && is_match(value - 1)) {
+        return value - 1;
+      }
+    }
+  }
+
+  bool empty() const { return slots_.empty(); }
+
+  size_t size_in_bytes() const {
+    return slots_.size_in_bytes() + tags_.size();
+  }
+
+ private:
+  static uint8_t tag_of(uint64_t hash) { return hash >> 56; }
+
+  dwarfs::internal::packed_int_vector<uint32_t> slots_;
+  std::vector<uint8_t> tags_;
+  uint64_t mask_{0};
+};
+
+using dir_lookup_index_cache = lazy_dir_cache<dir_lookup_index>;
+
+} // namespace dwarfs::reader::internal
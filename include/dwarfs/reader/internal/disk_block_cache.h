@@ -0,0 +1,104 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace dwarfs {
+
+class logger;
+class os_access;
+
+namespace internal {
+
+class fs_section;
+
+}
+
+namespace reader {
+
+struct disk_cache_options;
+
+namespace internal {
+
+class cached_block;
+
+// Persistent second-level cache for fully decompressed blocks. Blocks are
+// stored as individual files named after the section checksum and block
+// number, and are memory-mapped when loaded. The total size of all files
+// is bounded; the least recently used files are removed first. Each file
+// also stores a checksum of the block data, which is verified on load;
+// files that fail verification are removed and treated as a miss.
+class disk_block_cache {
+ public:
+  disk_block_cache(logger& lgr, os_access const& os,
+                   disk_cache_options const& options);
+
+  // Returns nullptr if the block is not in the cache. This reads the
+  // whole block to verify it, so don't call it while holding any locks.
+  std::shared_ptr<cached_block>
+  load(dwarfs::internal::fs_section const& section, size_t block_no) const {
+    return impl_->load(section, block_no);
+  }
+
+  bool
+  contains(dwarfs::internal::fs_section const& section, size_t block_no) const {
+    return impl_->contains(section, block_no);
+  }
+
+  // Only fully decompressed blocks are stored
+  void store(dwarfs::internal::fs_section const& section, size_t block_no,
+             cached_block const& block) const {
+    impl_->store(section, block_no, block);
+  }
+
+  size_t size_bytes() const { return impl_->size_bytes(); }
+
+  class impl {
+   public:
+    virtual ~impl() = default;
+
+    virtual std::shared_ptr<cached_block>
+    load(dwarfs::internal::fs_section const& section,
+         size_t block_no) const = 0;
+    virtual bool contains(dwarfs::internal::fs_section const& section,
+                          size_t block_no) const = 0;
+    virtual void store(dwarfs::internal::fs_section const& section,
+                       size_t block_no, cached_block const& block) const = 0;
+    virtual size_t size_bytes() const = 0;
+  };
+
+ private:
+  std::unique_ptr<impl const> impl_;
+};
+
+} // namespace internal
+} // namespace reader
+} // namespace dwarfs
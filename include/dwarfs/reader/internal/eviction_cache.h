@@ -0,0 +1,469 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+#include <dwarfs/reader/block_cache_options.h>
+
+namespace dwarfs::reader::internal {
+
+// An eviction policy only tracks keys. It is told about insertions,
+// accesses and removals and decides which key should be evicted next.
+template <typename KeyT>
+class eviction_policy {
+ public:
+  using key_type = KeyT;
+
+  virtual ~eviction_policy() = default;
+
+  virtual std::string_view name() const = 0;
+  virtual void set_capacity(size_t capacity) = 0;
+  virtual void insert(key_type const& key) = 0;
+  virtual void access(key_type const& key) = 0;
+  virtual void erase(key_type const& key) = 0;
+  virtual void clear() = 0;
+
+  // Only called if at least one key is being tracked
+  virtual key_type victim() = 0;
+};
+
+template <typename KeyT>
+class lru_eviction_policy final : public eviction_policy<KeyT> {
+ public:
+  using key_type = KeyT;
+
+  std::string_view name() const override { return "lru"; }
+
+  void set_capacity(size_t capacity) override { index_.reserve(capacity); }
+
+  void insert(key_type const& key) override {
+    lru_.push_front(key);
+    index_[key] = lru_.begin();
+  }
+
+  void access(key_type const& key) override {
+    if (auto it = index_.find(key); it != index_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+    }
+  }
+
+  void erase(key_type const& key) override {
+    if (auto it = index_.find(key); it != index_.end()) {
+      lru_.erase(it->second);
+      index_.erase(it);
+    }
+  }
+
+  void clear() override {
+    index_.clear();
+    lru_.clear();
+  }
+
+  key_type victim() override { return lru_.back(); }
+
+ private:
+  std::list<key_type> lru_;
+  phmap::flat_hash_map<key_type, typename std::list<key_type>::iterator>
+      index_;
+};
+
+// Approximate frequency counts with periodic aging, as used by TinyLFU.
+// This is a count-min sketch with four rows of saturating 4-bit counters
+// (stored in bytes for simplicity). Once the number of increments reaches
+// ten times the width of the sketch, all counters are halved.
+template <typename KeyT, typename Hash = std::hash<KeyT>>
+class frequency_sketch {
+ public:
+  using key_type = KeyT;
+
+  static constexpr size_t const kDepth{4};
+  static constexpr uint8_t const kMaxCount{15};
+
+  explicit frequency_sketch(size_t capacity = 0) { set_capacity(capacity); }
+
+  void set_capacity(size_t capacity) {
+    width_ = std::bit_ceil(std::max<size_t>(capacity, 16));
+    table_.assign(kDepth * width_, 0);
+    sample_size_ = 10 * width_;
+    additions_ = 0;
+  }
+
+  void increment(key_type const& key) {
+    auto const h = hash(key);
+    bool added = false;
+
+    for (size_t d = 0; d < kDepth; ++d) {
+      if (auto& c = table_[index(h, d)]; c < kMaxCount) {
+        ++c;
+        added = true;
+      }
+    }
+
+    if (added && ++additions_ >= sample_size_) {
+      age();
+    }
+  }
+
+  uint8_t frequency(key_type const& key) const {
+    auto const h = hash(key);
+    uint8_t freq{kMaxCount};
+
+    for (size_t d = 0; d < kDepth; ++d) {
+      freq = std::min(freq, table_[index(h, d)]);
+    }
+
+    return freq;
+  }
+
+ private:
+  uint64_t hash(key_type const& key) const {
+    // std::hash is the identity for integers in most implementations,
+    // so mix the bits (splitmix64 finalizer)
+    uint64_t h = Hash{}(key);
+    h ^= h >> 30;
+    h *= UINT64_C(0xbf58476d1ce4e5b9);
+    h ^= h >> 27;
+    h *= UINT64_C(0x94d049bb133111eb);
+    h ^= h >> 31;
+    return h;
+  }
+
+  size_t index(uint64_t h, size_t depth) const {
+    auto const step = (h >> 32) | 1;
+    return depth * width_ + ((h + depth * step) & (width_ - 1));
+  }
+
+  void age() {
+    for (auto& c : table_) {
+      c >>= 1;
+    }
+    additions_ /= 2;
+  }
+
+  std::vector<uint8_t> table_;
+  size_t width_{0};
+  size_t sample_size_{0};
+  size_t additions_{0};
+};
+
+// W-TinyLFU: new keys enter a small LRU window. Once the cache is full,
+// keys leaving the window have to compete against the eviction candidate
+// of the main segmented LRU (probation + protected) and are only admitted
+// if they have been seen more frequently. Keys accessed again while on
+// probation are promoted to the protected segment. This makes the policy
+// resistant to large scans, which would otherwise flush the entire working
+// set.
+template <typename KeyT>
+class tinylfu_eviction_policy final : public eviction_policy<KeyT> {
+ public:
+  using key_type = KeyT;
+
+  static constexpr size_t const kWindowPercent{1};
+  static constexpr size_t const kProtectedPercent{80};
+
+  std::string_view name() const override { return "tinylfu"; }
+
+  void set_capacity(size_t capacity) override {
+    window_max_ = std::max<size_t>(1, capacity * kWindowPercent / 100);
+    main_max_ = capacity > window_max_ ? capacity - window_max_ : 1;
+    protected_max_ = std::max<size_t>(1, main_max_ * kProtectedPercent / 100);
+    sketch_.set_capacity(capacity);
+    index_.reserve(capacity);
+  }
+
+  void insert(key_type const& key) override {
+    sketch_.increment(key);
+    window_.push_front(key);
+    index_[key] = {segment::window, window_.begin()};
+
+    // As long as the main segment isn't full, keys leaving the window
+    // are admitted without competition.
+    while (window_.size() > window_max_ &&
+           probation_.size() + protected_.size() < main_max_) {
+      move_to(index_.find(window_.back())->second, window_, probation_,
+              segment::probation);
+    }
+  }
+
+  void access(key_type const& key) override {
+    sketch_.increment(key);
+
+    auto it = index_.find(key);
+
+    if (it == index_.end()) {
+      return;
+    }
+
+    auto& e = it->second;
+
+    switch (e.seg) {
+    case segment::window:
+      window_.splice(window_.begin(), window_, e.pos);
+      break;
+
+    case segment::probation:
+      move_to(e, probation_, protected_, segment::protected_);
+      trim_protected();
+      break;
+
+    case segment::protected_:
+      protected_.splice(protected_.begin(), protected_, e.pos);
+      break;
+    }
+  }
+
+  void erase(key_type const& key) override {
+    if (auto it = index_.find(key); it != index_.end()) {
+      list_for(it->second.seg).erase(it->second.pos);
+      index_.erase(it);
+    }
+  }
+
+  void clear() override {
+    index_.clear();
+    window_.clear();
+    probation_.clear();
+    protected_.clear();
+  }
+
+  key_type victim() override {
+    while (window_.size() > window_max_) {
+      auto& candidate = index_.find(window_.back())->second;
+
+      if (probation_.empty() && protected_.empty()) {
+        move_to(candidate, window_, probation_, segment::probation);
+        continue;
+      }
+
+      // Copy the main victim, as moving the candidate may invalidate it
+      auto main_victim =
+          probation_.empty() ? protected_.back() : probation_.back();
+
+      if (sketch_.frequency(window_.back()) > sketch_.frequency(main_victim)) {
+        move_to(candidate, window_, probation_, segment::probation);
+        return main_victim;
+      }
+
+      return window_.back();
+    }
+
+    if (!probation_.empty()) {
+      return probation_.back();
+    }
+
+    if (!protected_.empty()) {
+      return protected_.back();
+    }
+
+    return window_.back();
+  }
+
+ private:
+  enum class segment : uint8_t { window, probation, protected_ };
+
+  using list_type = std::list<key_type>;
+
+  struct entry {
+    segment seg;
+    typename list_type::iterator pos;
+  };
+
+  list_type& list_for(segment seg) {
+    switch (seg) {
+    case segment::window:
+      return window_;
+    case segment::probation:
+      return probation_;
+    default:
+      return protected_;
+    }
+  }
+
+  void move_to(entry& e, list_type& from, list_type& to, segment seg) {
+    to.splice(to.begin(), from, e.pos);
+    e.seg = seg;
+  }
+
+  void trim_protected() {
+    while (protected_.size() > protected_max_) {
+      move_to(index_.find(protected_.back())->second, protected_, probation_,
+              segment::probation);
+    }
+  }
+
+  frequency_sketch<key_type> sketch_;
+  size_t window_max_{1};
+  size_t main_max_{1};
+  size_t protected_max_{1};
+  list_type window_;
+  list_type probation_;
+  list_type protected_;
+  phmap::flat_hash_map<key_type, entry> index_;
+};
+
+template <typename KeyT>
+std::unique_ptr<eviction_policy<KeyT>>
+make_eviction_policy(block_cache_eviction_policy policy) {
+  switch (policy) {
+  case block_cache_eviction_policy::TINYLFU:
+    return std::make_unique<tinylfu_eviction_policy<KeyT>>();
+
+  default:
+    return std::make_unique<lru_eviction_policy<KeyT>>();
+  }
+}
+
+// A bounded key/value cache with a pluggable eviction policy. The
+// interface mirrors `lru_cache`, except that iteration order is
+// unspecified.
+template <typename KeyT, typename T>
+class eviction_cache {
+ public:
+  using key_type = KeyT;
+  using mapped_type = T;
+  using policy_type = eviction_policy<key_type>;
+
+  using map_type = phmap::flat_hash_map<key_type, mapped_type>;
+  using iterator = typename map_type::iterator;
+  using const_iterator = typename map_type::const_iterator;
+
+  using prune_hook_type = std::function<void(key_type, mapped_type&&)>;
+
+  explicit eviction_cache(size_t max_size,
+                          std::unique_ptr<policy_type> policy =
+                              std::make_unique<lru_eviction_policy<KeyT>>())
+      : max_size_{max_size}
+      , policy_{std::move(policy)} {
+    policy_->set_capacity(max_size_);
+  }
+
+  // Replace the eviction policy; this clears the cache
+  void set_policy(std::unique_ptr<policy_type> policy) {
+    clear();
+    policy_ = std::move(policy);
+    policy_->set_capacity(max_size_);
+  }
+
+  std::string_view policy_name() const { return policy_->name(); }
+
+  // Set the maximum cache size
+  void set_max_size(size_t max_size) {
+    max_size_ = max_size;
+    policy_->set_capacity(max_size_);
+    while (map_.size() > max_size_) {
+      evict();
+    }
+  }
+
+  // Set a custom prune hook
+  void set_prune_hook(prune_hook_type hook) { prune_hook_ = std::move(hook); }
+
+  // Insert or update an item in the cache
+  void set(key_type const& key, mapped_type value,
+           prune_hook_type const& custom_prune_hook = {}) {
+    if (auto it = map_.find(key); it != map_.end()) {
+      it->second = std::move(value);
+      policy_->access(key);
+    } else {
+      // The new item is inserted *before* evicting, so the policy can
+      // decide whether or not to admit it. The new item itself is never
+      // evicted right away.
+      map_.emplace(key, std::move(value));
+      policy_->insert(key);
+      while (map_.size() > max_size_ && map_.size() > 1) {
+        evict(custom_prune_hook);
+      }
+    }
+  }
+
+  // Find an item, optionally recording the access with the policy
+  iterator find(key_type const& key, bool promote = true) {
+    auto it = map_.find(key);
+    if (promote && it != map_.end()) {
+      policy_->access(key);
+    }
+    return it;
+  }
+
+  iterator erase(iterator pos, prune_hook_type const& custom_prune_hook = {}) {
+    auto key = pos->first;
+    if (custom_prune_hook) {
+      custom_prune_hook(key, std::move(pos->second));
+    } else if (prune_hook_) {
+      prune_hook_(key, std::move(pos->second));
+    }
+    policy_->erase(key);
+    auto next = std::next(pos);
+    map_.erase(pos);
+    return next;
+  }
+
+  // Evict the item selected by the eviction policy, if any
+  void evict(prune_hook_type const& custom_prune_hook = {}) {
+    if (!map_.empty()) {
+      erase(map_.find(policy_->victim()), custom_prune_hook);
+    }
+  }
+
+  void clear() {
+    map_.clear();
+    policy_->clear();
+  }
+
+  bool empty() const { return map_.empty(); }
+
+  size_t size() const { return map_.size(); }
+
+  iterator begin() { return map_.begin(); }
+  iterator end() { return map_.end(); }
+
+  const_iterator begin() const { return map_.begin(); }
+  const_iterator end() const { return map_.end(); }
+
+ private:
+  size_t max_size_;
+  map_type map_;
+  std::unique_ptr<policy_type> policy_;
+  prune_hook_type prune_hook_;
+};
+
+} // namespace dwarfs::reader::internal
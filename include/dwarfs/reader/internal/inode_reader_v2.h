@@ -34,6 +34,7 @@
 #include <span>
 #include <string>
 #include <system_error>
+#include <utility>
 #include <vector>
 
 #include <dwarfs/reader/block_range.h>
@@ -55,6 +56,7 @@ struct iovec_read_buf;
 
 namespace internal {
 
+class block_access_recorder;
 class block_cache;
 
 class inode_reader_v2 {
@@ -106,6 +108,15 @@ class inode_reader_v2 {
     impl_->cache_blocks(blocks);
   }
 
+  void preload_blocks(std::span<size_t const> blocks) const {
+    impl_->preload_blocks(blocks);
+  }
+
+  void
+  set_block_access_recorder(std::shared_ptr<block_access_recorder> recorder) {
+    impl_->set_block_access_recorder(std::move(recorder));
+  }
+
   std::future<block_range>
   read_raw_block_data(size_t block_no, size_t offset, size_t size) const {
     return impl_->read_raw_block_data(block_no, offset, size);
@@ -133,6 +144,9 @@ class inode_reader_v2 {
     virtual void set_cache_tidy_config(cache_tidy_config const& cfg) = 0;
     virtual size_t num_blocks() const = 0;
     virtual void cache_blocks(std::span<size_t const> blocks) const = 0;
+    virtual void preload_blocks(std::span<size_t const> blocks) const = 0;
+    virtual void set_block_access_recorder(
+        std::shared_ptr<block_access_recorder> recorder) = 0;
     virtual std::future<block_range>
     read_raw_block_data(size_t block_no, size_t offset, size_t size) const = 0;
   };
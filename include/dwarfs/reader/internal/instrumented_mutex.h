@@ -0,0 +1,72 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace dwarfs::reader::internal {
+
+// A mutex that keeps track of how often it was acquired, how often
+// it was contended and how long threads had to wait for it.
+class instrumented_mutex {
+ public:
+  std::unique_lock<std::mutex> lock() const {
+    std::unique_lock lock(mx_, std::try_to_lock);
+
+    if (!lock.owns_lock()) {
+      auto const start = std::chrono::steady_clock::now();
+      lock.lock();
+      auto const wait = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start);
+      contended_.fetch_add(1, std::memory_order_relaxed);
+      wait_ns_.fetch_add(wait.count(), std::memory_order_relaxed);
+    }
+
+    acquired_.fetch_add(1, std::memory_order_relaxed);
+
+    return lock;
+  }
+
+  size_t acquired() const { return acquired_.load(); }
+  size_t contended() const { return contended_.load(); }
+  std::chrono::nanoseconds wait() const {
+    return std::chrono::nanoseconds(wait_ns_.load());
+  }
+
+ private:
+  std::mutex mutable mx_;
+  std::atomic<size_t> mutable acquired_{0};
+  std::atomic<size_t> mutable contended_{0};
+  std::atomic<int64_t> mutable wait_ns_{0};
+};
+
+} // namespace dwarfs::reader::internal
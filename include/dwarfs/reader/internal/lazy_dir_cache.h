@@ -0,0 +1,93 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace dwarfs::reader::internal {
+
+/**
+ * Per-directory values for a fixed number of directories, built on demand.
+ * This is safe to use from multiple threads; if two threads race to
+ * build the same value, one of the results is discarded.
+ *
+ * Empty values (as determined by `T::empty()`) are not stored, so
+ * directories that don't need any data don't cost an allocation.
+ */
+template <typename T>
+class lazy_dir_cache {
+ public:
+  explicit lazy_dir_cache(size_t num_dirs)
+      : num_dirs_{num_dirs}
+      , values_{std::make_unique<std::atomic<T const*>[]>(num_dirs)} {}
+
+  ~lazy_dir_cache() {
+    for (size_t i = 0; i < num_dirs_; ++i) {
+      if (auto const* value = values_[i].load(std::memory_order_relaxed);
+          value != &empty_) {
+        delete value;
+      }
+    }
+  }
+
+  lazy_dir_cache(lazy_dir_cache const&) = delete;
+  lazy_dir_cache& operator=(lazy_dir_cache const&) = delete;
+
+  template <typename Builder>
+  T const& get(size_t dir, Builder const& build) const {
+    auto& slot = values_[dir];
+
+    if (auto const* value = slot.load(std::memory_order_acquire)) {
+      return *value;
+    }
+
+    auto value = std::make_unique<T const>(build());
+    T const* desired = value->empty() ? &empty_ : value.get();
+    T const* expected{nullptr};
+
+    if (slot.compare_exchange_strong(expected, desired,
+                                     std::memory_order_acq_rel)) {
+      if (desired == value.get()) {
+        return *value.release();
+      }
+      return *desired;
+    }
+
+    return *expected;
+  }
+
+ private:
+  size_t const num_dirs_;
+  std::unique_ptr<std::atomic<T const*>[]> const values_;
+  T const empty_{};
+};
+
+} // namespace dwarfs::reader::internal
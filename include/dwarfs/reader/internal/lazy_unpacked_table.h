@@ -0,0 +1,122 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include <dwarfs/bit_view.h>
+
+#include <dwarfs/internal/elias_fano.h>
+
+namespace dwarfs::reader::internal {
+
+/**
+ * A table of integers that is unpacked block by block on first access.
+ *
+ * The values of each block are produced by a generator that can decode
+ * any block on its own, so accessing an index only unpacks the block that
+ * contains the index. The generated values must be non-decreasing within
+ * a block; each block is stored using Elias-Fano encoding, which typically
+ * takes only a few bits per value. Unpacking a block is serialized per
+ * block; lookups in blocks that have already been unpacked are lock-free.
+ *
+ * Alternatively, the table can refer to values that have been unpacked
+ * before, e.g. from a memory-mapped cache file.
+ */
+class lazy_unpacked_table {
+ public:
+  // Must fill `out` with the values of block `block` of the table. May be
+  // called concurrently for different blocks.
+  using generator_type =
+      std::function<void(size_t block, std::span<uint32_t> out)>;
+
+  static constexpr size_t block_bits{12};
+  static constexpr size_t block_size{size_t{1} << block_bits};
+
+  static constexpr size_t num_blocks(size_t size) {
+    return (size + block_size - 1) / block_size;
+  }
+
+  lazy_unpacked_table() = default;
+  lazy_unpacked_table(size_t size, size_t bits, generator_type gen);
+  lazy_unpacked_table(size_t size, size_t bits,
+                      std::span<uint32_t const> packed);
+
+  lazy_unpacked_table(lazy_unpacked_table const&) = delete;
+  lazy_unpacked_table& operator=(lazy_unpacked_table const&) = delete;
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  size_t bits() const { return bits_; }
+
+  uint32_t operator[](size_t i) const {
+    assert(i < size_);
+    if (!blocks_) {
+      return bit_view(mapped_.data())
+          .template read<uint32_t>({i * bits_, bits_});
+    }
+    auto& blk = blocks_[i >> block_bits];
+    if (!blk.ready.load(std::memory_order_acquire)) [[unlikely]] {
+      unpack_block(i >> block_bits);
+    }
+    return blk.values[i & (block_size - 1)];
+  }
+
+  void unpack_all() const;
+  bool is_unpacked() const;
+  size_t size_in_bytes() const;
+  std::vector<uint32_t> unpack() const;
+
+ private:
+  struct block {
+    dwarfs::internal::elias_fano values;
+    std::atomic<bool> ready{false};
+    std::once_flag once;
+  };
+
+  void unpack_block(size_t block) const;
+
+  size_t size_{0};
+  size_t bits_{0};
+  size_t num_blocks_{0};
+  std::unique_ptr<block[]> blocks_;
+  std::atomic<size_t> mutable ready_{0};
+  generator_type mutable gen_;
+  std::span<uint32_t const> mapped_;
+};
+
+} // namespace dwarfs::reader::internal
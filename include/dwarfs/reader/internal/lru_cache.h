@@ -30,6 +30,7 @@
 
 #include <functional>
 #include <iterator>
+#include <limits>
 #include <list>
 
 #include <parallel_hashmap/phmap.h>
@@ -83,8 +84,10 @@ class lru_cache {
     }
   }
 
-  // Find an item, optionally promoting it
-  iterator find(key_type const& key, bool promote = true) {
+  // Find an item, optionally promoting it; `K` can be any type that can
+  // be looked up transparently in the index
+  template <typename K = key_type>
+  iterator find(K const& key, bool promote = true) {
     auto it = index_.find(key);
     if (it == index_.end()) {
       return end();
@@ -112,6 +115,13 @@ class lru_cache {
     cache_.clear();
   }
 
+  // Evict the least recently used item, if any
+  void evict_lru(prune_hook_type const& custom_prune_hook = {}) {
+    if (auto it = cache_.end(); it != cache_.begin()) {
+      erase(--it, custom_prune_hook);
+    }
+  }
+
   bool empty() const { return cache_.empty(); }
 
   size_t size() const { return cache_.size(); }
@@ -126,14 +136,7 @@ class lru_cache {
   // Move the accessed item to the front of the cache (most recently used)
   void move_to_front(iterator it) { cache_.splice(cache_.begin(), cache_, it); }
 
-  // Evict the least recently used item
-  void evict_lru(prune_hook_type const& custom_prune_hook = {}) {
-    if (auto it = cache_.end(); it != cache_.begin()) {
-      erase(--it, custom_prune_hook);
-    }
-  }
-
-  size_t max_size_;
+  size_t max_size_{std::numeric_limits<size_t>::max()};
   phmap::flat_hash_map<key_type, iterator> index_;
   std::list<value_type> cache_;
   prune_hook_type prune_hook_;
@@ -0,0 +1,122 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <dwarfs/bit_view.h>
+#include <dwarfs/file_view.h>
+
+#include <dwarfs/internal/packed_int_vector.h>
+
+namespace dwarfs::reader::internal {
+
+/**
+ * Tables derived from the frozen metadata, persisted in a sidecar file.
+ *
+ * Tables are stored in the same bit-packed layout used in memory, so a
+ * loaded cache is used directly from the mapped file instead of being
+ * rebuilt. A cache file is keyed by the checksum of the metadata section
+ * and is ignored if the key or the checksum of its contents doesn't match.
+ */
+class metadata_cache {
+ public:
+  enum class table_id : uint32_t {
+    chunk_table = 1,
+    shared_files = 2,
+    nlink_minus_one = 3,
+    icase_dir_offsets = 4,
+    icase_order = 5,
+  };
+
+  class table_view {
+   public:
+    table_view() = default;
+    table_view(size_t size, size_t bits, std::span<uint32_t const> data)
+        : size_{size}
+        , bits_{bits}
+        , data_{data} {}
+
+    size_t size() const { return size_; }
+    size_t bits() const { return bits_; }
+    bool empty() const { return size_ == 0; }
+    std::span<uint32_t const> data() const { return data_; }
+
+    uint32_t operator[](size_t i) const {
+      return bit_view(data_.data()).template read<uint32_t>({i * bits_, bits_});
+    }
+
+    dwarfs::internal::packed_int_vector<uint32_t> to_packed() const;
+
+   private:
+    size_t size_{0};
+    size_t bits_{0};
+    std::span<uint32_t const> data_;
+  };
+
+  metadata_cache() = default;
+
+  metadata_cache(metadata_cache const&) = delete;
+  metadata_cache& operator=(metadata_cache const&) = delete;
+  metadata_cache(metadata_cache&&) = default;
+  metadata_cache& operator=(metadata_cache&&) = default;
+
+  // Returns nullptr if `mm` isn't a valid cache for `key`.
+  static std::shared_ptr<metadata_cache const>
+  load(file_view const& mm, uint64_t key);
+
+  std::optional<table_view> find(table_id id) const;
+  bool contains(table_id id) const { return tables_.contains(id); }
+
+  std::optional<uint64_t> total_hardlink_size() const {
+    return total_hardlink_size_;
+  }
+
+  void add(table_id id, dwarfs::internal::packed_int_vector<uint32_t> vec);
+  void set_total_hardlink_size(uint64_t size) { total_hardlink_size_ = size; }
+
+  // Writes to a uniquely named temporary file that is renamed to `path`
+  // once complete. Throws on error.
+  void write(std::filesystem::path const& path, uint64_t key) const;
+
+ private:
+  file_view mm_;
+  std::map<table_id, table_view> tables_;
+  std::vector<dwarfs::internal::packed_int_vector<uint32_t>> owned_;
+  std::optional<uint64_t> total_hardlink_size_;
+};
+
+} // namespace dwarfs::reader::internal
@@ -33,6 +33,7 @@
 #include <cstdint>
 #include <filesystem>
 #include <string>
+#include <string_view>
 #include <variant>
 
 #include <boost/iterator/iterator_facade.hpp>
@@ -44,6 +45,7 @@
 #include <dwarfs/metadata_defs.h>
 #include <dwarfs/types.h>
 
+#include <dwarfs/internal/elias_fano.h>
 #include <dwarfs/internal/packed_ptr.h>
 #include <dwarfs/internal/string_table.h>
 
@@ -84,6 +86,7 @@ class global_metadata {
 
  private:
   Meta const& meta_;
+  dwarfs::internal::elias_fano const first_entries_;
   std::optional<bundled_directories_view> const bundled_directories_;
   directories_view const directories_;
   dwarfs::internal::string_table const names_;
@@ -163,8 +166,11 @@ class dir_entry_view_impl {
                        entry_name_type name_type = entry_name_type::other);
 
   static std::string name(uint32_t index, global_metadata const& g);
+  static std::string_view
+  name(uint32_t index, global_metadata const& g, std::string& scratch);
 
   std::string name() const;
+  std::string_view name(std::string& scratch) const;
   std::shared_ptr<inode_view_impl> inode_shared() const;
   inode_view_impl inode() const;
 
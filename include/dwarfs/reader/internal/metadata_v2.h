@@ -67,6 +67,7 @@ struct metadata_options;
 
 namespace internal {
 
+class metadata_cache;
 class metadata_v2_data;
 
 class metadata_v2 {
@@ -79,7 +80,8 @@ class metadata_v2 {
       logger& lgr, std::span<uint8_t const> schema,
       std::span<uint8_t const> data, metadata_options const& options,
       int inode_offset = 0, bool force_consistency_check = false,
-      std::shared_ptr<performance_monitor const> const& perfmon = nullptr);
+      std::shared_ptr<performance_monitor const> const& perfmon = nullptr,
+      std::shared_ptr<metadata_cache const> cache = nullptr);
 
   void check_consistency() const { impl_->check_consistency(); }
 
@@ -89,6 +91,16 @@ class metadata_v2 {
     impl_->walk(func);
   }
 
+  void walk_with_path(
+      std::function<void(dir_entry_view, std::string_view)> const& func) const {
+    impl_->walk_with_path(func);
+  }
+
+  void walk_data_order_with_path(
+      std::function<void(dir_entry_view, std::string_view)> const& func) const {
+    impl_->walk_data_order_with_path(func);
+  }
+
   dir_entry_view_iterable directory_entries() const {
     return impl_->directory_entries();
   }
@@ -127,6 +139,19 @@ class metadata_v2 {
     return impl_->readdir(dir, offset);
   }
 
+  void readdir(
+      directory_view dir, size_t offset,
+      std::function<bool(dir_entry_view, std::string_view)> const& func) const {
+    impl_->readdir(dir, offset, func);
+  }
+
+  void readdirplus(directory_view dir, size_t offset,
+                   std::function<bool(dir_entry_view, std::string_view,
+                                      file_stat const&)> const& func,
+                   std::error_code& ec) const {
+    impl_->readdirplus(dir, offset, func, ec);
+  }
+
   size_t dirsize(directory_view dir) const { return impl_->dirsize(dir); }
 
   void access(inode_view iv, int mode, file_stat::uid_type uid,
@@ -204,6 +229,12 @@ class metadata_v2 {
 
     virtual void
     walk(std::function<void(dir_entry_view)> const& func) const = 0;
+    virtual void walk_with_path(
+        std::function<void(dir_entry_view, std::string_view)> const& func)
+        const = 0;
+    virtual void walk_data_order_with_path(
+        std::function<void(dir_entry_view, std::string_view)> const& func)
+        const = 0;
 
     virtual dir_entry_view_iterable directory_entries() const = 0;
     virtual dir_entry_view_iterable entries_in_data_order() const = 0;
@@ -223,6 +254,15 @@ class metadata_v2 {
 
     virtual std::optional<dir_entry_view>
     readdir(directory_view dir, size_t offset) const = 0;
+    virtual void
+    readdir(directory_view dir, size_t offset,
+            std::function<bool(dir_entry_view, std::string_view)> const& func)
+        const = 0;
+    virtual void readdirplus(
+        directory_view dir, size_t offset,
+        std::function<bool(dir_entry_view, std::string_view,
+                           file_stat const&)> const& func,
+        std::error_code& ec) const = 0;
 
     virtual size_t dirsize(directory_view dir) const = 0;
 
@@ -293,6 +333,12 @@ class metadata_v2_utils {
 
   std::unique_ptr<thrift::metadata::fs_options> thaw_fs_options() const;
 
+  // True if all derived tables are taken from the metadata cache
+  bool has_complete_cache() const;
+
+  // Builds all derived tables for writing them to a metadata cache
+  metadata_cache build_cache() const;
+
  private:
   metadata_v2_data const& data_;
 };
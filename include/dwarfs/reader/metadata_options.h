@@ -40,6 +40,15 @@ struct metadata_options {
   bool readonly{false};
   bool check_consistency{false};
   bool case_insensitive_lookup{false};
+  // Directories with at least this many entries get a hash index for
+  // name lookups, which is built on first access. Zero disables this.
+  size_t lookup_index_min_entries{64};
+  // Defer unpacking of derived tables (chunk table, shared files table,
+  // hardlink counts, case-insensitive directory order) until first use.
+  bool lazy_init{false};
+  // Maximum number of resolved directory paths to keep around for
+  // `find(path)` lookups. Zero disables the cache.
+  size_t path_cache_size{0};
   size_t block_size{512};
   std::optional<file_stat::uid_type> fs_uid{};
   std::optional<file_stat::gid_type> fs_gid{};
@@ -34,6 +34,7 @@
 #include <optional>
 #include <span>
 #include <string>
+#include <string_view>
 
 #include <boost/range/irange.hpp>
 
@@ -94,6 +95,9 @@ class dir_entry_view {
       : impl_{std::move(impl)} {}
 
   std::string name() const;
+  // Allocation-free variant; the returned view may point into `scratch`
+  // and is only valid as long as `scratch` is not modified.
+  std::string_view name(std::string& scratch) const;
   inode_view inode() const;
 
   bool is_root() const;
@@ -32,6 +32,9 @@ struct filesystem_writer_options {
   size_t worst_case_block_size{4 << 20};
   bool remove_header{false};
   bool no_section_index{false};
+  // Store blocks as independently decompressible sub-frames of this size
+  // (0 = disabled), which allows random access within large blocks
+  size_t subframe_size{0};
 };
 
 } // namespace dwarfs::writer
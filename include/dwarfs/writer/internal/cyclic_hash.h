@@ -23,8 +23,10 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <stdexcept>
+#include <string_view>
 
 #include <dwarfs/compiler.h>
 
@@ -56,6 +58,15 @@ class rsync_hash {
     len_ = 0;
   }
 
+  // Slides the (full) window across `count` bytes, i.e. `p[i]` enters and
+  // `p[i - window_size]` leaves the window, and stores the hash value after
+  // each step in `hashes[i]`. Equivalent to calling `update(outbyte, inbyte)`
+  // `count` times, but computes multiple hash values at once if possible.
+  void roll(uint8_t const* p, size_t count, uint32_t* hashes);
+
+  // Name of the implementation used by `roll()`
+  static std::string_view roll_implementation();
+
   static DWARFS_FORCE_INLINE constexpr uint32_t
   repeating_window(uint8_t byte, size_t length) {
     auto v = static_cast<uint16_t>(byte);
@@ -105,6 +105,9 @@ class filesystem_writer_detail {
       std::optional<fragment_category::value_type> cat = std::nullopt) = 0;
   virtual void write_compressed_section(dwarfs::internal::fs_section const& sec,
                                         file_segment segment) = 0;
+  // Framed compressors are detected automatically, but copied FRAMED
+  // sections must be announced before the first section is written
+  virtual void mark_framed_blocks() = 0;
   virtual void flush() = 0;
   virtual size_t size() const = 0;
 };
@@ -0,0 +1,138 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <parallel_hashmap/phmap.h>
+
+#include <dwarfs/file_util.h>
+
+namespace dwarfs::writer::internal {
+
+/**
+ * Index mapping chunk fingerprints to chunk locations
+ *
+ * Entries are kept in an in-memory hash table until it exceeds the
+ * configured memory limit. The table is then sorted and written to a
+ * run file in a temporary directory. Each run keeps a bloom filter and
+ * the first fingerprint of each page in memory, so a lookup of a missing
+ * fingerprint usually doesn't touch the disk at all, and a lookup of an
+ * existing fingerprint reads a single page. Once there are too many runs,
+ * they are merged into a single run.
+ *
+ * The memory kept for spilled runs counts against the memory limit, so
+ * the in-memory table shrinks as more entries are spilled. It never drops
+ * below `kMinMemoryFraction` of the limit, though, so a very large index
+ * can exceed the limit.
+ */
+class fingerprint_index {
+ public:
+  struct fingerprint {
+    uint64_t lo{0};
+    uint64_t hi{0};
+
+    auto operator<=>(fingerprint const&) const = default;
+  };
+
+  struct location {
+    uint32_t block{0};
+    uint32_t offset{0};
+    uint32_t size{0};
+  };
+
+  struct stats {
+    size_t entries{0};
+    size_t spilled_entries{0};
+    size_t spills{0};
+    size_t merges{0};
+    size_t page_reads{0};
+    size_t bloom_false_positives{0};
+  };
+
+  // Approximate memory used per in-memory entry
+  static constexpr size_t kMemoryPerEntry{48};
+
+  // Minimum fraction of the memory limit reserved for the in-memory table
+  static constexpr size_t kMinMemoryFraction{8};
+
+  // Runs are stored in a temporary directory below `spill_dir`, or below
+  // the system temporary directory if `spill_dir` is empty.
+  explicit fingerprint_index(size_t memory_limit,
+                             std::filesystem::path spill_dir = {});
+  ~fingerprint_index();
+
+  fingerprint_index(fingerprint_index const&) = delete;
+  fingerprint_index& operator=(fingerprint_index const&) = delete;
+
+  static fingerprint compute(void const* data, size_t size);
+
+  std::optional<location> find(fingerprint const& fp);
+
+  // `fp` must not already be in the index
+  void insert(fingerprint const& fp, location const& loc);
+
+  stats const& get_stats() const { return stats_; }
+
+  size_t memory_usage() const;
+  size_t run_memory_usage() const { return run_memory_; }
+
+ private:
+  struct entry {
+    fingerprint fp;
+    location loc;
+    uint32_t reserved{0};
+  };
+
+  struct fingerprint_hash {
+    size_t operator()(fingerprint const& fp) const noexcept {
+      return static_cast<size_t>(fp.lo);
+    }
+  };
+
+  class run;
+
+  void spill();
+  void merge_runs();
+  void update_memory_budget();
+  std::filesystem::path next_run_path();
+
+  size_t const memory_limit_;
+  std::filesystem::path const spill_dir_;
+  size_t max_memory_entries_;
+  size_t run_memory_{0};
+  phmap::flat_hash_map<fingerprint, location, fingerprint_hash> memory_;
+  std::optional<temporary_directory> tmpdir_;
+  std::vector<std::unique_ptr<run>> runs_;
+  size_t next_run_id_{0};
+  stats stats_;
+};
+
+} // namespace dwarfs::writer::internal
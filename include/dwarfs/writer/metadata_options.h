@@ -62,6 +62,7 @@ struct metadata_options {
   bool enable_sparse_files{false};
   bool no_hardlink_table{false};
   size_t inode_size_cache_min_chunk_count{128};
+  bool complete_inode_size_cache{false};
 
   static void validate(metadata_options const& opts);
 };
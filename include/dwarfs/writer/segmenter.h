@@ -25,6 +25,7 @@
 
 #include <cstddef>
 #include <functional>
+#include <filesystem>
 #include <memory>
 #include <vector>
 
@@ -50,6 +51,14 @@ class chunkable;
 
 class segmenter {
  public:
+  enum class algorithm {
+    // Match against a bounded lookback of active blocks using a
+    // rolling hash window
+    rolling_hash,
+    // Content-defined chunking with a global fingerprint index
+    cdc,
+  };
+
   struct config {
     std::string context{};
     unsigned blockhash_window_size{12};
@@ -58,6 +67,12 @@ class segmenter {
     unsigned bloom_filter_size{4};
     unsigned block_size_bits{22};
     bool enable_sparse_files{false};
+    size_t num_hash_workers{0};
+    size_t min_byte_run_size{0};
+    algorithm algo{algorithm::rolling_hash};
+    unsigned cdc_chunk_size_bits{16};
+    size_t cdc_index_memory{static_cast<size_t>(256) << 20};
+    std::filesystem::path cdc_spill_dir{};
   };
 
   using block_ready_cb =
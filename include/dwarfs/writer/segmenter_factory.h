@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <filesystem>
 #include <memory>
 
 #include <dwarfs/types.h>
@@ -49,6 +50,12 @@ class segmenter_factory {
     categorized_option<unsigned> bloom_filter_size;
     unsigned block_size_bits{22};
     bool enable_sparse_files{false};
+    size_t num_hash_workers{0};
+    size_t min_byte_run_size{0};
+    segmenter::algorithm algo{segmenter::algorithm::rolling_hash};
+    unsigned cdc_chunk_size_bits{16};
+    size_t cdc_index_memory{static_cast<size_t>(256) << 20};
+    std::filesystem::path cdc_spill_dir{};
   };
 
   segmenter_factory(logger& lgr, writer_progress& prog);
@@ -29,10 +29,18 @@
 #include <dwarfs/block_compressor.h>
 #include <dwarfs/compressor_registry.h>
 
+#include "compression/framed.h"
+
 namespace dwarfs {
 
 block_compressor::block_compressor(std::string const& spec) {
   impl_ = compressor_registry::instance().create(spec);
 }
 
+block_compressor block_compressor::with_subframes(size_t subframe_size) const {
+  block_compressor bc;
+  bc.impl_ = make_framed_block_compressor(impl_->clone(), subframe_size);
+  return bc;
+}
+
 } // namespace dwarfs
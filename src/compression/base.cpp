@@ -54,4 +54,12 @@ std::optional<std::string> block_decompressor_base::metadata() const {
   return std::nullopt;
 }
 
+size_t block_decompressor_base::num_subframes() const { return 0; }
+
+size_t block_decompressor_base::subframe_size() const { return 0; }
+
+void block_decompressor_base::decompress_subframe(size_t /*index*/) {
+  DWARFS_THROW(runtime_error, "block has no sub-frames");
+}
+
 } // namespace dwarfs
@@ -34,6 +34,9 @@ class block_decompressor_base : public block_decompressor::impl {
  public:
   void start_decompression(mutable_byte_buffer target) override;
   std::optional<std::string> metadata() const override;
+  size_t num_subframes() const override;
+  size_t subframe_size() const override;
+  void decompress_subframe(size_t index) override;
 
  protected:
   mutable_byte_buffer decompressed_;
@@ -0,0 +1,393 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <dwarfs/error.h>
+#include <dwarfs/fstypes.h>
+#include <dwarfs/malloc_byte_buffer.h>
+#include <dwarfs/util.h>
+#include <dwarfs/varint.h>
+
+#include "base.h"
+#include "framed.h"
+
+namespace dwarfs {
+
+namespace {
+
+// Read-only view of a single sub-frame of the input block, so sub-frames
+// can be passed to the inner compressor without copying them.
+class subframe_view_buffer final : public byte_buffer_interface {
+ public:
+  subframe_view_buffer(shared_byte_buffer block, size_t offset, size_t size)
+      : block_{std::move(block)}
+      , span_{block_.span().subspan(offset, size)} {}
+
+  uint8_t const* data() const override { return span_.data(); }
+
+  size_t size() const override { return span_.size(); }
+
+  size_t capacity() const override { return span_.size(); }
+
+  std::span<uint8_t const> span() const override { return span_; }
+
+ private:
+  shared_byte_buffer block_;
+  std::span<uint8_t const> span_;
+};
+
+// Fixed window into the decompressed block that an inner decompressor
+// writes a single sub-frame into.
+class subframe_target_buffer final : public mutable_byte_buffer_interface {
+ public:
+  subframe_target_buffer(uint8_t* data, size_t capacity)
+      : data_{data}
+      , capacity_{capacity} {}
+
+  size_t size() const override { return size_; }
+
+  size_t capacity() const override { return capacity_; }
+
+  uint8_t const* data() const override { return data_; }
+
+  uint8_t* mutable_data() override { return data_; }
+
+  std::span<uint8_t const> span() const override { return {data_, size_}; }
+
+  std::span<uint8_t> mutable_span() override { return {data_, size_}; }
+
+  void clear() override { size_ = 0; }
+
+  void reserve(size_t size) override {
+    if (size > capacity_) {
+      frozen_error("reserve");
+    }
+  }
+
+  void resize(size_t size) override {
+    if (size > capacity_) {
+      frozen_error("resize beyond capacity");
+    }
+    size_ = size;
+  }
+
+  void shrink_to_fit() override {
+    // capacity is fixed
+  }
+
+  void freeze_location() override {
+    // always frozen
+  }
+
+  void append(void const* data, size_t size) override {
+    if (size_ + size > capacity_) {
+      frozen_error("append beyond capacity");
+    }
+    std::memcpy(data_ + size_, data, size);
+    size_ += size;
+  }
+
+  internal::malloc_buffer& raw_buffer() override {
+    frozen_error("raw_buffer");
+  }
+
+ private:
+  [[noreturn]] static void frozen_error(std::string_view what) {
+    DWARFS_THROW(runtime_error,
+                 fmt::format("operation not allowed on sub-frame: {}", what));
+  }
+
+  uint8_t* data_;
+  size_t const capacity_;
+  size_t size_{0};
+};
+
+void append_varint(mutable_byte_buffer& buf, uint64_t value) {
+  std::array<uint8_t, varint::max_size> tmp;
+  auto const len = varint::encode(value, tmp.data());
+  buf.append(tmp.data(), len);
+}
+
+class framed_block_compressor final : public block_compressor::impl {
+ public:
+  framed_block_compressor(std::unique_ptr<block_compressor::impl> inner,
+                          size_t subframe_size)
+      : inner_{std::move(inner)}
+      , subframe_size_{subframe_size} {}
+
+  framed_block_compressor(framed_block_compressor const& rhs)
+      : inner_{rhs.inner_->clone()}
+      , subframe_size_{rhs.subframe_size_} {}
+
+  std::unique_ptr<block_compressor::impl> clone() const override {
+    return std::make_unique<framed_block_compressor>(*this);
+  }
+
+  shared_byte_buffer compress(shared_byte_buffer const& data,
+                              std::string const* metadata) const override {
+    std::vector<shared_byte_buffer> frames;
+    size_t frames_size{0};
+
+    frames.reserve((data.size() + subframe_size_ - 1) / subframe_size_);
+
+    for (size_t offset = 0; offset < data.size(); offset += subframe_size_) {
+      auto const size = std::min(subframe_size_, data.size() - offset);
+      auto frame = shared_byte_buffer{
+          std::make_shared<subframe_view_buffer>(data, offset, size)};
+
+      try {
+        auto compressed = inner_->compress(frame, metadata);
+
+        if (compressed.size() < size) {
+          frame = std::move(compressed);
+        }
+      } catch (bad_compression_ratio_error const&) {
+        // store this sub-frame uncompressed
+      }
+
+      frames_size += frame.size();
+      frames.push_back(std::move(frame));
+    }
+
+    auto compressed = malloc_byte_buffer::create();
+    compressed.reserve((frames.size() + 3) * varint::max_size + frames_size);
+
+    append_varint(compressed, static_cast<uint64_t>(inner_->type()));
+    append_varint(compressed, data.size());
+    append_varint(compressed, subframe_size_);
+
+    for (auto const& frame : frames) {
+      append_varint(compressed, frame.size());
+    }
+
+    for (auto const& frame : frames) {
+      compressed.append(frame);
+    }
+
+    if (compressed.size() >= data.size()) {
+      throw bad_compression_ratio_error();
+    }
+
+    compressed.shrink_to_fit();
+
+    return compressed.share();
+  }
+
+  compression_type type() const override { return compression_type::FRAMED; }
+
+  std::string describe() const override {
+    return fmt::format("{}, {} sub-frames", inner_->describe(),
+                       size_with_unit(subframe_size_));
+  }
+
+  std::string metadata_requirements() const override {
+    return inner_->metadata_requirements();
+  }
+
+  compression_constraints
+  get_compression_constraints(std::string const& metadata) const override {
+    return inner_->get_compression_constraints(metadata);
+  }
+
+  size_t estimate_memory_usage(size_t data_size) const override {
+    return inner_->estimate_memory_usage(std::min(data_size, subframe_size_)) +
+           data_size;
+  }
+
+ private:
+  std::unique_ptr<block_compressor::impl> inner_;
+  size_t const subframe_size_;
+};
+
+class framed_block_decompressor final : public block_decompressor_base {
+ public:
+  explicit framed_block_decompressor(std::span<uint8_t const> data) {
+    try {
+      auto const type = varint::decode(data);
+
+      inner_type_ = static_cast<compression_type>(type);
+
+      if (type > std::numeric_limits<uint16_t>::max() ||
+          !is_known_compression_type(inner_type_) ||
+          inner_type_ == compression_type::NONE ||
+          inner_type_ == compression_type::FRAMED) {
+        DWARFS_THROW(runtime_error,
+                     fmt::format("invalid sub-frame compression type {}",
+                                 type));
+      }
+
+      uncompressed_size_ = varint::decode(data);
+      subframe_size_ = varint::decode(data);
+
+      if (subframe_size_ == 0 && uncompressed_size_ > 0) {
+        DWARFS_THROW(runtime_error, "invalid sub-frame size 0");
+      }
+
+      auto const num_frames = uncompressed_size_ > 0
+                                  ? (uncompressed_size_ - 1) / subframe_size_ + 1
+                                  : 0;
+
+      // Every index entry takes at least one byte
+      if (num_frames > data.size()) {
+        DWARFS_THROW(runtime_error, "truncated sub-frame index");
+      }
+
+      offsets_.reserve(num_frames + 1);
+      offsets_.push_back(0);
+
+      for (size_t i = 0; i < num_frames; ++i) {
+        auto const size = varint::decode(data);
+
+        if (size > data.size() || offsets_.back() + size > data.size()) {
+          DWARFS_THROW(runtime_error, "truncated framed block");
+        }
+
+        offsets_.push_back(offsets_.back() + size);
+      }
+
+      if (offsets_.back() > data.size()) {
+        DWARFS_THROW(runtime_error, "truncated framed block");
+      }
+
+      frames_ = data.first(offsets_.back());
+    } catch (std::system_error const&) {
+      DWARFS_THROW(runtime_error, "truncated framed block header");
+    }
+  }
+
+  compression_type type() const override { return compression_type::FRAMED; }
+
+  void start_decompression(mutable_byte_buffer target) override {
+    block_decompressor_base::start_decompression(std::move(target));
+
+    // Sub-frames are decompressed in place, possibly out of order
+    decompressed_.resize(uncompressed_size_);
+  }
+
+  bool decompress_frame(size_t frame_size) override {
+    DWARFS_CHECK(decompressed_, "decompression not started");
+
+    size_t decompressed{0};
+
+    while (next_frame_ < num_subframes() && decompressed < frame_size) {
+      decompress_subframe(next_frame_);
+      decompressed += subframe_size_;
+      ++next_frame_;
+    }
+
+    return next_frame_ == num_subframes();
+  }
+
+  size_t uncompressed_size() const override { return uncompressed_size_; }
+
+  size_t num_subframes() const override { return offsets_.size() - 1; }
+
+  size_t subframe_size() const override { return subframe_size_; }
+
+  void decompress_subframe(size_t index) override {
+    DWARFS_CHECK(decompressed_, "decompression not started");
+    DWARFS_CHECK(index < num_subframes(), "sub-frame index out of range");
+
+    auto const offset = index * subframe_size_;
+    auto const size = std::min(subframe_size_, uncompressed_size_ - offset);
+    auto const frame =
+        frames_.subspan(offsets_[index], offsets_[index + 1] - offsets_[index]);
+    auto* const target = decompressed_.data() + offset;
+
+    if (frame.size() == size) {
+      std::memcpy(target, frame.data(), size);
+      return;
+    }
+
+    block_decompressor bd(inner_type_, frame);
+
+    if (bd.uncompressed_size() != size) {
+      DWARFS_THROW(runtime_error,
+                   fmt::format("unexpected size for sub-frame {}: {} != {}",
+                               index, bd.uncompressed_size(), size));
+    }
+
+    bd.start_decompression(mutable_byte_buffer{
+        std::make_shared<subframe_target_buffer>(target, size)});
+
+    while (!bd.decompress_frame(size)) {
+    }
+  }
+
+ private:
+  compression_type inner_type_{compression_type::NONE};
+  size_t uncompressed_size_{0};
+  size_t subframe_size_{0};
+  std::vector<size_t> offsets_;
+  std::span<uint8_t const> frames_;
+  size_t next_frame_{0};
+};
+
+} // namespace
+
+std::unique_ptr<block_compressor::impl>
+make_framed_block_compressor(std::unique_ptr<block_compressor::impl> inner,
+                             size_t subframe_size) {
+  if (subframe_size == 0) {
+    DWARFS_THROW(runtime_error, "sub-frame size must not be zero");
+  }
+
+  if (inner->type() == compression_type::NONE ||
+      inner->type() == compression_type::FRAMED) {
+    DWARFS_THROW(runtime_error,
+                 fmt::format("cannot use '{}' for sub-frames",
+                             inner->describe()));
+  }
+
+  if (!inner->metadata_requirements().empty()) {
+    DWARFS_THROW(runtime_error,
+                 fmt::format("cannot use '{}' for sub-frames because it "
+                             "requires compression metadata",
+                             inner->describe()));
+  }
+
+  return std::make_unique<framed_block_compressor>(std::move(inner),
+                                                   subframe_size);
+}
+
+std::unique_ptr<block_decompressor::impl>
+make_framed_block_decompressor(std::span<uint8_t const> data) {
+  return std::make_unique<framed_block_decompressor>(data);
+}
+
+} // namespace dwarfs
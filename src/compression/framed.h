@@ -0,0 +1,65 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+#include <dwarfs/block_compressor.h>
+#include <dwarfs/block_decompressor.h>
+
+namespace dwarfs {
+
+/**
+ * Framed blocks are split into sub-frames of a fixed uncompressed size,
+ * each of which is compressed independently by an inner compressor.
+ * A small seek index at the start of the block allows each sub-frame to
+ * be located and decompressed without touching any of the others.
+ *
+ * Layout (all integers are varints):
+ *
+ *   inner compression type
+ *   uncompressed block size
+ *   uncompressed sub-frame size
+ *   compressed size of each sub-frame
+ *   compressed sub-frames
+ *
+ * A sub-frame whose compressed size equals its uncompressed size is
+ * stored as-is.
+ */
+std::unique_ptr<block_compressor::impl>
+make_framed_block_compressor(std::unique_ptr<block_compressor::impl> inner,
+                             size_t subframe_size);
+
+std::unique_ptr<block_decompressor::impl>
+make_framed_block_decompressor(std::span<uint8_t const> data);
+
+} // namespace dwarfs
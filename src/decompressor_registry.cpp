@@ -30,6 +30,7 @@
 #include <dwarfs/error.h>
 #include <dwarfs/fstypes.h>
 
+#include "compression/framed.h"
 #include "compression_registry.h"
 
 namespace dwarfs {
@@ -51,6 +52,12 @@ decompressor_registry& decompressor_registry::instance() {
 std::unique_ptr<block_decompressor::impl>
 decompressor_registry::create(compression_type type,
                               std::span<uint8_t const> data) const {
+  // Framed blocks are a container for blocks of any other type rather
+  // than an algorithm of their own
+  if (type == compression_type::FRAMED) {
+    return make_framed_block_decompressor(data);
+  }
+
   return get_factory(type).create(data);
 }
 
@@ -28,6 +28,7 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <fstream>
 #include <limits>
 #include <stdexcept>
 #include <string>
@@ -58,13 +59,17 @@ namespace fs = std::filesystem;
 
 namespace {
 
-fs::path make_tempdir_path(std::string_view prefix) {
+std::string random_uuid() {
   static thread_local boost::uuids::random_generator gen;
-  auto dirname = boost::uuids::to_string(gen());
+  return boost::uuids::to_string(gen());
+}
+
+fs::path make_tempdir_path(std::string_view prefix, fs::path const& parent) {
+  auto dirname = random_uuid();
   if (!prefix.empty()) {
     dirname = std::string(prefix) + '.' + dirname;
   }
-  return fs::temp_directory_path() / dirname;
+  return parent / dirname;
 }
 
 bool keep_temporary_directories() {
@@ -162,11 +167,63 @@ class file_descriptor {
 
 } // namespace
 
+fs::path unique_temporary_path(fs::path const& path, std::string_view suffix) {
+  auto tmp = path;
+  tmp += '.' + random_uuid();
+  tmp += suffix;
+  return tmp;
+}
+
+void replace_file(fs::path const& path, std::string_view tmp_suffix,
+                  std::function<void(std::ostream&)> const& write,
+                  std::error_code& ec) {
+  ec.clear();
+
+  auto const tmp_path = unique_temporary_path(path, tmp_suffix);
+
+  auto remove_tmp = [&] {
+    std::error_code ignored;
+    fs::remove(tmp_path, ignored);
+  };
+
+  {
+    std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+
+    if (ofs) {
+      try {
+        write(ofs);
+      } catch (...) {
+        ofs.close();
+        remove_tmp();
+        throw;
+      }
+    }
+
+    ofs.close();
+
+    if (!ofs.good()) {
+      ec = std::make_error_code(std::errc::io_error);
+    }
+  }
+
+  if (!ec) {
+    fs::rename(tmp_path, path, ec);
+  }
+
+  if (ec) {
+    remove_tmp();
+  }
+}
+
 temporary_directory::temporary_directory()
     : temporary_directory(std::string_view{}) {}
 
 temporary_directory::temporary_directory(std::string_view prefix)
-    : path_{make_tempdir_path(prefix)} {
+    : temporary_directory(prefix, fs::temp_directory_path()) {}
+
+temporary_directory::temporary_directory(std::string_view prefix,
+                                         fs::path const& parent)
+    : path_{make_tempdir_path(prefix, parent)} {
   fs::create_directory(path_);
 }
 
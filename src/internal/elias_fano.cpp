@@ -0,0 +1,110 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <dwarfs/error.h>
+
+#include <dwarfs/internal/elias_fano.h>
+
+namespace dwarfs::internal {
+
+elias_fano::builder::builder(size_t size, uint32_t first, uint32_t last) {
+  DWARFS_CHECK(first <= last, "invalid elias-fano value range");
+
+  auto& ef = ef_;
+  auto const range = static_cast<uint64_t>(last - first) + 1;
+
+  ef.size_ = size;
+  ef.base_ = first;
+  ef.low_bits_ =
+      size > 0 && range > size ? std::bit_width(range / size) - 1 : 0;
+  ef.lower_.reset(ef.low_bits_, size);
+
+  auto const upper_bits = size + (range >> ef.low_bits_) + 1;
+  ef.upper_.resize((upper_bits + 63) / 64);
+  ef.samples_.reserve((size + select_sample - 1) / select_sample);
+
+  prev_ = first;
+}
+
+void elias_fano::builder::push_back(uint32_t value) {
+  DWARFS_CHECK(pos_ < ef_.size_, "too many elias-fano values");
+  DWARFS_CHECK(value >= prev_, "elias-fano values must be non-decreasing");
+
+  auto const v = value - ef_.base_;
+  auto const bit = (static_cast<size_t>(v) >> ef_.low_bits_) + pos_;
+
+  ef_.upper_[bit / 64] |= uint64_t{1} << (bit % 64);
+  ef_.lower_.set(pos_, v & ((uint64_t{1} << ef_.low_bits_) - 1));
+
+  if (pos_ % select_sample == 0) {
+    ef_.samples_.push_back(static_cast<uint32_t>(bit));
+  }
+
+  prev_ = value;
+  ++pos_;
+}
+
+elias_fano elias_fano::builder::build() {
+  DWARFS_CHECK(pos_ == ef_.size_, "too few elias-fano values");
+  return std::move(ef_);
+}
+
+elias_fano::elias_fano(std::span<uint32_t const> values) {
+  if (!values.empty()) {
+    builder b(values.size(), values.front(), values.back());
+    for (auto v : values) {
+      b.push_back(v);
+    }
+    *this = b.build();
+  }
+}
+
+size_t elias_fano::size_in_bytes() const {
+  return upper_.size() * sizeof(upper_[0]) + lower_.size_in_bytes() +
+         samples_.size() * sizeof(samples_[0]);
+}
+
+std::vector<uint32_t> elias_fano::unpack() const {
+  std::vector<uint32_t> result;
+  result.reserve(size_);
+
+  size_t bit = 0;
+
+  for (size_t i = 0; i < size_; ++i, ++bit) {
+    while ((upper_[bit / 64] & (uint64_t{1} << (bit % 64))) == 0) {
+      ++bit;
+    }
+    auto const high = bit - i;
+    result.push_back(base_ +
+                     static_cast<uint32_t>((high << low_bits_) | lower_[i]));
+  }
+
+  return result;
+}
+
+} // namespace dwarfs::internal
@@ -132,6 +132,27 @@ fsst_compress_(std::span<T const> input, bool force) {
   return output;
 }
 
+// The output buffer must have room for 8 bytes per input byte, plus
+// 32 bytes of slack so that `fsst_decompress` can stay on its fast path.
+constexpr size_t const bulk_output_slack{32};
+
+void bulk_decompress(::fsst_decoder_t const& dec,
+                     std::span<std::string_view const> data, char* out,
+                     size_t size, std::string_view* views) {
+  size_t pos = 0;
+
+  // Each call may write up to 7 bytes past the end of the decoded string;
+  // these get overwritten by the following string, so the decoded strings
+  // can be packed densely.
+  for (auto const& in : data) {
+    auto const len = ::fsst_decompress(
+        &dec, in.size(), reinterpret_cast<unsigned char const*>(in.data()),
+        size - pos, reinterpret_cast<unsigned char*>(out + pos));
+    *views++ = {out + pos, len};
+    pos += len;
+  }
+}
+
 class fsst_decoder_ : public fsst_decoder::impl {
  public:
   explicit fsst_decoder_(std::string_view dictionary) {
@@ -145,13 +166,37 @@ class fsst_decoder_ : public fsst_decoder::impl {
 
   std::string decompress(std::string_view data) const override {
     thread_local std::string out;
+    return std::string(decompress(data, out));
+  }
+
+  std::string_view
+  decompress(std::string_view data, std::string& buffer) const override {
     auto const size = data.size();
-    out.resize(8 * size);
+    // each symbol expands to at most 8 bytes
+    if (buffer.size() < 8 * size) {
+      buffer.resize(8 * size);
+    }
     auto outlen = ::fsst_decompress(
         &decoder_, size, reinterpret_cast<unsigned char const*>(data.data()),
-        out.size(), reinterpret_cast<unsigned char*>(out.data()));
-    out.resize(outlen);
-    return out;
+        buffer.size(), reinterpret_cast<unsigned char*>(buffer.data()));
+    return {buffer.data(), outlen};
+  }
+
+  void decompress(std::span<std::string_view const> data, std::string& buffer,
+                  std::vector<std::string_view>& out) const override {
+    size_t total_size = 0;
+    for (auto const& in : data) {
+      total_size += in.size();
+    }
+
+    if (auto const required = 8 * total_size + bulk_output_slack;
+        buffer.size() < required) {
+      buffer.resize(required);
+    }
+
+    out.resize(data.size());
+
+    bulk_decompress(decoder_, data, buffer.data(), buffer.size(), out.data());
   }
 
  private:
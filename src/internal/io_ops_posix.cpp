@@ -61,6 +61,12 @@ int posix_advice(io_advice adv) {
     return MADV_WILLNEED;
   case io_advice::dontneed:
     return MADV_DONTNEED;
+  case io_advice::hugepage:
+#ifdef MADV_HUGEPAGE
+    return MADV_HUGEPAGE;
+#else
+    return -1;
+#endif
   }
 
   DWARFS_PANIC("invalid advice");
@@ -283,6 +289,11 @@ class io_ops_posix : public io_ops {
               std::error_code& ec) const override {
     auto const native_advice = posix_advice(advice);
 
+    if (native_advice < 0) {
+      ec = std::make_error_code(std::errc::operation_not_supported);
+      return;
+    }
+
     if (::madvise(addr, size, native_advice) != 0) {
       ec = std::error_code{errno, std::generic_category()};
     }
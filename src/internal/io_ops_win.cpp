@@ -338,8 +338,15 @@ class io_ops_win : public io_ops {
     }
   }
 
-  void advise(void* /*addr*/, size_t /*size*/, io_advice /*advice*/,
-              std::error_code& /*ec*/) const override {
+  void advise(void* /*addr*/, size_t /*size*/, io_advice advice,
+              std::error_code& ec) const override {
+    // Large pages can only be requested when the memory is allocated, so
+    // report this like the POSIX implementation does without MADV_HUGEPAGE.
+    if (advice == io_advice::hugepage) {
+      ec = std::make_error_code(std::errc::operation_not_supported);
+      return;
+    }
+
     // TODO: implement Windows equivalent of madvise
   }
 
@@ -0,0 +1,221 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <dwarfs/util.h>
+
+#include <dwarfs/internal/memory_page_stats.h>
+
+namespace dwarfs::internal {
+
+namespace {
+
+constexpr size_t kDefaultHugePageSize{static_cast<size_t>(2) << 20};
+
+size_t div_ceil(size_t num, size_t den) { return (num + den - 1) / den; }
+
+// "7f5e2a400000-7f5e2a600000 rw-p 00000000 00:00 0"
+std::optional<std::pair<uintptr_t, uintptr_t>>
+parse_vma_header(std::string_view line) {
+  auto const dash = line.find('-');
+  auto const space = line.find(' ');
+
+  if (dash == std::string_view::npos || space == std::string_view::npos ||
+      dash > space) {
+    return std::nullopt;
+  }
+
+  uintptr_t start{};
+  uintptr_t end{};
+  auto const* const first = line.data();
+
+  if (auto [p, ec] = std::from_chars(first, first + dash, start, 16);
+      ec != std::errc{} || p != first + dash) {
+    return std::nullopt;
+  }
+
+  if (auto [p, ec] = std::from_chars(first + dash + 1, first + space, end, 16);
+      ec != std::errc{} || p != first + space || end < start) {
+    return std::nullopt;
+  }
+
+  return std::pair{start, end};
+}
+
+// "AnonHugePages:      2048 kB"
+std::optional<size_t> parse_kb_field(std::string_view line,
+                                     std::string_view key) {
+  if (!line.starts_with(key) || line.size() <= key.size() ||
+      line[key.size()] != ':') {
+    return std::nullopt;
+  }
+
+  line.remove_prefix(key.size() + 1);
+
+  auto const pos = line.find_first_not_of(' ');
+
+  if (pos == std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  line.remove_prefix(pos);
+
+  size_t value{};
+
+  if (auto [p, ec] = std::from_chars(line.data(), line.data() + line.size(),
+                                     value);
+      ec != std::errc{}) {
+    return std::nullopt;
+  }
+
+  return value << 10;
+}
+
+} // namespace
+
+size_t memory_page_stats::tlb_entries() const {
+  size_t entries{0};
+
+  if (huge_page_size > 0) {
+    entries += div_ceil(huge, huge_page_size);
+  }
+
+  if (page_size > 0 && resident > huge) {
+    entries += div_ceil(resident - huge, page_size);
+  }
+
+  return entries;
+}
+
+std::optional<memory_page_stats>
+parse_memory_page_stats(std::istream& smaps, uintptr_t begin, uintptr_t end,
+                        size_t huge_page_size) {
+  memory_page_stats st;
+  st.huge_page_size = huge_page_size;
+
+  bool found{false};
+  double overlap{0.0};
+  std::string line;
+
+  while (std::getline(smaps, line)) {
+    if (auto const vma = parse_vma_header(line)) {
+      auto const [vma_begin, vma_end] = *vma;
+      auto const lo = std::max(vma_begin, begin);
+      auto const hi = std::min(vma_end, end);
+
+      if (lo < hi) {
+        // smaps reports per-mapping totals; attribute them to our range
+        // proportionally if the mapping only partially overlaps
+        overlap = static_cast<double>(hi - lo) / (vma_end - vma_begin);
+        st.size += hi - lo;
+        found = true;
+      } else {
+        overlap = 0.0;
+      }
+
+      continue;
+    }
+
+    if (overlap == 0.0) {
+      continue;
+    }
+
+    auto add = [&](size_t& field, std::string_view key) {
+      if (auto const value = parse_kb_field(line, key)) {
+        field += static_cast<size_t>(*value * overlap);
+        return true;
+      }
+      return false;
+    };
+
+    if (add(st.resident, "Rss") || add(st.huge, "AnonHugePages") ||
+        add(st.huge, "FilePmdMapped") || add(st.huge, "ShmemPmdMapped") ||
+        add(st.locked, "Locked")) {
+      continue;
+    }
+
+    if (st.page_size == 0) {
+      if (auto const value = parse_kb_field(line, "KernelPageSize")) {
+        st.page_size = *value;
+      }
+    }
+  }
+
+  if (!found) {
+    return std::nullopt;
+  }
+
+  return st;
+}
+
+std::optional<memory_page_stats>
+get_memory_page_stats(std::span<std::byte const> range) {
+#ifdef __linux__
+  std::ifstream smaps("/proc/self/smaps");
+
+  if (!smaps) {
+    return std::nullopt;
+  }
+
+  size_t huge_page_size{kDefaultHugePageSize};
+
+  if (std::ifstream hps("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+      hps) {
+    if (size_t value{}; hps >> value && value > 0) {
+      huge_page_size = value;
+    }
+  }
+
+  auto const begin = reinterpret_cast<uintptr_t>(range.data());
+
+  return parse_memory_page_stats(smaps, begin, begin + range.size(),
+                                 huge_page_size);
+#else
+  static_cast<void>(range);
+  static_cast<void>(kDefaultHugePageSize);
+  return std::nullopt;
+#endif
+}
+
+std::ostream& operator<<(std::ostream& os, memory_page_stats const& st) {
+  os << size_with_unit(st.size) << " mapped, " << size_with_unit(st.resident)
+     << " resident, " << size_with_unit(st.huge) << " in huge pages, "
+     << size_with_unit(st.locked) << " locked, " << st.tlb_entries()
+     << " TLB entries";
+  return os;
+}
+
+} // namespace dwarfs::internal
@@ -48,6 +48,27 @@ class legacy_string_table : public string_table::impl {
     return std::string(v_[index]);
   }
 
+  std::string_view
+  lookup(size_t index, std::string& /*scratch*/) const override {
+    return v_[index];
+  }
+
+  void lookup(std::span<uint32_t const> indices,
+              string_table::lookup_batch& batch) const override {
+    batch.strings.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+      batch.strings[i] = v_[indices[i]];
+    }
+  }
+
+  void lookup(size_t begin, size_t end,
+              string_table::lookup_batch& batch) const override {
+    batch.strings.resize(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+      batch.strings[i - begin] = v_[i];
+    }
+  }
+
   std::vector<std::string> unpack() const override {
     throw std::runtime_error("cannot unpack legacy string table");
   }
@@ -97,31 +118,44 @@ class packed_string_table : public string_table::impl {
   }
 
   std::string lookup(size_t index) const override {
-    auto beg = buffer_;
-    auto end = buffer_;
-
-    if constexpr (PackedIndex) {
-      beg += index_[index];
-      end += index_[index + 1];
+    if constexpr (PackedData) {
+      return dec_->decompress(raw(index));
     } else {
-      beg += v_.index()[index];
-      end += v_.index()[index + 1];
+      return std::string(raw(index));
     }
+  }
 
+  std::string_view
+  lookup(size_t index, std::string& scratch) const override {
     if constexpr (PackedData) {
-      return dec_->decompress(std::string_view{beg, end});
+      return dec_->decompress(raw(index), scratch);
     } else {
-      return {beg, end};
+      return raw(index);
     }
   }
 
+  void lookup(std::span<uint32_t const> indices,
+              string_table::lookup_batch& batch) const override {
+    lookup_batch_impl(
+        indices.size(), [&](size_t i) { return indices[i]; }, batch);
+  }
+
+  void lookup(size_t begin, size_t end,
+              string_table::lookup_batch& batch) const override {
+    lookup_batch_impl(end - begin, [&](size_t i) { return begin + i; }, batch);
+  }
+
   std::vector<std::string> unpack() const override {
     std::vector<std::string> v;
     auto size = PackedIndex ? index_.size() : v_.index().size();
     if (size > 0) {
+      // Decode in batches, so the decode buffer stays small
+      static constexpr size_t kBatchSize{1024};
+      string_table::lookup_batch batch;
       v.reserve(size - 1);
-      for (size_t i = 0; i < size - 1; ++i) {
-        v.emplace_back(lookup(i));
+      for (size_t begin = 0; begin < size - 1; begin += kBatchSize) {
+        lookup(begin, std::min(begin + kBatchSize, size - 1), batch);
+        v.insert(v.end(), batch.strings.begin(), batch.strings.end());
       }
     }
     return v;
@@ -131,14 +165,46 @@ class packed_string_table : public string_table::impl {
 
   size_t unpacked_size() const override {
     size_t unpacked = 0;
+    std::string scratch;
     auto size = PackedIndex ? index_.size() : v_.index().size();
     for (size_t i = 0; i < size - 1; ++i) {
-      unpacked += lookup(i).size();
+      unpacked += lookup(i, scratch).size();
     }
     return unpacked;
   }
 
  private:
+  std::string_view raw(size_t index) const {
+    auto beg = buffer_;
+    auto end = buffer_;
+
+    if constexpr (PackedIndex) {
+      beg += index_[index];
+      end += index_[index + 1];
+    } else {
+      beg += v_.index()[index];
+      end += v_.index()[index + 1];
+    }
+
+    return {beg, end};
+  }
+
+  template <typename IndexFn>
+  void lookup_batch_impl(size_t count, IndexFn const& index_of,
+                         string_table::lookup_batch& batch) const {
+    auto& raw_strings = PackedData ? batch.packed : batch.strings;
+
+    raw_strings.resize(count);
+
+    for (size_t i = 0; i < count; ++i) {
+      raw_strings[i] = raw(index_of(i));
+    }
+
+    if constexpr (PackedData) {
+      dec_->decompress(batch.packed, batch.buffer, batch.strings);
+    }
+  }
+
   string_table::PackedTableView v_;
   char const* const buffer_;
   std::vector<uint32_t> index_;
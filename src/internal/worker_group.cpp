@@ -27,14 +27,19 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <ctime>
 #include <exception>
+#include <iterator>
 #include <mutex>
 #include <optional>
 #include <queue>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -51,7 +56,24 @@
 #include <dwarfs/internal/thread_util.h>
 #include <dwarfs/internal/worker_group.h>
 
-namespace dwarfs::internal::detail {
+namespace dwarfs::internal {
+
+std::string_view job_priority_name(job_priority prio) {
+  switch (prio) {
+  case job_priority::DEMAND:
+    return "demand";
+  case job_priority::READAHEAD:
+    return "readahead";
+  case job_priority::PREFETCH:
+    return "prefetch";
+  case job_priority::PRELOAD:
+    return "preload";
+  }
+
+  return "unknown";
+}
+
+namespace detail {
 
 namespace {
 
@@ -131,17 +153,18 @@ class worker_group_impl_ final : public worker_group_impl {
     return running_;
   }
 
-  bool add_job(queued_job&& job) override {
+  bool add_job(queued_job&& job, job_priority prio) override {
     std::unique_lock lock(mx_);
 
     queue_space_available_.wait(
-        lock, [this] { return !running_ || jobs_.size() < max_queue_len_; });
+        lock, [this] { return !running_ || queued_ < max_queue_len_; });
 
     if (!running_) {
       return false;
     }
 
-    jobs_.emplace(std::move(job));
+    jobs_[static_cast<size_t>(prio)].emplace(std::move(job), clock_type::now());
+    ++queued_;
     ++pending_;
 
     lock.unlock();
@@ -192,8 +215,45 @@ class worker_group_impl_ final : public worker_group_impl {
     return true;
   }
 
+  job_queue_stats get_queue_stats(job_priority prio) const override {
+    std::lock_guard lock(mx_);
+    return queue_stats_[static_cast<size_t>(prio)];
+  }
+
  private:
-  using jobs_t = std::queue<queued_job>;
+  using clock_type = std::chrono::steady_clock;
+
+  struct pending_job {
+    pending_job(queued_job&& j, clock_type::time_point t)
+        : job{std::move(j)}
+        , queued_at{t} {}
+
+    queued_job job;
+    clock_type::time_point queued_at;
+  };
+
+  using jobs_t = std::array<std::queue<pending_job>, num_job_priorities>;
+
+  // must be called with the lock held and at least one job queued
+  queued_job pop_job() {
+    auto it = std::ranges::find_if(
+        jobs_, [](auto const& q) { return !q.empty(); });
+    assert(it != jobs_.end());
+
+    auto& pj = it->front();
+    auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock_type::now() - pj.queued_at);
+    auto& qs = queue_stats_[std::distance(jobs_.begin(), it)];
+    ++qs.jobs;
+    qs.total_wait += wait;
+    qs.max_wait = std::max(qs.max_wait, wait);
+
+    auto job = std::move(pj.job);
+    it->pop();
+    --queued_;
+
+    return job;
+  }
 
   void check_set_affinity_from_environment(std::string_view group_name) {
     if (auto var = os_.getenv("DWARFS_WORKER_GROUP_AFFINITY")) {
@@ -220,14 +280,13 @@ class worker_group_impl_ final : public worker_group_impl {
         std::unique_lock lock(mx_);
 
         jobs_available_.wait(lock,
-                             [this] { return !running_ || !jobs_.empty(); });
+                             [this] { return !running_ || queued_ > 0; });
 
-        if (jobs_.empty()) {
+        if (queued_ == 0) {
           break;
         }
 
-        job.emplace(std::move(jobs_.front()));
-        jobs_.pop();
+        job.emplace(pop_job());
       }
 
       queue_space_available_.notify_one();
@@ -257,12 +316,14 @@ class worker_group_impl_ final : public worker_group_impl {
   os_access const& os_;
   std::vector<std::thread> workers_;
   jobs_t jobs_;
+  std::array<job_queue_stats, num_job_priorities> queue_stats_{};
   mutable std::mutex mx_;
   std::condition_variable jobs_available_;
   std::condition_variable queue_space_available_;
   std::condition_variable all_done_;
   bool running_{true};
   size_t pending_{0};
+  size_t queued_{0};
   size_t const max_queue_len_;
 };
 
@@ -278,4 +339,6 @@ make_worker_group_impl(logger& lgr, os_access const& os,
                                                      options, std::move(sf));
 }
 
-} // namespace dwarfs::internal::detail
+} // namespace detail
+
+} // namespace dwarfs::internal
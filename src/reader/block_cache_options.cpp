@@ -27,6 +27,7 @@
  */
 
 #include <ostream>
+#include <string_view>
 
 #include <fmt/format.h>
 
@@ -34,11 +35,44 @@
 
 namespace dwarfs::reader {
 
+namespace {
+
+std::string_view policy_name(block_cache_eviction_policy policy) {
+  switch (policy) {
+  case block_cache_eviction_policy::LRU:
+    return "lru";
+  case block_cache_eviction_policy::TINYLFU:
+    return "tinylfu";
+  }
+  return "unknown";
+}
+
+std::string_view allocation_mode_name(block_cache_allocation_mode mode) {
+  switch (mode) {
+  case block_cache_allocation_mode::MALLOC:
+    return "malloc";
+  case block_cache_allocation_mode::MMAP:
+    return "mmap";
+  case block_cache_allocation_mode::HUGEPAGE:
+    return "hugepage";
+  }
+  return "unknown";
+}
+
+} // namespace
+
 std::ostream& operator<<(std::ostream& os, block_cache_options const& opts) {
   os << fmt::format("max_bytes={}, num_workers={}, decompress_ratio={}, "
-                    "disable_block_integrity_check={}",
+                    "disable_block_integrity_check={}, num_shards={}, "
+                    "eviction_policy={}, "
+                    "sequential_access_detector_threshold={}, "
+                    "max_prefetch_depth={}, allocation_mode={}",
                     opts.max_bytes, opts.num_workers, opts.decompress_ratio,
-                    opts.disable_block_integrity_check);
+                    opts.disable_block_integrity_check, opts.num_shards,
+                    policy_name(opts.eviction_policy),
+                    opts.sequential_access_detector_threshold,
+                    opts.max_prefetch_depth,
+                    allocation_mode_name(opts.allocation_mode));
   return os;
 }
 
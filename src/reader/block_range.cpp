@@ -42,6 +42,12 @@ block_range::block_range(uint8_t const* data, size_t offset, size_t size)
   }
 }
 
+block_range::block_range(uint8_t const* data, size_t offset, size_t size,
+                         file_off_t image_offset)
+    : block_range(data, offset, size) {
+  image_offset_ = image_offset + static_cast<file_off_t>(offset);
+}
+
 block_range::block_range(std::shared_ptr<internal::cached_block const> block,
                          size_t offset, size_t size)
     : span_{block->data() + offset, size}
@@ -49,7 +55,7 @@ block_range::block_range(std::shared_ptr<internal::cached_block const> block,
   if (!block_->data()) {
     DWARFS_THROW(runtime_error, "block_range: block data is null");
   }
-  if (offset + size > block_->range_end()) {
+  if (!block_->is_available(offset, offset + size)) {
     DWARFS_THROW(runtime_error,
                  fmt::format("block_range: size out of range ({0} > {1})",
                              offset + size, block_->range_end()));
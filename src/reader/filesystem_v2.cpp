@@ -29,10 +29,13 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstring>
+#include <filesystem>
 #include <functional>
 #include <iostream>
 #include <mutex>
+#include <set>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -45,12 +48,15 @@
 #include <dwarfs/file_view.h>
 #include <dwarfs/fstypes.h>
 #include <dwarfs/history.h>
+#include <dwarfs/io_advice.h>
 #include <dwarfs/logger.h>
 #include <dwarfs/malloc_byte_buffer.h>
 #include <dwarfs/mapped_byte_buffer.h>
 #include <dwarfs/match.h>
+#include <dwarfs/memory_mapping.h>
 #include <dwarfs/os_access.h>
 #include <dwarfs/performance_monitor.h>
+#include <dwarfs/reader/block_cache_arena.h>
 #include <dwarfs/reader/filesystem_options.h>
 #include <dwarfs/reader/filesystem_v2.h>
 #include <dwarfs/reader/fsinfo_options.h>
@@ -58,10 +64,14 @@
 
 #include <dwarfs/internal/fs_section.h>
 #include <dwarfs/internal/fs_section_checker.h>
+#include <dwarfs/internal/memory_page_stats.h>
 #include <dwarfs/internal/worker_group.h>
+#include <dwarfs/reader/internal/block_access_trace.h>
 #include <dwarfs/reader/internal/block_cache.h>
+#include <dwarfs/reader/internal/disk_block_cache.h>
 #include <dwarfs/reader/internal/filesystem_parser.h>
 #include <dwarfs/reader/internal/inode_reader_v2.h>
+#include <dwarfs/reader/internal/metadata_cache.h>
 #include <dwarfs/reader/internal/metadata_v2.h>
 
 namespace dwarfs::reader {
@@ -105,6 +115,27 @@ auto call_ec_throw(Fn&& fn) {
 
 using section_map = std::unordered_map<section_type, std::vector<fs_section>>;
 
+void handle_lock_error(logger& lgr, mlock_mode lock_mode, std::string_view what,
+                       std::error_code const& ec) {
+  LOG_PROXY(debug_logger_policy, lgr);
+
+  if (ec) {
+    if (lock_mode == mlock_mode::MUST) {
+      DWARFS_THROW(system_error, "mlock");
+    }
+    LOG_WARN << "mlock() failed for " << what << ": " << ec.message();
+  }
+}
+
+std::string page_stats_str(std::span<uint8_t const> data) {
+  if (auto const st = get_memory_page_stats(std::as_bytes(data))) {
+    std::ostringstream oss;
+    oss << *st;
+    return oss.str();
+  }
+  return "not available";
+}
+
 class section_wrapper {
  public:
   class section_data {
@@ -124,11 +155,17 @@ class section_wrapper {
     explicit section_data(shared_byte_buffer const& buf)
         : data_{buf} {}
 
+    explicit section_data(std::shared_ptr<memory_mapping const> mm)
+        : data_{std::move(mm)} {}
+
     std::span<uint8_t const> span() const {
       return data_ |
              match{
                  [](secseg const& ss) { return ss.section.data(ss.segment); },
                  [](shared_byte_buffer const& buf) { return buf.span(); },
+                 [](std::shared_ptr<memory_mapping const> const& mm) {
+                   return mm->const_span<uint8_t>();
+                 },
              };
     }
 
@@ -136,11 +173,16 @@ class section_wrapper {
       data_ | match{
                   [&](secseg const& ss) { ss.segment.lock(ec); },
                   [](shared_byte_buffer const&) {},
+                  [&](std::shared_ptr<memory_mapping const> const& mm) {
+                    mm->lock(ec);
+                  },
               };
     }
 
    private:
-    std::variant<secseg, shared_byte_buffer> data_;
+    std::variant<secseg, shared_byte_buffer,
+                 std::shared_ptr<memory_mapping const>>
+        data_;
   };
 
   section_wrapper(file_view const& fv, fs_section const& sec)
@@ -181,6 +223,22 @@ class section_wrapper {
         block_decompressor::decompress(compression, sec_.data(seg))};
   }
 
+  // Copies the (decompressed) section data into `mm`, which must be at
+  // least get_uncompressed_size() bytes.
+  section_data get_section_data(memory_mapping mm) {
+    auto const data = get_section_data();
+    auto const src = data.span();
+    auto const dst = mm.span<uint8_t>();
+
+    DWARFS_CHECK(dst.size() >= src.size(),
+                 fmt::format("mapping too small for {} section: {} < {}",
+                             sec_.name(), dst.size(), src.size()));
+
+    std::ranges::copy(src, dst.begin());
+
+    return section_data{std::make_shared<memory_mapping const>(std::move(mm))};
+  }
+
  private:
   file_segment const& segment() {
     if (!segment_) {
@@ -207,11 +265,91 @@ class section_wrapper {
   std::optional<file_segment> segment_{};
 };
 
+std::optional<uint64_t> metadata_cache_key(section_map const& sections) {
+  if (auto it = sections.find(section_type::METADATA_V2);
+      it != sections.end() && it->second.size() == 1) {
+    return it->second.front().xxh3_64_value();
+  }
+  return std::nullopt;
+}
+
+std::shared_ptr<metadata_cache const>
+load_metadata_cache(logger& lgr, os_access const& os,
+                    std::filesystem::path const& path, uint64_t key,
+                    mlock_mode lock_mode) {
+  LOG_PROXY(debug_logger_policy, lgr);
+
+  std::error_code ec;
+
+  if (!std::filesystem::exists(path, ec)) {
+    LOG_DEBUG << "metadata cache " << path.string() << " does not exist";
+    return nullptr;
+  }
+
+  try {
+    auto mm = os.open_file(path);
+
+    if (auto cache = metadata_cache::load(mm, key)) {
+      LOG_VERBOSE << "loaded metadata cache " << path.string();
+
+      if (lock_mode != mlock_mode::NONE) {
+        // The cache holds on to the mapping, so the lock remains in effect
+        // for as long as the tables are in use.
+        std::error_code ec;
+        mm.segment_at(0, mm.size()).lock(ec);
+        handle_lock_error(lgr, lock_mode, "metadata cache", ec);
+      }
+
+      return cache;
+    }
+
+    LOG_INFO << "metadata cache " << path.string()
+             << " does not match file system, rebuilding";
+  } catch (std::exception const& e) {
+    LOG_WARN << "failed to load metadata cache " << path.string() << ": "
+             << exception_str(e);
+  }
+
+  return nullptr;
+}
+
+// Metadata cache files that could not be written; these are not retried
+// for the lifetime of the process.
+std::mutex failed_cache_writes_mx;
+std::set<std::filesystem::path> failed_cache_writes;
+
+bool needs_metadata_cache_update(metadata_v2 const& meta,
+                                 std::filesystem::path const& path) {
+  if (metadata_v2_utils(meta).has_complete_cache()) {
+    return false;
+  }
+
+  std::lock_guard lock(failed_cache_writes_mx);
+  return !failed_cache_writes.contains(path);
+}
+
+void write_metadata_cache(logger& lgr, metadata_v2 const& meta,
+                          std::filesystem::path const& path, uint64_t key) {
+  LOG_PROXY(debug_logger_policy, lgr);
+
+  try {
+    auto tv = LOG_TIMED_VERBOSE;
+    metadata_v2_utils(meta).build_cache().write(path, key);
+    tv << "wrote metadata cache " << path.string();
+  } catch (std::exception const& e) {
+    LOG_WARN << "failed to write metadata cache: " << exception_str(e);
+    std::lock_guard lock(failed_cache_writes_mx);
+    failed_cache_writes.insert(path);
+  }
+}
+
 std::tuple<section_wrapper::section_data, metadata_v2>
-make_metadata(logger& lgr, file_view const& mm, section_map const& sections,
-              metadata_options const& options, int inode_offset,
-              mlock_mode lock_mode, bool force_consistency_check,
-              std::shared_ptr<performance_monitor const> const& perfmon) {
+make_metadata(logger& lgr, os_access const& os, file_view const& mm,
+              section_map const& sections, metadata_options const& options,
+              int inode_offset, mlock_mode lock_mode, bool hugepages,
+              bool force_consistency_check,
+              std::shared_ptr<performance_monitor const> const& perfmon,
+              std::shared_ptr<metadata_cache const> cache) {
   LOG_PROXY(debug_logger_policy, lgr);
   auto schema_it = sections.find(section_type::METADATA_V2_SCHEMA);
   auto meta_it = sections.find(section_type::METADATA_V2);
@@ -235,25 +373,48 @@ make_metadata(logger& lgr, file_view const& mm, section_map const& sections,
   auto meta_section = section_wrapper(mm, meta_it->second.front());
   auto schema_section = section_wrapper(mm, schema_it->second.front());
 
-  auto meta_buffer = meta_section.get_section_data();
-  auto schema_buffer = schema_section.get_section_data();
+  // Decompressed metadata lives on the heap, where we cannot lock it. So
+  // if we need to lock it, or if we want huge pages, we need to copy it to
+  // an anonymous mapping first.
+  bool const anonymous =
+      hugepages ||
+      (lock_mode != mlock_mode::NONE &&
+       meta_it->second.front().compression() != compression_type::NONE);
+
+  auto meta_buffer = [&] {
+    if (!anonymous) {
+      return meta_section.get_section_data();
+    }
 
-  if (lock_mode != mlock_mode::NONE) {
-    std::error_code ec;
+    auto anon = os.map_empty(meta_section.get_uncompressed_size());
 
-    meta_buffer.lock(ec);
+    if (hugepages) {
+      // must happen before the pages are touched for the first time
+      std::error_code ec;
+      anon.advise(io_advice::hugepage, ec);
 
-    if (ec) {
-      if (lock_mode == mlock_mode::MUST) {
-        DWARFS_THROW(system_error, "mlock");
+      if (ec) {
+        LOG_WARN << "huge pages not available for metadata: " << ec.message();
       }
-      LOG_WARN << "mlock() failed: " << ec.message();
     }
+
+    return meta_section.get_section_data(std::move(anon));
+  }();
+
+  auto schema_buffer = schema_section.get_section_data();
+
+  if (lock_mode != mlock_mode::NONE) {
+    std::error_code ec;
+    meta_buffer.lock(ec);
+    handle_lock_error(lgr, lock_mode, "metadata", ec);
   }
 
+  LOG_VERBOSE << "metadata pages: " << page_stats_str(meta_buffer.span());
+
   return {meta_buffer,
           metadata_v2{lgr, schema_buffer.span(), meta_buffer.span(), options,
-                      inode_offset, force_consistency_check, perfmon}};
+                      inode_offset, force_consistency_check, perfmon,
+                      std::move(cache)}};
 }
 
 } // namespace
@@ -277,6 +438,10 @@ class filesystem_ final {
   bool has_valid_section_index() const;
   void walk(std::function<void(dir_entry_view)> const& func) const;
   void walk_data_order(std::function<void(dir_entry_view)> const& func) const;
+  void walk_with_path(
+      std::function<void(dir_entry_view, std::string_view)> const& func) const;
+  void walk_data_order_with_path(
+      std::function<void(dir_entry_view, std::string_view)> const& func) const;
   dir_entry_view_iterable directory_entries() const;
   dir_entry_view_iterable entries_in_data_order() const;
   dir_entry_view root() const;
@@ -295,6 +460,17 @@ class filesystem_ final {
   std::optional<directory_view> opendir(inode_view entry) const;
   std::optional<dir_entry_view>
   readdir(directory_view dir, size_t offset) const;
+  void
+  readdir(directory_view dir, size_t offset,
+          std::function<bool(dir_entry_view, std::string_view)> const& func)
+      const;
+  void readdirplus(directory_view dir, size_t offset,
+                   std::function<bool(dir_entry_view, std::string_view,
+                                      file_stat const&)> const& func,
+                   std::error_code& ec) const;
+  void readdirplus(directory_view dir, size_t offset,
+                   std::function<bool(dir_entry_view, std::string_view,
+                                      file_stat const&)> const& func) const;
   size_t dirsize(directory_view dir) const;
   std::string
   readlink(inode_view entry, readlink_mode mode, std::error_code& ec) const;
@@ -400,6 +576,43 @@ class filesystem_ final {
     ir_.cache_blocks(block_numbers);
   }
 
+  void record_block_trace(std::filesystem::path const& path) {
+    ir_.set_block_access_recorder(
+        std::make_shared<block_access_recorder>(path, ir_.num_blocks()));
+  }
+
+  void cache_blocks_from_trace(std::filesystem::path const& path) const {
+    auto const trace = block_access_trace::read(path);
+
+    if (trace.num_blocks != ir_.num_blocks()) {
+      DWARFS_THROW(runtime_error,
+                   fmt::format("trace file {} was recorded for a different "
+                               "file system ({} blocks, expected {})",
+                               path.string(), trace.num_blocks,
+                               ir_.num_blocks()));
+    }
+
+    auto const max_blocks = get_max_cache_blocks();
+    std::vector<size_t> block_numbers;
+    block_numbers.reserve(trace.entries.size());
+
+    for (auto const& e : trace.entries) {
+      block_numbers.push_back(e.block_no);
+    }
+
+    if (block_numbers.size() > max_blocks) {
+      LOG_WARN << "too many blocks in trace file, caching only the first "
+               << max_blocks << " out of " << block_numbers.size()
+               << " blocks";
+      block_numbers.resize(max_blocks);
+    }
+
+    LOG_VERBOSE << "preloading " << block_numbers.size()
+                << " blocks from trace file " << path.string();
+
+    ir_.preload_blocks(block_numbers);
+  }
+
   std::unique_ptr<thrift::metadata::metadata> thawed_metadata() const {
     return metadata_v2_utils(meta_).thaw();
   }
@@ -424,7 +637,10 @@ class filesystem_ final {
   }
 
   size_t get_max_cache_blocks() const {
-    return options_.block_cache.max_bytes / meta_.block_size();
+    auto const max_bytes = options_.block_cache_arena
+                               ? options_.block_cache_arena->max_bytes()
+                               : options_.block_cache.max_bytes;
+    return max_bytes / meta_.block_size();
   }
 
   filesystem_info const* get_info(fsinfo_options const& opts) const;
@@ -455,6 +671,7 @@ class filesystem_ final {
   filesystem_options const options_;
   filesystem_version version_;
   bool has_valid_section_index_{false};
+  std::jthread cache_writer_;
   PERFMON_CLS_PROXY_DECL
   PERFMON_CLS_TIMER_DECL(find_path)
   PERFMON_CLS_TIMER_DECL(find_inode)
@@ -467,6 +684,7 @@ class filesystem_ final {
   PERFMON_CLS_TIMER_DECL(access_ec)
   PERFMON_CLS_TIMER_DECL(opendir)
   PERFMON_CLS_TIMER_DECL(readdir)
+  PERFMON_CLS_TIMER_DECL(readdirplus)
   PERFMON_CLS_TIMER_DECL(dirsize)
   PERFMON_CLS_TIMER_DECL(readlink)
   PERFMON_CLS_TIMER_DECL(readlink_ec)
@@ -569,6 +787,7 @@ filesystem_<LoggerPolicy>::filesystem_(
     PERFMON_CLS_TIMER_INIT(access_ec)
     PERFMON_CLS_TIMER_INIT(opendir)
     PERFMON_CLS_TIMER_INIT(readdir)
+    PERFMON_CLS_TIMER_INIT(readdirplus)
     PERFMON_CLS_TIMER_INIT(dirsize)
     PERFMON_CLS_TIMER_INIT(readlink)
     PERFMON_CLS_TIMER_INIT(readlink_ec)
@@ -586,7 +805,17 @@ filesystem_<LoggerPolicy>::filesystem_(
     PERFMON_CLS_TIMER_INIT(readv_future)
     PERFMON_CLS_TIMER_INIT(readv_future_ec) // clang-format on
 {
-  block_cache cache(lgr, os_, mm_, options.block_cache, perfmon);
+  block_cache cache(lgr, os_, mm_, options.block_cache,
+                    options.block_cache_arena
+                        ? options.block_cache_arena->get_arena()
+                        : nullptr,
+                    perfmon);
+
+  if (!options.disk_cache.directory.empty()) {
+    cache.set_disk_cache(
+        std::make_shared<disk_block_cache>(lgr, os_, options.disk_cache));
+  }
+
   auto parser = make_fs_parser();
 
   if (parser.has_index()) {
@@ -629,9 +858,25 @@ filesystem_<LoggerPolicy>::filesystem_(
     }
   }
 
+  std::optional<uint64_t> cache_key;
+  std::shared_ptr<metadata_cache const> meta_cache;
+
+  if (!options.metadata_cache_file.empty()) {
+    cache_key = metadata_cache_key(sections);
+
+    if (cache_key) {
+      meta_cache = load_metadata_cache(lgr, os_, options.metadata_cache_file,
+                                       *cache_key, options.lock_mode);
+    } else {
+      LOG_WARN << "metadata cache requires a file system with checksums";
+    }
+  }
+
   std::tie(meta_buffer_, meta_) =
-      make_metadata(lgr, mm_, sections, options.metadata, options.inode_offset,
-                    options.lock_mode, !parser.has_checksums(), perfmon);
+      make_metadata(lgr, os_, mm_, sections, options.metadata,
+                    options.inode_offset, options.lock_mode,
+                    options.metadata_hugepages, !parser.has_checksums(),
+                    perfmon, std::move(meta_cache));
 
   LOG_DEBUG << "read " << cache.block_count() << " blocks and " << meta_.size()
             << " bytes of metadata";
@@ -644,6 +889,16 @@ filesystem_<LoggerPolicy>::filesystem_(
   if (auto it = sections.find(section_type::HISTORY); it != sections.end()) {
     history_sections_ = std::move(it->second);
   }
+
+  if (cache_key &&
+      needs_metadata_cache_update(meta_, options.metadata_cache_file)) {
+    // Building the cache unpacks all derived tables, so do it in the
+    // background rather than delaying the mount.
+    cache_writer_ = std::jthread([this, key = *cache_key] {
+      write_metadata_cache(LOG_GET_LOGGER, meta_, options_.metadata_cache_file,
+                           key);
+    });
+  }
 }
 
 template <typename LoggerPolicy>
@@ -923,6 +1178,18 @@ void filesystem_<LoggerPolicy>::walk_data_order(
   }
 }
 
+template <typename LoggerPolicy>
+void filesystem_<LoggerPolicy>::walk_with_path(
+    std::function<void(dir_entry_view, std::string_view)> const& func) const {
+  meta_.walk_with_path(func);
+}
+
+template <typename LoggerPolicy>
+void filesystem_<LoggerPolicy>::walk_data_order_with_path(
+    std::function<void(dir_entry_view, std::string_view)> const& func) const {
+  meta_.walk_data_order_with_path(func);
+}
+
 template <typename LoggerPolicy>
 dir_entry_view_iterable filesystem_<LoggerPolicy>::directory_entries() const {
   return meta_.directory_entries();
@@ -1024,6 +1291,37 @@ filesystem_<LoggerPolicy>::readdir(directory_view dir, size_t offset) const {
   return meta_.readdir(dir, offset);
 }
 
+template <typename LoggerPolicy>
+void filesystem_<LoggerPolicy>::readdir(
+    directory_view dir, size_t offset,
+    std::function<bool(dir_entry_view, std::string_view)> const& func) const {
+  PERFMON_CLS_SCOPED_SECTION(readdir)
+  meta_.readdir(dir, offset, func);
+}
+
+template <typename LoggerPolicy>
+void filesystem_<LoggerPolicy>::readdirplus(
+    directory_view dir, size_t offset,
+    std::function<bool(dir_entry_view, std::string_view,
+                       file_stat const&)> const& func,
+    std::error_code& ec) const {
+  PERFMON_CLS_SCOPED_SECTION(readdirplus)
+  meta_.readdirplus(dir, offset, func, ec);
+}
+
+template <typename LoggerPolicy>
+void filesystem_<LoggerPolicy>::readdirplus(
+    directory_view dir, size_t offset,
+    std::function<bool(dir_entry_view, std::string_view,
+                       file_stat const&)> const& func) const {
+  PERFMON_CLS_SCOPED_SECTION(readdirplus)
+  std::error_code ec;
+  meta_.readdirplus(dir, offset, func, ec);
+  if (ec) {
+    throw std::system_error(ec);
+  }
+}
+
 template <typename LoggerPolicy>
 size_t filesystem_<LoggerPolicy>::dirsize(directory_view dir) const {
   PERFMON_CLS_SCOPED_SECTION(dirsize)
@@ -1309,6 +1607,16 @@ class filesystem_common_ : public Base {
       std::function<void(dir_entry_view)> const& func) const override {
     fs_.walk_data_order(func);
   }
+  void walk_with_path(
+      std::function<void(dir_entry_view, std::string_view)> const& func)
+      const override {
+    fs_.walk_with_path(func);
+  }
+  void walk_data_order_with_path(
+      std::function<void(dir_entry_view, std::string_view)> const& func)
+      const override {
+    fs_.walk_data_order_with_path(func);
+  }
   dir_entry_view_iterable directory_entries() const override {
     return fs_.directory_entries();
   }
@@ -1355,6 +1663,24 @@ class filesystem_common_ : public Base {
   readdir(directory_view dir, size_t offset) const override {
     return fs_.readdir(dir, offset);
   }
+  void readdir(
+      directory_view dir, size_t offset,
+      std::function<bool(dir_entry_view, std::string_view)> const& func)
+      const override {
+    fs_.readdir(dir, offset, func);
+  }
+  void readdirplus(directory_view dir, size_t offset,
+                   std::function<bool(dir_entry_view, std::string_view,
+                                      file_stat const&)> const& func,
+                   std::error_code& ec) const override {
+    fs_.readdirplus(dir, offset, func, ec);
+  }
+  void readdirplus(directory_view dir, size_t offset,
+                   std::function<bool(dir_entry_view, std::string_view,
+                                      file_stat const&)> const& func)
+      const override {
+    fs_.readdirplus(dir, offset, func);
+  }
   size_t dirsize(directory_view dir) const override { return fs_.dirsize(dir); }
   std::string readlink(inode_view entry, readlink_mode mode,
                        std::error_code& ec) const override {
@@ -1490,6 +1816,15 @@ class filesystem_common_ : public Base {
 
   void cache_all_blocks() const override { fs_.cache_all_blocks(); }
 
+  void record_block_trace(std::filesystem::path const& path) override {
+    fs_.record_block_trace(path);
+  }
+
+  void
+  cache_blocks_from_trace(std::filesystem::path const& path) const override {
+    fs_.cache_blocks_from_trace(path);
+  }
+
  protected:
   filesystem_<LoggerPolicy> const& fs() const { return fs_; }
 
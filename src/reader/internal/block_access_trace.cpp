@@ -0,0 +1,182 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <span>
+#include <string_view>
+#include <system_error>
+
+#include <fmt/format.h>
+
+#include <dwarfs/error.h>
+#include <dwarfs/varint.h>
+
+#include <dwarfs/reader/internal/block_access_trace.h>
+
+namespace dwarfs::reader::internal {
+
+namespace {
+
+constexpr std::string_view kTraceMagic{"DWARFSAT"};
+constexpr uint64_t kTraceVersion{1};
+constexpr size_t kWriteBufferSize{64 * 1024};
+
+void append_varint(std::vector<uint8_t>& buf, uint64_t value) {
+  std::array<uint8_t, varint::max_size> tmp;
+  auto const len = varint::encode(value, tmp.data());
+  buf.insert(buf.end(), tmp.begin(), tmp.begin() + len);
+}
+
+} // namespace
+
+block_access_trace
+block_access_trace::read(std::filesystem::path const& path) {
+  std::ifstream ifs(path, std::ios::binary);
+
+  if (!ifs) {
+    DWARFS_THROW(runtime_error,
+                 fmt::format("cannot open trace file {}: {}", path.string(),
+                             std::strerror(errno)));
+  }
+
+  std::vector<uint8_t> data{std::istreambuf_iterator<char>(ifs),
+                            std::istreambuf_iterator<char>()};
+
+  auto const magic = std::string_view(
+      reinterpret_cast<char const*>(data.data()),
+      std::min(data.size(), kTraceMagic.size()));
+
+  if (magic != kTraceMagic) {
+    DWARFS_THROW(runtime_error,
+                 fmt::format("{} is not a block access trace", path.string()));
+  }
+
+  std::span<uint8_t const> buf{data};
+  buf = buf.subspan(kTraceMagic.size());
+
+  block_access_trace trace;
+
+  try {
+    if (auto const version = varint::decode(buf); version != kTraceVersion) {
+      DWARFS_THROW(runtime_error,
+                   fmt::format("unsupported trace file version {} in {}",
+                               version, path.string()));
+    }
+
+    trace.num_blocks = varint::decode(buf);
+
+    std::chrono::microseconds time{0};
+
+    while (!buf.empty()) {
+      time += std::chrono::microseconds(varint::decode(buf));
+      auto const block_no = varint::decode(buf);
+
+      if (block_no >= trace.num_blocks) {
+        DWARFS_THROW(runtime_error,
+                     fmt::format("invalid block number {} in trace file {}",
+                                 block_no, path.string()));
+      }
+
+      trace.entries.push_back({time, block_no});
+    }
+  } catch (std::system_error const& e) {
+    DWARFS_THROW(runtime_error, fmt::format("corrupt trace file {}: {}",
+                                            path.string(), e.what()));
+  }
+
+  return trace;
+}
+
+block_access_recorder::block_access_recorder(std::filesystem::path const& path,
+                                             size_t num_blocks)
+    : ofs_{path, std::ios::binary | std::ios::trunc}
+    , seen_(num_blocks, false)
+    , start_{std::chrono::steady_clock::now()} {
+  if (!ofs_) {
+    DWARFS_THROW(runtime_error,
+                 fmt::format("cannot create trace file {}: {}", path.string(),
+                             std::strerror(errno)));
+  }
+
+  buffer_.reserve(kWriteBufferSize);
+  buffer_.insert(buffer_.end(), kTraceMagic.begin(), kTraceMagic.end());
+  append_varint(buffer_, kTraceVersion);
+  append_varint(buffer_, num_blocks);
+  write_buffer();
+}
+
+block_access_recorder::~block_access_recorder() {
+  std::lock_guard lock(mx_);
+  write_buffer();
+}
+
+void block_access_recorder::record(size_t block_no) {
+  auto const now = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_);
+
+  std::lock_guard lock(mx_);
+
+  if (block_no >= seen_.size() || seen_[block_no]) {
+    return;
+  }
+
+  seen_[block_no] = true;
+  ++num_recorded_;
+
+  // Timestamps can be slightly out of order due to the clock being read
+  // outside of the lock
+  auto const delta = std::max(now - last_, std::chrono::microseconds{0});
+  last_ += delta;
+
+  append_varint(buffer_, delta.count());
+  append_varint(buffer_, block_no);
+
+  // Write out the trace in chunks, so most of it is preserved even if
+  // the process doesn't terminate cleanly
+  if (buffer_.size() >= kWriteBufferSize - 2 * varint::max_size ||
+      num_recorded_ == seen_.size()) {
+    write_buffer();
+  }
+}
+
+size_t block_access_recorder::num_recorded() const {
+  std::lock_guard lock(mx_);
+  return num_recorded_;
+}
+
+void block_access_recorder::write_buffer() {
+  ofs_.write(reinterpret_cast<char const*>(buffer_.data()), buffer_.size());
+  ofs_.flush();
+  buffer_.clear();
+}
+
+} // namespace dwarfs::reader::internal
@@ -0,0 +1,514 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+
+#include <parallel_hashmap/phmap.h>
+
+#include <dwarfs/error.h>
+#include <dwarfs/reader/block_cache_arena.h>
+#include <dwarfs/small_vector.h>
+#include <dwarfs/util.h>
+
+#include <dwarfs/internal/fs_section.h>
+#include <dwarfs/reader/internal/block_arena.h>
+#include <dwarfs/reader/internal/cached_block.h>
+#include <dwarfs/reader/internal/eviction_cache.h>
+#include <dwarfs/reader/internal/instrumented_mutex.h>
+
+namespace dwarfs::reader::internal {
+
+using namespace dwarfs::internal;
+
+namespace {
+
+// Blocks with a content id are keyed by their xxh3 checksum. All other
+// blocks are keyed by image id and block number, packed into 64 bits and
+// tagged with the most significant bit, so both kinds of keys can never
+// collide.
+using key_type = uint64_t;
+
+constexpr key_type const kPackedKeyFlag{key_type{1} << 63};
+constexpr unsigned const kImageIdShift{40};
+constexpr key_type const kBlockNoMask{(key_type{1} << kImageIdShift) - 1};
+constexpr uint32_t const kMaxImageId{(uint32_t{1} << (63 - kImageIdShift)) -
+                                     1};
+
+key_type make_key(uint32_t image_id, size_t block_no,
+                  block_arena::content_id const& content) {
+  if (content) {
+    return content->xxh3_64 & ~kPackedKeyFlag;
+  }
+
+  return kPackedKeyFlag | (static_cast<key_type>(image_id) << kImageIdShift) |
+         block_no;
+}
+
+struct arena_user {
+  uint32_t image_id;
+  size_t block_no;
+};
+
+struct arena_entry {
+  std::shared_ptr<cached_block> block;
+  block_arena::content_id content;
+  // all images referencing this block; almost always just one
+  small_vector<arena_user, 1> users;
+
+  arena_user const* find_user(uint32_t image_id) const {
+    auto it = std::ranges::find(users, image_id, &arena_user::image_id);
+    return it != users.end() ? &*it : nullptr;
+  }
+
+  void remove_user(uint32_t image_id) {
+    auto it = std::ranges::find(users, image_id, &arena_user::image_id);
+    if (it != users.end()) {
+      users.erase(it);
+    }
+  }
+};
+
+class alignas(64) arena_shard {
+ public:
+  using cache_type = eviction_cache<key_type, arena_entry>;
+
+  instrumented_mutex mx;
+
+  // protected by mx
+  cache_type mutable cache{0};
+  size_t mutable cached_bytes{0};
+};
+
+struct arena_client {
+  explicit arena_client(block_arena::removal_hook&& h)
+      : hook{std::move(h)} {}
+
+  block_arena::removal_hook const hook;
+  size_t num_blocks{0};
+  std::atomic<size_t> cached_bytes{0};
+  std::atomic<size_t> shared_hits{0};
+};
+
+class block_arena_ final : public block_arena::impl {
+ public:
+  static constexpr size_t const kMaxAutoShards{64};
+
+  explicit block_arena_(block_cache_arena_options const& options)
+      : num_shards_{get_num_shards(options.num_shards)}
+      , shards_{std::make_unique<arena_shard[]>(num_shards_)}
+      , max_bytes_{options.max_bytes}
+      , options_{options} {
+    for (size_t i = 0; i < num_shards_; ++i) {
+      auto& shard = shards_[i];
+      shard.cache.set_policy(
+          make_eviction_policy<key_type>(options.eviction_policy));
+      shard.cache.set_prune_hook(
+          // NOLINTNEXTLINE(cppcoreguidelines-rvalue-reference-param-not-moved)
+          [this, &shard](key_type, arena_entry&& entry) {
+            on_removed(shard, entry);
+          });
+    }
+  }
+
+  uint32_t attach(block_arena::removal_hook hook) override {
+    std::unique_lock lock(mx_clients_);
+    auto const image_id = next_image_id_++;
+    DWARFS_CHECK(image_id <= kMaxImageId, "too many images attached to arena");
+    clients_.emplace(image_id, std::make_unique<arena_client>(std::move(hook)));
+    return image_id;
+  }
+
+  void detach(uint32_t image_id) override {
+    {
+      std::unique_lock lock(mx_clients_);
+      if (auto it = clients_.find(image_id); it != clients_.end()) {
+        total_blocks_ -= it->second->num_blocks;
+        clients_.erase(it);
+      }
+    }
+
+    // The client is gone, so its hook won't be called for these
+    remove_if(
+        image_id, [](cached_block const&) { return true; },
+        [](size_t, block_arena::block_ptr&&) {});
+  }
+
+  void set_block_size(uint32_t image_id, size_t block_size,
+                      size_t num_blocks) override {
+    DWARFS_CHECK(block_size > 0, "block size is zero");
+    DWARFS_CHECK(num_blocks <= kBlockNoMask, "too many blocks in image");
+
+    size_t max_bytes;
+    size_t max_blocks;
+
+    {
+      std::unique_lock lock(mx_clients_);
+
+      if (auto it = clients_.find(image_id); it != clients_.end()) {
+        total_blocks_ -= it->second->num_blocks;
+        it->second->num_blocks = num_blocks;
+        total_blocks_ += num_blocks;
+      }
+
+      min_block_size_ = std::min(min_block_size_, block_size);
+      max_block_size_ = std::max(max_block_size_, block_size);
+
+      // We always keep at least one block in the cache
+      max_bytes = std::max(options_.max_bytes, max_block_size_);
+      max_blocks = std::max<size_t>(max_bytes / min_block_size_, 1);
+
+      if (total_blocks_ > 0 && max_blocks > total_blocks_) {
+        max_blocks = total_blocks_;
+      }
+    }
+
+    max_bytes_.store(max_bytes, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < num_shards_; ++i) {
+      auto const& shard = shards_[i];
+      auto lock = shard.mx.lock();
+      shard.cache.set_max_size(max_blocks);
+      evict_from_shard(shard, 0);
+    }
+  }
+
+  block_arena::block_ptr
+  find(uint32_t image_id, size_t block_no,
+       block_arena::content_id const& content, bool promote) const override {
+    auto const key = make_key(image_id, block_no, content);
+    auto const& shard = shard_for(key, block_no, image_id);
+    auto lock = shard.mx.lock();
+    auto it = shard.cache.find(key, promote);
+
+    if (it == shard.cache.end() || it->second.content != content) {
+      // In the extremely unlikely case of an xxh3 collision between
+      // different blocks, the block simply won't be cached.
+      return nullptr;
+    }
+
+    auto& entry = it->second;
+
+    if (!entry.find_user(image_id)) {
+      add_user(entry, image_id, block_no, true);
+    }
+
+    return entry.block;
+  }
+
+  bool insert(uint32_t image_id, size_t block_no,
+              block_arena::content_id const& content,
+              block_arena::block_ptr block) const override {
+    auto const key = make_key(image_id, block_no, content);
+    auto const& shard = shard_for(key, block_no, image_id);
+    bool inserted = false;
+
+    {
+      auto lock = shard.mx.lock();
+
+      if (auto it = shard.cache.find(key); it != shard.cache.end()) {
+        auto& entry = it->second;
+
+        if (entry.content != content) {
+          return false;
+        }
+
+        // Another image may have inserted the same block concurrently,
+        // keep the one that is already shared.
+        if (!entry.find_user(image_id)) {
+          add_user(entry, image_id, block_no, false);
+        }
+      } else {
+        auto const bytes = block->uncompressed_size();
+        shard.cached_bytes += bytes;
+        cached_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+
+        arena_entry entry{.block = std::move(block), .content = content};
+        add_user(entry, image_id, block_no, false);
+
+        shard.cache.set(key, std::move(entry));
+        inserted = true;
+      }
+
+      // Prefer evicting from this shard as long as it holds more than
+      // its fair share of the budget.
+      evict_from_shard(shard, max_bytes_.load(std::memory_order_relaxed) /
+                                  num_shards_);
+    }
+
+    enforce_budget(shard);
+
+    return inserted;
+  }
+
+  void remove_if(uint32_t image_id, block_arena::block_predicate const& pred,
+                 block_arena::removal_hook const& hook) const override {
+    for (size_t i = 0; i < num_shards_; ++i) {
+      auto const& shard = shards_[i];
+      auto lock = shard.mx.lock();
+      auto it = shard.cache.begin();
+
+      while (it != shard.cache.end()) {
+        auto& entry = it->second;
+        auto const* user = entry.find_user(image_id);
+
+        if (!user || !pred(*entry.block)) {
+          ++it;
+          continue;
+        }
+
+        auto const block_no = user->block_no;
+
+        if (entry.users.size() > 1) {
+          // Other images still use this block, so only drop the reference
+          entry.remove_user(image_id);
+          sub_client_bytes(image_id, entry.block->uncompressed_size());
+          hook(block_no, std::shared_ptr<cached_block>(entry.block));
+          ++it;
+        } else {
+          auto block = entry.block;
+          // NOLINTBEGIN(cppcoreguidelines-rvalue-reference-param-not-moved)
+          it = shard.cache.erase(it, [this, &shard](key_type, arena_entry&& e) {
+            e.users.clear();
+            on_removed(shard, e);
+          });
+          // NOLINTEND(cppcoreguidelines-rvalue-reference-param-not-moved)
+          sub_client_bytes(image_id, block->uncompressed_size());
+          hook(block_no, std::move(block));
+        }
+      }
+    }
+  }
+
+  void for_each(uint32_t image_id,
+                block_arena::block_visitor const& visitor) const override {
+    for (size_t i = 0; i < num_shards_; ++i) {
+      auto const& shard = shards_[i];
+      auto lock = shard.mx.lock();
+
+      for (auto const& [key, entry] : shard.cache) {
+        if (auto const* user = entry.find_user(image_id)) {
+          visitor(user->block_no, *entry.block);
+        }
+      }
+    }
+  }
+
+  size_t max_bytes() const override {
+    return max_bytes_.load(std::memory_order_relaxed);
+  }
+
+  size_t cached_bytes() const override {
+    return cached_bytes_.load(std::memory_order_relaxed);
+  }
+
+  block_arena::image_stats get_image_stats(uint32_t image_id) const override {
+    block_arena::image_stats stats;
+    std::shared_lock lock(mx_clients_);
+
+    if (auto it = clients_.find(image_id); it != clients_.end()) {
+      stats.cached_bytes =
+          it->second->cached_bytes.load(std::memory_order_relaxed);
+      stats.shared_hits =
+          it->second->shared_hits.load(std::memory_order_relaxed);
+    }
+
+    return stats;
+  }
+
+  size_t num_images() const override {
+    std::shared_lock lock(mx_clients_);
+    return clients_.size();
+  }
+
+  size_t num_shards() const override { return num_shards_; }
+
+  std::string_view policy_name() const override {
+    return shards_[0].cache.policy_name();
+  }
+
+  block_arena::lock_stats get_lock_stats() const override {
+    block_arena::lock_stats stats;
+
+    for (size_t i = 0; i < num_shards_; ++i) {
+      auto const& mx = shards_[i].mx;
+      stats.acquired += mx.acquired();
+      stats.contended += mx.contended();
+      stats.wait += mx.wait();
+    }
+
+    return stats;
+  }
+
+ private:
+  static size_t get_num_shards(size_t requested) {
+    if (requested > 0) {
+      return requested;
+    }
+
+    return std::clamp<size_t>(std::bit_ceil(hardware_concurrency()), 1,
+                              kMaxAutoShards);
+  }
+
+  arena_shard const&
+  shard_for(key_type key, size_t block_no, uint32_t image_id) const {
+    if (key & kPackedKeyFlag) {
+      return shards_[(block_no + image_id) % num_shards_];
+    }
+
+    return shards_[key % num_shards_];
+  }
+
+  // must be called with the shard lock held
+  void add_user(arena_entry& entry, uint32_t image_id, size_t block_no,
+                bool is_lookup) const {
+    bool const is_shared = is_lookup && !entry.users.empty();
+
+    entry.users.push_back({image_id, block_no});
+
+    std::shared_lock lock(mx_clients_);
+
+    if (auto it = clients_.find(image_id); it != clients_.end()) {
+      it->second->cached_bytes.fetch_add(entry.block->uncompressed_size(),
+                                         std::memory_order_relaxed);
+      if (is_shared) {
+        it->second->shared_hits.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void sub_client_bytes(uint32_t image_id, size_t bytes) const {
+    std::shared_lock lock(mx_clients_);
+    if (auto it = clients_.find(image_id); it != clients_.end()) {
+      it->second->cached_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+  }
+
+  // Must be called with the shard lock held. Calls the removal hook for
+  // all images that still reference the block.
+  void on_removed(arena_shard const& shard, arena_entry& entry) const {
+    auto const bytes = entry.block->uncompressed_size();
+    shard.cached_bytes -= bytes;
+    cached_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+
+    std::shared_lock lock(mx_clients_);
+
+    for (auto const& user : entry.users) {
+      if (auto it = clients_.find(user.image_id); it != clients_.end()) {
+        it->second->cached_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        it->second->hook(user.block_no,
+                         std::shared_ptr<cached_block>(entry.block));
+      }
+    }
+  }
+
+  bool over_budget() const {
+    return cached_bytes_.load(std::memory_order_relaxed) >
+           max_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // Evict blocks from a single shard while the global budget is exceeded
+  // and the shard holds more than `keep_bytes`, but always keep at least
+  // one block. Must be called with the shard lock held.
+  void evict_from_shard(arena_shard const& shard, size_t keep_bytes) const {
+    while (over_budget() && shard.cache.size() > 1 &&
+           shard.cached_bytes > keep_bytes) {
+      shard.cache.evict();
+    }
+  }
+
+  // Enforce the global memory budget after inserting into shard `self`.
+  // Other shards are visited round-robin, one lock at a time, so we never
+  // hold more than a single shard lock.
+  void enforce_budget(arena_shard const& self) const {
+    for (size_t i = 0; i < num_shards_ && over_budget(); ++i) {
+      auto const& shard =
+          shards_[evict_hand_.fetch_add(1, std::memory_order_relaxed) %
+                  num_shards_];
+
+      if (&shard == &self) {
+        continue;
+      }
+
+      auto lock = shard.mx.lock();
+
+      while (over_budget() && !shard.cache.empty()) {
+        shard.cache.evict();
+      }
+    }
+
+    if (over_budget()) {
+      auto lock = self.mx.lock();
+      evict_from_shard(self, 0);
+    }
+  }
+
+  size_t const num_shards_;
+  std::unique_ptr<arena_shard[]> const shards_;
+  std::atomic<size_t> mutable evict_hand_{0};
+  std::atomic<size_t> max_bytes_;
+  std::atomic<size_t> mutable cached_bytes_{0};
+
+  // protects clients_ and the block size / count bookkeeping
+  std::shared_mutex mutable mx_clients_;
+  phmap::flat_hash_map<uint32_t, std::unique_ptr<arena_client>> clients_;
+  uint32_t next_image_id_{0};
+  size_t total_blocks_{0};
+  size_t min_block_size_{std::numeric_limits<size_t>::max()};
+  size_t max_block_size_{0};
+
+  block_cache_arena_options const options_;
+};
+
+} // namespace
+
+std::optional<block_content_id>
+block_content_id::from_section(fs_section const& section) {
+  auto xxh = section.xxh3_64_value();
+  auto sha = section.sha2_512_256_value();
+
+  if (!xxh || !sha || sha->size() != 32) {
+    return std::nullopt;
+  }
+
+  block_content_id id{.xxh3_64 = *xxh};
+  std::ranges::copy(*sha, id.sha2_512_256.begin());
+
+  return id;
+}
+
+block_arena::block_arena(block_cache_arena_options const& options)
+    : impl_{std::make_unique<block_arena_>(options)} {}
+
+} // namespace dwarfs::reader::internal
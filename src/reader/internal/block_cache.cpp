@@ -28,8 +28,10 @@
 
 #include <algorithm>
 #include <atomic>
+#include <bit>
 #include <cassert>
 #include <chrono>
+#include <deque>
 #include <exception>
 #include <future>
 #include <iterator>
@@ -46,6 +48,7 @@
 #include <dwarfs/file_view.h>
 #include <dwarfs/logger.h>
 #include <dwarfs/performance_monitor.h>
+#include <dwarfs/reader/block_cache_arena.h>
 #include <dwarfs/reader/block_cache_options.h>
 #include <dwarfs/reader/cache_tidy_config.h>
 #include <dwarfs/scope_exit.h>
@@ -54,10 +57,14 @@
 #include <dwarfs/internal/fs_section.h>
 #include <dwarfs/internal/value_stream_quantile_estimator.h>
 #include <dwarfs/internal/worker_group.h>
+#include <dwarfs/reader/internal/block_access_trace.h>
+#include <dwarfs/reader/internal/block_arena.h>
 #include <dwarfs/reader/internal/block_cache.h>
 #include <dwarfs/reader/internal/block_cache_byte_buffer_factory.h>
+#include <dwarfs/reader/internal/block_prefetcher.h>
 #include <dwarfs/reader/internal/cached_block.h>
-#include <dwarfs/reader/internal/lru_cache.h>
+#include <dwarfs/reader/internal/disk_block_cache.h>
+#include <dwarfs/reader/internal/instrumented_mutex.h>
 #include <dwarfs/reader/internal/periodic_executor.h>
 
 namespace dwarfs::reader::internal {
@@ -66,79 +73,6 @@ using namespace dwarfs::internal;
 
 namespace {
 
-class sequential_access_detector {
- public:
-  virtual ~sequential_access_detector() = default;
-
-  virtual void set_block_count(size_t) = 0;
-  virtual void touch(size_t block_no) = 0;
-  virtual std::optional<size_t> prefetch() const = 0;
-};
-
-class no_sequential_access_detector : public sequential_access_detector {
- public:
-  void set_block_count(size_t) override {}
-  void touch(size_t) override {}
-  std::optional<size_t> prefetch() const override { return std::nullopt; }
-};
-
-class lru_sequential_access_detector : public sequential_access_detector {
- public:
-  explicit lru_sequential_access_detector(size_t seq_blocks)
-      : lru_{seq_blocks}
-      , seq_blocks_{seq_blocks} {}
-
-  void set_block_count(size_t num_blocks) override {
-    std::lock_guard lock(mx_);
-    num_blocks_ = num_blocks;
-    lru_.clear();
-    is_sequential_.reset();
-  }
-
-  void touch(size_t block_no) override {
-    std::lock_guard lock(mx_);
-    lru_.set(
-        block_no, block_no, /* true, */
-        // NOLINTNEXTLINE(cppcoreguidelines-rvalue-reference-param-not-moved)
-        [this](size_t, size_t&&) { is_sequential_.reset(); });
-  }
-
-  std::optional<size_t> prefetch() const override {
-    std::lock_guard lock(mx_);
-
-    if (lru_.size() < seq_blocks_) {
-      return std::nullopt;
-    }
-
-    if (is_sequential_.has_value()) {
-      return std::nullopt;
-    }
-
-    auto minmax = std::ranges::minmax_element(
-        lru_, [](auto const& a, auto const& b) { return a.first < b.first; });
-
-    auto min = minmax.min->first;
-    auto max = minmax.max->first;
-
-    is_sequential_ = max - min + 1 == seq_blocks_;
-
-    if (*is_sequential_ && max + 1 < num_blocks_) {
-      return max + 1;
-    }
-
-    return std::nullopt;
-  }
-
- private:
-  using lru_type = lru_cache<size_t, size_t>;
-
-  std::mutex mutable mx_;
-  lru_type lru_;
-  std::optional<bool> mutable is_sequential_;
-  size_t num_blocks_{0};
-  size_t const seq_blocks_;
-};
-
 class block_request {
  public:
   block_request() = default;
@@ -155,10 +89,14 @@ class block_request {
 
   bool operator<(block_request const& rhs) const { return end_ < rhs.end_; }
 
+  size_t begin() const { return begin_; }
+
   size_t end() const { return end_; }
 
   void fulfill(std::shared_ptr<cached_block const> block) {
-    promise_.set_value(block_range(std::move(block), begin_, end_ - begin_));
+    // Open-ended requests (i.e. prefetches) cover the whole block
+    auto const end = std::min(end_, block->uncompressed_size());
+    promise_.set_value(block_range(std::move(block), begin_, end - begin_));
   }
 
   void error(std::exception_ptr error) {
@@ -173,9 +111,11 @@ class block_request {
 
 class block_request_set {
  public:
-  block_request_set(std::shared_ptr<cached_block> block, size_t block_no)
+  block_request_set(std::shared_ptr<cached_block> block, size_t block_no,
+                    job_priority prio)
       : block_(std::move(block))
-      , block_no_(block_no) {}
+      , block_no_(block_no)
+      , priority_(prio) {}
 
   ~block_request_set() { assert(queue_.empty()); }
 
@@ -210,25 +150,91 @@ class block_request_set {
 
   std::shared_ptr<cached_block> block() const { return block_; }
 
+  // must be called with the shard lock held
+  void replace_block(std::shared_ptr<cached_block> block) {
+    block_ = std::move(block);
+  }
+
+  // Sets for newly created blocks are first looked up in the disk cache
+  // by the worker processing the set, so no file I/O happens while the
+  // shard lock is held.
+  void set_check_disk_cache() { check_disk_cache_ = true; }
+
+  bool check_disk_cache() const { return check_disk_cache_; }
+
   size_t block_no() const { return block_no_; }
 
+  job_priority priority() const {
+    return priority_.load(std::memory_order_relaxed);
+  }
+
+  // A set that is still queued can be promoted to a more urgent class,
+  // in which case it is queued again. Only the first of these jobs to
+  // run will claim and process the set.
+  // must be called with the shard lock held
+  bool promote(job_priority prio) {
+    if (prio < priority() && !claimed_.load(std::memory_order_relaxed)) {
+      priority_.store(prio, std::memory_order_relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  bool claim() { return !claimed_.exchange(true); }
+
  private:
   std::vector<block_request> queue_;
   size_t range_end_{0};
   std::shared_ptr<cached_block> block_;
   size_t const block_no_;
+  // written under the shard lock, but read by the worker without it
+  std::atomic<job_priority> priority_;
+  std::atomic<bool> claimed_{false};
+  bool check_disk_cache_{false};
+};
+
+// Request bookkeeping is split into a number of shards, each with its
+// own lock, active request sets and decompression map. Blocks are
+// assigned to shards by block number, so concurrent requests for
+// different blocks rarely contend for the same lock. The decompressed
+// blocks themselves are kept in a (possibly shared) block arena.
+class alignas(64) block_cache_shard {
+ public:
+  template <typename Key, typename Value>
+  using fast_map_type = phmap::flat_hash_map<Key, Value>;
+
+  std::unique_lock<std::mutex> lock() const { return mx_.lock(); }
+
+  instrumented_mutex const& mutex() const { return mx_; }
+
+  // protected by the shard lock
+  fast_map_type<size_t, std::vector<std::weak_ptr<block_request_set>>> mutable
+      active;
+
+  std::mutex mutable mx_dec;
+  fast_map_type<size_t, std::weak_ptr<block_request_set>> mutable
+      decompressing;
+
+ private:
+  instrumented_mutex mx_;
 };
 
 // multi-threaded block cache
 template <typename LoggerPolicy>
 class block_cache_ final : public block_cache::impl {
  public:
+  static constexpr size_t const kMaxAutoShards{64};
+  static constexpr size_t const kMaxAutoPrefetchDepth{64};
+
   block_cache_(logger& lgr, os_access const& os, file_view const& mm,
                block_cache_options const& options,
+               std::shared_ptr<block_arena const> arena,
                std::shared_ptr<performance_monitor const> const& perfmon
                [[maybe_unused]])
-      : cache_(0)
-      , tidy_runner_{mx_, {}, "tidy-blkcache", [this] { tidy_cache(); }}
+      : num_shards_{get_num_shards(options.num_shards)}
+      , shards_{std::make_unique<block_cache_shard[]>(num_shards_)}
+      , arena_{arena ? std::move(arena) : make_private_arena(options)}
+      , tidy_runner_{mx_tidy_, {}, "tidy-blkcache", [this] { tidy_cache(); }}
       , mm_{mm}
       , buffer_factory_{block_cache_byte_buffer_factory::create(
             os, options.allocation_mode)}
@@ -238,12 +244,16 @@ class block_cache_ final : public block_cache::impl {
       PERFMON_CLS_TIMER_INIT(get, "block_no", "offset", "size")
       PERFMON_CLS_TIMER_INIT(process, "block_no")
       PERFMON_CLS_TIMER_INIT(decompress, "range_end") // clang-format on
-      , seq_access_detector_{create_seq_access_detector(
-            options.sequential_access_detector_threshold)}
+      , prefetcher_{create_prefetcher(options)}
+      , num_workers_{std::max(options.num_workers > 0
+                                  ? options.num_workers
+                                  : hardware_concurrency(),
+                              static_cast<size_t>(1))}
       , os_{os}
       , options_(options) {
-    cache_.set_prune_hook(
+    image_id_ = arena_->attach(
         [this](size_t block_no, std::shared_ptr<cached_block>&& block) {
+          spill_block(block_no, block);
           on_block_removed("evicted", block_no, std::move(block));
           blocks_evicted_.fetch_add(1, std::memory_order_relaxed);
         });
@@ -252,6 +262,16 @@ class block_cache_ final : public block_cache::impl {
   ~block_cache_() noexcept override {
     LOG_DEBUG << "stopping cache workers";
 
+    // Other images sharing the arena can still evict our blocks until we
+    // detach below. Make sure this doesn't queue any more jobs (or even
+    // start a new worker group) once the workers are gone.
+    stopping_.store(true);
+
+    {
+      std::lock_guard lock(mx_preload_);
+      preload_queue_.clear();
+    }
+
     tidy_runner_.stop();
 
     {
@@ -262,19 +282,40 @@ class block_cache_ final : public block_cache::impl {
       }
     }
 
+    auto const image_stats = arena_->get_image_stats(image_id_);
+    auto const arena_images = arena_->num_images();
+
+    if (blocks_created_.load()) {
+      LOG_DEBUG << "cached blocks:";
+
+      arena_->for_each(image_id_, [this](size_t block_no,
+                                         cached_block const& cb) {
+        LOG_DEBUG << "  block " << block_no << ", decompression ratio = "
+                  << static_cast<double>(cb.range_end()) /
+                         static_cast<double>(cb.uncompressed_size());
+        update_block_stats(cb);
+      });
+    }
+
+    arena_->detach(image_id_);
+
     if (!blocks_created_.load()) {
       return;
     }
 
-    LOG_DEBUG << "cached blocks:";
+    size_t lock_acquired{0};
+    size_t lock_contended{0};
+    std::chrono::nanoseconds lock_wait{0};
 
-    for (auto const& cb : cache_) {
-      LOG_DEBUG << "  block " << cb.first << ", decompression ratio = "
-                << static_cast<double>(cb.second->range_end()) /
-                       static_cast<double>(cb.second->uncompressed_size());
-      update_block_stats(*cb.second);
+    for (size_t i = 0; i < num_shards_; ++i) {
+      auto const& mx = shards_[i].mutex();
+      lock_acquired += mx.acquired();
+      lock_contended += mx.contended();
+      lock_wait += mx.wait();
     }
 
+    auto const arena_locks = arena_->get_lock_stats();
+
     double fast_hit_rate =
         100.0 * (active_hits_fast_ + cache_hits_fast_) / range_requests_;
     double slow_hit_rate =
@@ -282,6 +323,16 @@ class block_cache_ final : public block_cache::impl {
     double miss_rate = 100.0 - (fast_hit_rate + slow_hit_rate);
     double avg_decompression =
         100.0 * total_decompressed_bytes_ / total_block_bytes_;
+    double contention_rate =
+        lock_acquired > 0 ? 100.0 * lock_contended / lock_acquired : 0.0;
+    double arena_contention_rate =
+        arena_locks.acquired > 0
+            ? 100.0 * arena_locks.contended / arena_locks.acquired
+            : 0.0;
+    auto const cache_hits = cache_hits_fast_ + cache_hits_slow_;
+    auto const cache_lookups = cache_hits + cache_misses_;
+    double cache_hit_ratio =
+        cache_lookups > 0 ? 100.0 * cache_hits / cache_lookups : 0.0;
 
     // The same block can be evicted multiple times. Active requests may hold
     // on to a block that has been evicted from the cache and re-insert the
@@ -292,7 +343,41 @@ class block_cache_ final : public block_cache::impl {
     LOG_VERBOSE << "blocks tidied: " << blocks_tidied_.load();
     LOG_VERBOSE << "request sets merged: " << sets_merged_.load();
     LOG_VERBOSE << "total requests: " << range_requests_.load();
-    LOG_VERBOSE << "sequential prefetches: " << sequential_prefetches_.load();
+    LOG_VERBOSE << "prefetches: " << prefetches_started_.load();
+    LOG_VERBOSE << "blocks preloaded: " << blocks_preloaded_.load();
+    LOG_VERBOSE << "jobs promoted: " << jobs_promoted_.load();
+    LOG_VERBOSE << "sub-frame helper jobs: " << subframe_jobs_.load();
+    if (wg_) {
+      for (size_t i = 0; i < num_job_priorities; ++i) {
+        auto const prio = static_cast<job_priority>(i);
+        auto const qs = wg_.get_queue_stats(prio);
+        if (qs.jobs > 0) {
+          LOG_VERBOSE << "queue wait (" << job_priority_name(prio)
+                      << "): " << qs.jobs << " jobs, avg "
+                      << time_with_unit(qs.total_wait / qs.jobs) << ", max "
+                      << time_with_unit(qs.max_wait);
+        }
+      }
+    }
+    if (recorder_) {
+      LOG_VERBOSE << "blocks recorded in access trace: "
+                  << recorder_->num_recorded();
+    }
+    if (prefetcher_) {
+      auto const ps = prefetcher_->get_stats();
+      LOG_VERBOSE << "access streams detected: " << ps.streams_detected;
+      LOG_VERBOSE << "prefetches issued: " << ps.prefetches_issued;
+      LOG_VERBOSE << "prefetch hits: " << ps.prefetch_hits
+                  << ", late: " << ps.late_prefetches
+                  << ", evicted: " << ps.evicted_prefetches
+                  << ", abandoned: " << ps.abandoned_prefetches;
+      LOG_VERBOSE << "streams reaching max prefetch depth: "
+                  << ps.max_depth_reached;
+    }
+    if (disk_cache_) {
+      LOG_VERBOSE << "blocks spilled to disk: " << blocks_spilled_.load();
+      LOG_VERBOSE << "blocks loaded from disk: " << disk_hits_.load();
+    }
     LOG_VERBOSE << "active hits (fast): " << active_hits_fast_.load();
     LOG_VERBOSE << "active hits (slow): " << active_hits_slow_.load();
     LOG_VERBOSE << "cache hits (fast): " << cache_hits_fast_.load();
@@ -308,6 +393,10 @@ class block_cache_ final : public block_cache::impl {
                 << "%";
     LOG_VERBOSE << "miss rate: " << fmt::format("{:.3f}", miss_rate) << "%";
 
+    LOG_VERBOSE << "cache hit ratio (" << arena_->policy_name()
+                << "): " << fmt::format("{:.3f}", cache_hit_ratio) << "% ("
+                << cache_hits << "/" << cache_lookups << ")";
+
     LOG_VERBOSE << "expired active requests: " << active_expired_.load();
 
     auto pct = [&](double p) { return active_set_size_.quantile(p / 100.0); };
@@ -315,26 +404,47 @@ class block_cache_ final : public block_cache::impl {
     LOG_VERBOSE << "active set size p50: " << pct(50) << ", p75: " << pct(75)
                 << ", p90: " << pct(90) << ", p95: " << pct(95)
                 << ", p99: " << pct(99);
+
+    LOG_VERBOSE << "cache shards: " << num_shards_;
+    LOG_VERBOSE << "shard lock acquisitions: " << lock_acquired;
+    LOG_VERBOSE << "shard lock contention: "
+                << fmt::format("{:.3f}", contention_rate) << "% ("
+                << lock_contended << " waits)";
+    LOG_VERBOSE << "total shard lock wait time: "
+                << time_with_unit(lock_wait);
+
+    LOG_VERBOSE << "arena shards: " << arena_->num_shards();
+    LOG_VERBOSE << "arena lock contention: "
+                << fmt::format("{:.3f}", arena_contention_rate) << "% ("
+                << arena_locks.contended << " waits)";
+    LOG_VERBOSE << "total arena lock wait time: "
+                << time_with_unit(arena_locks.wait);
+    LOG_VERBOSE << "arena bytes used by this image: "
+                << size_with_unit(image_stats.cached_bytes) << " of "
+                << size_with_unit(arena_->max_bytes()) << " (" << arena_images
+                << " image" << (arena_images == 1 ? "" : "s") << " attached)";
+    LOG_VERBOSE << "blocks shared with other images: "
+                << image_stats.shared_hits;
   }
 
   size_t block_count() const override { return block_.size(); }
 
   void insert(fs_section const& section) override {
     block_.emplace_back(section);
-    seq_access_detector_->set_block_count(block_.size());
+    if (prefetcher_) {
+      prefetcher_->set_block_count(block_.size());
+    }
   }
 
   void set_block_size(size_t size) override {
-    DWARFS_CHECK(size > 0, "block size is zero");
-
-    auto max_blocks = std::max<size_t>(options_.max_bytes / size, 1);
+    arena_->set_block_size(image_id_, size, block_.size());
 
-    if (!block_.empty() && max_blocks > block_.size()) {
-      max_blocks = block_.size();
+    if (prefetcher_ && options_.max_prefetch_depth == 0 && size > 0) {
+      // Don't prefetch so far ahead that the blocks would likely be
+      // evicted again before they are used
+      prefetcher_->set_max_depth(std::clamp<size_t>(
+          arena_->max_bytes() / (4 * size), 1, kMaxAutoPrefetchDepth));
     }
-
-    std::lock_guard lock(mx_);
-    cache_.set_max_size(max_blocks);
   }
 
   void set_num_workers(size_t num) override {
@@ -345,21 +455,26 @@ class block_cache_ final : public block_cache::impl {
     }
 
     wg_ = worker_group(LOG_GET_LOGGER, os_, "blkcache", {.num_workers = num});
+    num_workers_.store(std::max<size_t>(num, 1), std::memory_order_relaxed);
   }
 
   void set_tidy_config(cache_tidy_config const& cfg) override {
     if (cfg.strategy == cache_tidy_strategy::NONE) {
       tidy_runner_.stop();
+      touch_blocks_.store(false, std::memory_order_relaxed);
     } else {
       if (cfg.interval == std::chrono::milliseconds::zero()) {
         DWARFS_THROW(runtime_error, "tidy interval is zero");
       }
 
       {
-        std::lock_guard lock(mx_);
+        std::lock_guard lock(mx_tidy_);
         tidy_config_ = cfg;
       }
 
+      touch_blocks_.store(cfg.strategy == cache_tidy_strategy::EXPIRY_TIME,
+                          std::memory_order_relaxed);
+
       tidy_runner_.set_period(cfg.interval);
 
       if (!tidy_runner_.running()) {
@@ -368,24 +483,36 @@ class block_cache_ final : public block_cache::impl {
     }
   }
 
-  std::future<block_range>
-  get(size_t block_no, size_t offset, size_t size) const override {
+  void set_disk_cache(std::shared_ptr<disk_block_cache const> cache) override {
+    disk_cache_ = std::move(cache);
+  }
+
+  void set_access_recorder(
+      std::shared_ptr<block_access_recorder> recorder) override {
+    recorder_ = std::move(recorder);
+  }
+
+  void preload(std::span<size_t const> blocks) const override {
+    {
+      std::lock_guard lock(mx_preload_);
+      preload_queue_.insert(preload_queue_.end(), blocks.begin(),
+                            blocks.end());
+    }
+
+    continue_preload();
+  }
+
+  std::future<block_range> get(size_t block_no, size_t offset, size_t size,
+                               job_priority prio) const override {
     PERFMON_CLS_SCOPED_SECTION(get)
     PERFMON_SET_CONTEXT(block_no, offset, size)
 
-    seq_access_detector_->touch(block_no);
+    auto const is_demand = prio == job_priority::DEMAND;
+    auto access_result = block_access_result::MISS;
 
     scope_exit do_prefetch{[&] {
-      if (auto next = seq_access_detector_->prefetch()) {
-        std::lock_guard lock(mx_);
-
-        if (cache_.find(*next, false) == cache_.end() &&
-            active_.find(*next) == active_.end()) {
-          sequential_prefetches_.fetch_add(1, std::memory_order_relaxed);
-          LOG_TRACE << "prefetching block " << *next;
-          create_cached_block(*next, std::promise<block_range>{}, 0,
-                              std::numeric_limits<size_t>::max());
-        }
+      if (prefetcher_ && is_demand) {
+        prefetch_after(block_no, access_result);
       }
     }};
 
@@ -403,6 +530,10 @@ class block_cache_ final : public block_cache::impl {
                                  block_no, block_.size()));
       }
 
+      if (recorder_ && is_demand) {
+        recorder_->record(block_no);
+      }
+
       // TODO: we probably want to change the interface for `section.data()`
       //       so that we don't need multiple different `data()` methods
       if (mm_.supports_raw_bytes()) {
@@ -411,8 +542,11 @@ class block_cache_ final : public block_cache::impl {
         if (section.compression() == compression_type::NONE) {
           LOG_TRACE << "block " << block_no
                     << " is uncompressed, bypassing cache";
-          promise.set_value(
-              block_range(section.raw_bytes(mm_).data(), offset, size));
+          auto const data = section.raw_bytes(mm_).data();
+          promise.set_value(block_range(
+              data, offset, size,
+              std::distance(mm_.raw_bytes<uint8_t>().data(), data)));
+          access_result = block_access_result::CACHE_HIT;
           return future;
         }
       }
@@ -421,17 +555,18 @@ class block_cache_ final : public block_cache::impl {
       return future;
     }
 
-    // That is a mighty long lock, let's see how it works...
-    std::lock_guard lock(mx_);
+    // Only the shard that owns this block needs to be locked
+    auto const& shard = shard_for(block_no);
+    auto lock = shard.lock();
 
     auto const range_end = offset + size;
 
     // See if the block is currently active (about-to-be decompressed)
-    auto ia = active_.find(block_no);
+    auto ia = shard.active.find(block_no);
 
     std::shared_ptr<block_request_set> brs;
 
-    if (ia != active_.end()) {
+    if (ia != shard.active.end()) {
       LOG_TRACE << "active sets found for block " << block_no;
 
       bool add_to_set = false;
@@ -464,7 +599,7 @@ class block_cache_ final : public block_cache::impl {
       if (ia->second.empty()) {
         // No request sets left at all? M'kay.
         assert(!brs);
-        active_.erase(ia);
+        shard.active.erase(ia);
       } else if (brs) {
         // That's the one
         // Check if by any chance the block has already
@@ -474,17 +609,19 @@ class block_cache_ final : public block_cache::impl {
 
         LOG_TRACE << "block " << block_no << " found in active set";
 
+        access_result = block_access_result::IN_FLIGHT;
+
         auto block = brs->block();
 
-        if (range_end <= block->range_end()) {
+        if (block->is_available(offset, range_end)) {
           // We can immediately satisfy the promise
           promise.set_value(block_range(std::move(block), offset, size));
           active_hits_fast_.fetch_add(1, std::memory_order_relaxed);
         } else {
           if (!add_to_set) {
             // Make a new set for the same block
-            brs =
-                std::make_shared<block_request_set>(std::move(block), block_no);
+            brs = std::make_shared<block_request_set>(std::move(block),
+                                                      block_no, prio);
           }
 
           // Promise will be fulfilled asynchronously
@@ -494,7 +631,13 @@ class block_cache_ final : public block_cache::impl {
           if (!add_to_set) {
             ia->second.emplace_back(brs);
             active_set_size_.add(ia->second.size());
-            enqueue_job(std::move(brs));
+            enqueue_job(std::move(brs), prio);
+          } else if (brs->promote(prio)) {
+            // Don't let the request wait behind less urgent jobs
+            LOG_TRACE << "promoting block " << block_no << " to "
+                      << job_priority_name(prio);
+            jobs_promoted_.fetch_add(1, std::memory_order_relaxed);
+            enqueue_job(std::move(brs), prio);
           }
         }
 
@@ -505,31 +648,30 @@ class block_cache_ final : public block_cache::impl {
     }
 
     // See if it's cached (fully or partially decompressed)
-    auto ic = cache_.find(block_no);
-
-    if (ic != cache_.end()) {
+    if (auto block = arena_->find(image_id_, block_no, content_id(block_no))) {
       // Nice, at least the block is already there.
 
       LOG_TRACE << "block " << block_no << " found in cache";
 
-      auto block = ic->second;
+      access_result = block_access_result::CACHE_HIT;
 
-      if (range_end <= block->range_end()) {
+      if (block->is_available(offset, range_end)) {
         // We can immediately satisfy the promise
         promise.set_value(block_range(std::move(block), offset, size));
         cache_hits_fast_.fetch_add(1, std::memory_order_relaxed);
       } else {
         // Make a new set for the block
-        brs = std::make_shared<block_request_set>(std::move(block), block_no);
+        brs = std::make_shared<block_request_set>(std::move(block), block_no,
+                                                  prio);
 
         // Promise will be fulfilled asynchronously
         brs->add(offset, range_end, std::move(promise));
         cache_hits_slow_.fetch_add(1, std::memory_order_relaxed);
 
-        auto& active = active_[block_no];
+        auto& active = shard.active[block_no];
         active.emplace_back(brs);
         active_set_size_.add(active.size());
-        enqueue_job(std::move(brs));
+        enqueue_job(std::move(brs), prio);
       }
 
       return future;
@@ -537,17 +679,49 @@ class block_cache_ final : public block_cache::impl {
 
     // Bummer. We don't know anything about the block.
 
+    cache_misses_.fetch_add(1, std::memory_order_relaxed);
+
     LOG_TRACE << "block " << block_no << " not found";
 
-    create_cached_block(block_no, std::move(promise), offset, range_end);
+    create_cached_block(shard, block_no, std::move(promise), offset, range_end,
+                        prio);
 
     return future;
   }
 
  private:
+  static std::shared_ptr<block_arena const>
+  make_private_arena(block_cache_options const& options) {
+    return std::make_shared<block_arena>(block_cache_arena_options{
+        .max_bytes = options.max_bytes,
+        .num_shards = options.num_shards,
+        .eviction_policy = options.eviction_policy,
+    });
+  }
+
+  // Blocks are identified by their content in the arena, so identical
+  // blocks from different images are only cached once. Only call this
+  // when the block is actually accessed, as it loads lazy sections.
+  block_arena::content_id content_id(size_t block_no) const {
+    return block_content_id::from_section(block_[block_no]);
+  }
+
+  static size_t get_num_shards(size_t requested) {
+    if (requested > 0) {
+      return requested;
+    }
+
+    return std::clamp<size_t>(std::bit_ceil(hardware_concurrency()), 1,
+                              kMaxAutoShards);
+  }
+
+  block_cache_shard const& shard_for(size_t block_no) const {
+    return shards_[block_no % num_shards_];
+  }
+
   // NOLINTBEGIN(cppcoreguidelines-rvalue-reference-param-not-moved)
   void on_block_removed(std::string_view action, size_t block_no,
-                        std::shared_ptr<cached_block>&& block) {
+                        std::shared_ptr<cached_block>&& block) const {
     // NOLINTEND(cppcoreguidelines-rvalue-reference-param-not-moved)
     LOG_DEBUG << "block " << block_no << " " << action
               << " from cache, decompression ratio = "
@@ -556,42 +730,155 @@ class block_cache_ final : public block_cache::impl {
     update_block_stats(*block);
   }
 
-  static std::unique_ptr<sequential_access_detector>
-  create_seq_access_detector(size_t threshold) {
-    if (threshold == 0) {
-      return std::make_unique<no_sequential_access_detector>();
+  static std::unique_ptr<block_prefetcher>
+  create_prefetcher(block_cache_options const& options) {
+    if (options.sequential_access_detector_threshold == 0) {
+      return nullptr;
     }
 
-    return std::make_unique<lru_sequential_access_detector>(threshold);
+    return std::make_unique<block_prefetcher>(block_prefetcher_options{
+        .threshold = options.sequential_access_detector_threshold,
+        .max_depth = options.max_prefetch_depth > 0
+                         ? options.max_prefetch_depth
+                         : kMaxAutoPrefetchDepth,
+    });
+  }
+
+  // Prefetching is limited by the number of idle workers, so that
+  // demand requests never queue up behind a large number of prefetches.
+  // Allowing a backlog of one job per worker keeps all workers busy.
+  size_t prefetch_capacity() const {
+    auto const slots = 2 * num_workers_.load(std::memory_order_relaxed);
+    auto const pending = jobs_pending_.load(std::memory_order_relaxed);
+    return pending < slots ? slots - pending : 0;
+  }
+
+  bool has_idle_workers() const {
+    return jobs_pending_.load(std::memory_order_relaxed) <
+           num_workers_.load(std::memory_order_relaxed);
+  }
+
+  void prefetch_after(size_t block_no, block_access_result result) const {
+    block_prefetcher::block_list blocks;
+
+    // Always allow at least the next block of a stream to be prefetched,
+    // even if all workers are busy. Otherwise, the stream could overtake
+    // its own prefetches and skip blocks entirely.
+    prefetcher_->access(block_no, result,
+                        std::max<size_t>(prefetch_capacity(), 1), blocks);
+
+    for (auto next : blocks) {
+      if (start_prefetch(next, job_priority::PREFETCH)) {
+        prefetches_started_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
   }
 
-  void create_cached_block(size_t block_no, std::promise<block_range>&& promise,
-                           size_t offset, size_t range_end) const {
+  // Start decompressing a block unless it is already active or cached
+  bool start_prefetch(size_t block_no, job_priority prio) const {
+    auto const& shard = shard_for(block_no);
+    auto lock = shard.lock();
+
+    if (shard.active.find(block_no) != shard.active.end() ||
+        arena_->find(image_id_, block_no, content_id(block_no), false)) {
+      return false;
+    }
+
+    LOG_TRACE << "prefetching block " << block_no;
+    create_cached_block(shard, block_no, std::promise<block_range>{}, 0,
+                        std::numeric_limits<size_t>::max(), prio);
+
+    return true;
+  }
+
+  // Preloading is driven by job completion and only ever uses idle
+  // workers, so it never delays demand requests.
+  void continue_preload() const {
+    for (;;) {
+      size_t block_no;
+
+      {
+        std::lock_guard lock(mx_preload_);
+
+        if (preload_queue_.empty() || !has_idle_workers()) {
+          return;
+        }
+
+        block_no = preload_queue_.front();
+        preload_queue_.pop_front();
+      }
+
+      if (block_no >= block_.size() ||
+          (mm_.supports_raw_bytes() &&
+           block_[block_no].compression() == compression_type::NONE)) {
+        // Uncompressed blocks bypass the cache anyway
+        continue;
+      }
+
+      if (start_prefetch(block_no, job_priority::PRELOAD)) {
+        blocks_preloaded_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // must be called with the shard lock held
+  void create_cached_block(block_cache_shard const& shard, size_t block_no,
+                           std::promise<block_range>&& promise, size_t offset,
+                           size_t range_end, job_priority prio) const {
     try {
       auto const& section = DWARFS_NOTHROW(block_.at(block_no));
 
-      std::shared_ptr<cached_block> block = cached_block::create(
-          LOG_GET_LOGGER, section, section.segment(mm_), buffer_factory_,
-          options_.disable_block_integrity_check);
+      auto block = cached_block::create(LOG_GET_LOGGER, section,
+                                        section.segment(mm_), buffer_factory_,
+                                        options_.disable_block_integrity_check);
+
       blocks_created_.fetch_add(1, std::memory_order_relaxed);
 
       // Make a new set for the block
-      auto brs =
-          std::make_shared<block_request_set>(std::move(block), block_no);
+      auto brs = std::make_shared<block_request_set>(std::move(block),
+                                                     block_no, prio);
+
+      if (disk_cache_) {
+        brs->set_check_disk_cache();
+      }
 
       // Promise will be fulfilled asynchronously
       brs->add(offset, range_end, std::move(promise));
 
-      auto& active = active_[block_no];
+      auto& active = shard.active[block_no];
       active.emplace_back(brs);
       active_set_size_.add(active.size());
-      enqueue_job(std::move(brs));
+      enqueue_job(std::move(brs), prio);
     } catch (...) {
       promise.set_exception(std::current_exception());
     }
   }
 
-  void update_block_stats(cached_block const& cb) {
+  // Write a fully decompressed block to the disk cache. This happens
+  // asynchronously on a cache worker, which keeps the block alive until
+  // it has been written.
+  void spill_block(size_t block_no,
+                   std::shared_ptr<cached_block> const& block) const {
+    if (!disk_cache_ || block->range_end() < block->uncompressed_size() ||
+        stopping_.load()) {
+      return;
+    }
+
+    auto const& section = block_[block_no];
+
+    if (disk_cache_->contains(section, block_no)) {
+      return;
+    }
+
+    blocks_spilled_.fetch_add(1, std::memory_order_relaxed);
+
+    // Spilling is the least urgent thing a worker can do
+    add_job(job_priority::PRELOAD, [this, &section, block_no, block] {
+      disk_cache_->store(section, block_no, *block);
+    });
+  }
+
+  void update_block_stats(cached_block const& cb) const {
     if (cb.range_end() < cb.uncompressed_size()) {
       partially_decompressed_.fetch_add(1, std::memory_order_relaxed);
     }
@@ -604,23 +891,54 @@ class block_cache_ final : public block_cache::impl {
   void init_worker_group() const {
     std::unique_lock lock(mx_wg_);
 
-    if (!wg_) {
-      wg_ = worker_group(LOG_GET_LOGGER, os_, "blkcache",
-                         {.num_workers = std::max(options_.num_workers > 0
-                                                      ? options_.num_workers
-                                                      : hardware_concurrency(),
-                                                  static_cast<size_t>(1))});
+    if (!wg_ && !stopping_.load()) {
+      wg_ = worker_group(
+          LOG_GET_LOGGER, os_, "blkcache",
+          {.num_workers = num_workers_.load(std::memory_order_relaxed)});
     }
   }
 
-  void enqueue_job(std::shared_ptr<block_request_set> brs) const {
+  void add_job(job_priority prio, worker_group::job_type&& job) const {
     // lazy initialization of worker group
     std::call_once(wg_init_flag_, [this] { init_worker_group(); });
 
     std::shared_lock lock(mx_wg_);
 
+    if (!stopping_.load()) {
+      wg_.add_job(prio, std::move(job));
+    }
+  }
+
+  // Helper jobs for decompressing sub-frames in parallel. Each job keeps
+  // its own reference to the block, as it may outlive the request.
+  cached_block::task_spawner
+  subframe_spawner(std::shared_ptr<cached_block> const& block,
+                   job_priority prio) const {
+    if (!block->has_subframes()) {
+      return {};
+    }
+
+    return [this, block, prio](size_t count, std::function<void()> const& task) {
+      auto const workers = num_workers_.load(std::memory_order_relaxed);
+      count = std::min(count, workers > 0 ? workers - 1 : 0);
+
+      for (size_t i = 0; i < count; ++i) {
+        subframe_jobs_.fetch_add(1, std::memory_order_relaxed);
+        add_job(prio, [block, task] { task(); });
+      }
+    };
+  }
+
+  void enqueue_job(std::shared_ptr<block_request_set> brs,
+                   job_priority prio) const {
+    jobs_pending_.fetch_add(1, std::memory_order_relaxed);
+
     // Lambda needs to be mutable so we can actually move out of it
-    wg_.add_job([this, brs = std::move(brs)]() mutable {
+    add_job(prio, [this, brs = std::move(brs)]() mutable {
+      scope_exit done{[this] {
+        jobs_pending_.fetch_sub(1, std::memory_order_relaxed);
+        continue_preload();
+      }};
       process_job(std::move(brs));
     });
   }
@@ -631,16 +949,23 @@ class block_cache_ final : public block_cache::impl {
     auto block_no = brs->block_no();
     PERFMON_SET_CONTEXT(block_no)
 
+    if (!brs->claim()) {
+      LOG_TRACE << "block " << block_no << " already claimed by another job";
+      return;
+    }
+
     LOG_TRACE << "processing block " << block_no;
 
+    auto const& shard = shard_for(block_no);
+
     // Check if another worker is already processing this block
     {
-      std::lock_guard lock_dec(mx_dec_);
+      std::lock_guard lock_dec(shard.mx_dec);
 
-      auto di = decompressing_.find(block_no);
+      auto di = shard.decompressing.find(block_no);
 
-      if (di != decompressing_.end()) {
-        std::lock_guard lock(mx_);
+      if (di != shard.decompressing.end()) {
+        auto lock = shard.lock();
 
         if (auto other = di->second.lock()) {
           LOG_TRACE << "merging sets for block " << block_no;
@@ -651,18 +976,30 @@ class block_cache_ final : public block_cache::impl {
         }
       }
 
-      decompressing_[block_no] = brs;
+      shard.decompressing[block_no] = brs;
     }
 
     auto block = brs->block();
 
+    if (brs->check_disk_cache()) {
+      if (auto loaded = disk_cache_->load(block_[block_no], block_no)) {
+        LOG_TRACE << "block " << block_no << " loaded from disk cache";
+        disk_hits_.fetch_add(1, std::memory_order_relaxed);
+        auto lock = shard.lock();
+        brs->replace_block(loaded);
+        block = std::move(loaded);
+      }
+    }
+
+    auto const spawn = subframe_spawner(block, brs->priority());
+
     for (;;) {
       block_request req;
       bool is_last_req = false;
 
       // Fetch the next request, if any
       {
-        std::lock_guard lock(mx_);
+        auto lock = shard.lock();
 
         if (brs->empty()) {
           // This is absolutely crucial! At this point, we can no longer
@@ -678,6 +1015,8 @@ class block_cache_ final : public block_cache::impl {
 
       // Process this request!
 
+      // Blocks with sub-frames don't need to be decompressed from the start
+      size_t range_begin = block->has_subframes() ? req.begin() : 0;
       size_t range_end = req.end();
       auto max_end = block->uncompressed_size();
 
@@ -686,24 +1025,25 @@ class block_cache_ final : public block_cache::impl {
       }
 
       if (is_last_req) {
-        double ratio =
-            static_cast<double>(range_end) / static_cast<double>(max_end);
+        double ratio = static_cast<double>(range_end - range_begin) /
+                       static_cast<double>(max_end);
         if (ratio > options_.decompress_ratio) {
           LOG_TRACE << "block " << block_no << " over ratio: " << ratio << " > "
                     << options_.decompress_ratio;
+          range_begin = 0;
           range_end = max_end;
         }
       }
 
       try {
-        if (range_end > block->range_end()) {
+        if (!block->is_available(range_begin, range_end)) {
           PERFMON_CLS_SCOPED_SECTION(decompress)
           PERFMON_SET_CONTEXT(range_end)
 
-          LOG_TRACE << "decompressing block " << block_no << " until position "
-                    << range_end;
+          LOG_TRACE << "decompressing block " << block_no << " range "
+                    << range_begin << " to " << range_end;
 
-          block->decompress_until(range_end);
+          block->decompress_range(range_begin, range_end, spawn);
         }
 
         req.fulfill(block);
@@ -713,38 +1053,25 @@ class block_cache_ final : public block_cache::impl {
     }
 
     // Finally, put the block into the cache; it might already be
-    // in there, in which case we just promote it to the front of
-    // the LRU queue.
-    {
-      std::lock_guard lock(mx_);
-
-      if (tidy_config_.strategy == cache_tidy_strategy::EXPIRY_TIME) {
-        block->touch();
-      }
+    // in there, in which case we just record the access with the
+    // eviction policy.
+    if (touch_blocks_.load(std::memory_order_relaxed)) {
+      block->touch();
+    }
 
-      LOG_DEBUG << "inserting block " << block_no << " into cache";
+    LOG_DEBUG << "inserting block " << block_no << " into cache";
 
-      cache_.set(block_no, std::move(block));
-    }
+    arena_->insert(image_id_, block_no, content_id(block_no), std::move(block));
   }
 
-  template <typename Pred>
-  void remove_block_if(Pred const& predicate) {
-    auto it = cache_.begin();
-
-    while (it != cache_.end()) {
-      if (predicate(*it->second)) {
-        LOG_TRACE << "tidying block " << it->first;
-        it = cache_.erase(
-            it, [this](size_t block_no, std::shared_ptr<cached_block>&& block) {
-              on_block_removed("tidied", block_no, std::move(block));
-              blocks_tidied_.fetch_add(1, std::memory_order_relaxed);
-            });
-      } else {
-        LOG_TRACE << "keeping block " << it->first;
-        ++it;
-      }
-    }
+  void remove_block_if(block_arena::block_predicate const& predicate) {
+    arena_->remove_if(
+        image_id_, predicate,
+        [this](size_t block_no, std::shared_ptr<cached_block>&& block) {
+          LOG_TRACE << "tidying block " << block_no;
+          on_block_removed("tidied", block_no, std::move(block));
+          blocks_tidied_.fetch_add(1, std::memory_order_relaxed);
+        });
   }
 
   void tidy_cache() {
@@ -770,19 +1097,15 @@ class block_cache_ final : public block_cache::impl {
     }
   }
 
-  using lru_type = lru_cache<size_t, std::shared_ptr<cached_block>>;
-  template <typename Key, typename Value>
-  using fast_map_type = phmap::flat_hash_map<Key, Value>;
+  size_t const num_shards_;
+  std::unique_ptr<block_cache_shard[]> const shards_;
+  std::shared_ptr<block_arena const> const arena_;
+  uint32_t image_id_{0};
 
-  mutable std::mutex mx_;
-  mutable lru_type cache_;
-  mutable fast_map_type<size_t, std::vector<std::weak_ptr<block_request_set>>>
-      active_;
+  // protects tidy_config_; held by the tidy runner while tidying
+  std::mutex mx_tidy_;
   periodic_executor tidy_runner_;
-
-  mutable std::mutex mx_dec_;
-  mutable fast_map_type<size_t, std::weak_ptr<block_request_set>>
-      decompressing_;
+  std::atomic<bool> touch_blocks_{false};
 
   mutable std::atomic<size_t> blocks_created_{0};
   mutable std::atomic<size_t> blocks_evicted_{0};
@@ -792,19 +1115,31 @@ class block_cache_ final : public block_cache::impl {
   mutable std::atomic<size_t> active_hits_slow_{0};
   mutable std::atomic<size_t> cache_hits_fast_{0};
   mutable std::atomic<size_t> cache_hits_slow_{0};
+  mutable std::atomic<size_t> cache_misses_{0};
   mutable std::atomic<size_t> partially_decompressed_{0};
   mutable std::atomic<size_t> total_block_bytes_{0};
   mutable std::atomic<size_t> total_decompressed_bytes_{0};
   mutable std::atomic<size_t> blocks_tidied_{0};
   mutable std::atomic<size_t> active_expired_{0};
-  mutable std::atomic<size_t> sequential_prefetches_{0};
+  mutable std::atomic<size_t> prefetches_started_{0};
+  mutable std::atomic<size_t> jobs_pending_{0};
+  mutable std::atomic<size_t> blocks_preloaded_{0};
+  mutable std::atomic<size_t> jobs_promoted_{0};
+  mutable std::atomic<size_t> subframe_jobs_{0};
+  mutable std::atomic<size_t> blocks_spilled_{0};
+  mutable std::atomic<size_t> disk_hits_{0};
   mutable value_stream_quantile_estimator active_set_size_{0.5, 0.75, 0.9, 0.95,
                                                            0.99};
 
   mutable std::shared_mutex mx_wg_;
   mutable worker_group wg_;
+  std::atomic<bool> stopping_{false};
   mutable std::once_flag wg_init_flag_;
   std::vector<fs_section> block_;
+  std::shared_ptr<disk_block_cache const> disk_cache_;
+  std::shared_ptr<block_access_recorder> recorder_;
+  std::mutex mutable mx_preload_;
+  std::deque<size_t> mutable preload_queue_;
   file_view mm_;
   byte_buffer_factory buffer_factory_;
   LOG_PROXY_DECL(LoggerPolicy);
@@ -812,7 +1147,8 @@ class block_cache_ final : public block_cache::impl {
   PERFMON_CLS_TIMER_DECL(get)
   PERFMON_CLS_TIMER_DECL(process)
   PERFMON_CLS_TIMER_DECL(decompress)
-  std::unique_ptr<sequential_access_detector> seq_access_detector_;
+  std::unique_ptr<block_prefetcher> const prefetcher_;
+  std::atomic<size_t> num_workers_;
   os_access const& os_;
   block_cache_options const options_;
   cache_tidy_config tidy_config_;
@@ -823,8 +1159,9 @@ class block_cache_ final : public block_cache::impl {
 block_cache::block_cache(
     logger& lgr, os_access const& os, file_view const& mm,
     block_cache_options const& options,
+    std::shared_ptr<block_arena const> arena,
     std::shared_ptr<performance_monitor const> const& perfmon)
     : impl_(make_unique_logging_object<impl, block_cache_, logger_policies>(
-          lgr, os, mm, options, perfmon)) {}
+          lgr, os, mm, options, std::move(arena), perfmon)) {}
 
 } // namespace dwarfs::reader::internal
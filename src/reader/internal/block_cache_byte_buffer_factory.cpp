@@ -45,9 +45,16 @@ namespace {
 
 class mmap_byte_buffer_impl final : public mutable_byte_buffer_interface {
  public:
-  mmap_byte_buffer_impl(os_access const& os, size_t size)
+  mmap_byte_buffer_impl(os_access const& os, size_t size, bool hugepages)
       : mm_{os.map_empty(size)}
-      , data_{mm_.span<uint8_t>().data()} {}
+      , data_{mm_.span<uint8_t>().data()} {
+    if (hugepages) {
+      // This is only a hint; if transparent huge pages are unavailable,
+      // we simply end up with a regular anonymous mapping.
+      std::error_code ec;
+      mm_.advise(io_advice::hugepage, ec);
+    }
+  }
 
   size_t size() const override { return size_; }
 
@@ -115,10 +122,16 @@ class block_cache_byte_buffer_factory_impl
       , mode_{mode} {}
 
   mutable_byte_buffer create_mutable_fixed_reserve(size_t size) const override {
-    if (mode_ == block_cache_allocation_mode::MMAP) {
-      return mutable_byte_buffer{
-          std::make_shared<mmap_byte_buffer_impl>(os_, size)};
+    switch (mode_) {
+    case block_cache_allocation_mode::MALLOC:
+      break;
+
+    case block_cache_allocation_mode::MMAP:
+    case block_cache_allocation_mode::HUGEPAGE:
+      return mutable_byte_buffer{std::make_shared<mmap_byte_buffer_impl>(
+          os_, size, mode_ == block_cache_allocation_mode::HUGEPAGE)};
     }
+
     return malloc_byte_buffer::create_reserve(size);
   }
 
@@ -0,0 +1,216 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include <dwarfs/reader/internal/block_prefetcher.h>
+
+namespace dwarfs::reader::internal {
+
+block_prefetcher::block_prefetcher(block_prefetcher_options const& options)
+    : max_depth_{std::max<size_t>(options.max_depth, 1)}
+    , options_{options} {
+  streams_.reserve(options_.max_streams);
+}
+
+void block_prefetcher::set_block_count(size_t num_blocks) {
+  std::lock_guard lock(mx_);
+  num_blocks_ = num_blocks;
+  streams_.clear();
+}
+
+void block_prefetcher::set_max_depth(size_t max_depth) {
+  std::lock_guard lock(mx_);
+  max_depth_ = std::max<size_t>(max_depth, 1);
+  for (auto& s : streams_) {
+    s.depth = std::min(s.depth, max_depth_);
+  }
+}
+
+block_prefetcher::stats block_prefetcher::get_stats() const {
+  std::lock_guard lock(mx_);
+  return stats_;
+}
+
+void block_prefetcher::access(size_t block_no, block_access_result result,
+                              size_t capacity, block_list& prefetch) {
+  std::lock_guard lock(mx_);
+
+  ++clock_;
+
+  auto const threshold = std::max<size_t>(options_.threshold, 1);
+  auto* s = find_stream(block_no);
+
+  if (!s) {
+    auto& ns = new_stream(block_no);
+
+    if (threshold == 1) {
+      // Assume every access starts a sequential stream
+      ns.stride = 1;
+      ++stats_.streams_detected;
+      issue(ns, capacity, prefetch);
+    }
+
+    return;
+  }
+
+  s->last_used = clock_;
+
+  if (block_no == s->last) {
+    // Multiple reads from the same block, nothing new to learn
+    return;
+  }
+
+  if (s->stride > 0 && block_no == s->last + s->stride) {
+    feedback(*s, block_no, result);
+    ++s->length;
+  } else {
+    // Tentative stream, (re-)establish the stride
+    s->stride = block_no - s->last;
+    s->length = 2;
+    s->next_issue = block_no + s->stride;
+  }
+
+  s->last = block_no;
+
+  if (threshold > 1 && s->length == threshold) {
+    ++stats_.streams_detected;
+  }
+
+  if (s->length >= threshold) {
+    issue(*s, capacity, prefetch);
+  }
+}
+
+block_prefetcher::stream* block_prefetcher::find_stream(size_t block_no) {
+  // Prefer streams that expect exactly this block
+  for (auto& s : streams_) {
+    if (block_no == s.last || (s.stride > 0 && block_no == s.last + s.stride)) {
+      return &s;
+    }
+  }
+
+  // Otherwise, the closest stream that doesn't have a confirmed stride yet
+  stream* best{nullptr};
+  size_t best_delta{std::numeric_limits<size_t>::max()};
+
+  for (auto& s : streams_) {
+    if (s.length <= 2 && block_no > s.last) {
+      auto const delta = block_no - s.last;
+      if (delta <= options_.max_stride &&
+          (delta < best_delta ||
+           (delta == best_delta && s.last_used > best->last_used))) {
+        best = &s;
+        best_delta = delta;
+      }
+    }
+  }
+
+  return best;
+}
+
+block_prefetcher::stream& block_prefetcher::new_stream(size_t block_no) {
+  stream* s{nullptr};
+
+  if (streams_.size() < std::max<size_t>(options_.max_streams, 1)) {
+    s = &streams_.emplace_back();
+  } else {
+    s = &*std::ranges::min_element(streams_, std::less{}, &stream::last_used);
+
+    // Anything this stream prefetched beyond its last access is wasted
+    if (s->stride > 0 && s->next_issue > s->last + s->stride) {
+      stats_.abandoned_prefetches +=
+          (s->next_issue - s->last) / s->stride - 1;
+    }
+  }
+
+  *s = stream{.last = block_no,
+              .stride = 0,
+              .length = 1,
+              .depth = 1,
+              .next_issue = block_no + 1,
+              .last_used = clock_};
+
+  return *s;
+}
+
+void block_prefetcher::feedback(stream& s, size_t block_no,
+                                block_access_result result) {
+  auto grow = [&] {
+    if (s.depth < max_depth_) {
+      s.depth = std::min(2 * s.depth, max_depth_);
+      if (s.depth == max_depth_) {
+        ++stats_.max_depth_reached;
+      }
+    }
+  };
+
+  if (block_no < s.next_issue) {
+    // This block was prefetched by the stream
+    switch (result) {
+    case block_access_result::CACHE_HIT:
+      ++stats_.prefetch_hits;
+      break;
+
+    case block_access_result::IN_FLIGHT:
+      // Still being decompressed, we need to look further ahead
+      ++stats_.late_prefetches;
+      grow();
+      break;
+
+    case block_access_result::MISS:
+      // Already evicted again, we're looking too far ahead
+      ++stats_.evicted_prefetches;
+      s.depth = std::max<size_t>(s.depth / 2, 1);
+      break;
+    }
+  } else if (result != block_access_result::CACHE_HIT &&
+             s.length >= options_.threshold) {
+    // The stream has overtaken its prefetches
+    grow();
+  }
+}
+
+void block_prefetcher::issue(stream& s, size_t capacity,
+                             block_list& prefetch) {
+  auto const horizon = s.last + s.stride * s.depth;
+
+  if (s.next_issue <= s.last) {
+    s.next_issue = s.last + s.stride;
+  }
+
+  while (s.next_issue <= horizon && s.next_issue < num_blocks_ &&
+         prefetch.size() < capacity) {
+    prefetch.push_back(s.next_issue);
+    s.next_issue += s.stride;
+    ++stats_.prefetches_issued;
+  }
+}
+
+} // namespace dwarfs::reader::internal
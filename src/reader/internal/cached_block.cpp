@@ -28,6 +28,8 @@
 
 #include <algorithm>
 #include <atomic>
+#include <exception>
+#include <span>
 
 #ifndef _WIN32
 #include <sys/mman.h>
@@ -37,6 +39,7 @@
 #include <dwarfs/block_decompressor.h>
 #include <dwarfs/error.h>
 #include <dwarfs/file_segment.h>
+#include <dwarfs/file_view.h>
 #include <dwarfs/logger.h>
 
 #include <dwarfs/internal/fs_section.h>
@@ -66,6 +69,11 @@ class cached_block_ final : public cached_block {
     if (!disable_integrity_check && !section_.check_fast(seg_)) {
       DWARFS_THROW(runtime_error, "block data integrity check failed");
     }
+    if (auto const n = decompressor_->num_subframes(); n > 0) {
+      num_subframes_ = n;
+      subframe_size_ = decompressor_->subframe_size();
+      subframe_state_ = std::make_unique<std::atomic<uint8_t>[]>(n);
+    }
     std::atomic_fetch_add(&instance_count_, 1U);
     LOG_TRACE << "create cached block " << section_.section_number().value()
               << " [" << instance_count_ << "]";
@@ -90,6 +98,11 @@ class cached_block_ final : public cached_block {
   uint8_t const* data() const override { return data_.data(); }
 
   void decompress_until(size_t end) override {
+    if (num_subframes_ > 0) {
+      decompress_range(0, end, {});
+      return;
+    }
+
     auto pos = data_.size();
 
     while (pos < end) {
@@ -110,6 +123,92 @@ class cached_block_ final : public cached_block {
     }
   }
 
+  bool has_subframes() const override { return num_subframes_ > 0; }
+
+  bool is_available(size_t begin, size_t end) const override {
+    if (end <= range_end()) {
+      return true;
+    }
+
+    if (num_subframes_ == 0 || begin >= end) {
+      return false;
+    }
+
+    auto const [first, last] = subframe_range(begin, end);
+
+    for (auto i = first; i < last; ++i) {
+      if (subframe_state_[i].load(std::memory_order_acquire) != DONE) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Decompress all sub-frames overlapping [begin, end). Additional
+  // threads obtained from `spawn` help with the work, but the calling
+  // thread always makes progress on its own, so this never depends on
+  // the helpers actually running.
+  void decompress_range(size_t begin, size_t end,
+                        task_spawner const& spawn) override {
+    if (num_subframes_ == 0) {
+      decompress_until(end);
+      return;
+    }
+
+    end = std::min(end, uncompressed_size_);
+
+    if (begin >= end || is_available(begin, end)) {
+      return;
+    }
+
+    auto const [first, last] = subframe_range(begin, end);
+
+    if (spawn) {
+      size_t pending = 0;
+
+      for (auto i = first; i < last; ++i) {
+        if (subframe_state_[i].load(std::memory_order_relaxed) == PENDING) {
+          ++pending;
+        }
+      }
+
+      if (pending > 1) {
+        // Errors in helpers are not fatal; the frame is reset to pending
+        // and the error will resurface when this thread decodes it.
+        spawn(pending - 1, [this, first, last] {
+          try {
+            decode_subframes(first, last);
+          } catch (...) { // NOLINT(bugprone-empty-catch)
+          }
+        });
+      }
+    }
+
+    for (;;) {
+      decode_subframes(first, last);
+
+      bool all_done = true;
+
+      for (auto i = first; i < last; ++i) {
+        auto state = subframe_state_[i].load(std::memory_order_acquire);
+
+        while (state == IN_PROGRESS) {
+          subframe_state_[i].wait(state, std::memory_order_acquire);
+          state = subframe_state_[i].load(std::memory_order_acquire);
+        }
+
+        if (state != DONE) {
+          all_done = false;
+        }
+      }
+
+      if (all_done) {
+        break;
+      }
+    }
+  }
+
   size_t uncompressed_size() const override { return uncompressed_size_; }
 
   void touch() override { last_access_ = std::chrono::steady_clock::now(); }
@@ -145,6 +244,68 @@ class cached_block_ final : public cached_block {
   }
 
  private:
+  enum subframe_state : uint8_t { PENDING, IN_PROGRESS, DONE };
+
+  std::pair<size_t, size_t> subframe_range(size_t begin, size_t end) const {
+    return {begin / subframe_size_,
+            std::min((end + subframe_size_ - 1) / subframe_size_,
+                     num_subframes_)};
+  }
+
+  // Claim and decode all pending sub-frames in [first, last).
+  void decode_subframes(size_t first, size_t last) {
+    for (auto i = first; i < last; ++i) {
+      uint8_t expected = PENDING;
+
+      if (!subframe_state_[i].compare_exchange_strong(
+              expected, IN_PROGRESS, std::memory_order_acquire)) {
+        continue;
+      }
+
+      try {
+        decompressor_->decompress_subframe(i);
+      } catch (...) {
+        subframe_state_[i].store(PENDING, std::memory_order_release);
+        subframe_state_[i].notify_all();
+        throw;
+      }
+
+      subframe_state_[i].store(DONE, std::memory_order_release);
+      subframe_state_[i].notify_all();
+
+      advance_range_end();
+
+      if (subframes_done_.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+          num_subframes_) {
+        // Nobody can be using the decompressor anymore
+        decompressor_.reset();
+        seg_.reset();
+      }
+    }
+  }
+
+  // Move range_end_ past the contiguous prefix of decoded sub-frames
+  void advance_range_end() {
+    auto pos = range_end_.load(std::memory_order_acquire);
+
+    for (;;) {
+      auto const index = pos / subframe_size_;
+
+      if (index >= num_subframes_ ||
+          subframe_state_[index].load(std::memory_order_acquire) != DONE) {
+        break;
+      }
+
+      auto const next = std::min((index + 1) * subframe_size_,
+                                 uncompressed_size_);
+
+      if (range_end_.compare_exchange_weak(pos, next,
+                                           std::memory_order_acq_rel)) {
+        pos = next;
+      }
+    }
+  }
+
   std::atomic<size_t> range_end_{0};
   std::unique_ptr<block_decompressor> decompressor_;
   shared_byte_buffer data_;
@@ -152,6 +313,46 @@ class cached_block_ final : public cached_block {
   fs_section section_;
   LOG_PROXY_DECL(LoggerPolicy);
   size_t const uncompressed_size_;
+  size_t num_subframes_{0};
+  size_t subframe_size_{0};
+  std::unique_ptr<std::atomic<uint8_t>[]> subframe_state_;
+  std::atomic<size_t> subframes_done_{0};
+  std::chrono::steady_clock::time_point last_access_;
+};
+
+class mapped_cached_block final : public cached_block {
+ public:
+  mapped_cached_block(file_view const& mm, size_t offset, size_t size)
+      : mm_{mm}
+      , data_{mm_.raw_bytes<uint8_t>(offset, size)} {}
+
+  size_t range_end() const override { return data_.size(); }
+
+  uint8_t const* data() const override { return data_.data(); }
+
+  void decompress_until(size_t end) override {
+    if (end > data_.size()) {
+      DWARFS_THROW(runtime_error, "mapped block range out of bounds");
+    }
+  }
+
+  size_t uncompressed_size() const override { return data_.size(); }
+
+  void touch() override { last_access_ = std::chrono::steady_clock::now(); }
+
+  bool
+  last_used_before(std::chrono::steady_clock::time_point tp) const override {
+    return last_access_ < tp;
+  }
+
+  // File-backed pages are simply dropped by the kernel, not swapped out
+  bool any_pages_swapped_out(std::vector<uint8_t>&) const override {
+    return false;
+  }
+
+ private:
+  file_view mm_;
+  std::span<uint8_t const> data_;
   std::chrono::steady_clock::time_point last_access_;
 };
 
@@ -166,4 +367,9 @@ cached_block::create(logger& lgr, fs_section const& b, file_segment const& seg,
                                                      disable_integrity_check);
 }
 
+std::unique_ptr<cached_block>
+cached_block::create(file_view const& mm, size_t offset, size_t size) {
+  return std::make_unique<mapped_cached_block>(mm, offset, size);
+}
+
 } // namespace dwarfs::reader::internal
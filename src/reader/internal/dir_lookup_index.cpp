@@ -0,0 +1,70 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <bit>
+#include <functional>
+#include <limits>
+
+#include <dwarfs/error.h>
+
+#include <dwarfs/reader/internal/dir_lookup_index.h>
+
+namespace dwarfs::reader::internal {
+
+dir_lookup_index::dir_lookup_index(std::vector<uint64_t> const& hashes) {
+  if (hashes.empty()) {
+    return;
+  }
+
+  DWARFS_CHECK(hashes.size() < std::numeric_limits<uint32_t>::max(),
+               "too many directory entries for lookup index");
+
+  auto const capacity = std::bit_ceil(2 * hashes.size());
+
+  slots_.reset(std::bit_width(hashes.size()), capacity);
+  tags_.resize(capacity);
+  mask_ = capacity - 1;
+
+  for (size_t pos = 0; pos < hashes.size(); ++pos) {
+    auto const hash = hashes[pos];
+    auto slot = hash & mask_;
+
+    while (slots_[slot] != 0) {
+      slot = (slot + 1) & mask_;
+    }
+
+    slots_[slot] = pos + 1;
+    tags_[slot] = tag_of(hash);
+  }
+}
+
+uint64_t dir_lookup_index::hash(std::string_view name) {
+  return std::hash<std::string_view>{}(name);
+}
+
+} // namespace dwarfs::reader::internal
@@ -0,0 +1,342 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <parallel_hashmap/phmap.h>
+
+#include <dwarfs/checksum.h>
+#include <dwarfs/error.h>
+#include <dwarfs/file_util.h>
+#include <dwarfs/file_view.h>
+#include <dwarfs/logger.h>
+#include <dwarfs/os_access.h>
+#include <dwarfs/reader/disk_cache_options.h>
+#include <dwarfs/util.h>
+
+#include <dwarfs/internal/fs_section.h>
+#include <dwarfs/reader/internal/cached_block.h>
+#include <dwarfs/reader/internal/disk_block_cache.h>
+#include <dwarfs/reader/internal/lru_cache.h>
+
+namespace dwarfs::reader::internal {
+
+using namespace dwarfs::internal;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::string_view const kFileSuffix{".blk"};
+constexpr std::string_view const kTempSuffix{".tmp"};
+constexpr std::array<char, 8> const kMagic{'D', 'W', 'A', 'R', 'F',
+                                           'S', 'B', 'C'};
+constexpr uint32_t const kVersion{2};
+
+// The header is padded so the block data starts on a cache line
+constexpr size_t const kDataOffset{64};
+
+struct disk_block_header {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t section_checksum;
+  uint64_t block_no;
+  uint64_t size;
+  uint64_t data_checksum;
+};
+
+static_assert(sizeof(disk_block_header) <= kDataOffset);
+
+template <typename LoggerPolicy>
+class disk_block_cache_ final : public disk_block_cache::impl {
+ public:
+  disk_block_cache_(logger& lgr, os_access const& os,
+                    disk_cache_options const& options)
+      : LOG_PROXY_INIT(lgr)
+      , os_{os}
+      , dir_{options.directory}
+      , max_bytes_{options.max_bytes} {
+    std::error_code ec;
+    fs::create_directories(dir_, ec);
+
+    if (ec) {
+      DWARFS_THROW(runtime_error,
+                   fmt::format("cannot create block cache directory {}: {}",
+                               dir_.string(), ec.message()));
+    }
+
+    // NOLINTNEXTLINE(cppcoreguidelines-rvalue-reference-param-not-moved)
+    index_.set_prune_hook([this](std::string const& name, size_t&& bytes) {
+      std::error_code ec;
+      fs::remove(dir_ / name, ec);
+      total_bytes_ -= bytes;
+      removed_.fetch_add(1, std::memory_order_relaxed);
+    });
+
+    scan_directory();
+  }
+
+  ~disk_block_cache_() override {
+    LOG_VERBOSE << "disk cache hits: " << hits_.load();
+    LOG_VERBOSE << "disk cache misses: " << misses_.load();
+    LOG_VERBOSE << "disk cache blocks stored: " << stored_.load() << " ("
+                << size_with_unit(bytes_written_.load()) << ")";
+    LOG_VERBOSE << "disk cache blocks removed: " << removed_.load();
+    LOG_VERBOSE << "disk cache errors: " << errors_.load();
+  }
+
+  std::shared_ptr<cached_block>
+  load(fs_section const& section, size_t block_no) const override {
+    auto const name = file_name(section, block_no);
+
+    if (!name) {
+      return nullptr;
+    }
+
+    {
+      std::lock_guard lock(mx_);
+      if (index_.find(*name) == index_.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+    }
+
+    try {
+      auto mm = os_.open_file(dir_ / *name);
+
+      if (mm.supports_raw_bytes() && mm.size() >= kDataOffset) {
+        disk_block_header hdr;
+        mm.copy_to(hdr);
+
+        if (hdr.magic == kMagic && hdr.version == kVersion &&
+            hdr.section_checksum == section.xxh3_64_value().value() &&
+            hdr.block_no == block_no &&
+            mm.size() == static_cast<file_size_t>(kDataOffset + hdr.size)) {
+          auto const data = mm.raw_bytes<uint8_t>(kDataOffset, hdr.size);
+
+          if (checksum::verify(checksum::xxh3_64, data.data(), data.size(),
+                               &hdr.data_checksum,
+                               sizeof(hdr.data_checksum))) {
+            LOG_TRACE << "loaded block " << block_no << " from disk cache";
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return cached_block::create(mm, kDataOffset, hdr.size);
+          }
+
+          LOG_WARN << "checksum mismatch in disk cache file " << *name;
+        }
+      }
+
+      LOG_WARN << "invalid disk cache file " << *name << ", removing";
+    } catch (std::exception const& e) {
+      LOG_WARN << "failed to load " << *name
+               << " from disk cache: " << exception_str(e);
+    }
+
+    errors_.fetch_add(1, std::memory_order_relaxed);
+    misses_.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard lock(mx_);
+    if (auto it = index_.find(*name, false); it != index_.end()) {
+      index_.erase(it);
+    }
+
+    return nullptr;
+  }
+
+  bool contains(fs_section const& section, size_t block_no) const override {
+    auto const name = file_name(section, block_no);
+
+    if (!name) {
+      return false;
+    }
+
+    std::lock_guard lock(mx_);
+    return index_.find(*name, false) != index_.end() ||
+           pending_.contains(*name);
+  }
+
+  void store(fs_section const& section, size_t block_no,
+             cached_block const& block) const override {
+    auto const name = file_name(section, block_no);
+    auto const size = block.uncompressed_size();
+
+    if (!name || block.range_end() < size || kDataOffset + size > max_bytes_) {
+      return;
+    }
+
+    {
+      std::lock_guard lock(mx_);
+      if (index_.find(*name, false) != index_.end() ||
+          !pending_.insert(*name).second) {
+        return;
+      }
+    }
+
+    disk_block_header hdr{};
+    hdr.magic = kMagic;
+    hdr.version = kVersion;
+    hdr.section_checksum = section.xxh3_64_value().value();
+    hdr.block_no = block_no;
+    hdr.size = size;
+
+    checksum cs(checksum::xxh3_64);
+    cs.update(block.data(), size);
+    bool success = cs.finalize(&hdr.data_checksum);
+
+    std::array<char, kDataOffset> header_bytes{};
+    std::memcpy(header_bytes.data(), &hdr, sizeof(hdr));
+
+    auto const path = dir_ / *name;
+    std::error_code ec;
+
+    if (success) {
+      replace_file(
+          path, kTempSuffix,
+          [&](std::ostream& os) {
+            os.write(header_bytes.data(), header_bytes.size());
+            os.write(reinterpret_cast<char const*>(block.data()), size);
+          },
+          ec);
+      success = !ec;
+    }
+
+    std::lock_guard lock(mx_);
+
+    pending_.erase(*name);
+
+    if (!success) {
+      LOG_WARN << "failed to write " << path.string() << " to disk cache";
+      errors_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    LOG_TRACE << "stored block " << block_no << " in disk cache";
+
+    stored_.fetch_add(1, std::memory_order_relaxed);
+    bytes_written_.fetch_add(kDataOffset + size, std::memory_order_relaxed);
+
+    add_to_index(*name, kDataOffset + size);
+  }
+
+  size_t size_bytes() const override {
+    std::lock_guard lock(mx_);
+    return total_bytes_;
+  }
+
+ private:
+  static std::optional<std::string>
+  file_name(fs_section const& section, size_t block_no) {
+    if (auto cs = section.xxh3_64_value()) {
+      return fmt::format("{:016x}-{}{}", *cs, block_no, kFileSuffix);
+    }
+
+    return std::nullopt;
+  }
+
+  void scan_directory() {
+    std::vector<std::tuple<fs::file_time_type, std::string, size_t>> files;
+
+    for (auto const& e : fs::directory_iterator(dir_)) {
+      if (!e.is_regular_file()) {
+        continue;
+      }
+
+      auto name = e.path().filename().string();
+
+      if (name.ends_with(kTempSuffix)) {
+        // leftover from an interrupted write
+        std::error_code ec;
+        fs::remove(e.path(), ec);
+      } else if (name.ends_with(kFileSuffix)) {
+        files.emplace_back(e.last_write_time(), std::move(name),
+                           e.file_size());
+      }
+    }
+
+    std::ranges::sort(files);
+
+    std::lock_guard lock(mx_);
+
+    // oldest files first, so the most recent ones end up at the front
+    for (auto& [_, name, size] : files) {
+      add_to_index(name, size);
+    }
+
+    LOG_DEBUG << "found " << index_.size() << " blocks ("
+              << size_with_unit(total_bytes_) << ") in disk cache "
+              << dir_.string();
+  }
+
+  // must be called with mx_ held
+  void add_to_index(std::string const& name, size_t size) const {
+    index_.set(name, size);
+    total_bytes_ += size;
+
+    while (total_bytes_ > max_bytes_ && !index_.empty()) {
+      index_.evict_lru();
+    }
+  }
+
+  LOG_PROXY_DECL(LoggerPolicy);
+  os_access const& os_;
+  fs::path const dir_;
+  size_t const max_bytes_;
+  std::mutex mutable mx_;
+  lru_cache<std::string, size_t> mutable index_;
+  phmap::flat_hash_set<std::string> mutable pending_;
+  size_t mutable total_bytes_{0};
+  std::atomic<size_t> mutable hits_{0};
+  std::atomic<size_t> mutable misses_{0};
+  std::atomic<size_t> mutable stored_{0};
+  std::atomic<size_t> mutable bytes_written_{0};
+  std::atomic<size_t> mutable removed_{0};
+  std::atomic<size_t> mutable errors_{0};
+};
+
+} // namespace
+
+disk_block_cache::disk_block_cache(logger& lgr, os_access const& os,
+                                   disk_cache_options const& options)
+    : impl_(make_unique_logging_object<impl, disk_block_cache_,
+                                       logger_policies>(lgr, os, options)) {}
+
+} // namespace dwarfs::reader::internal
@@ -26,7 +26,10 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <future>
@@ -48,6 +51,7 @@
 #include <dwarfs/util.h>
 
 #include <dwarfs/internal/value_stream_quantile_estimator.h>
+#include <dwarfs/internal/worker_group_fwd.h>
 #include <dwarfs/reader/internal/block_cache.h>
 #include <dwarfs/reader/internal/inode_reader_v2.h>
 #include <dwarfs/reader/internal/lru_cache.h>
@@ -55,6 +59,7 @@
 
 namespace dwarfs::reader::internal {
 
+using dwarfs::internal::job_priority;
 using dwarfs::internal::value_stream_quantile_estimator;
 
 namespace {
@@ -103,6 +108,23 @@ constexpr size_t const offset_cache_updater_max_inline_offsets = 4;
 constexpr size_t const offset_cache_size = 64;
 constexpr size_t const readahead_cache_size = 64;
 
+/**
+ * Readahead state per inode
+ *
+ * The readahead window starts out at `inode_reader_options::readahead`
+ * and is reset to that size whenever an inode is not read sequentially.
+ * If `inode_reader_options::max_readahead` is larger, the window is
+ * doubled (up to that limit) each time a sequential read has to wait
+ * for data that was requested ahead, but isn't available yet. Because
+ * readahead follows the chunk list of the inode, it also works well for
+ * fragmented files whose blocks are not accessed in sequential order.
+ */
+struct readahead_state {
+  file_off_t next_offset{0};
+  file_off_t readahead_pos{0};
+  file_off_t window{0};
+};
+
 template <class T>
 std::future<T> make_ready_future(T value) {
   std::promise<T> p;
@@ -131,9 +153,18 @@ class inode_reader_ final : public inode_reader_v2::impl {
       PERFMON_CLS_TIMER_INIT(readv_iovec, "offset", "size")
       PERFMON_CLS_TIMER_INIT(readv_future, "offset", "size") // clang-format on
       , offset_cache_{offset_cache_size}
-      , readahead_cache_{readahead_cache_size} {}
+      , readahead_cache_{readahead_cache_size}
+      , max_readahead_{static_cast<file_off_t>(
+            std::max(opts.readahead, opts.max_readahead))} {}
 
   ~inode_reader_() override {
+    if (max_readahead_ > static_cast<file_off_t>(opts_.readahead)) {
+      LOG_VERBOSE << "sequential reads waiting for readahead: "
+                  << readahead_late_.load();
+      LOG_VERBOSE << "readahead window increases: "
+                  << readahead_increases_.load();
+    }
+
     std::lock_guard lock(iovec_sizes_mutex_);
     LOG_VERBOSE << "iovec size p90: " << iovec_sizes_.quantile(0.9);
     LOG_VERBOSE << "iovec size p95: " << iovec_sizes_.quantile(0.95);
@@ -161,10 +192,19 @@ class inode_reader_ final : public inode_reader_v2::impl {
 
   void cache_blocks(std::span<size_t const> blocks) const override {
     for (auto b : blocks) {
-      cache_.get(b, 0, 1);
+      cache_.get(b, 0, 1, job_priority::PRELOAD);
     }
   }
 
+  void preload_blocks(std::span<size_t const> blocks) const override {
+    cache_.preload(blocks);
+  }
+
+  void set_block_access_recorder(
+      std::shared_ptr<block_access_recorder> recorder) override {
+    cache_.set_access_recorder(std::move(recorder));
+  }
+
   std::future<block_range> read_raw_block_data(size_t block_no, size_t offset,
                                                size_t size) const override;
 
@@ -174,7 +214,7 @@ class inode_reader_ final : public inode_reader_v2::impl {
                          offset_cache_chunk_index_interval,
                          offset_cache_updater_max_inline_offsets>;
 
-  using readahead_cache_type = lru_cache<uint32_t, file_off_t>;
+  using readahead_cache_type = lru_cache<uint32_t, readahead_state>;
 
   std::vector<std::future<block_range>>
   read_internal(uint32_t inode, size_t size, file_off_t offset, size_t maxiov,
@@ -187,7 +227,7 @@ class inode_reader_ final : public inode_reader_v2::impl {
 
   void do_readahead(uint32_t inode, chunk_range::iterator it,
                     chunk_range::iterator const& end, file_off_t read_offset,
-                    size_t size, file_off_t it_offset) const;
+                    size_t size, file_off_t it_offset, bool late) const;
 
   readonly_memory_mapping const& get_hole_data() const {
     std::call_once(hole_data_init_flag_, [this]() {
@@ -212,6 +252,9 @@ class inode_reader_ final : public inode_reader_v2::impl {
   mutable offset_cache_type offset_cache_;
   mutable std::mutex readahead_cache_mutex_;
   mutable readahead_cache_type readahead_cache_;
+  file_off_t const max_readahead_;
+  mutable std::atomic<size_t> readahead_late_{0};
+  mutable std::atomic<size_t> readahead_increases_{0};
   mutable std::mutex iovec_sizes_mutex_;
   mutable value_stream_quantile_estimator iovec_sizes_{0.9, 0.95, 0.99};
   mutable std::once_flag hole_data_init_flag_;
@@ -234,38 +277,58 @@ void inode_reader_<LoggerPolicy>::dump(std::ostream& os,
 }
 
 template <typename LoggerPolicy>
-void inode_reader_<LoggerPolicy>::do_readahead(uint32_t inode,
-                                               chunk_range::iterator it,
-                                               chunk_range::iterator const& end,
-                                               file_off_t const read_offset,
-                                               size_t const size,
-                                               file_off_t it_offset) const {
+void inode_reader_<LoggerPolicy>::do_readahead(
+    uint32_t inode, chunk_range::iterator it, chunk_range::iterator const& end,
+    file_off_t const read_offset, size_t const size, file_off_t it_offset,
+    bool const late) const {
   LOG_TRACE << "readahead (" << inode << "): " << read_offset << "/" << size
-            << "/" << it_offset;
+            << "/" << it_offset << (late ? " (late)" : "");
 
   file_off_t readahead_pos{0};
   file_off_t const current_offset = read_offset + size;
-  file_off_t const readahead_until = current_offset + opts_.readahead;
+  file_off_t readahead_until{0};
 
   {
     std::lock_guard lock(readahead_cache_mutex_);
 
-    if (read_offset > 0) {
-      if (auto i = readahead_cache_.find(inode); i != readahead_cache_.end()) {
-        readahead_pos = i->second;
+    readahead_state st{.window = static_cast<file_off_t>(opts_.readahead)};
+
+    if (auto i = readahead_cache_.find(inode); i != readahead_cache_.end()) {
+      if (read_offset > 0) {
+        readahead_pos = i->second.readahead_pos;
       }
 
-      if (readahead_until <= readahead_pos) {
-        return;
+      if (read_offset == i->second.next_offset) {
+        st.window = i->second.window;
+
+        if (late) {
+          readahead_late_.fetch_add(1, std::memory_order_relaxed);
+
+          if (st.window < max_readahead_) {
+            st.window = std::min(
+                std::max(2 * st.window, static_cast<file_off_t>(size)),
+                max_readahead_);
+            readahead_increases_.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
       }
     }
 
-    readahead_cache_.set(inode, readahead_until);
+    readahead_until = current_offset + st.window;
+    st.next_offset = current_offset;
+    st.readahead_pos = std::max(readahead_pos, readahead_until);
+
+    readahead_cache_.set(inode, st);
+
+    if (readahead_until <= readahead_pos) {
+      return;
+    }
   }
 
   while (it != end) {
     if (it_offset + it->size() >= readahead_pos) {
-      cache_.get(it->block(), it->offset(), it->size());
+      cache_.get(it->block(), it->offset(), it->size(),
+                 job_priority::READAHEAD);
     }
 
     it_offset += it->size();
@@ -404,8 +467,16 @@ inode_reader_<LoggerPolicy>::read_internal(uint32_t inode, size_t const size,
         offset_cache_.set(inode, std::move(oc_ent));
       }
 
-      if (opts_.readahead > 0) {
-        do_readahead(inode, it, end, read_offset, size, it_offset);
+      if (max_readahead_ > 0) {
+        // Data that was read ahead should be available by now
+        bool const late =
+            max_readahead_ > static_cast<file_off_t>(opts_.readahead) &&
+            std::ranges::any_of(ranges, [](auto const& f) {
+              return f.wait_for(std::chrono::seconds::zero()) !=
+                     std::future_status::ready;
+            });
+
+        do_readahead(inode, it, end, read_offset, size, it_offset, late);
       }
 
       break;
@@ -0,0 +1,106 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+
+#include <dwarfs/reader/internal/lazy_unpacked_table.h>
+
+namespace dwarfs::reader::internal {
+
+lazy_unpacked_table::lazy_unpacked_table(size_t size, size_t bits,
+                                         generator_type gen)
+    : size_{size}
+    , bits_{bits}
+    , num_blocks_{num_blocks(size)}
+    , blocks_{std::make_unique<block[]>(num_blocks_)}
+    , gen_{std::move(gen)} {}
+
+lazy_unpacked_table::lazy_unpacked_table(size_t size, size_t bits,
+                                         std::span<uint32_t const> packed)
+    : size_{size}
+    , bits_{bits}
+    , num_blocks_{num_blocks(size)}
+    , ready_{num_blocks_}
+    , mapped_{packed} {}
+
+void lazy_unpacked_table::unpack_all() const {
+  if (!blocks_) {
+    return;
+  }
+  for (size_t i = 0; i < num_blocks_; ++i) {
+    if (!blocks_[i].ready.load(std::memory_order_acquire)) {
+      unpack_block(i);
+    }
+  }
+}
+
+bool lazy_unpacked_table::is_unpacked() const {
+  return ready_.load(std::memory_order_acquire) == num_blocks_;
+}
+
+size_t lazy_unpacked_table::size_in_bytes() const {
+  if (!blocks_) {
+    return mapped_.size_bytes();
+  }
+  size_t size = 0;
+  for (size_t i = 0; i < num_blocks_; ++i) {
+    if (blocks_[i].ready.load(std::memory_order_acquire)) {
+      size += blocks_[i].values.size_in_bytes();
+    }
+  }
+  return size;
+}
+
+std::vector<uint32_t> lazy_unpacked_table::unpack() const {
+  std::vector<uint32_t> result(size_);
+  for (size_t i = 0; i < size_; ++i) {
+    result[i] = (*this)[i];
+  }
+  return result;
+}
+
+void lazy_unpacked_table::unpack_block(size_t block) const {
+  auto& blk = blocks_[block];
+
+  std::call_once(blk.once, [&] {
+    auto const offset = block * block_size;
+    std::vector<uint32_t> values(std::min(block_size, size_ - offset));
+
+    gen_(block, values);
+
+    blk.values = dwarfs::internal::elias_fano(values);
+    blk.ready.store(true, std::memory_order_release);
+
+    if (ready_.fetch_add(1, std::memory_order_acq_rel) + 1 == num_blocks_) {
+      // all generator calls have returned, release any captured state
+      gen_ = nullptr;
+    }
+  });
+}
+
+} // namespace dwarfs::reader::internal
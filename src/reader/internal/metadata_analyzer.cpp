@@ -422,6 +422,16 @@ void frozen_analyzer::print(std::ostream& os) const {
                   cache->allocated_size_lookup(),
                   l.reg_file_size_cacheField.layout.valueField.layout
                       .allocated_size_lookupField);
+    if (auto table = cache->size_table()) {
+      add_list_size(usage, "inode_size_table", *table,
+                    l.reg_file_size_cacheField.layout.valueField.layout
+                        .size_tableField.layout.valueField);
+    }
+    if (auto table = cache->allocated_size_table()) {
+      add_list_size(usage, "inode_allocated_size_table", *table,
+                    l.reg_file_size_cacheField.layout.valueField.layout
+                        .allocated_size_tableField.layout.valueField);
+    }
   }
 
   if (auto list = meta_.metadata_version_history()) {
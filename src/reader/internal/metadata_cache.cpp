@@ -0,0 +1,259 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <ostream>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <dwarfs/checksum.h>
+#include <dwarfs/error.h>
+#include <dwarfs/file_util.h>
+
+#include <dwarfs/reader/internal/metadata_cache.h>
+
+namespace dwarfs::reader::internal {
+
+using namespace dwarfs::internal;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::array<char, 8> const kMagic{'D', 'W', 'A', 'R', 'F',
+                                           'S', 'M', 'C'};
+constexpr uint32_t const kVersion{2};
+constexpr uint32_t const kByteOrderMark{0x01020304};
+constexpr uint32_t const kFlagHasTotalHardlinkSize{1};
+constexpr std::string_view const kTempSuffix{".tmp"};
+
+// Table data starts on a cache line
+constexpr size_t const kTableAlignment{64};
+
+struct file_header {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t key;
+  uint64_t total_hardlink_size;
+  uint32_t flags;
+  uint32_t num_tables;
+  // xxh3_64 of everything following the header
+  uint64_t payload_checksum;
+};
+
+struct table_entry {
+  uint32_t id;
+  uint32_t bits;
+  uint64_t size;
+  uint64_t offset;
+  uint64_t words;
+};
+
+constexpr size_t align_up(size_t offset) {
+  return (offset + kTableAlignment - 1) & ~(kTableAlignment - 1);
+}
+
+constexpr size_t min_words(size_t size, size_t bits) {
+  return (size * bits + 31) / 32;
+}
+
+bool is_known_table(uint32_t id) {
+  switch (static_cast<metadata_cache::table_id>(id)) {
+  case metadata_cache::table_id::chunk_table:
+  case metadata_cache::table_id::shared_files:
+  case metadata_cache::table_id::nlink_minus_one:
+  case metadata_cache::table_id::icase_dir_offsets:
+  case metadata_cache::table_id::icase_order:
+    return true;
+  }
+  return false;
+}
+
+} // namespace
+
+packed_int_vector<uint32_t> metadata_cache::table_view::to_packed() const {
+  packed_int_vector<uint32_t> vec;
+  vec.reset(bits_, size_);
+  auto out = vec.raw_data();
+  std::copy_n(data_.begin(), out.size(), out.begin());
+  return vec;
+}
+
+std::shared_ptr<metadata_cache const>
+metadata_cache::load(file_view const& mm, uint64_t key) {
+  if (!mm.supports_raw_bytes() ||
+      std::cmp_less(mm.size(), sizeof(file_header))) {
+    return nullptr;
+  }
+
+  file_header hdr;
+  mm.copy_to(hdr);
+
+  if (hdr.magic != kMagic || hdr.version != kVersion ||
+      hdr.byte_order != kByteOrderMark || hdr.key != key) {
+    return nullptr;
+  }
+
+  auto const file_size = static_cast<size_t>(mm.size());
+  auto const dir_end =
+      sizeof(file_header) + size_t{hdr.num_tables} * sizeof(table_entry);
+
+  if (dir_end > file_size) {
+    return nullptr;
+  }
+
+  auto const bytes = mm.raw_bytes();
+  auto const payload = bytes.subspan(sizeof(file_header));
+
+  if (!checksum::verify(checksum::xxh3_64, payload.data(), payload.size(),
+                        &hdr.payload_checksum, sizeof(hdr.payload_checksum))) {
+    return nullptr;
+  }
+
+  auto cache = std::make_shared<metadata_cache>();
+  std::span<uint32_t const> const words{
+      reinterpret_cast<uint32_t const*>(bytes.data()),
+      bytes.size() / sizeof(uint32_t)};
+
+  for (uint32_t i = 0; i < hdr.num_tables; ++i) {
+    table_entry te;
+    mm.copy_to(te, sizeof(file_header) + i * sizeof(table_entry));
+
+    if (te.bits > 32 || te.offset % kTableAlignment != 0 ||
+        te.offset > file_size ||
+        te.words > (file_size - te.offset) / sizeof(uint32_t) ||
+        te.words < min_words(te.size, te.bits)) {
+      return nullptr;
+    }
+
+    if (is_known_table(te.id)) {
+      cache->tables_.emplace(
+          static_cast<table_id>(te.id),
+          table_view(te.size, te.bits,
+                     words.subspan(te.offset / sizeof(uint32_t), te.words)));
+    }
+  }
+
+  if (hdr.flags & kFlagHasTotalHardlinkSize) {
+    cache->total_hardlink_size_ = hdr.total_hardlink_size;
+  }
+
+  cache->mm_ = mm;
+
+  return cache;
+}
+
+std::optional<metadata_cache::table_view>
+metadata_cache::find(table_id id) const {
+  if (auto it = tables_.find(id); it != tables_.end()) {
+    return it->second;
+  }
+  return std::nullopt;
+}
+
+void metadata_cache::add(table_id id, packed_int_vector<uint32_t> vec) {
+  auto const& v = owned_.emplace_back(std::move(vec));
+  tables_.insert_or_assign(id, table_view(v.size(), v.bits(), v.raw_data()));
+}
+
+void metadata_cache::write(fs::path const& path, uint64_t key) const {
+  file_header hdr{};
+  hdr.magic = kMagic;
+  hdr.version = kVersion;
+  hdr.byte_order = kByteOrderMark;
+  hdr.key = key;
+  hdr.total_hardlink_size = total_hardlink_size_.value_or(0);
+  hdr.flags = total_hardlink_size_ ? kFlagHasTotalHardlinkSize : 0;
+  hdr.num_tables = tables_.size();
+
+  std::vector<table_entry> dir;
+  size_t offset =
+      align_up(sizeof(file_header) + tables_.size() * sizeof(table_entry));
+
+  for (auto const& [id, tv] : tables_) {
+    auto& te = dir.emplace_back();
+    te.id = static_cast<uint32_t>(id);
+    te.bits = tv.bits();
+    te.size = tv.size();
+    te.offset = offset;
+    te.words = tv.data().size();
+    offset = align_up(offset + tv.data().size_bytes());
+  }
+
+  std::array<char, kTableAlignment> const padding{};
+
+  // The checksum pass and the write pass must produce the same bytes
+  auto for_each_chunk = [&](auto&& put) {
+    size_t pos = sizeof(file_header);
+
+    auto emit = [&](void const* data, size_t size) {
+      put(data, size);
+      pos += size;
+    };
+
+    emit(dir.data(), dir.size() * sizeof(table_entry));
+
+    for (auto const& te : dir) {
+      auto const& tv = tables_.at(static_cast<table_id>(te.id));
+      emit(padding.data(), te.offset - pos);
+      emit(tv.data().data(), tv.data().size_bytes());
+    }
+  };
+
+  checksum cs(checksum::xxh3_64);
+  for_each_chunk([&](void const* data, size_t size) { cs.update(data, size); });
+
+  if (!cs.finalize(&hdr.payload_checksum)) {
+    DWARFS_THROW(runtime_error, "failed to compute metadata cache checksum");
+  }
+
+  std::error_code ec;
+
+  replace_file(
+      path, kTempSuffix,
+      [&](std::ostream& os) {
+        auto put = [&](void const* data, size_t size) {
+          os.write(static_cast<char const*>(data), size);
+        };
+
+        put(&hdr, sizeof(hdr));
+        for_each_chunk(put);
+      },
+      ec);
+
+  if (ec) {
+    DWARFS_THROW(runtime_error,
+                 fmt::format("failed to write metadata cache {}: {}",
+                             path.string(), ec.message()));
+  }
+}
+
+} // namespace dwarfs::reader::internal
@@ -29,6 +29,7 @@
 #include <algorithm>
 #include <bit>
 #include <cassert>
+#include <limits>
 #include <numeric>
 #include <queue>
 
@@ -86,8 +87,56 @@ bool dir_has_self_entry(global_metadata::Meta const& meta) {
              .bits > 0;
 }
 
+elias_fano
+unpack_first_entries(logger& lgr, global_metadata::Meta const& meta) {
+  auto opts = meta.options();
+
+  auto metadir = meta.directories();
+
+  if (!opts or !opts->packed_directories() or metadir.empty()) {
+    return {};
+  }
+
+  LOG_PROXY(debug_logger_policy, lgr);
+
+  auto td = LOG_TIMED_DEBUG;
+
+  // the delta-encoded first entries are non-decreasing, so they can be
+  // stored as Elias-Fano sequence instead of a full unpacked table; this
+  // only holds as long as the sum doesn't overflow
+  uint64_t last{0};
+
+  for (auto d : metadir) {
+    last += d.first_entry();
+  }
+
+  if (last > std::numeric_limits<uint32_t>::max()) {
+    DWARFS_THROW(runtime_error,
+                 fmt::format("invalid packed directories: first entries "
+                             "sum up to {}",
+                             last));
+  }
+
+  elias_fano::builder builder(metadir.size(), metadir[0].first_entry(),
+                              static_cast<uint32_t>(last));
+  uint32_t sum{0};
+
+  for (auto d : metadir) {
+    sum += d.first_entry();
+    builder.push_back(sum);
+  }
+
+  auto ef = builder.build();
+
+  td << "delta-decoded " << ef.size() << " first entries ("
+     << size_with_unit(ef.size_in_bytes()) << ")";
+
+  return ef;
+}
+
 std::optional<global_metadata::bundled_directories_view>
-unpack_directories(logger& lgr, global_metadata::Meta const& meta) {
+unpack_directories(logger& lgr, global_metadata::Meta const& meta,
+                   elias_fano const& first_entries) {
   auto opts = meta.options();
   auto dep = meta.dir_entries();
 
@@ -107,23 +156,11 @@ unpack_directories(logger& lgr, global_metadata::Meta const& meta) {
   std::vector<thrift::metadata::directory> directories;
 
   if (opts->packed_directories()) {
+    // first entries are kept in `first_entries`, so they remain zero here
+    // and won't take up any space in the frozen table
     directories.resize(metadir.size());
 
-    // delta-decode first entries first
-    {
-      auto tt = LOG_TIMED_TRACE;
-
-      directories[0].first_entry() = metadir[0].first_entry();
-
-      for (size_t i = 1; i < directories.size(); ++i) {
-        directories[i].first_entry() =
-            directories[i - 1].first_entry().value() + metadir[i].first_entry();
-      }
-
-      tt << "delta-decoded " << directories.size() << " first entries";
-    }
-
-    // then traverse to recover parent entries
+    // traverse to recover parent entries
     {
       auto tt = LOG_TIMED_TRACE;
 
@@ -136,8 +173,8 @@ unpack_directories(logger& lgr, global_metadata::Meta const& meta) {
 
         auto p_ino = dirent[parent].inode_num();
 
-        auto beg = directories[p_ino].first_entry().value();
-        auto end = directories[p_ino + 1].first_entry().value();
+        auto beg = first_entries[p_ino];
+        auto end = first_entries[p_ino + 1];
 
         for (auto e = beg; e < end; ++e) {
           if (auto e_ino = dirent[e].inode_num(); e_ino < num_dir_inodes) {
@@ -839,7 +876,8 @@ T const& unbundled(frozen::Bundled<T> const& bundle) {
 
 global_metadata::global_metadata(logger& lgr, Meta const& meta)
     : meta_{meta}
-    , bundled_directories_{unpack_directories(lgr, meta_)}
+    , first_entries_{unpack_first_entries(lgr, meta_)}
+    , bundled_directories_{unpack_directories(lgr, meta_, first_entries_)}
     , directories_{bundled_directories_ ? unbundled(*bundled_directories_)
                                         : meta_.directories()}
     , names_{meta_.compact_names()
@@ -855,6 +893,10 @@ void global_metadata::check_consistency(logger& lgr) const {
 }
 
 uint32_t global_metadata::first_dir_entry(uint32_t ino) const {
+  if (!first_entries_.empty()) {
+    return first_entries_[ino];
+  }
+
   return directories_[ino].first_entry();
 }
 
@@ -924,6 +966,11 @@ auto inode_view_impl::getgid() const -> gid_type {
 // TODO: pretty certain some of this stuff can be simplified
 
 std::string dir_entry_view_impl::name() const {
+  thread_local std::string scratch;
+  return std::string(name(scratch));
+}
+
+std::string_view dir_entry_view_impl::name(std::string& scratch) const {
   switch (g_.get_data()) {
   case entry_name_type::other:
     break;
@@ -937,15 +984,15 @@ std::string dir_entry_view_impl::name() const {
     return {};
   }
 
-  return v_ |
-         match{
-             [this](DirEntryView const& dev) {
-               return g_->names()[dev.name_index()];
-             },
-             [this](InodeView const& iv) {
-               return std::string(g_->meta().names()[iv.name_index_v2_2()]);
-             },
-         };
+  return v_ | match{
+                  [&](DirEntryView const& dev) {
+                    return g_->names().lookup(dev.name_index(), scratch);
+                  },
+                  [this](InodeView const& iv) {
+                    return std::string_view(
+                        g_->meta().names()[iv.name_index_v2_2()]);
+                  },
+              };
 }
 
 template <template <typename...> class Ctor>
@@ -1086,15 +1133,22 @@ std::shared_ptr<dir_entry_view_impl> dir_entry_view_impl::parent() const {
 
 std::string
 dir_entry_view_impl::name(uint32_t index, global_metadata const& g) {
+  thread_local std::string scratch;
+  return std::string(name(index, g, scratch));
+}
+
+std::string_view
+dir_entry_view_impl::name(uint32_t index, global_metadata const& g,
+                          std::string& scratch) {
   if (auto de = g.meta().dir_entries()) {
     DWARFS_CHECK(index < de->size(), "index out of range");
     auto dev = (*de)[index];
-    return g.names()[dev.name_index()];
+    return g.names().lookup(dev.name_index(), scratch);
   }
 
   DWARFS_CHECK(index < g.meta().inodes().size(), "index out of range");
   auto iv = g.meta().inodes()[index];
-  return std::string(g.meta().names()[iv.name_index_v2_2()]);
+  return g.meta().names()[iv.name_index_v2_2()];
 }
 
 std::string dir_entry_view_impl::path() const {
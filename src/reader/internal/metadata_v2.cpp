@@ -34,7 +34,10 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <filesystem>
+#include <functional>
+#include <mutex>
 #include <numeric>
 #include <ostream>
 
@@ -73,8 +76,12 @@
 #include <dwarfs/internal/synchronized.h>
 #include <dwarfs/internal/unicode_case_folding.h>
 #include <dwarfs/internal/value_stream_quantile_estimator.h>
+#include <dwarfs/reader/internal/dir_lookup_index.h>
+#include <dwarfs/reader/internal/lazy_dir_cache.h>
+#include <dwarfs/reader/internal/lazy_unpacked_table.h>
 #include <dwarfs/reader/internal/lru_cache.h>
 #include <dwarfs/reader/internal/metadata_analyzer.h>
+#include <dwarfs/reader/internal/metadata_cache.h>
 #include <dwarfs/reader/internal/metadata_v2.h>
 #include <dwarfs/reader/internal/sparse_file_seeker.h>
 #include <dwarfs/reader/internal/time_resolution_handler.h>
@@ -343,6 +350,17 @@ struct nlink_info {
   std::optional<file_size_t> total_hardlink_size;
 };
 
+// Scratch space for decoding the names of consecutive directory entries
+struct entry_name_batch {
+  std::vector<uint32_t> name_indices;
+  string_table::lookup_batch names;
+};
+
+// Number of names decoded at once when iterating over entries; this is large
+// enough to amortize the per-batch overhead, yet small enough not to waste
+// too much work if the caller stops early (e.g. when the FUSE buffer is full)
+constexpr size_t const entry_name_batch_size = 128;
+
 } // namespace
 
 class metadata_v2_data {
@@ -353,7 +371,8 @@ class metadata_v2_data {
                    std::span<uint8_t const> data,
                    metadata_options const& options, int inode_offset,
                    bool force_consistency_check,
-                   std::shared_ptr<performance_monitor const> const& perfmon);
+                   std::shared_ptr<performance_monitor const> const& perfmon,
+                   std::shared_ptr<metadata_cache const> cache);
 
   size_t size() const { return data_.size(); }
 
@@ -400,6 +419,17 @@ class metadata_v2_data {
   std::optional<dir_entry_view>
   readdir(directory_view dir, size_t offset) const;
 
+  void
+  readdir(directory_view dir, size_t offset,
+          std::function<bool(dir_entry_view, std::string_view)> const& func)
+      const;
+
+  template <typename LoggerPolicy>
+  void readdirplus(LOG_PROXY_REF_(LoggerPolicy) directory_view dir,
+                   size_t offset,
+                   std::function<bool(dir_entry_view, std::string_view,
+                                      file_stat const&)> const& func) const;
+
   template <typename LoggerPolicy>
   file_stat getattr(LOG_PROXY_REF_(LoggerPolicy) inode_view const& iv) const {
     PERFMON_CLS_SCOPED_SECTION(getattr)
@@ -424,6 +454,18 @@ class metadata_v2_data {
     });
   }
 
+  template <typename LoggerPolicy>
+  void walk_with_path(
+      LOG_PROXY_REF_(LoggerPolicy)
+          std::function<void(dir_entry_view, std::string_view)> const& func)
+      const;
+
+  template <typename LoggerPolicy>
+  void walk_data_order_with_path(
+      LOG_PROXY_REF_(LoggerPolicy)
+          std::function<void(dir_entry_view, std::string_view)> const& func)
+      const;
+
   dir_entry_view_iterable directory_entries() const {
     return dir_entry_view_iterable{
         std::make_unique<directories_dir_entry_range>(symlink_inode_offset_,
@@ -504,6 +546,9 @@ class metadata_v2_data {
     return std::make_unique<thrift::metadata::metadata>(meta_.thaw());
   }
 
+  bool has_complete_cache() const;
+  metadata_cache build_cache() const;
+
   std::unique_ptr<thrift::metadata::fs_options> thaw_fs_options() const {
     if (meta_.options().has_value()) {
       return std::make_unique<thrift::metadata::fs_options>(
@@ -526,24 +571,61 @@ class metadata_v2_data {
   void check_inode_size_cache(LOG_PROXY_REF(LoggerPolicy)) const;
 
   template <typename LoggerPolicy>
-  std::vector<packed_int_vector<uint32_t>>
-  build_dir_icase_cache(logger& lgr) const;
+  packed_int_vector<uint32_t>
+  build_dir_icase_order(logger& lgr, uint32_t inode) const;
 
   template <typename LoggerPolicy>
-  std::optional<nlink_info> build_nlinks(logger& lgr) const;
+  void build_dir_icase_cache(logger& lgr) const;
 
   template <typename LoggerPolicy>
-  packed_int_vector<uint32_t> unpack_chunk_table(logger& lgr) const;
+  std::optional<nlink_info> build_nlinks(logger& lgr) const;
+
+  lazy_unpacked_table unpack_chunk_table() const;
+  lazy_unpacked_table unpack_shared_files() const;
+  std::optional<View<std::vector<uint64_t>>>
+  find_size_cache_table(bool allocated) const;
+
+  // Returns the cached table only if it has the shape of the table that
+  // would be derived from the metadata; otherwise, the table is derived.
+  std::optional<metadata_cache::table_view>
+  cached_table(metadata_cache::table_id id, size_t size, size_t bits,
+               uint32_t last) const {
+    if (cache_) {
+      if (auto tv = cache_->find(id); tv && tv->size() == size &&
+                                      tv->bits() == bits && size > 0 &&
+                                      (*tv)[size - 1] == last) {
+        return tv;
+      }
+    }
+    return std::nullopt;
+  }
 
   template <typename LoggerPolicy>
-  packed_int_vector<uint32_t> unpack_shared_files(logger& lgr) const;
+  void unpack_tables(logger& lgr) const;
+
+  std::optional<nlink_info> const& nlinks() const {
+    std::call_once(nlinks_once_, [this] { nlinks_ = nlinks_builder_(); });
+    return nlinks_;
+  }
+
+  packed_int_vector<uint32_t> const& dir_icase_order(uint32_t inode) const {
+    return dir_icase_cache_.get(
+        inode, [this, inode] { return dir_icase_builder_(inode); });
+  }
 
   void analyze_chunks(std::ostream& os) const;
 
+  std::optional<dir_entry_view>
+  find_path_from(dir_entry_view const& dir, std::string_view path) const;
+
   std::optional<dir_entry_view>
   find_impl(directory_view dir, auto const& range, auto const& name,
             auto const& index_map, auto const& entry_name_transform) const;
 
+  std::optional<dir_entry_view>
+  find_indexed(directory_view dir, auto const& range, std::string_view name,
+               auto const& entry_name_transform) const;
+
   template <typename LoggerPolicy>
   file_stat getattr_impl(LOG_PROXY_REF_(LoggerPolicy) inode_view const& iv,
                          getattr_options const& opts) const;
@@ -605,6 +687,38 @@ class metadata_v2_data {
     walk(LOG_PROXY_ARG_ 0, 0, seen, std::forward<T>(func));
   }
 
+  template <typename LoggerPolicy, typename T>
+  void walk_with_path(LOG_PROXY_REF_(LoggerPolicy) uint32_t self_index,
+                      uint32_t parent_index, size_t depth, std::string& path,
+                      std::deque<entry_name_batch>& batches,
+                      set_type<int>& seen, T const& func) const;
+
+  // Decodes the names of `count` entries, where the i-th entry index is
+  // given by `entry_index(i)`, into `batch.names.strings`.
+  template <typename EntryIndexFn>
+  void lookup_entry_names(size_t count, EntryIndexFn const& entry_index,
+                          entry_name_batch& batch) const {
+    if (auto de = meta_.dir_entries()) {
+      batch.name_indices.resize(count);
+      for (size_t i = 0; i < count; ++i) {
+        batch.name_indices[i] = (*de)[entry_index(i)].name_index();
+      }
+      global_.names().lookup(batch.name_indices, batch.names);
+    } else {
+      batch.names.strings.resize(count);
+      for (size_t i = 0; i < count; ++i) {
+        batch.names.strings[i] =
+            meta_.names()[meta_.inodes()[entry_index(i)].name_index_v2_2()];
+      }
+    }
+  }
+
+  void lookup_entry_name_range(uint32_t first, size_t count,
+                               entry_name_batch& batch) const {
+    lookup_entry_names(
+        count, [first](size_t i) { return first + i; }, batch);
+  }
+
   // TODO: cleanup the walk logic
   void walk_call(std::function<void(dir_entry_view)> const& func,
                  uint32_t self_index, uint32_t parent_index) const {
@@ -713,21 +827,34 @@ class metadata_v2_data {
   int const file_inode_offset_;
   int const dev_inode_offset_;
   int const inode_count_;
-  packed_int_vector<uint32_t> const chunk_table_;
-  packed_int_vector<uint32_t> const shared_files_;
+  std::shared_ptr<metadata_cache const> const cache_;
+  lazy_unpacked_table const chunk_table_;
+  lazy_unpacked_table const shared_files_;
+  std::optional<View<std::vector<uint64_t>>> const size_table_;
+  std::optional<View<std::vector<uint64_t>>> const allocated_size_table_;
   int const unique_files_;
-  std::optional<nlink_info> const nlinks_;
+  std::function<std::optional<nlink_info>()> const nlinks_builder_;
+  std::once_flag mutable nlinks_once_;
+  std::optional<nlink_info> mutable nlinks_;
   metadata_options const options_;
   string_table const symlinks_;
-  std::vector<packed_int_vector<uint32_t>> const dir_icase_cache_;
+  std::function<packed_int_vector<uint32_t>(uint32_t)> const
+      dir_icase_builder_;
+  lazy_dir_cache<packed_int_vector<uint32_t>> const dir_icase_cache_;
+  dir_lookup_index_cache const dir_lookup_indices_;
   synchronized<lru_cache<
       size_t, std::shared_ptr<sparse_file_seeker const>>> mutable seek_cache_;
+  std::unique_ptr<synchronized<lru_cache<std::string, uint32_t>>> const
+      path_cache_;
   PERFMON_CLS_PROXY_DECL
   PERFMON_CLS_TIMER_DECL(find)
   PERFMON_CLS_TIMER_DECL(find_path)
+  PERFMON_CLS_TIMER_DECL(find_path_hit)
+  PERFMON_CLS_TIMER_DECL(find_path_miss)
   PERFMON_CLS_TIMER_DECL(getattr)
   PERFMON_CLS_TIMER_DECL(getattr_opts)
   PERFMON_CLS_TIMER_DECL(readdir)
+  PERFMON_CLS_TIMER_DECL(readdirplus)
   PERFMON_CLS_TIMER_DECL(reg_file_size)
   PERFMON_CLS_TIMER_DECL(unpack_metadata)
 };
@@ -737,7 +864,8 @@ metadata_v2_data::metadata_v2_data(
     LoggerPolicy const&, logger& lgr, std::span<uint8_t const> schema,
     std::span<uint8_t const> data, metadata_options const& options,
     int inode_offset, bool force_consistency_check,
-    std::shared_ptr<performance_monitor const> const& perfmon [[maybe_unused]])
+    std::shared_ptr<performance_monitor const> const& perfmon [[maybe_unused]],
+    std::shared_ptr<metadata_cache const> cache)
     : schema_{schema.begin(), schema.end()}
     , data_{data}
     , meta_{check_frozen(map_frozen<thrift::metadata::metadata>(schema, data_))}
@@ -752,28 +880,45 @@ metadata_v2_data::metadata_v2_data(
     , dev_inode_offset_{find_inode_offset(inode_rank::INO_DEV)}
     , inode_count_(meta_.dir_entries() ? meta_.inodes().size()
                                        : meta_.entry_table_v2_2().size())
-    , chunk_table_{unpack_chunk_table<LoggerPolicy>(lgr)}
-    , shared_files_{unpack_shared_files<LoggerPolicy>(lgr)}
+    , cache_{std::move(cache)}
+    , chunk_table_{unpack_chunk_table()}
+    , shared_files_{unpack_shared_files()}
+    , size_table_{find_size_cache_table(false)}
+    , allocated_size_table_{find_size_cache_table(true)}
     , unique_files_(dev_inode_offset_ - file_inode_offset_ -
                     (shared_files_.empty()
                          ? meta_.shared_files_table()
                                ? meta_.shared_files_table()->size()
                                : 0
                          : shared_files_.size()))
-    , nlinks_{build_nlinks<LoggerPolicy>(lgr)}
+    , nlinks_builder_{[this, &lgr] { return build_nlinks<LoggerPolicy>(lgr); }}
     , options_{options}
     , symlinks_{meta_.compact_symlinks()
                     ? string_table(lgr, "symlinks", *meta_.compact_symlinks())
                     : string_table(meta_.symlinks())}
-    , dir_icase_cache_{build_dir_icase_cache<LoggerPolicy>(lgr)}
+    , dir_icase_builder_{[this, &lgr](uint32_t inode) {
+      return build_dir_icase_order<LoggerPolicy>(lgr, inode);
+    }}
+    , dir_icase_cache_{options.case_insensitive_lookup
+                           ? meta_.directories().size()
+                           : 0}
+    , dir_lookup_indices_{meta_.directories().size()}
     , seek_cache_(std::in_place, 64)
+    , path_cache_{options.path_cache_size > 0
+                      ? std::make_unique<
+                            synchronized<lru_cache<std::string, uint32_t>>>(
+                            std::in_place, options.path_cache_size)
+                      : nullptr}
     // clang-format off
       PERFMON_CLS_PROXY_INIT(perfmon, "metadata")
       PERFMON_CLS_TIMER_INIT(find)
       PERFMON_CLS_TIMER_INIT(find_path)
+      PERFMON_CLS_TIMER_INIT(find_path_hit)
+      PERFMON_CLS_TIMER_INIT(find_path_miss)
       PERFMON_CLS_TIMER_INIT(getattr)
       PERFMON_CLS_TIMER_INIT(getattr_opts)
       PERFMON_CLS_TIMER_INIT(readdir)
+      PERFMON_CLS_TIMER_INIT(readdirplus)
       PERFMON_CLS_TIMER_INIT(reg_file_size)
       PERFMON_CLS_TIMER_INIT(unpack_metadata) // clang-format on
 {
@@ -823,6 +968,12 @@ metadata_v2_data::metadata_v2_data(
     }
   }
 
+  if (!options.lazy_init) {
+    unpack_tables<LoggerPolicy>(lgr);
+    nlinks();
+    build_dir_icase_cache<LoggerPolicy>(lgr);
+  }
+
   if (options.check_consistency || force_consistency_check) {
     LOG_PROXY(LoggerPolicy, lgr);
     check_inode_size_cache(LOG_PROXY_ARG);
@@ -943,6 +1094,14 @@ void metadata_v2_data::check_inode_size_cache(
       }
     }
 
+    for (auto const& table : {size_table_, allocated_size_table_}) {
+      if (table && table->size() != meta_.chunk_table().size() - 1) {
+        LOG_ERROR << "inode size table has " << table->size()
+                  << " entries, expected " << meta_.chunk_table().size() - 1;
+        ++errors;
+      }
+    }
+
     if (errors > 0) {
       DWARFS_THROW(
           runtime_error,
@@ -952,10 +1111,80 @@ void metadata_v2_data::check_inode_size_cache(
 }
 
 template <typename LoggerPolicy>
-std::vector<packed_int_vector<uint32_t>>
-metadata_v2_data::build_dir_icase_cache(logger& lgr) const {
-  std::vector<packed_int_vector<uint32_t>> cache;
+packed_int_vector<uint32_t>
+metadata_v2_data::build_dir_icase_order(logger& lgr, uint32_t inode) const {
+  LOG_PROXY(LoggerPolicy, lgr);
+  packed_int_vector<uint32_t> order;
+
+  directory_view dir{inode, global_};
+  auto range = dir.entry_range();
 
+  if (auto const tv =
+          cache_ ? cache_->find(metadata_cache::table_id::icase_order)
+                 : std::nullopt) {
+    if (auto offsets =
+            cached_table(metadata_cache::table_id::icase_dir_offsets,
+                         meta_.directories().size(),
+                         std::bit_width(tv->size()), tv->size())) {
+      auto const begin = (*offsets)[inode];
+      auto const end = (*offsets)[inode + 1];
+
+      if (begin <= end && end <= tv->size() &&
+          (begin == end || end - begin == range.size())) {
+        order.reset(tv->bits(), end - begin);
+        for (size_t i = 0; i < order.size(); ++i) {
+          order.set(i, (*tv)[begin + i]);
+        }
+        return order;
+      }
+    }
+  }
+
+  // Cache the folded names of the directory entries; this significantly
+  // speeds up the sorting code.
+  std::vector<std::string> names(range.size());
+  std::transform(range.begin(), range.end(), names.begin(), [&](auto ix) {
+    return utf8_case_fold_unchecked(dir_entry_view_impl::name(ix, global_));
+  });
+
+  // Check and report any collisions in the directory
+  phmap::flat_hash_map<std::string_view, small_vector<uint32_t, 1>>
+      collisions;
+  collisions.reserve(range.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    collisions[names[i]].push_back(i);
+  }
+  for (auto& [name, indices] : collisions) {
+    if (indices.size() > 1) {
+      LOG_WARN << fmt::format(
+          "case-insensitive collision in directory \"{}\" (inode={}): {}",
+          dir.self_entry_view().unix_path(), inode,
+          fmt::join(indices | ranges::views::transform([&](auto i) {
+                      return dir_entry_view_impl::name(range[i], global_);
+                    }),
+                    ", "));
+    }
+  }
+
+  // It's faster to check here if the folded names are sorted than to
+  // check later if the indices in `entries` are sorted.
+  if (!std::ranges::is_sorted(names)) {
+    std::vector<uint32_t> entries(range.size());
+    // NOLINTNEXTLINE(modernize-use-ranges)
+    std::iota(entries.begin(), entries.end(), 0);
+    std::ranges::stable_sort(
+        entries, [&](auto a, auto b) { return names[a] < names[b]; });
+    order.reset(std::bit_width(entries.size()), entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+      order.set(i, entries[i]);
+    }
+  }
+
+  return order;
+}
+
+template <typename LoggerPolicy>
+void metadata_v2_data::build_dir_icase_cache(logger& lgr) const {
   if (options_.case_insensitive_lookup) {
     LOG_PROXY(LoggerPolicy, lgr);
     auto ti = LOG_TIMED_INFO;
@@ -963,66 +1192,19 @@ metadata_v2_data::build_dir_icase_cache(logger& lgr) const {
     size_t num_cached_files = 0;
     size_t total_cache_size = 0;
 
-    cache.resize(meta_.directories().size());
-
     for (uint32_t inode = 0; inode < meta_.directories().size() - 1; ++inode) {
-      directory_view dir{inode, global_};
-      auto range = dir.entry_range();
-
-      // Cache the folded names of the directory entries; this significantly
-      // speeds up the sorting code.
-      std::vector<std::string> names(range.size());
-      std::transform(range.begin(), range.end(), names.begin(), [&](auto ix) {
-        return utf8_case_fold_unchecked(dir_entry_view_impl::name(ix, global_));
-      });
-
-      // Check and report any collisions in the directory
-      phmap::flat_hash_map<std::string_view, small_vector<uint32_t, 1>>
-          collisions;
-      collisions.reserve(range.size());
-      for (size_t i = 0; i < names.size(); ++i) {
-        collisions[names[i]].push_back(i);
-      }
-      for (auto& [name, indices] : collisions) {
-        if (indices.size() > 1) {
-          LOG_WARN << fmt::format(
-              "case-insensitive collision in directory \"{}\" (inode={}): {}",
-              dir.self_entry_view().unix_path(), inode,
-              fmt::join(indices | ranges::views::transform([&](auto i) {
-                          return dir_entry_view_impl::name(range[i], global_);
-                        }),
-                        ", "));
-        }
-      }
-
-      // It's faster to check here if the folded names are sorted than to
-      // check later if the indices in `entries` are sorted.
-      if (!std::ranges::is_sorted(names)) {
-        std::vector<uint32_t> entries(range.size());
-        // NOLINTNEXTLINE(modernize-use-ranges)
-        std::iota(entries.begin(), entries.end(), 0);
-        std::ranges::stable_sort(
-            entries, [&](auto a, auto b) { return names[a] < names[b]; });
-        auto& pv = cache[inode];
-        pv.reset(std::bit_width(entries.size()), entries.size());
-        for (size_t i = 0; i < entries.size(); ++i) {
-          pv.set(i, entries[i]);
-        }
+      if (auto const& order = dir_icase_order(inode); !order.empty()) {
         ++num_cached_dirs;
-        num_cached_files += entries.size();
-        total_cache_size += pv.size_in_bytes();
+        num_cached_files += order.size();
+        total_cache_size += order.size_in_bytes();
       }
     }
 
     ti << "built case-insensitive directory cache for " << num_cached_files
        << " entries in " << num_cached_dirs << " out of "
        << meta_.directories().size() - 1 << " directories ("
-       << size_with_unit(total_cache_size +
-                         sizeof(decltype(cache)::value_type) * cache.size())
-       << ")";
+       << size_with_unit(total_cache_size) << ")";
   }
-
-  return cache;
 }
 
 template <typename LoggerPolicy>
@@ -1035,10 +1217,28 @@ std::optional<nlink_info> metadata_v2_data::build_nlinks(logger& lgr) const {
   }
 
   if (dev_inode_offset_ > file_inode_offset_) {
+    auto const num_files =
+        static_cast<size_t>(dev_inode_offset_ - file_inode_offset_);
+
+    if (cache_ && cache_->contains(metadata_cache::table_id::nlink_minus_one)) {
+      auto tv = cache_->find(metadata_cache::table_id::nlink_minus_one);
+
+      if (tv->empty() || (tv->size() == num_files &&
+                          (meta_.total_hardlink_size().has_value() ||
+                           cache_->total_hardlink_size().has_value()))) {
+        packed_nlinks.emplace();
+        packed_nlinks->nlink_minus_one = tv->to_packed();
+        if (!tv->empty() && !meta_.total_hardlink_size().has_value()) {
+          packed_nlinks->total_hardlink_size = cache_->total_hardlink_size();
+        }
+        return packed_nlinks;
+      }
+    }
+
     LOG_PROXY(LoggerPolicy, lgr);
     auto td = LOG_TIMED_DEBUG;
 
-    std::vector<uint32_t> nlinks(dev_inode_offset_ - file_inode_offset_);
+    std::vector<uint32_t> nlinks(num_files);
     size_t total_links{0};
 
     auto add_link = [&](int index) {
@@ -1116,60 +1316,132 @@ std::optional<nlink_info> metadata_v2_data::build_nlinks(logger& lgr) const {
   return packed_nlinks;
 }
 
-template <typename LoggerPolicy>
-packed_int_vector<uint32_t>
-metadata_v2_data::unpack_chunk_table(logger& lgr) const {
-  packed_int_vector<uint32_t> chunk_table;
+std::optional<View<std::vector<uint64_t>>>
+metadata_v2_data::find_size_cache_table(bool allocated) const {
+  if (auto const cache = meta_.reg_file_size_cache()) {
+    if (auto const table = allocated ? cache->allocated_size_table()
+                                     : cache->size_table()) {
+      return *table;
+    }
+  }
 
+  return std::nullopt;
+}
+
+lazy_unpacked_table metadata_v2_data::unpack_chunk_table() const {
   if (auto opts = meta_.options(); opts and opts->packed_chunk_table()) {
-    LOG_PROXY(LoggerPolicy, lgr);
-    auto td = LOG_TIMED_DEBUG;
+    auto const tbl = meta_.chunk_table();
+    auto const num_chunks = meta_.chunks().size();
 
-    chunk_table.reset(std::bit_width(meta_.chunks().size()));
-    chunk_table.reserve(meta_.chunk_table().size());
-    std::partial_sum(meta_.chunk_table().begin(), meta_.chunk_table().end(),
-                     std::back_inserter(chunk_table));
+    if (auto tv = cached_table(metadata_cache::table_id::chunk_table,
+                               tbl.size(), std::bit_width(num_chunks),
+                               num_chunks)) {
+      return {tv->size(), tv->bits(), tv->data()};
+    }
+
+    // record the prefix sum at the start of each block so that every
+    // block can be unpacked on its own
+    std::vector<uint32_t> base(lazy_unpacked_table::num_blocks(tbl.size()));
+    uint32_t total = 0;
 
-    td << "unpacked chunk table with " << chunk_table.size() << " entries ("
-       << size_with_unit(chunk_table.size_in_bytes()) << ")";
+    for (size_t i = 0; i < tbl.size(); ++i) {
+      if (i % lazy_unpacked_table::block_size == 0) {
+        base[i / lazy_unpacked_table::block_size] = total;
+      }
+      total += tbl[i];
+    }
+
+    return {tbl.size(), std::bit_width(num_chunks),
+            [tbl, base = std::move(base)](size_t block,
+                                          std::span<uint32_t> out) {
+              auto pos = block * lazy_unpacked_table::block_size;
+              auto sum = base[block];
+              for (auto& v : out) {
+                sum += tbl[pos++];
+                v = sum;
+              }
+            }};
   }
 
-  return chunk_table;
+  return {};
 }
 
-template <typename LoggerPolicy>
-packed_int_vector<uint32_t>
-metadata_v2_data::unpack_shared_files(logger& lgr) const {
-  packed_int_vector<uint32_t> unpacked;
-
+lazy_unpacked_table metadata_v2_data::unpack_shared_files() const {
   if (auto opts = meta_.options(); opts and opts->packed_shared_files_table()) {
     if (auto sfp = meta_.shared_files_table(); sfp and !sfp->empty()) {
-      LOG_PROXY(LoggerPolicy, lgr);
-      auto td = LOG_TIMED_DEBUG;
-
       auto size = std::accumulate(sfp->begin(), sfp->end(), 2 * sfp->size());
-      unpacked.reset(std::bit_width(sfp->size()), size);
 
-      uint32_t target = 0;
-      size_t index = 0;
+      if (auto tv = cached_table(metadata_cache::table_id::shared_files,
+                                 size, std::bit_width(sfp->size()),
+                                 sfp->size() - 1)) {
+        return {tv->size(), tv->bits(), tv->data()};
+      }
 
-      for (auto c : *sfp) {
-        for (size_t i = 0; i < c + 2; ++i) {
-          unpacked.set(index++, target);
+      // record the current file and its remaining number of entries at
+      // the start of each block so that every block can be unpacked on
+      // its own
+      struct block_start {
+        uint32_t target;
+        uint32_t remaining;
+      };
+
+      auto const tbl = *sfp;
+      std::vector<block_start> start(lazy_unpacked_table::num_blocks(size));
+      size_t offset = 0;
+      size_t next = 0;
+
+      for (size_t pos = 0; pos < tbl.size(); ++pos) {
+        auto const count = tbl[pos] + 2;
+        while (next < start.size() &&
+               next * lazy_unpacked_table::block_size < offset + count) {
+          start[next] = {
+              static_cast<uint32_t>(pos),
+              static_cast<uint32_t>(offset + count -
+                                    next * lazy_unpacked_table::block_size)};
+          ++next;
         }
-
-        ++target;
+        offset += count;
       }
 
-      DWARFS_CHECK(unpacked.size() == size,
-                   "unexpected unpacked shared files count");
-
-      td << "unpacked shared files table with " << unpacked.size()
-         << " entries (" << size_with_unit(unpacked.size_in_bytes()) << ")";
+      return {size, std::bit_width(sfp->size()),
+              [tbl, start = std::move(start)](size_t block,
+                                              std::span<uint32_t> out) {
+                auto [target, remaining] = start[block];
+                for (auto& v : out) {
+                  if (remaining == 0) {
+                    remaining = tbl[++target] + 2;
+                  }
+                  v = target;
+                  --remaining;
+                }
+              }};
     }
   }
 
-  return unpacked;
+  return {};
+}
+
+template <typename LoggerPolicy>
+void metadata_v2_data::unpack_tables(logger& lgr) const {
+  LOG_PROXY(LoggerPolicy, lgr);
+
+  if (!chunk_table_.empty()) {
+    auto td = LOG_TIMED_DEBUG;
+
+    chunk_table_.unpack_all();
+
+    td << "unpacked chunk table with " << chunk_table_.size() << " entries ("
+       << size_with_unit(chunk_table_.size_in_bytes()) << ")";
+  }
+
+  if (!shared_files_.empty()) {
+    auto td = LOG_TIMED_DEBUG;
+
+    shared_files_.unpack_all();
+
+    td << "unpacked shared files table with " << shared_files_.size()
+       << " entries (" << size_with_unit(shared_files_.size_in_bytes()) << ")";
+  }
 }
 
 void metadata_v2_data::analyze_chunks(std::ostream& os) const {
@@ -1273,8 +1545,8 @@ void metadata_v2_data::statvfs(vfs_stat* stbuf) const {
 
   if (auto const thls = meta_.total_hardlink_size(); thls.has_value()) {
     stbuf->total_hardlink_size = *thls;
-  } else if (nlinks_.has_value()) {
-    stbuf->total_hardlink_size = nlinks_->total_hardlink_size.value_or(0);
+  } else if (auto const& nl = nlinks(); nl.has_value()) {
+    stbuf->total_hardlink_size = nl->total_hardlink_size.value_or(0);
     stbuf->total_fs_size -= stbuf->total_hardlink_size;
   } else {
     stbuf->total_hardlink_size = 0;
@@ -1355,17 +1627,29 @@ file_size_result
 metadata_v2_data::reg_file_size_impl_noperfmon(inode_view_impl const& iv,
                                                bool use_cache,
                                                TraceFunc const& trace) const {
-  // Looking up the chunk range is cheap, and we likely have to do it anyway
-  std::error_code ec;
   auto const inode = iv.inode_num();
   auto const index = file_inode_to_chunk_index(inode);
+  file_size_result result;
+  bool const enable_sparse = options_.enable_sparse_files;
+
+  if (use_cache && size_table_) {
+    // The complete size cache allows us to skip the chunk range entirely
+    trace(index);
+
+    result.size = (*size_table_)[index];
+    result.allocated_size = enable_sparse && allocated_size_table_
+                                ? (*allocated_size_table_)[index]
+                                : result.size;
+
+    return result;
+  }
+
+  // Looking up the chunk range is cheap, and we likely have to do it anyway
+  std::error_code ec;
   auto const cr = get_chunk_range_from_index(index, ec);
   DWARFS_CHECK(!ec,
                fmt::format("get_chunk_range({}): {}", inode, ec.message()));
 
-  file_size_result result;
-  bool const enable_sparse = options_.enable_sparse_files;
-
   if (use_cache) {
     if (auto const cache = meta_.reg_file_size_cache()) {
       if (cr.size() >= cache->min_chunk_count()) {
@@ -1893,6 +2177,87 @@ void metadata_v2_data::dump(
   }
 }
 
+bool metadata_v2_data::has_complete_cache() const {
+  using enum metadata_cache::table_id;
+
+  if (!cache_) {
+    return false;
+  }
+
+  auto const needs_nlinks =
+      !(meta_.options().has_value() && meta_.options()->inodes_have_nlink()) &&
+      dev_inode_offset_ > file_inode_offset_;
+
+  return (chunk_table_.empty() || cache_->contains(chunk_table)) &&
+         (shared_files_.empty() || cache_->contains(shared_files)) &&
+         (!needs_nlinks || cache_->contains(nlink_minus_one)) &&
+         (!options_.case_insensitive_lookup ||
+          (cache_->contains(icase_dir_offsets) &&
+           cache_->contains(icase_order)));
+}
+
+metadata_cache metadata_v2_data::build_cache() const {
+  using enum metadata_cache::table_id;
+
+  metadata_cache cache;
+
+  auto add_table = [&](metadata_cache::table_id id,
+                       lazy_unpacked_table const& tbl) {
+    if (!tbl.empty()) {
+      packed_int_vector<uint32_t> pv;
+      pv.reset(tbl.bits(), tbl.size());
+      for (size_t i = 0; i < tbl.size(); ++i) {
+        pv.set(i, tbl[i]);
+      }
+      cache.add(id, std::move(pv));
+    }
+  };
+
+  add_table(chunk_table, chunk_table_);
+  add_table(shared_files, shared_files_);
+
+  if (auto const& nl = nlinks()) {
+    cache.add(nlink_minus_one, nl->nlink_minus_one);
+    if (nl->total_hardlink_size) {
+      cache.set_total_hardlink_size(*nl->total_hardlink_size);
+    }
+  }
+
+  if (options_.case_insensitive_lookup) {
+    auto const num_dirs = meta_.directories().size() - 1;
+    size_t total = 0;
+    size_t max_bits = 0;
+
+    for (uint32_t inode = 0; inode < num_dirs; ++inode) {
+      auto const& order = dir_icase_order(inode);
+      total += order.size();
+      max_bits = std::max(max_bits, order.bits());
+    }
+
+    packed_int_vector<uint32_t> offsets;
+    packed_int_vector<uint32_t> entries;
+    offsets.reset(std::bit_width(total), num_dirs + 1);
+    entries.reset(max_bits, total);
+
+    size_t pos = 0;
+
+    for (uint32_t inode = 0; inode < num_dirs; ++inode) {
+      auto const& order = dir_icase_order(inode);
+      offsets.set(inode, pos);
+      for (size_t i = 0; i < order.size(); ++i) {
+        entries.set(pos++, order[i]);
+      }
+    }
+
+    offsets.set(num_dirs, pos);
+
+    cache.add(icase_dir_offsets, std::move(offsets));
+    cache.add(icase_order, std::move(entries));
+  }
+
+  return cache;
+}
+
 thrift::metadata::metadata metadata_v2_data::unpack_metadata() const {
   PERFMON_CLS_SCOPED_SECTION(unpack_metadata)
 
@@ -1903,7 +2268,11 @@ thrift::metadata::metadata metadata_v2_data::unpack_metadata() const {
       meta.chunk_table() = chunk_table_.unpack();
     }
     if (auto const& dirs = global_.bundled_directories()) {
-      meta.directories() = dirs->thaw();
+      auto& directories = meta.directories().value();
+      directories = dirs->thaw();
+      for (size_t i = 0; i < directories.size(); ++i) {
+        directories[i].first_entry() = global_.first_dir_entry(i);
+      }
     }
     if (opts->packed_shared_files_table().value()) {
       meta.shared_files_table() = shared_files_.unpack();
@@ -1950,6 +2319,136 @@ void metadata_v2_data::walk(LOG_PROXY_REF_(LoggerPolicy) uint32_t self_index,
   }
 }
 
+template <typename LoggerPolicy, typename T>
+void metadata_v2_data::walk_with_path(
+    LOG_PROXY_REF_(LoggerPolicy) uint32_t self_index, uint32_t parent_index,
+    size_t depth, std::string& path, std::deque<entry_name_batch>& batches,
+    set_type<int>& seen, T const& func) const {
+  func(self_index, parent_index, std::string_view{path});
+
+  auto entry = make_dir_entry_view_impl(self_index, parent_index);
+  auto iv = entry.inode();
+
+  if (iv.is_directory()) {
+    auto inode = iv.inode_num();
+
+    if (!seen.emplace(inode).second) {
+      DWARFS_THROW(runtime_error, "cycle detected during directory walk");
+    }
+
+    auto dir = make_directory_view(inode);
+    auto const first = dir.first_entry();
+    auto const count = dir.entry_count();
+
+    // One batch per level, as we need to keep the names of this level
+    // around while recursing. Adding to a deque keeps references stable.
+    if (batches.size() <= depth) {
+      batches.emplace_back();
+    }
+
+    auto& batch = batches[depth];
+    lookup_entry_name_range(first, count, batch);
+
+    auto const path_len = path.size();
+
+    for (uint32_t i = 0; i < count; ++i) {
+      if (path_len > 0) {
+        path += '/';
+      }
+      path += batch.names.strings[i];
+      walk_with_path(LOG_PROXY_ARG_ first + i, self_index, depth + 1, path,
+                     batches, seen, func);
+      path.resize(path_len);
+    }
+
+    seen.erase(inode);
+  }
+}
+
+template <typename LoggerPolicy>
+void metadata_v2_data::walk_with_path(
+    LOG_PROXY_REF_(LoggerPolicy)
+        std::function<void(dir_entry_view, std::string_view)> const& func)
+    const {
+  set_type<int> seen;
+  std::deque<entry_name_batch> batches;
+  std::string path;
+
+  walk_with_path(LOG_PROXY_ARG_ 0, 0, 0, path, batches, seen,
+                 [&](uint32_t self_index, uint32_t parent_index,
+                     std::string_view entry_path) {
+                   func(make_dir_entry_view(self_index, parent_index),
+                        entry_path);
+                 });
+}
+
+template <typename LoggerPolicy>
+void metadata_v2_data::walk_data_order_with_path(
+    LOG_PROXY_REF_(LoggerPolicy)
+        std::function<void(dir_entry_view, std::string_view)> const& func)
+    const {
+  // As entries in data order are not grouped by directory, we first record
+  // the paths of all directories in a single tree walk, then we decode the
+  // names of all other entries in batches as we go.
+  phmap::flat_hash_map<uint32_t, std::string> dir_paths;
+
+  {
+    set_type<int> seen;
+    std::deque<entry_name_batch> batches;
+    std::string path;
+
+    walk_with_path(LOG_PROXY_ARG_ 0, 0, 0, path, batches, seen,
+                   [&](uint32_t self_index, uint32_t parent_index,
+                       std::string_view entry_path) {
+                     if (make_dir_entry_view_impl(self_index, parent_index)
+                             .inode()
+                             .is_directory()) {
+                       dir_paths.emplace(self_index, entry_path);
+                     }
+                   });
+  }
+
+  std::vector<dir_entry_view> pending;
+  entry_name_batch batch;
+  std::string path;
+
+  pending.reserve(entry_name_batch_size);
+
+  auto flush = [&] {
+    lookup_entry_names(
+        pending.size(),
+        [&](size_t i) { return pending[i].raw().self_index(); }, batch);
+
+    for (size_t i = 0; i < pending.size(); ++i) {
+      auto const& raw = pending[i].raw();
+
+      if (auto it = dir_paths.find(raw.self_index()); it != dir_paths.end()) {
+        func(pending[i], it->second);
+        continue;
+      }
+
+      path.assign(dir_paths.at(raw.parent_index()));
+      if (!path.empty()) {
+        path += '/';
+      }
+      path += batch.names.strings[i];
+
+      func(pending[i], path);
+    }
+
+    pending.clear();
+  };
+
+  for (auto const& dev : entries_in_data_order(LOG_PROXY_ARG)) {
+    pending.push_back(dev);
+    if (pending.size() == entry_name_batch_size) {
+      flush();
+    }
+  }
+
+  flush();
+}
+
 template <typename LoggerPolicy>
 dir_entry_view_iterable
 metadata_v2_data::entries_in_data_order(LOG_PROXY_REF(LoggerPolicy)) const {
@@ -2062,11 +2561,21 @@ metadata_v2_data::find(directory_view dir, std::string_view name) const {
 
   auto range = dir.entry_range();
 
+  if (options_.lookup_index_min_entries > 0 &&
+      range.size() >= options_.lookup_index_min_entries) {
+    if (!options_.case_insensitive_lookup) {
+      return find_indexed(dir, range, name, std::identity{});
+    }
+
+    return find_indexed(dir, range, utf8_case_fold(name),
+                        utf8_case_fold_unchecked);
+  }
+
   if (!options_.case_insensitive_lookup) {
     return find_impl(dir, range, name, std::identity{}, std::identity{});
   }
 
-  auto const& cache = dir_icase_cache_[dir.inode()];
+  auto const& cache = dir_icase_order(dir.inode());
 
   return find_impl(
       dir, boost::irange(range.size()), utf8_case_fold(name),
@@ -2091,7 +2600,59 @@ metadata_v2_data::find(std::string_view path) const {
     path = {};
   }
 
-  auto dev = std::make_optional(root_);
+  if (!path_cache_) {
+    return find_path_from(root_, path);
+  }
+
+  // a single trailing slash is ignored, just like in the uncached lookup
+  auto const stripped = path.ends_with('/') ? path.substr(0, path.size() - 1)
+                                            : path;
+  auto const sep = stripped.rfind('/');
+
+  // empty path components are rare enough to not be worth caching
+  if (sep == std::string_view::npos || stripped.substr(0, sep).ends_with('/')) {
+    return find_path_from(root_, path);
+  }
+
+  auto const dirname = stripped.substr(0, sep);
+  auto const basename = stripped.substr(sep + 1);
+
+  auto cached = path_cache_->with_lock(
+      [dirname](auto& cache) -> std::optional<uint32_t> {
+        if (auto it = cache.find(dirname); it != cache.end()) {
+          return it->second;
+        }
+        return std::nullopt;
+      });
+
+  if (cached) {
+    PERFMON_CLS_SCOPED_SECTION(find_path_hit)
+    return find(make_directory_view(*cached), basename);
+  }
+
+  PERFMON_CLS_SCOPED_SECTION(find_path_miss)
+
+  auto dev = find_path_from(root_, dirname);
+
+  if (!dev) {
+    return std::nullopt;
+  }
+
+  auto iv = dev->inode();
+
+  if (!iv.is_directory()) {
+    return std::nullopt;
+  }
+
+  path_cache_->lock()->set(std::string(dirname), iv.inode_num());
+
+  return find(make_directory_view(iv), basename);
+}
+
+std::optional<dir_entry_view>
+metadata_v2_data::find_path_from(dir_entry_view const& dir,
+                                 std::string_view path) const {
+  auto dev = std::make_optional(dir);
 
   while (!path.empty()) {
     auto iv = dev->inode();
@@ -2124,8 +2685,10 @@ std::optional<dir_entry_view>
 metadata_v2_data::find_impl(directory_view dir, auto const& range,
                             auto const& name, auto const& index_map,
                             auto const& entry_name_transform) const {
+  std::string scratch;
   auto entry_name = [&](auto ix) {
-    return entry_name_transform(dir_entry_view_impl::name(ix, global_));
+    return entry_name_transform(
+        dir_entry_view_impl::name(ix, global_, scratch));
   };
 
   auto it = std::lower_bound(range.begin(), range.end(), name,
@@ -2144,6 +2707,35 @@ metadata_v2_data::find_impl(directory_view dir, auto const& range,
   return std::nullopt;
 }
 
+std::optional<dir_entry_view>
+metadata_v2_data::find_indexed(directory_view dir, auto const& range,
+                               std::string_view name,
+                               auto const& entry_name_transform) const {
+  std::string scratch;
+  auto entry_name = [&](auto pos) {
+    return entry_name_transform(
+        dir_entry_view_impl::name(range[pos], global_, scratch));
+  };
+
+  auto const& index = dir_lookup_indices_.get(dir.inode(), [&] {
+    std::vector<uint64_t> hashes(range.size());
+    for (size_t pos = 0; pos < hashes.size(); ++pos) {
+      hashes[pos] = dir_lookup_index::hash(entry_name(pos));
+    }
+    return dir_lookup_index(hashes);
+  });
+
+  auto pos = index.find(dir_lookup_index::hash(name),
+                        [&](size_t pos) { return entry_name(pos) == name; });
+
+  if (pos) {
+    return dir_entry_view{dir_entry_view_impl::from_dir_entry_index_shared(
+        range[*pos], global_.self_dir_entry(dir.inode()), global_)};
+  }
+
+  return std::nullopt;
+}
+
 template <typename LoggerPolicy>
 file_stat metadata_v2_data::getattr_impl(LOG_PROXY_REF_(LoggerPolicy)
                                              inode_view const& iv,
@@ -2181,10 +2773,10 @@ file_stat metadata_v2_data::getattr_impl(LOG_PROXY_REF_(LoggerPolicy)
   timeres_handler_.fill_stat_timevals(stbuf, ivr);
 
   if (stbuf.is_regular_file()) {
-    if (!nlinks_.has_value()) {
+    if (auto const& nl = nlinks(); !nl.has_value()) {
       // nlink values are stored directly in the inode metadata
       stbuf.set_nlink(ivr.nlink_minus_one() + 1);
-    } else if (auto const& nlm1 = nlinks_->nlink_minus_one; !nlm1.empty()) {
+    } else if (auto const& nlm1 = nl->nlink_minus_one; !nlm1.empty()) {
       // nlink values are stored in a separate table
       stbuf.set_nlink(DWARFS_NOTHROW(nlm1.at(inode - file_inode_offset_)) + 1);
     } else {
@@ -2228,6 +2820,55 @@ metadata_v2_data::readdir(directory_view dir, size_t offset) const {
   return std::nullopt;
 }
 
+void metadata_v2_data::readdir(
+    directory_view dir, size_t offset,
+    std::function<bool(dir_entry_view, std::string_view)> const& func) const {
+  for (; offset < 2; ++offset) {
+    if (!func(*readdir(dir, offset), offset == 0 ? "." : "..")) {
+      return;
+    }
+  }
+
+  offset -= 2;
+
+  auto const first = dir.first_entry();
+  auto const count = dir.entry_count();
+  auto const parent_index = global_.self_dir_entry(dir.inode());
+  entry_name_batch batch;
+
+  while (offset < count) {
+    auto const n = std::min<size_t>(count - offset, entry_name_batch_size);
+
+    lookup_entry_name_range(first + offset, n, batch);
+
+    for (size_t i = 0; i < n; ++i) {
+      if (!func(dir_entry_view{dir_entry_view_impl::from_dir_entry_index_shared(
+                    first + offset + i, parent_index, global_)},
+                batch.names.strings[i])) {
+        return;
+      }
+    }
+
+    offset += n;
+  }
+}
+
+template <typename LoggerPolicy>
+void metadata_v2_data::readdirplus(
+    LOG_PROXY_REF_(LoggerPolicy) directory_view dir, size_t offset,
+    std::function<bool(dir_entry_view, std::string_view,
+                       file_stat const&)> const& func) const {
+  PERFMON_CLS_SCOPED_SECTION(readdirplus)
+
+  // This goes through the same batched name lookup as readdir(), and
+  // calls getattr_impl() directly, so there's no per-entry dispatch or
+  // perfmon overhead.
+  readdir(dir, offset, [&](dir_entry_view dev, std::string_view name) {
+    auto const stbuf = getattr_impl(LOG_PROXY_ARG_ dev.inode(), {});
+    return func(std::move(dev), name, stbuf);
+  });
+}
+
 void metadata_v2_data::access(inode_view const& iv, int mode,
                               file_stat::uid_type uid, file_stat::gid_type gid,
                               std::error_code& ec) const {
@@ -2384,7 +3025,8 @@ class metadata_ final : public metadata_v2::impl {
   metadata_(logger& lgr, std::span<uint8_t const> schema,
             std::span<uint8_t const> data, metadata_options const& options,
             int inode_offset, bool force_consistency_check,
-            std::shared_ptr<performance_monitor const> const& perfmon)
+            std::shared_ptr<performance_monitor const> const& perfmon,
+            std::shared_ptr<metadata_cache const> cache)
       : LOG_PROXY_INIT(lgr)
       , data_{LoggerPolicy{},
               lgr,
@@ -2393,7 +3035,8 @@ class metadata_ final : public metadata_v2::impl {
               options,
               inode_offset,
               force_consistency_check,
-              perfmon} {}
+              perfmon,
+              std::move(cache)} {}
 
   void check_consistency() const override {
     data_.check_consistency(LOG_PROXY_ARG);
@@ -2405,6 +3048,18 @@ class metadata_ final : public metadata_v2::impl {
     data_.walk(LOG_PROXY_ARG_ func);
   }
 
+  void walk_with_path(
+      std::function<void(dir_entry_view, std::string_view)> const& func)
+      const override {
+    data_.walk_with_path(LOG_PROXY_ARG_ func);
+  }
+
+  void walk_data_order_with_path(
+      std::function<void(dir_entry_view, std::string_view)> const& func)
+      const override {
+    data_.walk_data_order_with_path(LOG_PROXY_ARG_ func);
+  }
+
   dir_entry_view_iterable directory_entries() const override {
     return data_.directory_entries();
   }
@@ -2456,6 +3111,21 @@ class metadata_ final : public metadata_v2::impl {
     return data_.readdir(dir, offset);
   }
 
+  void readdir(
+      directory_view dir, size_t offset,
+      std::function<bool(dir_entry_view, std::string_view)> const& func)
+      const override {
+    data_.readdir(dir, offset, func);
+  }
+
+  void readdirplus(directory_view dir, size_t offset,
+                   std::function<bool(dir_entry_view, std::string_view,
+                                      file_stat const&)> const& func,
+                   std::error_code& ec) const override {
+    ec.clear();
+    data_.readdirplus(LOG_PROXY_ARG_ dir, offset, func);
+  }
+
   size_t dirsize(directory_view dir) const override {
     return 2 + dir.entry_count(); // adds '.' and '..', which we fake in ;-)
   }
@@ -2580,14 +3250,23 @@ metadata_v2_utils::thaw_fs_options() const {
   return data_.thaw_fs_options();
 }
 
+bool metadata_v2_utils::has_complete_cache() const {
+  return data_.has_complete_cache();
+}
+
+metadata_cache metadata_v2_utils::build_cache() const {
+  return data_.build_cache();
+}
+
 metadata_v2::metadata_v2(
     logger& lgr, std::span<uint8_t const> schema, std::span<uint8_t const> data,
     metadata_options const& options, int inode_offset,
     bool force_consistency_check,
-    std::shared_ptr<performance_monitor const> const& perfmon)
+    std::shared_ptr<performance_monitor const> const& perfmon,
+    std::shared_ptr<metadata_cache const> cache)
     : impl_(make_unique_logging_object<metadata_v2::impl, metadata_,
                                        logger_policies>(
           lgr, schema, data, options, inode_offset, force_consistency_check,
-          perfmon)) {}
+          perfmon, std::move(cache))) {}
 
 } // namespace dwarfs::reader::internal
@@ -71,6 +71,10 @@ uint32_t inode_view::inode_num() const { return iv_->inode_num(); }
 
 std::string dir_entry_view::name() const { return impl_->name(); }
 
+std::string_view dir_entry_view::name(std::string& scratch) const {
+  return impl_->name(scratch);
+}
+
 inode_view dir_entry_view::inode() const {
   return inode_view{impl_->inode_shared()};
 }
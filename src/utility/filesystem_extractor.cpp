@@ -608,10 +608,10 @@ bool filesystem_extractor_<LoggerPolicy>::extract(
 
     // Collect all directories that contain matching files to make sure
     // we descend into them during the extraction walk below.
-    fs.walk([&](auto entry) {
+    fs.walk_with_path([&](auto entry, std::string_view path) {
       auto inode = entry.inode();
       if (!inode.is_directory()) {
-        if (matcher->match(entry.unix_path())) {
+        if (matcher->match(path)) {
           ++match_count;
 
           if (opts.enable_progress) {
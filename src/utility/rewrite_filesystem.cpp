@@ -281,6 +281,22 @@ void rewrite_filesystem(
 
   auto& writer = fs_writer.get_internal();
 
+  // Blocks that are copied don't go through a compressor, so the writer
+  // needs to be told if any of them are framed. We don't bother figuring
+  // out which blocks will actually be copied.
+  if (!opts.change_block_size &&
+      !(opts.recompress_block && opts.recompress_categories.empty())) {
+    parser->rewind();
+
+    while (auto s = parser->next_section()) {
+      if (s->type() == section_type::BLOCK &&
+          s->compression() == compression_type::FRAMED) {
+        writer.mark_framed_blocks();
+        break;
+      }
+    }
+  }
+
   if (opts.recompress_block && (!opts.no_check || opts.change_block_size)) {
     parser->rewind();
 
@@ -697,6 +697,9 @@ class filesystem_writer_ final : public filesystem_writer_detail {
                      std::optional<fragment_category::value_type> cat) override;
   void write_compressed_section(fs_section const& sec,
                                 file_segment segment) override;
+  void mark_framed_blocks() override {
+    minor_version_.store(MINOR_VERSION_FRAMED);
+  }
   void flush() override;
   size_t size() const override { return image_size_; }
 
@@ -708,6 +711,7 @@ class filesystem_writer_ final : public filesystem_writer_detail {
 
   block_compressor const&
   compressor_for_category(fragment_category::value_type cat) const;
+  block_compressor with_subframes(block_compressor bc);
   void
   write_block_impl(fragment_category cat, shared_byte_buffer data,
                    block_compressor const& bc, std::optional<std::string> meta,
@@ -746,6 +750,7 @@ class filesystem_writer_ final : public filesystem_writer_detail {
   bool volatile flush_{true};
   std::thread writer_thread_;
   uint32_t section_number_{0};
+  std::atomic<uint8_t> minor_version_{MINOR_VERSION};
   std::vector<uint64le_t> section_index_;
   std::ostream::pos_type header_size_{0};
   std::unique_ptr<block_merger_type> merger_;
@@ -874,7 +879,12 @@ void filesystem_writer_<LoggerPolicy>::write(fsblock const& fsb) {
     push_section_index(fsb.type());
   }
 
-  write(fsb.header());
+  // The minor version isn't covered by the checksums, so it can be
+  // adjusted here for all sections
+  auto hdr = fsb.header();
+  hdr.minor = minor_version_.load();
+
+  write(hdr);
   write(fsb.data());
 
   if (fsb.type() == section_type::BLOCK) {
@@ -1154,7 +1164,7 @@ void filesystem_writer_<LoggerPolicy>::add_default_compressor(
 
   DWARFS_CHECK(!default_bc_, "default compressor registered more than once");
 
-  default_bc_ = std::move(bc);
+  default_bc_ = with_subframes(std::move(bc));
 }
 
 template <typename LoggerPolicy>
@@ -1166,7 +1176,7 @@ void filesystem_writer_<LoggerPolicy>::add_category_compressor(
             << cat;
 
   DWARFS_CHECK(
-      category_bc_.emplace(cat, std::move(bc)).second,
+      category_bc_.emplace(cat, with_subframes(std::move(bc))).second,
       fmt::format("compressor registered more than once for category {}", cat));
 }
 
@@ -1200,6 +1210,24 @@ void filesystem_writer_<LoggerPolicy>::add_section_compressor(
                   get_friendly_section_name(type)));
 }
 
+template <typename LoggerPolicy>
+block_compressor
+filesystem_writer_<LoggerPolicy>::with_subframes(block_compressor bc) {
+  if (options_.subframe_size == 0 || bc.type() == compression_type::NONE) {
+    return bc;
+  }
+
+  if (!bc.metadata_requirements().empty()) {
+    LOG_VERBOSE << "not using sub-frames with compressor (" << bc.describe()
+                << ") as it requires compression metadata";
+    return bc;
+  }
+
+  mark_framed_blocks();
+
+  return bc.with_subframes(options_.subframe_size);
+}
+
 template <typename LoggerPolicy>
 auto filesystem_writer_<LoggerPolicy>::get_compression_constraints(
     fragment_category::value_type cat, std::string const& metadata) const
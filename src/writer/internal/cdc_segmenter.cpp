@@ -0,0 +1,500 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <dwarfs/compression_constraints.h>
+#include <dwarfs/error.h>
+#include <dwarfs/file_extent.h>
+#include <dwarfs/logger.h>
+#include <dwarfs/malloc_byte_buffer.h>
+#include <dwarfs/util.h>
+
+#include <dwarfs/writer/internal/block_manager.h>
+#include <dwarfs/writer/internal/cdc_segmenter.h>
+#include <dwarfs/writer/internal/chunkable.h>
+#include <dwarfs/writer/internal/fingerprint_index.h>
+#include <dwarfs/writer/internal/progress.h>
+#include <dwarfs/writer/internal/segmenter_progress.h>
+
+namespace dwarfs::writer::internal {
+
+namespace {
+
+/**
+ * Content-Defined Chunking
+ *
+ * Files are split into chunks at positions determined only by the local
+ * content, so identical data produces identical chunks regardless of its
+ * position in the input. Each chunk is identified by a 128-bit fingerprint,
+ * and chunks already in the fingerprint index are stored as references to
+ * the existing data instead of being added to a block again.
+ *
+ * Cut points are found using FastCDC, i.e. a gear hash with normalized
+ * chunking: chunks are at least 1/4 and at most 4 times the average chunk
+ * size, and between the minimum and average size, a stricter mask is used
+ * than after the average size, which narrows the chunk size distribution.
+ *
+ * As the index covers all chunks seen by the segmenter, this finds repeated
+ * data across the whole input, not just within a lookback window of recent
+ * blocks. The downside is that matches are limited to whole chunks.
+ */
+
+constexpr uint64_t splitmix64(uint64_t& state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+constexpr std::array<uint64_t, 256> make_gear_table() {
+  std::array<uint64_t, 256> table{};
+  uint64_t state{0x6765617274626c00}; // "geartbl"
+  for (auto& v : table) {
+    v = splitmix64(state);
+  }
+  return table;
+}
+
+constexpr auto kGearTable = make_gear_table();
+
+// Normalization level, i.e. the number of mask bits added before and
+// removed after the average chunk size
+constexpr unsigned kNormalizationLevel{2};
+
+class cdc_chunker {
+ public:
+  cdc_chunker(unsigned avg_size_bits, size_t granularity)
+      : granularity_{granularity}
+      , min_size_{static_cast<size_t>(1) << (avg_size_bits - 2)}
+      , avg_size_{static_cast<size_t>(1) << avg_size_bits}
+      , max_size_{(avg_size_ * 4) - ((avg_size_ * 4) % granularity)}
+      , mask_small_{top_bits(avg_size_bits + kNormalizationLevel)}
+      , mask_large_{top_bits(avg_size_bits - kNormalizationLevel)} {}
+
+  size_t min_size() const { return min_size_; }
+  size_t avg_size() const { return avg_size_; }
+  size_t max_size() const { return max_size_; }
+
+  // Returns the size of the chunk starting at the beginning of `data`, or
+  // std::nullopt if there's not enough data to find the end of the chunk.
+  std::optional<size_t> find_cut(std::span<uint8_t const> data) const {
+    auto const size = data.size();
+    auto const limit = std::min(size, max_size_);
+    auto const normal = std::min(limit, avg_size_);
+    uint64_t hash{0};
+    size_t i = min_size_;
+
+    for (; i < normal; ++i) {
+      hash = (hash << 1) + kGearTable[data[i]];
+      if ((hash & mask_small_) == 0) [[unlikely]] {
+        return align(i + 1, size);
+      }
+    }
+
+    for (; i < limit; ++i) {
+      hash = (hash << 1) + kGearTable[data[i]];
+      if ((hash & mask_large_) == 0) [[unlikely]] {
+        return align(i + 1, size);
+      }
+    }
+
+    if (limit == max_size_) {
+      return max_size_;
+    }
+
+    return std::nullopt;
+  }
+
+ private:
+  static constexpr uint64_t top_bits(unsigned bits) {
+    return ~static_cast<uint64_t>(0) << (64 - bits);
+  }
+
+  // Cut points must be a multiple of the granularity
+  std::optional<size_t> align(size_t cut, size_t size) const {
+    if (granularity_ > 1) {
+      cut += (granularity_ - (cut % granularity_)) % granularity_;
+      if (cut > size) {
+        return std::nullopt;
+      }
+    }
+    return cut;
+  }
+
+  size_t const granularity_;
+  size_t const min_size_;
+  size_t const avg_size_;
+  size_t const max_size_;
+  uint64_t const mask_small_;
+  uint64_t const mask_large_;
+};
+
+struct cdc_stats {
+  uint64_t chunks{0};
+  uint64_t chunk_bytes{0};
+  uint64_t duplicate_chunks{0};
+  uint64_t duplicate_bytes{0};
+  uint64_t split_chunks{0};
+};
+
+template <typename LoggerPolicy>
+class cdc_segmenter_ final : public segmenter::impl {
+ public:
+  cdc_segmenter_(logger& lgr, progress& prog,
+                 std::shared_ptr<block_manager> blkmgr,
+                 segmenter::config const& cfg,
+                 compression_constraints const& cc, file_size_t total_size,
+                 segmenter::block_ready_cb block_ready)
+      : LOG_PROXY_INIT(lgr)
+      , prog_{prog}
+      , blkmgr_{std::move(blkmgr)}
+      , cfg_{cfg}
+      , block_ready_{std::move(block_ready)}
+      , pctx_{prog.create_context<segmenter_progress>(cfg.context, total_size)}
+      , granularity_{cc.granularity.value_or(1)}
+      , block_size_{constrained_block_size(cfg, granularity_)}
+      , chunker_{cfg.cdc_chunk_size_bits, granularity_}
+      , index_{cfg.cdc_index_memory, cfg.cdc_spill_dir} {
+    LOG_VERBOSE << cfg_.context << "using content-defined chunking with "
+                << size_with_unit(chunker_.min_size()) << " / "
+                << size_with_unit(chunker_.avg_size()) << " / "
+                << size_with_unit(chunker_.max_size())
+                << " min/avg/max chunks, "
+                << size_with_unit(cfg_.cdc_index_memory)
+                << " fingerprint index memory";
+  }
+
+  void add_chunkable(chunkable& chkable) override;
+  void finish() override;
+
+ private:
+  static size_t
+  constrained_block_size(segmenter::config const& cfg, size_t granularity) {
+    auto size = static_cast<size_t>(1) << cfg.block_size_bits;
+    return size - (size % granularity);
+  }
+
+  size_t add_chunks(chunkable& chkable, std::span<uint8_t const> data,
+                    bool last);
+  void add_cdc_chunk(chunkable& chkable, std::span<uint8_t const> data);
+  void append_data(chunkable& chkable, std::span<uint8_t const> data);
+  void add_range(chunkable& chkable, size_t block, file_off_t offset,
+                 file_size_t size);
+  void finish_chunk(chunkable& chkable);
+  void start_block();
+  void block_ready();
+
+  size_t space_in_block() const {
+    return block_ ? block_size_ - block_->size() : block_size_;
+  }
+
+  // A chunk that has not yet been added to the chunkable; consecutive
+  // ranges are merged if they are contiguous within the same block
+  struct chunk_state {
+    size_t block{0};
+    file_off_t offset{0};
+    file_size_t size{0};
+  };
+
+  LOG_PROXY_DECL(LoggerPolicy);
+  progress& prog_;
+  std::shared_ptr<block_manager> blkmgr_;
+  segmenter::config const cfg_;
+  segmenter::block_ready_cb block_ready_;
+  std::shared_ptr<segmenter_progress> pctx_;
+  size_t const granularity_;
+  size_t const block_size_;
+  cdc_chunker const chunker_;
+  fingerprint_index index_;
+  std::optional<mutable_byte_buffer> block_;
+  size_t block_num_{0};
+  chunk_state chunk_;
+  std::vector<uint8_t> pending_;
+  cdc_stats stats_;
+};
+
+template <typename LoggerPolicy>
+void cdc_segmenter_<LoggerPolicy>::add_chunkable(chunkable& chkable) {
+  if (chkable.size() == 0) {
+    return;
+  }
+
+  LOG_TRACE << cfg_.context << "adding " << chkable.description();
+
+  DWARFS_CHECK(chkable.size() % granularity_ == 0,
+               fmt::format("unexpected size {} for given granularity {}",
+                           chkable.size(), granularity_));
+
+  pctx_->current_file = chkable.get_file();
+
+  for (auto const& ext : chkable.extents()) {
+    if (cfg_.enable_sparse_files && ext.kind() == extent_kind::hole) {
+      finish_chunk(chkable);
+      chkable.add_hole(ext.size());
+      prog_.total_bytes_read += ext.size();
+      pctx_->bytes_processed += ext.size();
+      continue;
+    }
+
+    // Cut points only depend on the chunk data, so chunks spanning
+    // multiple segments are assembled in `pending_`.
+    for (auto const& seg : ext.segments()) {
+      auto data = seg.span<uint8_t>();
+
+      if (!pending_.empty()) {
+        auto const old_size = pending_.size();
+        auto const take = std::min(data.size(), chunker_.max_size() - old_size);
+        pending_.insert(pending_.end(), data.begin(), data.begin() + take);
+
+        auto const cut = chunker_.find_cut(pending_);
+
+        if (!cut) {
+          assert(take == data.size());
+          continue;
+        }
+
+        add_cdc_chunk(chkable, std::span{pending_}.first(*cut));
+        data = data.subspan(*cut - old_size);
+        pending_.clear();
+      }
+
+      auto const used = add_chunks(chkable, data, false);
+      pending_.assign(data.begin() + used, data.end());
+
+      std::error_code ec;
+      ext.release_until(seg.offset() + seg.size() - ext.offset(), ec);
+    }
+
+    if (!pending_.empty()) {
+      add_chunks(chkable, pending_, true);
+      pending_.clear();
+    }
+  }
+
+  finish_chunk(chkable);
+}
+
+template <typename LoggerPolicy>
+size_t
+cdc_segmenter_<LoggerPolicy>::add_chunks(chunkable& chkable,
+                                         std::span<uint8_t const> data,
+                                         bool last) {
+  size_t pos = 0;
+
+  while (pos < data.size()) {
+    auto const rest = data.subspan(pos);
+    auto cut = chunker_.find_cut(rest);
+
+    if (!cut) {
+      if (!last) {
+        break;
+      }
+      cut = rest.size();
+    }
+
+    add_cdc_chunk(chkable, rest.first(*cut));
+    pos += *cut;
+  }
+
+  return pos;
+}
+
+template <typename LoggerPolicy>
+void cdc_segmenter_<LoggerPolicy>::add_cdc_chunk(
+    chunkable& chkable, std::span<uint8_t const> data) {
+  auto const fp = fingerprint_index::compute(data.data(), data.size());
+  auto const loc = index_.find(fp);
+
+  ++stats_.chunks;
+  stats_.chunk_bytes += data.size();
+
+  if (loc && loc->size == data.size()) {
+    LOG_TRACE << cfg_.context << "found " << data.size()
+              << " byte chunk in block " << loc->block << " @ "
+              << loc->offset;
+
+    ++stats_.duplicate_chunks;
+    stats_.duplicate_bytes += data.size();
+    prog_.saved_by_segmentation += data.size();
+    add_range(chkable, loc->block, loc->offset, loc->size);
+  } else if (space_in_block() >= data.size()) {
+    start_block();
+    fingerprint_index::location const new_loc{
+        static_cast<uint32_t>(block_num_),
+        static_cast<uint32_t>(block_->size()),
+        static_cast<uint32_t>(data.size())};
+    append_data(chkable, data);
+    if (!loc) {
+      index_.insert(fp, new_loc);
+    }
+  } else {
+    // Chunks split across blocks cannot be referenced
+    ++stats_.split_chunks;
+    append_data(chkable, data);
+  }
+
+  prog_.total_bytes_read += data.size();
+  pctx_->bytes_processed += data.size();
+}
+
+template <typename LoggerPolicy>
+void cdc_segmenter_<LoggerPolicy>::append_data(chunkable& chkable,
+                                               std::span<uint8_t const> data) {
+  do {
+    start_block();
+
+    auto const size = std::min(data.size(), space_in_block());
+    auto const offset = block_->size();
+
+    block_->append(data.data(), size);
+    prog_.filesystem_size += size;
+
+    if (size > 0) {
+      add_range(chkable, block_num_, offset, size);
+    }
+
+    if (block_->size() == block_size_) {
+      finish_chunk(chkable);
+      block_ready();
+    }
+
+    data = data.subspan(size);
+  } while (!data.empty());
+}
+
+template <typename LoggerPolicy>
+void cdc_segmenter_<LoggerPolicy>::add_range(chunkable& chkable, size_t block,
+                                             file_off_t offset,
+                                             file_size_t size) {
+  if (chunk_.size > 0 &&
+      (chunk_.block != block || chunk_.offset + chunk_.size != offset)) {
+    finish_chunk(chkable);
+  }
+
+  if (chunk_.size == 0) {
+    chunk_.block = block;
+    chunk_.offset = offset;
+  }
+
+  chunk_.size += size;
+}
+
+template <typename LoggerPolicy>
+void cdc_segmenter_<LoggerPolicy>::finish_chunk(chunkable& chkable) {
+  if (chunk_.size > 0) {
+    chkable.add_chunk(chunk_.block, chunk_.offset, chunk_.size);
+    chunk_.size = 0;
+    prog_.chunk_count++;
+  }
+}
+
+template <typename LoggerPolicy>
+void cdc_segmenter_<LoggerPolicy>::start_block() {
+  if (!block_) {
+    block_.emplace(malloc_byte_buffer::create());
+    block_->reserve(block_size_);
+    block_num_ = blkmgr_->get_logical_block();
+  }
+}
+
+template <typename LoggerPolicy>
+void cdc_segmenter_<LoggerPolicy>::block_ready() {
+  block_ready_(block_->share(), block_num_);
+  block_.reset();
+  ++prog_.block_count;
+}
+
+template <typename LoggerPolicy>
+void cdc_segmenter_<LoggerPolicy>::finish() {
+  if (block_ && !block_->empty()) {
+    block_ready();
+  }
+
+  if (stats_.chunks > 0) {
+    LOG_VERBOSE << cfg_.context << "content-defined chunking: "
+                << stats_.chunks << " chunks ("
+                << size_with_unit(stats_.chunk_bytes) << ", avg "
+                << size_with_unit(stats_.chunk_bytes / stats_.chunks)
+                << "), " << stats_.duplicate_chunks << " duplicates ("
+                << size_with_unit(stats_.duplicate_bytes) << "), "
+                << stats_.split_chunks << " split across blocks";
+  }
+
+  auto const& st = index_.get_stats();
+
+  if (st.entries > 0) {
+    LOG_VERBOSE << cfg_.context << "fingerprint index: " << st.entries
+                << " entries, " << size_with_unit(index_.memory_usage())
+                << " memory";
+  }
+
+  if (st.spills > 0) {
+    LOG_VERBOSE << cfg_.context << "fingerprint index spilled "
+                << st.spilled_entries << " entries in " << st.spills
+                << " runs (" << st.merges << " merges), " << st.page_reads
+                << " page reads, " << st.bloom_false_positives
+                << " bloom filter false positives, "
+                << size_with_unit(index_.run_memory_usage())
+                << " memory for spilled runs";
+
+    if (index_.memory_usage() > cfg_.cdc_index_memory) {
+      LOG_WARN << cfg_.context << "fingerprint index used "
+               << size_with_unit(index_.memory_usage()) << ", exceeding the "
+               << size_with_unit(cfg_.cdc_index_memory)
+               << " limit; consider a larger index memory limit or chunk "
+                  "size";
+    }
+  }
+}
+
+} // namespace
+
+std::unique_ptr<segmenter::impl>
+create_cdc_segmenter(logger& lgr, progress& prog,
+                     std::shared_ptr<block_manager> blkmgr,
+                     segmenter::config const& cfg,
+                     compression_constraints const& cc, file_size_t total_size,
+                     segmenter::block_ready_cb block_ready) {
+  return make_unique_logging_object<segmenter::impl, cdc_segmenter_,
+                                    logger_policies>(
+      lgr, prog, std::move(blkmgr), cfg, cc, total_size,
+      std::move(block_ready));
+}
+
+uint64_t estimate_cdc_segmenter_memory_usage(segmenter::config const& cfg) {
+  // the in-memory parts of spilled runs count against the same limit
+  return cfg.cdc_index_memory;
+}
+
+} // namespace dwarfs::writer::internal
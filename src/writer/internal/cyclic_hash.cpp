@@ -0,0 +1,185 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <dwarfs/compiler.h>
+
+#include <dwarfs/writer/internal/cyclic_hash.h>
+
+#if defined(DWARFS_USE_CPU_FEATURES) && defined(__x86_64__)
+#define DWARFS_USE_AVX2_ROLL
+#include <immintrin.h>
+#endif
+
+namespace dwarfs::writer::internal {
+
+namespace {
+
+/**
+ * Both halves of the rsync hash are running sums modulo 2^16 over the
+ * window positions:
+ *
+ *   a[i] = a[i-1] + in[i] - out[i]
+ *   b[i] = b[i-1] + a[i] - window_size * out[i]
+ *
+ * So hash values for consecutive positions can be computed as two
+ * prefix sums over 16-bit lanes, which is what the vectorized kernel
+ * does for 16 positions at a time.
+ */
+
+enum class cpu_feature {
+  none,
+  avx2,
+};
+
+#ifdef DWARFS_USE_AVX2_ROLL
+cpu_feature detect_cpu_feature() {
+  static cpu_feature const feature = [] {
+    if (__builtin_cpu_supports("avx2")) {
+      return cpu_feature::avx2;
+    }
+    return cpu_feature::none;
+  }();
+  return feature;
+}
+#endif
+
+DWARFS_FORCE_INLINE void
+roll_generic(uint16_t& a, uint16_t& b, size_t len, uint8_t const* p,
+             size_t count, uint32_t* hashes) {
+  auto const* out = p - len;
+  auto const mul = static_cast<uint16_t>(len);
+
+  for (size_t i = 0; i < count; ++i) {
+    a = a - out[i] + p[i];
+    b = b - mul * out[i] + a;
+    hashes[i] = a | (static_cast<uint32_t>(b) << 16);
+  }
+}
+
+void roll_default(uint16_t& a, uint16_t& b, size_t len, uint8_t const* p,
+                  size_t count, uint32_t* hashes) {
+  roll_generic(a, b, len, p, count, hashes);
+}
+
+#ifdef DWARFS_USE_AVX2_ROLL
+// Broadcast the last 16-bit element of each 128-bit lane to the whole lane
+__attribute__((__target__("avx2"))) inline __m256i
+broadcast_lane_last_epi16(__m256i x) {
+  x = _mm256_shufflehi_epi16(x, 0xff);
+  return _mm256_unpackhi_epi64(x, x);
+}
+
+__attribute__((__target__("avx2"))) inline __m256i
+prefix_sum_epi16(__m256i x) {
+  x = _mm256_add_epi16(x, _mm256_slli_si256(x, 2));
+  x = _mm256_add_epi16(x, _mm256_slli_si256(x, 4));
+  x = _mm256_add_epi16(x, _mm256_slli_si256(x, 8));
+  // carry the sum of the low lane over into the high lane
+  auto const carry = broadcast_lane_last_epi16(x);
+  return _mm256_add_epi16(x, _mm256_permute2x128_si256(carry, carry, 0x08));
+}
+
+__attribute__((__target__("avx2"))) inline __m256i
+broadcast_last_epi16(__m256i x) {
+  auto const t = broadcast_lane_last_epi16(x);
+  return _mm256_permute2x128_si256(t, t, 0x11);
+}
+
+__attribute__((__target__("avx2"))) inline __m256i
+load_epu8_epi16(uint8_t const* p) {
+  return _mm256_cvtepu8_epi16(
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(p)));
+}
+
+__attribute__((__target__("avx2"))) void
+roll_avx2(uint16_t& a, uint16_t& b, size_t len, uint8_t const* p,
+          size_t count, uint32_t* hashes) {
+  static constexpr size_t kLanes{16};
+
+  auto const vlen = _mm256_set1_epi16(static_cast<int16_t>(len));
+  auto va = _mm256_set1_epi16(static_cast<int16_t>(a));
+  auto vb = _mm256_set1_epi16(static_cast<int16_t>(b));
+  size_t i = 0;
+
+  for (; i + kLanes <= count; i += kLanes) {
+    auto const in = load_epu8_epi16(p + i);
+    auto const out = load_epu8_epi16(p + i - len);
+
+    auto ha =
+        _mm256_add_epi16(va, prefix_sum_epi16(_mm256_sub_epi16(in, out)));
+    auto hb = _mm256_add_epi16(
+        vb, prefix_sum_epi16(
+                _mm256_sub_epi16(ha, _mm256_mullo_epi16(out, vlen))));
+
+    va = broadcast_last_epi16(ha);
+    vb = broadcast_last_epi16(hb);
+
+    // interleave a and b into 32-bit hash values in position order
+    ha = _mm256_permute4x64_epi64(ha, 0xd8);
+    hb = _mm256_permute4x64_epi64(hb, 0xd8);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i),
+                        _mm256_unpacklo_epi16(ha, hb));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i + kLanes / 2),
+                        _mm256_unpackhi_epi16(ha, hb));
+  }
+
+  a = static_cast<uint16_t>(_mm256_extract_epi16(va, 0));
+  b = static_cast<uint16_t>(_mm256_extract_epi16(vb, 0));
+
+  roll_generic(a, b, len, p + i, count - i, hashes + i);
+}
+#endif
+
+using roll_fn = void (*)(uint16_t&, uint16_t&, size_t, uint8_t const*,
+                         size_t, uint32_t*);
+
+roll_fn select_roll() {
+#ifdef DWARFS_USE_AVX2_ROLL
+  switch (detect_cpu_feature()) {
+  case cpu_feature::avx2:
+    return &roll_avx2;
+  default:
+    break;
+  }
+#endif
+  return &roll_default;
+}
+
+} // namespace
+
+void rsync_hash::roll(uint8_t const* p, size_t count, uint32_t* hashes) {
+  static roll_fn const roll_impl = select_roll();
+  roll_impl(a_, b_, static_cast<size_t>(len_), p, count, hashes);
+}
+
+std::string_view rsync_hash::roll_implementation() {
+#ifdef DWARFS_USE_AVX2_ROLL
+  if (detect_cpu_feature() == cpu_feature::avx2) {
+    return "avx2";
+  }
+#endif
+  return "scalar";
+}
+
+} // namespace dwarfs::writer::internal
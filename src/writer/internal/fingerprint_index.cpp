@@ -0,0 +1,371 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <fstream>
+#include <queue>
+#include <span>
+#include <type_traits>
+
+#include <fmt/format.h>
+
+#include <xxhash.h>
+
+#include <dwarfs/error.h>
+
+#include <dwarfs/writer/internal/fingerprint_index.h>
+
+namespace dwarfs::writer::internal {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kMaxRuns{8};
+constexpr size_t kBloomBitsPerEntry{10};
+constexpr size_t kBloomProbes{4};
+
+} // namespace
+
+/**
+ * A sorted run of index entries stored in a file
+ *
+ * Entries are written in fingerprint order and grouped into pages of
+ * `kEntriesPerPage` entries. The run file is only meant to be read back
+ * by the same process, so entries are stored in their in-memory layout.
+ */
+class fingerprint_index::run {
+ public:
+  static constexpr size_t kEntriesPerPage{128};
+
+  static_assert(std::is_trivially_copyable_v<entry>);
+  static_assert(sizeof(entry) == 32);
+
+  run(fs::path path, size_t num_entries)
+      : path_{std::move(path)}
+      , bloom_(std::bit_ceil(std::max<size_t>(
+                   64, num_entries * kBloomBitsPerEntry)) /
+               64)
+      , bloom_mask_{bloom_.size() * 64 - 1}
+      , out_{path_, std::ios::binary | std::ios::trunc} {
+    if (!out_) {
+      DWARFS_THROW(runtime_error,
+                   fmt::format("failed to create fingerprint index run: {}",
+                               path_.string()));
+    }
+    page_first_.reserve((num_entries + kEntriesPerPage - 1) / kEntriesPerPage);
+  }
+
+  ~run() {
+    in_.close();
+    std::error_code ec;
+    fs::remove(path_, ec);
+  }
+
+  run(run const&) = delete;
+  run& operator=(run const&) = delete;
+
+  // Entries must be added in fingerprint order
+  void add(entry const& e) {
+    if (size_ % kEntriesPerPage == 0) {
+      page_first_.push_back(e.fp);
+    }
+
+    for (size_t i = 0; i < kBloomProbes; ++i) {
+      auto const bit = bloom_bit(e.fp, i);
+      bloom_[bit / 64] |= static_cast<uint64_t>(1) << (bit % 64);
+    }
+
+    out_.write(reinterpret_cast<char const*>(&e), sizeof(e));
+    ++size_;
+  }
+
+  void finish() {
+    out_.close();
+
+    if (!out_) {
+      DWARFS_THROW(runtime_error,
+                   fmt::format("failed to write fingerprint index run: {}",
+                               path_.string()));
+    }
+
+    in_.open(path_, std::ios::binary);
+
+    if (!in_) {
+      DWARFS_THROW(runtime_error,
+                   fmt::format("failed to open fingerprint index run: {}",
+                               path_.string()));
+    }
+  }
+
+  size_t size() const { return size_; }
+
+  fs::path const& path() const { return path_; }
+
+  size_t memory_usage() const {
+    return sizeof(*this) + bloom_.size() * sizeof(bloom_[0]) +
+           page_first_.capacity() * sizeof(page_first_[0]);
+  }
+
+  bool may_contain(fingerprint const& fp) const {
+    for (size_t i = 0; i < kBloomProbes; ++i) {
+      auto const bit = bloom_bit(fp, i);
+      if ((bloom_[bit / 64] & (static_cast<uint64_t>(1) << (bit % 64))) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::optional<location> find(fingerprint const& fp, stats& st) {
+    if (!may_contain(fp)) {
+      return std::nullopt;
+    }
+
+    auto it = std::upper_bound(page_first_.begin(), page_first_.end(), fp);
+
+    if (it != page_first_.begin()) {
+      auto const page = static_cast<size_t>(std::distance(
+                            page_first_.begin(), it)) -
+                        1;
+      auto const first = page * kEntriesPerPage;
+      auto const count = std::min(kEntriesPerPage, size_ - first);
+
+      read_entries(first, count);
+      ++st.page_reads;
+
+      auto const end = page_.begin() + count;
+      auto eit = std::lower_bound(
+          page_.begin(), end, fp,
+          [](entry const& e, fingerprint const& key) { return e.fp < key; });
+
+      if (eit != end && eit->fp == fp) {
+        return eit->loc;
+      }
+    }
+
+    ++st.bloom_false_positives;
+
+    return std::nullopt;
+  }
+
+  // Reads `count` entries starting at entry `first` into the page buffer
+  std::span<entry const> read_entries(size_t first, size_t count) {
+    in_.clear();
+    in_.seekg(static_cast<std::streamoff>(first * sizeof(entry)));
+    in_.read(reinterpret_cast<char*>(page_.data()),
+             static_cast<std::streamsize>(count * sizeof(entry)));
+
+    if (!in_) {
+      DWARFS_THROW(runtime_error,
+                   fmt::format("failed to read fingerprint index run: {}",
+                               path_.string()));
+    }
+
+    return {page_.data(), count};
+  }
+
+ private:
+  size_t bloom_bit(fingerprint const& fp, size_t i) const {
+    // The fingerprint is already a good hash, so double hashing is fine
+    return static_cast<size_t>(fp.lo + i * (fp.hi | 1)) & bloom_mask_;
+  }
+
+  fs::path const path_;
+  std::vector<uint64_t> bloom_;
+  size_t const bloom_mask_;
+  std::vector<fingerprint> page_first_;
+  std::array<entry, kEntriesPerPage> page_;
+  std::ofstream out_;
+  std::ifstream in_;
+  size_t size_{0};
+};
+
+fingerprint_index::fingerprint_index(size_t memory_limit,
+                                     fs::path spill_dir)
+    : memory_limit_{memory_limit}
+    , spill_dir_{std::move(spill_dir)}
+    , max_memory_entries_{std::max<size_t>(1, memory_limit / kMemoryPerEntry)} {
+}
+
+fingerprint_index::~fingerprint_index() = default;
+
+auto fingerprint_index::compute(void const* data, size_t size) -> fingerprint {
+  auto const h = XXH3_128bits(data, size);
+  return {h.low64, h.high64};
+}
+
+auto fingerprint_index::find(fingerprint const& fp)
+    -> std::optional<location> {
+  if (auto it = memory_.find(fp); it != memory_.end()) {
+    return it->second;
+  }
+
+  for (auto& r : runs_) {
+    if (auto loc = r->find(fp, stats_)) {
+      return loc;
+    }
+  }
+
+  return std::nullopt;
+}
+
+void fingerprint_index::insert(fingerprint const& fp, location const& loc) {
+  memory_.emplace(fp, loc);
+  ++stats_.entries;
+
+  if (memory_.size() >= max_memory_entries_) {
+    spill();
+  }
+}
+
+size_t fingerprint_index::memory_usage() const {
+  return memory_.capacity() * (sizeof(decltype(memory_)::slot_type) + 1) +
+         run_memory_;
+}
+
+void fingerprint_index::update_memory_budget() {
+  run_memory_ = 0;
+  for (auto const& r : runs_) {
+    run_memory_ += r->memory_usage();
+  }
+
+  auto const available =
+      memory_limit_ > run_memory_ ? memory_limit_ - run_memory_ : 0;
+  auto const reserved = memory_limit_ / kMinMemoryFraction;
+
+  max_memory_entries_ = std::max<size_t>(
+      1, std::max(available, reserved) / kMemoryPerEntry);
+}
+
+fs::path fingerprint_index::next_run_path() {
+  if (!tmpdir_) {
+    if (spill_dir_.empty()) {
+      tmpdir_.emplace("dwarfs-fingerprints");
+    } else {
+      tmpdir_.emplace("dwarfs-fingerprints", spill_dir_);
+    }
+  }
+  return tmpdir_->path() / fmt::format("run{:06}", next_run_id_++);
+}
+
+void fingerprint_index::spill() {
+  std::vector<entry> entries;
+  entries.reserve(memory_.size());
+
+  for (auto const& [fp, loc] : memory_) {
+    entries.push_back({fp, loc});
+  }
+
+  // Release the memory before writing the run
+  decltype(memory_)().swap(memory_);
+
+  std::ranges::sort(entries, {}, &entry::fp);
+
+  auto r = std::make_unique<run>(next_run_path(), entries.size());
+  for (auto const& e : entries) {
+    r->add(e);
+  }
+  r->finish();
+
+  runs_.push_back(std::move(r));
+  stats_.spilled_entries += entries.size();
+  ++stats_.spills;
+
+  if (runs_.size() > kMaxRuns) {
+    merge_runs();
+  }
+
+  update_memory_budget();
+}
+
+void fingerprint_index::merge_runs() {
+  static constexpr size_t kBatchSize{run::kEntriesPerPage};
+
+  struct source {
+    run* r;
+    size_t next{0};
+    std::vector<entry> buffer;
+    size_t pos{0};
+
+    bool fill() {
+      if (pos < buffer.size()) {
+        return true;
+      }
+      auto const count = std::min(kBatchSize, r->size() - next);
+      if (count == 0) {
+        return false;
+      }
+      auto const entries = r->read_entries(next, count);
+      buffer.assign(entries.begin(), entries.end());
+      next += count;
+      pos = 0;
+      return true;
+    }
+
+    entry const& front() const { return buffer[pos]; }
+  };
+
+  size_t total = 0;
+  std::vector<source> sources;
+  sources.reserve(runs_.size());
+
+  for (auto& r : runs_) {
+    total += r->size();
+    sources.push_back({r.get()});
+  }
+
+  auto cmp = [&](size_t a, size_t b) {
+    return sources[b].front().fp < sources[a].front().fp;
+  };
+  std::priority_queue<size_t, std::vector<size_t>, decltype(cmp)> queue(cmp);
+
+  for (size_t i = 0; i < sources.size(); ++i) {
+    if (sources[i].fill()) {
+      queue.push(i);
+    }
+  }
+
+  auto merged = std::make_unique<run>(next_run_path(), total);
+
+  while (!queue.empty()) {
+    auto const i = queue.top();
+    queue.pop();
+    auto& src = sources[i];
+    merged->add(src.front());
+    ++src.pos;
+    if (src.fill()) {
+      queue.push(i);
+    }
+  }
+
+  merged->finish();
+
+  runs_.clear();
+  runs_.push_back(std::move(merged));
+  ++stats_.merges;
+}
+
+} // namespace dwarfs::writer::internal
@@ -690,11 +690,22 @@ void metadata_builder_<LoggerPolicy>::update_totals_and_size_cache() {
     md_.reg_file_size_cache().ensure();
     auto& cache = md_.reg_file_size_cache().value();
     cache.min_chunk_count() = options_.inode_size_cache_min_chunk_count;
+    cache.size_table().reset();
+    cache.allocated_size_table().reset();
 
     auto const& shared = md_.shared_files_table();
     auto const num_unique_files = (dev_offset - reg_offset) - shared->size();
     inode_size_provider isp(md_);
 
+    std::vector<uint64_t> size_table;
+    std::vector<uint64_t> allocated_size_table;
+    bool has_sparse_files{false};
+
+    if (options_.complete_inode_size_cache) {
+      size_table.resize(md_.chunk_table()->size() - 1);
+      allocated_size_table.resize(size_table.size());
+    }
+
     for (auto inode_num = reg_offset; inode_num < dev_offset;) {
       auto const reg_inode_num = inode_num - reg_offset;
       auto const nlink =
@@ -711,7 +722,12 @@ void metadata_builder_<LoggerPolicy>::update_totals_and_size_cache() {
                                          : reg_inode_num;
       auto const info = isp.get(chunk_table_index);
 
-      if (info.num_chunks >= options_.inode_size_cache_min_chunk_count) {
+      if (options_.complete_inode_size_cache) {
+        size_table[chunk_table_index] = info.size;
+        allocated_size_table[chunk_table_index] = info.allocated_size;
+        has_sparse_files = has_sparse_files || info.allocated_size != info.size;
+      } else if (info.num_chunks >=
+                 options_.inode_size_cache_min_chunk_count) {
         LOG_DEBUG << "caching size " << info.size << " for chunk table index "
                   << chunk_table_index << " with " << info.num_chunks
                   << " chunks";
@@ -744,6 +760,17 @@ void metadata_builder_<LoggerPolicy>::update_totals_and_size_cache() {
       total_allocated_fs_size += shared_count * info.allocated_size;
       total_hardlink_size += shared_count * info.size * (nlink - 1);
     }
+
+    if (options_.complete_inode_size_cache) {
+      LOG_DEBUG << "adding complete size cache for " << size_table.size()
+                << " inodes";
+
+      cache.size_table() = std::move(size_table);
+
+      if (has_sparse_files) {
+        cache.allocated_size_table() = std::move(allocated_size_table);
+      }
+    }
   }
 
   if (auto const orig = md_.total_fs_size().value();
@@ -83,6 +83,9 @@ std::ostream& operator<<(std::ostream& os, metadata_options const& opts) {
   if (opts.no_create_timestamp) {
     os << "no_create_timestamp, ";
   }
+  if (opts.complete_inode_size_cache) {
+    os << "complete_inode_size_cache, ";
+  }
   os << "inode_size_cache_min_chunk_count: "
      << opts.inode_size_cache_min_chunk_count;
   os << "}";
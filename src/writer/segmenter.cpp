@@ -22,12 +22,20 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <bit>
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
 #include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -43,6 +51,7 @@
 #include <dwarfs/error.h>
 #include <dwarfs/logger.h>
 #include <dwarfs/malloc_byte_buffer.h>
+#include <dwarfs/scope_exit.h>
 #include <dwarfs/small_vector.h>
 #include <dwarfs/util.h>
 #include <dwarfs/writer/segmenter.h>
@@ -52,10 +61,12 @@
 #include <dwarfs/internal/malloc_buffer.h>
 #include <dwarfs/internal/value_stream_quantile_estimator.h>
 #include <dwarfs/writer/internal/block_manager.h>
+#include <dwarfs/writer/internal/cdc_segmenter.h>
 #include <dwarfs/writer/internal/chunkable.h>
 #include <dwarfs/writer/internal/cyclic_hash.h>
 #include <dwarfs/writer/internal/entry.h>
 #include <dwarfs/writer/internal/progress.h>
+#include <dwarfs/writer/internal/segmenter_progress.h>
 
 namespace dwarfs::writer {
 
@@ -98,6 +109,17 @@ struct segmenter_stats {
   uint64_t bloom_lookups{0};
   uint64_t bloom_hits{0};
   uint64_t bloom_true_positives{0};
+  uint64_t group_bloom_lookups{0};
+  uint64_t group_bloom_hits{0};
+  uint64_t block_bloom_lookups{0};
+  uint64_t block_bloom_hits{0};
+  uint64_t block_bloom_true_positives{0};
+  uint64_t bloom_rebuilds{0};
+  uint64_t speculative_batches{0};
+  uint64_t speculative_hashes{0};
+  uint64_t byte_runs{0};
+  uint64_t byte_run_holes{0};
+  uint64_t byte_run_bytes{0};
   value_stream_quantile_estimator l2_collision_vec_size{0.5, 0.75, 0.9, 0.95,
                                                         0.99};
 };
@@ -246,22 +268,9 @@ class alignas(64) bloom_filter {
     std::fill(begin(), end(), 0);
   }
 
-  void merge(bloom_filter const& other) {
-    assert(bits_);
-    if (size() != other.size()) {
-      throw std::runtime_error("size mismatch");
-    }
-    // NOLINTNEXTLINE(modernize-use-ranges)
-    std::transform(cbegin(), cend(), other.cbegin(), begin(), std::bit_or<>{});
-  }
-
   uint64_t memory_usage() const { return size_ / 8; }
 
  private:
-  DWARFS_FORCE_INLINE bits_type const* cbegin() const { return bits_; }
-  DWARFS_FORCE_INLINE bits_type const* cend() const {
-    return bits_ + (size_ >> index_shift);
-  }
   DWARFS_FORCE_INLINE bits_type* begin() { return bits_; }
   DWARFS_FORCE_INLINE bits_type* end() {
     return bits_ + (size_ >> index_shift);
@@ -272,6 +281,24 @@ class alignas(64) bloom_filter {
   size_t const size_{0};
 };
 
+/**
+ * The low 16 bits of the cyclic hash are just the sum of all bytes in the
+ * window and thus far from uniformly distributed. Also, group and block
+ * filters are only tested after another filter in the hierarchy has
+ * matched, so if they used the same bits of the hash, a match in one
+ * filter would make a match in the next one very likely. Remixing the
+ * hash with a different multiplier per tier fixes both issues.
+ */
+enum class bloom_filter_tier : uint64_t {
+  global = UINT64_C(0xff51afd7ed558ccd),
+  group = UINT64_C(0x9e3779b97f4a7c15),
+  block = UINT64_C(0xc2b2ae3d27d4eb4f),
+};
+
+DWARFS_FORCE_INLINE size_t remix_hash(uint32_t hash, bloom_filter_tier tier) {
+  return (static_cast<uint64_t>(hash) * static_cast<uint64_t>(tier)) >> 32;
+}
+
 /**
  * Granularity
  *
@@ -378,6 +405,10 @@ class ConstantGranularityPolicy : private GranularityPolicyBase {
   }
 
   static DWARFS_FORCE_INLINE bool compile_time_granularity() { return true; }
+
+  static DWARFS_FORCE_INLINE constexpr bool has_byte_frames() {
+    return kGranularity == 1;
+  }
 };
 
 class VariableGranularityPolicy : private GranularityPolicyBase {
@@ -447,6 +478,8 @@ class VariableGranularityPolicy : private GranularityPolicyBase {
 
   static DWARFS_FORCE_INLINE bool compile_time_granularity() { return false; }
 
+  static DWARFS_FORCE_INLINE constexpr bool has_byte_frames() { return false; }
+
  private:
   uint_fast32_t const granularity_;
 };
@@ -697,6 +730,60 @@ class segment_queue {
   std::unique_ptr<queue_data> data_;
 };
 
+/**
+ * Find the first run of at least `min_size` identical bytes starting at
+ * or after `offset`.
+ *
+ * Any such run must cover one of a set of probe positions that are
+ * `min_size` bytes apart, so outside of runs we only ever look at a
+ * single byte per `min_size` bytes. Runs are extended a word at a time.
+ */
+std::optional<std::pair<size_t, size_t>>
+find_identical_byte_run(std::span<uint8_t const> data, size_t offset,
+                        size_t min_size) {
+  static constexpr size_t kWordSize{sizeof(uint64_t)};
+
+  assert(min_size > 0);
+
+  auto load_word = [&](size_t pos) {
+    uint64_t word;
+    std::memcpy(&word, data.data() + pos, kWordSize);
+    return word;
+  };
+
+  auto probe = offset;
+
+  while (probe < data.size()) {
+    auto const byte = data[probe];
+    auto const pattern = UINT64_C(0x0101010101010101) * byte;
+
+    auto begin = probe;
+    while (begin - offset >= kWordSize &&
+           load_word(begin - kWordSize) == pattern) {
+      begin -= kWordSize;
+    }
+    while (begin > offset && data[begin - 1] == byte) {
+      --begin;
+    }
+
+    auto end = probe + 1;
+    while (data.size() - end >= kWordSize && load_word(end) == pattern) {
+      end += kWordSize;
+    }
+    while (end < data.size() && data[end] == byte) {
+      ++end;
+    }
+
+    if (end - begin >= min_size) {
+      return std::pair{begin, end};
+    }
+
+    probe = std::max(probe + min_size, end);
+  }
+
+  return std::nullopt;
+}
+
 template <typename GranularityPolicy, bool UseSegmentQueue>
 class granular_extent_adapter;
 
@@ -723,6 +810,32 @@ class granular_extent_adapter<GranularityPolicy, false>
     return raw_bytes_.size();
   }
 
+  DWARFS_FORCE_INLINE value_type byte_at(file_off_t offset) const {
+    return raw_bytes_[this->frames_to_bytes(offset)];
+  }
+
+  // Returns the frame range of the first run of identical bytes of at least
+  // `min_size` frames starting at or after frame `offset`.
+  std::optional<std::pair<file_off_t, file_off_t>>
+  find_byte_run(file_off_t offset, file_size_t min_size) const {
+    auto const granularity = this->granularity_bytes();
+    size_t pos = this->frames_to_bytes(offset);
+
+    while (auto run = find_identical_byte_run(
+               raw_bytes_, pos, this->frames_to_bytes(min_size))) {
+      file_off_t const begin = (run->first + granularity - 1) / granularity;
+      file_off_t const end = run->second / granularity;
+
+      if (end > begin && std::cmp_greater_equal(end - begin, min_size)) {
+        return std::pair{begin, end};
+      }
+
+      pos = run->second;
+    }
+
+    return std::nullopt;
+  }
+
   template <typename H>
   DWARFS_FORCE_INLINE void update_hash(H& hasher, file_off_t offset) const {
     offset = this->frames_to_bytes(offset);
@@ -738,6 +851,22 @@ class granular_extent_adapter<GranularityPolicy, false>
         [&] { hasher.update(raw_bytes_[from++], raw_bytes_[to++]); });
   }
 
+  // Rolls frames `offset` to `offset + count - 1` into the (full) window
+  // and stores the hash value after each step in `hashes`.
+  DWARFS_FORCE_INLINE void
+  roll_hash(rsync_hash& hasher, file_off_t offset, size_t window_size,
+            size_t count, uint32_t* hashes) const {
+    if constexpr (GranularityPolicy::has_byte_frames()) {
+      assert(std::cmp_less_equal(offset + count, raw_bytes_.size()));
+      hasher.roll(raw_bytes_.data() + offset, count, hashes);
+    } else {
+      for (size_t i = 0; i < count; ++i, ++offset) {
+        update_hash(hasher, offset - window_size, offset);
+        hashes[i] = hasher();
+      }
+    }
+  }
+
   DWARFS_FORCE_INLINE void
   append_to(auto& v, file_off_t offset, file_size_t size) const {
     v.append(raw_bytes_.data() + offset, size);
@@ -1011,6 +1140,384 @@ class hash_window<true> {
   segment_queue::byte_range_iterable::iterator to_it_;
 };
 
+template <bool UseSegmentQueue>
+class serial_hash_cursor {
+ public:
+  explicit serial_hash_cursor(size_t window_size) noexcept
+      : hashwin_{window_size} {}
+
+  template <typename ExtentAdapter>
+  DWARFS_FORCE_INLINE file_off_t
+  seek(ExtentAdapter const& data, file_off_t offset) {
+    hasher_.clear();
+    return hashwin_.seek(hasher_, data, offset);
+  }
+
+  template <typename ExtentAdapter>
+  DWARFS_FORCE_INLINE file_off_t
+  slide(ExtentAdapter const& data, file_off_t offset) {
+    return hashwin_.slide(hasher_, data, offset);
+  }
+
+  DWARFS_FORCE_INLINE uint32_t operator()() const { return hasher_(); }
+
+  DWARFS_FORCE_INLINE bool test(bloom_filter const& filter) const {
+    return filter.test(remix_hash(hasher_(), bloom_filter_tier::global));
+  }
+
+ private:
+  rsync_hash hasher_;
+  hash_window<UseSegmentQueue> hashwin_;
+};
+
+/**
+ * Rolling hashes for a range of positions, computed in batches
+ *
+ * Computing the hashes for many consecutive positions at once allows
+ * `rsync_hash::roll()` to use a vectorized kernel. The batch is simply
+ * extended when sliding past its end; seeking to a position outside of
+ * the batch (i.e. after a match) restarts the batch at that position.
+ */
+template <typename ExtentAdapter>
+class batched_hash_cursor {
+ public:
+  static constexpr size_t kBatchSize{static_cast<size_t>(1) << 14};
+
+  batched_hash_cursor(std::vector<uint32_t>& hashes, size_t window_size,
+                      file_size_t size)
+      : hashes_{hashes}
+      , window_size_{window_size}
+      , size_{static_cast<file_off_t>(size)} {
+    hashes_.resize(kBatchSize);
+  }
+
+  DWARFS_FORCE_INLINE file_off_t
+  seek(ExtentAdapter const& data, file_off_t offset) {
+    pos_ = offset + window_size_;
+
+    if (pos_ < begin_ || pos_ >= end_) {
+      hasher_.clear();
+      hash_window<false> hashwin(window_size_);
+      hashwin.seek(hasher_, data, offset);
+      begin_ = pos_;
+      end_ = pos_ + 1;
+      hashes_[0] = hasher_();
+      extend(data);
+    }
+
+    return pos_;
+  }
+
+  DWARFS_FORCE_INLINE file_off_t
+  slide(ExtentAdapter const& data, file_off_t offset) {
+    pos_ = offset + 1;
+
+    if (pos_ >= end_) [[unlikely]] {
+      // the last hash of the batch becomes the first of the next batch
+      hashes_[0] = hashes_[end_ - begin_ - 1];
+      begin_ = end_ - 1;
+      extend(data);
+    }
+
+    return pos_;
+  }
+
+  DWARFS_FORCE_INLINE uint32_t operator()() const {
+    return hashes_[pos_ - begin_];
+  }
+
+  DWARFS_FORCE_INLINE bool test(bloom_filter const& filter) const {
+    return filter.test(remix_hash((*this)(), bloom_filter_tier::global));
+  }
+
+ private:
+  // Computes the hashes for positions `end_` up to the end of the batch;
+  // the hash for position `end_ - 1` is the current state of `hasher_`.
+  DWARFS_FORCE_INLINE void extend(ExtentAdapter const& data) {
+    auto const last = std::min<file_off_t>(
+        size_ + 1, begin_ + static_cast<file_off_t>(kBatchSize));
+    if (last > end_) {
+      data.roll_hash(hasher_, end_ - 1, window_size_,
+                     static_cast<size_t>(last - end_), &hashes_[end_ - begin_]);
+      end_ = last;
+    }
+  }
+
+  std::vector<uint32_t>& hashes_;
+  rsync_hash hasher_;
+  size_t const window_size_;
+  file_off_t const size_;
+  file_off_t begin_{0};
+  file_off_t end_{0};
+  file_off_t pos_{0};
+};
+
+/**
+ * Speculatively computed rolling hashes for a range of positions
+ *
+ * The value of the rolling hash only depends on the contents of the
+ * window, so hashes for a range of positions can be computed on multiple
+ * threads, each seeking to the start of its own sub-range. The segmenter
+ * is stalled while the workers are running, which makes the global bloom
+ * filter read-only and allows the workers to test each hash against this
+ * snapshot of the filter.
+ *
+ * Between two snapshots, the global filter can only ever gain bits from
+ * hashes added to the active blocks (rebuilding the filter after blocks
+ * have been evicted only yields a subset of these bits). These
+ * hashes are also recorded in a small delta filter, so the result of
+ * testing the live global filter can be reproduced exactly from the
+ * snapshot result and the delta filter. Only positions that pass this
+ * test need to touch the large global filter, and the segmenter output
+ * does not depend on the number of workers.
+ *
+ * The helper threads are started on first use and then wait for the
+ * next batch for the lifetime of the segmenter.
+ */
+class speculative_hash_batch {
+ public:
+  static constexpr size_t kFramesPerWorker{static_cast<size_t>(1) << 19};
+  static constexpr size_t kMinFramesPerWorker{static_cast<size_t>(1) << 16};
+
+  explicit speculative_hash_batch(size_t num_workers) noexcept
+      : num_workers_{std::max<size_t>(1, num_workers)} {}
+
+  ~speculative_hash_batch() {
+    {
+      std::lock_guard lock(mx_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+  }
+
+  speculative_hash_batch(speculative_hash_batch const&) = delete;
+  speculative_hash_batch& operator=(speculative_hash_batch const&) = delete;
+
+  size_t capacity() const { return num_workers_ * kFramesPerWorker; }
+
+  void reset() {
+    begin_ = 0;
+    end_ = 0;
+  }
+
+  DWARFS_FORCE_INLINE bool contains(file_off_t pos) const {
+    return pos >= begin_ && pos < end_;
+  }
+
+  DWARFS_FORCE_INLINE uint32_t hash(file_off_t pos) const {
+    return hashes_[pos - begin_];
+  }
+
+  DWARFS_FORCE_INLINE bool snapshot_hit(file_off_t pos) const {
+    return hits_[pos - begin_] != 0;
+  }
+
+  template <typename ExtentAdapter>
+  void fill(ExtentAdapter const& data, bloom_filter const& filter,
+            size_t window_size, file_off_t begin, file_off_t end) {
+    static_assert(!ExtentAdapter::kUseSegmentQueue);
+
+    assert(std::cmp_greater_equal(begin, window_size));
+    assert(begin < end);
+
+    auto const count = static_cast<size_t>(end - begin);
+    auto const parts =
+        std::clamp<size_t>(count / kMinFramesPerWorker, 1, num_workers_);
+    auto const part_size = (count + parts - 1) / parts;
+
+    begin_ = begin;
+    end_ = end;
+    hashes_.resize(count);
+    hits_.resize(count);
+
+    auto hash_part = [&](size_t part) {
+      auto const first = begin + static_cast<file_off_t>(part * part_size);
+      auto const last =
+          std::min<file_off_t>(end, first + static_cast<file_off_t>(part_size));
+      rsync_hash hasher;
+      hash_window<false> hashwin(window_size);
+      auto const pos = hashwin.seek(hasher, data, first - window_size);
+      auto const ix = pos - begin;
+      auto const num = static_cast<size_t>(last - pos);
+
+      hashes_[ix] = hasher();
+      data.roll_hash(hasher, pos, window_size, num - 1, &hashes_[ix + 1]);
+
+      for (size_t i = ix; i < ix + num; ++i) {
+        hits_[i] =
+            filter.test(remix_hash(hashes_[i], bloom_filter_tier::global)) ? 1
+                                                                           : 0;
+      }
+    };
+
+    run_parts(parts, hash_part);
+  }
+
+ private:
+  using part_job = std::function<void(size_t part)>;
+
+  // Runs `job` for parts [0, parts), part 0 on the calling thread. The
+  // first exception thrown by any part is rethrown once all parts are done.
+  void run_parts(size_t parts, part_job const& job) {
+    if (parts == 1) {
+      job(0);
+      return;
+    }
+
+    if (helpers_.empty()) {
+      helpers_.reserve(num_workers_ - 1);
+      for (size_t i = 1; i < num_workers_; ++i) {
+        helpers_.emplace_back([this, i] { helper_loop(i); });
+      }
+    }
+
+    {
+      std::lock_guard lock(mx_);
+      job_ = &job;
+      job_parts_ = parts;
+      pending_ = parts - 1;
+      error_ = nullptr;
+      ++generation_;
+    }
+
+    cv_.notify_all();
+
+    {
+      // the helpers reference `job` and everything it captures
+      scope_exit wait_for_helpers{[this] {
+        std::unique_lock lock(mx_);
+        done_cv_.wait(lock, [this] { return pending_ == 0; });
+        job_ = nullptr;
+      }};
+
+      job(0);
+    }
+
+    if (error_) {
+      std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+  }
+
+  void helper_loop(size_t part) {
+    uint64_t seen{0};
+
+    for (;;) {
+      part_job const* job{nullptr};
+
+      {
+        std::unique_lock lock(mx_);
+        cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+
+        if (stop_) {
+          return;
+        }
+
+        seen = generation_;
+
+        if (part < job_parts_) {
+          job = job_;
+        }
+      }
+
+      if (job) {
+        std::exception_ptr error;
+
+        try {
+          (*job)(part);
+        } catch (...) {
+          error = std::current_exception();
+        }
+
+        std::lock_guard lock(mx_);
+        if (error && !error_) {
+          error_ = std::move(error);
+        }
+        if (--pending_ == 0) {
+          done_cv_.notify_one();
+        }
+      }
+    }
+  }
+
+  size_t const num_workers_;
+  file_off_t begin_{0};
+  file_off_t end_{0};
+  std::vector<uint32_t> hashes_;
+  std::vector<uint8_t> hits_;
+  std::mutex mx_;
+  std::condition_variable cv_;
+  std::condition_variable done_cv_;
+  part_job const* job_{nullptr};
+  size_t job_parts_{0};
+  size_t pending_{0};
+  std::exception_ptr error_;
+  uint64_t generation_{0};
+  bool stop_{false};
+  // must be last so the helpers are joined before anything else is gone
+  std::vector<std::jthread> helpers_;
+};
+
+template <typename ExtentAdapter>
+class speculative_hash_cursor {
+ public:
+  speculative_hash_cursor(speculative_hash_batch& batch,
+                          bloom_filter& delta_filter,
+                          bloom_filter const& global_filter,
+                          segmenter_stats& stats, size_t window_size,
+                          file_size_t size)
+      : batch_{batch}
+      , delta_filter_{delta_filter}
+      , global_filter_{global_filter}
+      , stats_{stats}
+      , window_size_{window_size}
+      , size_{static_cast<file_off_t>(size)} {
+    batch_.reset();
+  }
+
+  DWARFS_FORCE_INLINE file_off_t
+  seek(ExtentAdapter const& data, file_off_t offset) {
+    pos_ = offset + window_size_;
+    refill(data);
+    return pos_;
+  }
+
+  DWARFS_FORCE_INLINE file_off_t
+  slide(ExtentAdapter const& data, file_off_t offset) {
+    pos_ = offset + 1;
+    refill(data);
+    return pos_;
+  }
+
+  DWARFS_FORCE_INLINE uint32_t operator()() const { return batch_.hash(pos_); }
+
+  DWARFS_FORCE_INLINE bool test(bloom_filter const& filter) const {
+    auto const hashval =
+        remix_hash(batch_.hash(pos_), bloom_filter_tier::global);
+    return (batch_.snapshot_hit(pos_) || delta_filter_.test(hashval)) &&
+           filter.test(hashval);
+  }
+
+ private:
+  DWARFS_FORCE_INLINE void refill(ExtentAdapter const& data) {
+    if (!batch_.contains(pos_) && pos_ < size_) [[unlikely]] {
+      auto const end = std::min<file_off_t>(
+          size_, pos_ + static_cast<file_off_t>(batch_.capacity()));
+      delta_filter_.clear();
+      batch_.fill(data, global_filter_, window_size_, pos_, end);
+      ++stats_.speculative_batches;
+      stats_.speculative_hashes += end - pos_;
+    }
+  }
+
+  speculative_hash_batch& batch_;
+  bloom_filter& delta_filter_;
+  bloom_filter const& global_filter_;
+  segmenter_stats& stats_;
+  size_t const window_size_;
+  file_off_t const size_;
+  file_off_t pos_{0};
+};
+
 template <typename GranularityPolicy, bool SegmentationEnabled, bool MultiBlock>
 class BasicSegmentationPolicy : public GranularityPolicy {
  public:
@@ -1089,6 +1596,20 @@ class basic_granular_container_adapter : private GranularityPolicy {
     this->for_bytes_in_frame([&] { hasher.update(*pfrom++, *pto++); });
   }
 
+  DWARFS_FORCE_INLINE void
+  roll_hash(rsync_hash& hasher, file_off_t offset, size_t window_size,
+            size_t count, uint32_t* hashes) const {
+    if constexpr (GranularityPolicy::has_byte_frames()) {
+      assert(offset + count <= v_.size());
+      hasher.roll(v_.data() + offset, count, hashes);
+    } else {
+      for (size_t i = 0; i < count; ++i, ++offset) {
+        update_hash(hasher, offset - window_size, offset);
+        hashes[i] = hasher();
+      }
+    }
+  }
+
  private:
   T& v_;
 };
@@ -1151,10 +1672,10 @@ class active_block : private GranularityPolicy {
 
   DWARFS_FORCE_INLINE mutable_byte_buffer data() const { return data_; }
 
-  template <bool UseSegmentQueue>
+  template <bool UseSegmentQueue, typename F>
   DWARFS_FORCE_INLINE void append_bytes(
       granular_extent_adapter<GranularityPolicy, UseSegmentQueue>& data,
-      file_off_t offset, file_size_t size, bloom_filter& global_filter);
+      file_off_t offset, file_size_t size, F&& add_hash);
 
   DWARFS_FORCE_INLINE size_t next_hash_distance_in_frames() const {
     return window_step_mask_ + 1 - (size_in_frames() & window_step_mask_);
@@ -1165,10 +1686,10 @@ class active_block : private GranularityPolicy {
     offsets_.for_each_value(key, std::forward<F>(func));
   }
 
-  template <typename F>
-  DWARFS_FORCE_INLINE void for_each_offset_filter(hash_t key, F&& func) const {
-    if (filter_.test(key)) [[unlikely]] {
-      offsets_.for_each_value(key, std::forward<F>(func));
+  void add_global_hashes_to(bloom_filter& filter) const {
+    // every key with collisions is also a key in values()
+    for (auto const& [key, _] : offsets_.values()) {
+      filter.add(remix_hash(key, bloom_filter_tier::global));
     }
   }
 
@@ -1200,37 +1721,6 @@ class active_block : private GranularityPolicy {
   mutable_byte_buffer data_;
 };
 
-class segmenter_progress : public progress::context {
- public:
-  using status = progress::context::status;
-
-  segmenter_progress(std::string context, uint64_t total_size)
-      : context_{std::move(context)}
-      , bytes_total_{total_size} {}
-
-  status get_status() const override {
-    auto f = current_file.load();
-    status st;
-    st.color = termcolor::GREEN;
-    st.context = context_;
-    if (f) {
-      st.path.emplace(f->path_as_string());
-    }
-    st.bytes_processed.emplace(bytes_processed.load());
-    st.bytes_total.emplace(bytes_total_);
-    return st;
-  }
-
-  // NOLINTBEGIN(cppcoreguidelines-non-private-member-variables-in-classes)
-  std::atomic<file const*> current_file{nullptr};
-  std::atomic<uint64_t> bytes_processed{0};
-  // NOLINTEND(cppcoreguidelines-non-private-member-variables-in-classes)
-
- private:
-  std::string const context_;
-  uint64_t const bytes_total_;
-};
-
 DWARFS_FORCE_INLINE size_t window_size(segmenter::config const& cfg) {
   return cfg.blockhash_window_size > 0
              ? static_cast<size_t>(1) << cfg.blockhash_window_size
@@ -1241,6 +1731,38 @@ DWARFS_FORCE_INLINE size_t window_step(segmenter::config const& cfg) {
   return std::max<size_t>(1, window_size(cfg) >> cfg.window_increment_shift);
 }
 
+/**
+ * Bloom filter hierarchy
+ *
+ * In multi-block mode, each active block has its own bloom filter and
+ * a global filter covers all active blocks. With a long lookback, every
+ * hit in the global filter would have to test the filters of all active
+ * blocks, so the blocks are additionally arranged in groups of roughly
+ * sqrt(N) consecutive blocks, each with its own filter. A lookup then
+ * only tests N/G group filters and G block filters.
+ *
+ * Evicting a block leaves stale bits in the global and group filters,
+ * which is harmless except for a slightly higher false positive rate.
+ * Once the last block of a group has been evicted, the group filter is
+ * dropped and the global filter is rebuilt from the hashes of all
+ * remaining blocks. Without groups, this happens on every eviction.
+ */
+DWARFS_FORCE_INLINE size_t
+bloom_filter_group_size(segmenter::config const& cfg) {
+  static constexpr size_t kMinBlocksForGroups{16};
+  if (cfg.max_active_blocks < kMinBlocksForGroups) {
+    return 1;
+  }
+  return static_cast<size_t>(1)
+         << ((std::bit_width(cfg.max_active_blocks) - 1) / 2);
+}
+
+DWARFS_FORCE_INLINE size_t
+bloom_filter_size_for(segmenter::config const& cfg, size_t hash_count) {
+  return (static_cast<size_t>(1) << cfg.bloom_filter_size) *
+         std::bit_ceil(std::max<size_t>(1, hash_count));
+}
+
 template <typename LoggerPolicy, typename SegmentingPolicy>
 class segmenter_ final : public segmenter::impl, private SegmentingPolicy {
  private:
@@ -1273,7 +1795,15 @@ class segmenter_ final : public segmenter::impl, private SegmentingPolicy {
       , window_size_{window_size(cfg)}
       , window_step_{window_step(cfg)}
       , block_size_in_frames_{block_size_in_frames(cfg)}
-      , global_filter_{bloom_filter_size(cfg)} {
+      , min_byte_run_size_in_frames_{
+            cfg.min_byte_run_size > 0
+                ? std::max<size_t>(1, cfg.min_byte_run_size /
+                                          granularity_bytes())
+                : 0}
+      , group_size_{is_multi_block_mode() ? bloom_filter_group_size(cfg) : 1}
+      , global_filter_{bloom_filter_size(cfg)}
+      , delta_filter_{delta_filter_size(cfg)}
+      , speculative_batch_{cfg.num_hash_workers} {
     if constexpr (is_segmentation_enabled()) {
       LOG_VERBOSE << cfg_.context << "using a "
                   << size_with_unit(frames_to_bytes(window_size_))
@@ -1283,9 +1813,28 @@ class segmenter_ final : public segmenter::impl, private SegmentingPolicy {
                   << (compile_time_granularity() ? "compile" : "run")
                   << "-time " << granularity_bytes()
                   << "-byte frames for segment analysis";
+      LOG_VERBOSE << cfg_.context << "using "
+                  << (GranularityPolicyT::has_byte_frames()
+                          ? rsync_hash::roll_implementation()
+                          : "scalar")
+                  << " rolling hash implementation";
       LOG_VERBOSE << cfg_.context << "bloom filter size: "
                   << size_with_unit(global_filter_.size() / 8);
 
+      if (group_size_ > 1) {
+        LOG_VERBOSE << cfg_.context << "using bloom filter groups of "
+                    << group_size_ << " blocks ("
+                    << size_with_unit(group_filter_size(cfg_) / 8)
+                    << " per group, "
+                    << size_with_unit(block_filter_size(cfg_) / 8)
+                    << " per block)";
+      }
+
+      if (delta_filter_.size() > 0) {
+        LOG_VERBOSE << cfg_.context << "using " << cfg_.num_hash_workers
+                    << " workers for speculative hashing";
+      }
+
       for (int i = 0; i < 256; ++i) {
         auto val =
             rsync_hash::repeating_window(i, frames_to_bytes(window_size_));
@@ -1304,6 +1853,21 @@ class segmenter_ final : public segmenter::impl, private SegmentingPolicy {
     file_size_t size_in_frames{0};
   };
 
+  struct byte_run_ref {
+    size_t block_num{0};
+    file_off_t offset_in_frames{0};
+    file_size_t size_in_frames{0};
+  };
+
+  struct bloom_filter_group {
+    bloom_filter_group(size_t first, size_t filter_size)
+        : first_block{first}
+        , filter{filter_size} {}
+
+    size_t const first_block;
+    bloom_filter filter;
+  };
+
   DWARFS_FORCE_INLINE void block_ready();
   void finish_chunk(chunkable& chkable);
   template <bool UseSegmentQueue>
@@ -1314,23 +1878,76 @@ class segmenter_ final : public segmenter::impl, private SegmentingPolicy {
   void add_data(chunkable& chkable, extent_adapter_t<UseSegmentQueue>& data,
                 file_off_t offset_in_frames, file_size_t size_in_frames);
   template <bool UseSegmentQueue>
+  void add_extent_range(chunkable& chkable,
+                        extent_adapter_t<UseSegmentQueue>& data,
+                        file_off_t begin_in_frames, file_off_t end_in_frames);
+  void add_byte_run(chunkable& chkable, extent_adapter_t<false>& data,
+                    file_off_t begin_in_frames, file_off_t end_in_frames);
+  template <bool UseSegmentQueue>
+  DWARFS_FORCE_INLINE void
+  segment_and_add_data(chunkable& chkable,
+                       extent_adapter_t<UseSegmentQueue>& data,
+                       file_off_t begin_in_frames, file_off_t end_in_frames);
+  template <bool UseSegmentQueue, typename HashCursor>
   DWARFS_FORCE_INLINE void
   segment_and_add_data(chunkable& chkable,
                        extent_adapter_t<UseSegmentQueue>& data,
-                       file_size_t size_in_frames);
+                       file_off_t begin_in_frames, file_off_t end_in_frames,
+                       HashCursor& hasher);
+
+  void rebuild_global_filter();
+
+  DWARFS_FORCE_INLINE size_t
+  hashes_per_block(segmenter::config const& cfg) const {
+    return block_size_in_frames(cfg) / window_step(cfg);
+  }
 
   DWARFS_FORCE_INLINE size_t
   bloom_filter_size(segmenter::config const& cfg) const {
     if constexpr (is_segmentation_enabled()) {
-      auto hash_count =
-          std::bit_ceil(std::max<size_t>(1, cfg.max_active_blocks) *
-                        (block_size_in_frames(cfg) / window_step(cfg)));
-      return (static_cast<size_t>(1) << cfg.bloom_filter_size) * hash_count;
+      return bloom_filter_size_for(
+          cfg, std::max<size_t>(1, cfg.max_active_blocks) *
+                   hashes_per_block(cfg));
+    } else {
+      return 0;
+    }
+  }
+
+  DWARFS_FORCE_INLINE size_t
+  block_filter_size(segmenter::config const& cfg) const {
+    if constexpr (is_multi_block_mode()) {
+      return bloom_filter_size_for(cfg, hashes_per_block(cfg));
     } else {
       return 0;
     }
   }
 
+  DWARFS_FORCE_INLINE size_t
+  group_filter_size(segmenter::config const& cfg) const {
+    if constexpr (is_multi_block_mode()) {
+      if (group_size_ > 1) {
+        return bloom_filter_size_for(cfg, group_size_ * hashes_per_block(cfg));
+      }
+    }
+    return 0;
+  }
+
+  DWARFS_FORCE_INLINE size_t
+  delta_filter_size(segmenter::config const& cfg) const {
+    if constexpr (is_segmentation_enabled()) {
+      if (cfg.num_hash_workers > 1) {
+        auto const batch_frames =
+            cfg.num_hash_workers * speculative_hash_batch::kFramesPerWorker;
+        auto hash_count = std::bit_ceil(
+            std::max<size_t>(1, batch_frames / window_step(cfg)));
+        return std::min(bloom_filter_size(cfg),
+                        (static_cast<size_t>(1) << cfg.bloom_filter_size) *
+                            hash_count);
+      }
+    }
+    return 0;
+  }
+
   size_t DWARFS_FORCE_INLINE
   block_size_in_frames(segmenter::config const& cfg) const {
     auto raw_size = static_cast<size_t>(1) << cfg.block_size_bits;
@@ -1347,11 +1964,31 @@ class segmenter_ final : public segmenter::impl, private SegmentingPolicy {
   size_t const window_size_;
   size_t const window_step_;
   size_t const block_size_in_frames_;
+  size_t const min_byte_run_size_in_frames_;
 
   chunk_state chunk_;
 
+  // Runs of identical bytes that have been written to a block and can be
+  // referenced by subsequent runs of the same byte.
+  std::array<byte_run_ref, 256> canonical_byte_runs_;
+
+  size_t const group_size_;
+  size_t next_block_index_{0};
+
   bloom_filter global_filter_;
 
+  // Only used in multi-block mode with a long lookback; filters for
+  // groups of `group_size_` consecutive blocks that are still active.
+  std::deque<bloom_filter_group> groups_;
+
+  // Only used for speculative hashing with multiple workers; records
+  // all hashes added to the global filter since the last batch.
+  bloom_filter delta_filter_;
+  speculative_hash_batch speculative_batch_;
+
+  // Hash buffer reused by all batched hash cursors
+  std::vector<uint32_t> rolled_hashes_;
+
   segmenter_stats stats_;
 
   using active_block_type = active_block<LoggerPolicy, GranularityPolicyT>;
@@ -1442,12 +2079,11 @@ active_block<LoggerPolicy, GranularityPolicy>::is_existing_repeating_sequence(
 }
 
 template <typename LoggerPolicy, typename GranularityPolicy>
-template <bool UseSegmentQueue>
+template <bool UseSegmentQueue, typename F>
 DWARFS_FORCE_INLINE void
 active_block<LoggerPolicy, GranularityPolicy>::append_bytes(
     granular_extent_adapter<GranularityPolicy, UseSegmentQueue>& data,
-    file_off_t data_offset, file_size_t data_size,
-    bloom_filter& global_filter) {
+    file_off_t data_offset, file_size_t data_size, F&& add_hash) {
   auto v = this->template create<granular_buffer_adapter<GranularityPolicy>>(
       data_.raw_buffer());
 
@@ -1463,27 +2099,46 @@ active_block<LoggerPolicy, GranularityPolicy>::append_bytes(
 
   v.append(data, data_offset, data_size);
 
-  if (window_size_ > 0) {
-    while (offset < v.size()) {
-      if (offset < window_size_) [[unlikely]] {
-        v.update_hash(hasher_, offset);
-      } else {
-        v.update_hash(hasher_, offset - window_size_, offset);
-      }
-      if (++offset >= window_size_) [[likely]] {
-        if ((offset & window_step_mask_) == 0) [[unlikely]] {
-          auto hashval = hasher_();
-          if (!is_existing_repeating_sequence(hashval, offset - window_size_))
-              [[likely]] {
-            offsets_.insert(hashval, offset - window_size_);
-            if (filter_.size() > 0) {
-              filter_.add(hashval);
-            }
-            global_filter.add(hashval);
-          }
-        }
+  if (window_size_ == 0) {
+    return;
+  }
+
+  auto add_window = [&](hash_t hashval, size_t window_offset) {
+    if (!is_existing_repeating_sequence(hashval, window_offset)) [[likely]] {
+      offsets_.insert(hashval, window_offset);
+      if (filter_.size() > 0) {
+        filter_.add(remix_hash(hashval, bloom_filter_tier::block));
       }
+      add_hash(hashval);
+    }
+  };
+
+  auto const end = v.size();
+
+  while (offset < window_size_ && offset < end) [[unlikely]] {
+    v.update_hash(hasher_, offset);
+    if (++offset == window_size_ && (offset & window_step_mask_) == 0) {
+      add_window(hasher_(), 0);
+    }
+  }
+
+  // Once the window is full, compute the hashes in chunks and only keep
+  // those at multiples of the window step.
+  std::array<hash_t, 1024> hashes;
+  auto const step = window_step_mask_ + 1;
+
+  while (offset < end) {
+    auto const count = std::min<size_t>(hashes.size(), end - offset);
+    v.roll_hash(hasher_, offset, window_size_, count, hashes.data());
+
+    // hashes[i] is the hash of the window ending at `offset + i + 1`
+    for (size_t i = (step - ((offset + 1) & window_step_mask_)) &
+                    window_step_mask_;
+         i < count; i += step) {
+      add_window(hashes[i], offset + i + 1 - window_size_);
     }
+
+    offset += count;
   }
 }
 
@@ -1531,19 +2186,22 @@ void segmenter_<LoggerPolicy, SegmentingPolicy>::add_chunkable(
     pctx_->current_file = chkable.get_file();
 
     auto process_extent = [&](auto& data) {
-      auto const size_in_frames = data.size();
-
-      if (!is_segmentation_enabled() or
-          std::cmp_less(size_in_frames, window_size_)) {
-        // no point dealing with hashing, just write it out
-        add_data(chkable, data, 0, size_in_frames);
-        finish_chunk(chkable);
-        auto const size_in_bytes = data.size_in_bytes();
-        prog_.total_bytes_read += size_in_bytes;
-        pctx_->bytes_processed += size_in_bytes;
-      } else {
-        segment_and_add_data(chkable, data, size_in_frames);
+      file_off_t const size_in_frames = data.size();
+      file_off_t offset_in_frames = 0;
+
+      if constexpr (!std::decay_t<decltype(data)>::kUseSegmentQueue) {
+        if (min_byte_run_size_in_frames_ > 0) {
+          while (auto run = data.find_byte_run(offset_in_frames,
+                                               min_byte_run_size_in_frames_)) {
+            auto const [run_begin, run_end] = *run;
+            add_extent_range(chkable, data, offset_in_frames, run_begin);
+            add_byte_run(chkable, data, run_begin, run_end);
+            offset_in_frames = run_end;
+          }
+        }
       }
+
+      add_extent_range(chkable, data, offset_in_frames, size_in_frames);
     };
 
     for (auto const& ext : chkable.extents()) {
@@ -1560,6 +2218,105 @@ void segmenter_<LoggerPolicy, SegmentingPolicy>::add_chunkable(
   }
 }
 
+template <typename LoggerPolicy, typename SegmentingPolicy>
+template <bool UseSegmentQueue>
+void segmenter_<LoggerPolicy, SegmentingPolicy>::add_extent_range(
+    chunkable& chkable, extent_adapter_t<UseSegmentQueue>& data,
+    file_off_t begin_in_frames, file_off_t end_in_frames) {
+  if (begin_in_frames == end_in_frames) {
+    return;
+  }
+
+  if (!is_segmentation_enabled() or
+      std::cmp_less(end_in_frames - begin_in_frames, window_size_)) {
+    // no point dealing with hashing, just write it out
+    add_data(chkable, data, begin_in_frames, end_in_frames - begin_in_frames);
+    finish_chunk(chkable);
+    auto const size_in_bytes = frames_to_bytes(end_in_frames - begin_in_frames);
+    prog_.total_bytes_read += size_in_bytes;
+    pctx_->bytes_processed += size_in_bytes;
+  } else {
+    segment_and_add_data(chkable, data, begin_in_frames, end_in_frames);
+  }
+}
+
+template <typename LoggerPolicy, typename SegmentingPolicy>
+void segmenter_<LoggerPolicy, SegmentingPolicy>::add_byte_run(
+    chunkable& chkable, extent_adapter_t<false>& data,
+    file_off_t begin_in_frames, file_off_t end_in_frames) {
+  auto const byte = data.byte_at(begin_in_frames);
+  file_size_t const size_in_frames = end_in_frames - begin_in_frames;
+  auto const size_in_bytes = frames_to_bytes(size_in_frames);
+
+  LOG_TRACE << cfg_.context << "found run of " << size_in_bytes
+            << fmt::format(" 0x{:02x} bytes", byte) << " @ "
+            << frames_to_bytes(begin_in_frames);
+
+  ++stats_.byte_runs;
+  stats_.byte_run_bytes += size_in_bytes;
+  prog_.total_bytes_read += size_in_bytes;
+  pctx_->bytes_processed += size_in_bytes;
+
+  if (byte == 0 && cfg_.enable_sparse_files) {
+    finish_chunk(chkable);
+    chkable.add_hole(size_in_bytes);
+    ++stats_.byte_run_holes;
+    return;
+  }
+
+  // The canonical run must be contiguous within a single block. We don't
+  // need it to be larger than a fraction of the block size, as this only
+  // affects the number of chunks needed to represent very long runs.
+  auto& canon = canonical_byte_runs_[byte];
+  auto const wanted_size = std::min<file_size_t>(
+      size_in_frames, std::max<size_t>(1, block_size_in_frames_ / 4));
+  file_size_t frames_written = 0;
+
+  auto current_block_offset = [this]() -> file_off_t {
+    return blocks_.empty() || blocks_.back().full()
+               ? 0
+               : blocks_.back().size_in_frames();
+  };
+
+  if (canon.size_in_frames < wanted_size) {
+    auto const block_offset = current_block_offset();
+    file_size_t const space = block_size_in_frames_ - block_offset;
+
+    if (space < wanted_size) {
+      // fill up the current block, then start the canonical run
+      // at the beginning of a new block
+      auto const block_num = blocks_.back().num();
+      add_data(chkable, data, begin_in_frames, space);
+      frames_written = space;
+      if (space > canon.size_in_frames) {
+        canon = {block_num, block_offset, space};
+      }
+    }
+
+    auto const canon_size =
+        std::min(wanted_size, size_in_frames - frames_written);
+
+    if (canon_size > canon.size_in_frames) {
+      auto const canon_offset = current_block_offset();
+      add_data(chkable, data, begin_in_frames + frames_written, canon_size);
+      canon = {blocks_.back().num(), canon_offset, canon_size};
+      frames_written += canon_size;
+    }
+  }
+
+  finish_chunk(chkable);
+
+  while (frames_written < size_in_frames) {
+    auto const size =
+        std::min(canon.size_in_frames, size_in_frames - frames_written);
+    chkable.add_chunk(canon.block_num, frames_to_bytes(canon.offset_in_frames),
+                      frames_to_bytes(size));
+    prog_.chunk_count++;
+    prog_.saved_by_segmentation += frames_to_bytes(size);
+    frames_written += size;
+  }
+}
+
 template <typename LoggerPolicy, typename SegmentingPolicy>
 void segmenter_<LoggerPolicy, SegmentingPolicy>::finish() {
   if (!blocks_.empty() && !blocks_.back().full()) {
@@ -1575,6 +2332,41 @@ void segmenter_<LoggerPolicy, SegmentingPolicy>::finish() {
                                               stats_.bloom_hits)
                 << ", lookups=" << stats_.bloom_lookups << ")";
   }
+  if (stats_.group_bloom_lookups > 0) {
+    LOG_VERBOSE << cfg_.context << "group bloom filter reject rate: "
+                << fmt::format("{:.3f}%",
+                               100.0 - 100.0 * stats_.group_bloom_hits /
+                                           stats_.group_bloom_lookups)
+                << " (lookups=" << stats_.group_bloom_lookups << ")";
+  }
+  if (stats_.block_bloom_lookups > 0) {
+    LOG_VERBOSE << cfg_.context << "block bloom filter reject rate: "
+                << fmt::format("{:.3f}%",
+                               100.0 - 100.0 * stats_.block_bloom_hits /
+                                           stats_.block_bloom_lookups)
+                << " (TPR="
+                << fmt::format("{:.3f}%",
+                               100.0 * stats_.block_bloom_true_positives /
+                                   stats_.block_bloom_hits)
+                << ", lookups=" << stats_.block_bloom_lookups << ")";
+  }
+  if (stats_.bloom_rebuilds > 0) {
+    LOG_VERBOSE << cfg_.context << "global bloom filter rebuilt "
+                << stats_.bloom_rebuilds << " times";
+  }
+  if (stats_.byte_runs > 0) {
+    LOG_VERBOSE << cfg_.context << "byte runs: " << stats_.byte_runs
+                << " runs (" << stats_.byte_run_holes << " holes), "
+                << size_with_unit(stats_.byte_run_bytes);
+  }
+  if (stats_.speculative_batches > 0) {
+    LOG_VERBOSE << cfg_.context << "speculative hashing: "
+                << stats_.speculative_batches << " batches, "
+                << stats_.speculative_hashes << " hashes ("
+                << fmt::format("{:.3f}%", 100.0 * stats_.bloom_lookups /
+                                              stats_.speculative_hashes)
+                << " used)";
+  }
   if (stats_.total_matches > 0) {
     LOG_VERBOSE << fmt::format(
         "{}segment matches: good={}, bad={}, collisions={}, total={}",
@@ -1634,35 +2426,62 @@ segmenter_<LoggerPolicy, SegmentingPolicy>::append_to_block(
     file_off_t offset_in_frames, file_size_t size_in_frames) {
   if (blocks_.empty() or blocks_.back().full()) [[unlikely]] {
     if (blocks_.size() >= std::max<size_t>(1, cfg_.max_active_blocks)) {
+      auto const evicted_index = next_block_index_ - blocks_.size();
+
       blocks_.pop_front();
-    }
 
-    if constexpr (is_segmentation_enabled()) {
-      global_filter_.clear();
       if constexpr (is_multi_block_mode()) {
-        for (auto const& b : blocks_) {
-          global_filter_.merge(b.filter());
+        if ((evicted_index + 1) % group_size_ == 0) {
+          if (!groups_.empty()) {
+            groups_.pop_front();
+          }
+          rebuild_global_filter();
         }
       }
     }
 
+    if constexpr (is_segmentation_enabled() && !is_multi_block_mode()) {
+      global_filter_.clear();
+    }
+
+    if constexpr (is_multi_block_mode()) {
+      if (group_size_ > 1 && next_block_index_ % group_size_ == 0) {
+        groups_.emplace_back(next_block_index_, group_filter_size(cfg_));
+      }
+    }
+
     add_new_block(blocks_, LOG_GET_LOGGER, repeating_sequence_hash_values_,
                   repeating_collisions_, blkmgr_->get_logical_block(),
                   block_size_in_frames_,
                   cfg_.max_active_blocks > 0 ? window_size_ : 0, window_step_,
-                  is_multi_block_mode() ? global_filter_.size() : 0);
+                  block_filter_size(cfg_));
+
+    ++next_block_index_;
   }
 
   auto const offset_in_bytes = frames_to_bytes(offset_in_frames);
   auto const size_in_bytes = frames_to_bytes(size_in_frames);
   auto& block = blocks_.back();
+  auto* group_filter = groups_.empty() ? nullptr : &groups_.back().filter;
 
   LOG_TRACE << cfg_.context << "appending " << size_in_bytes
             << " bytes to block " << block.num() << " @ "
             << frames_to_bytes(block.size_in_frames())
             << " from chunkable offset " << offset_in_bytes;
 
-  block.append_bytes(data, offset_in_bytes, size_in_bytes, global_filter_);
+  block.append_bytes(data, offset_in_bytes, size_in_bytes,
+                     [this, group_filter](uint32_t hashval) {
+                       auto const global_hashval =
+                           remix_hash(hashval, bloom_filter_tier::global);
+                       global_filter_.add(global_hashval);
+                       if (group_filter) {
+                         group_filter->add(
+                             remix_hash(hashval, bloom_filter_tier::group));
+                       }
+                       if (delta_filter_.size() > 0) {
+                         delta_filter_.add(global_hashval);
+                       }
+                     });
   chunk_.size_in_frames += size_in_frames;
 
   prog_.filesystem_size += size_in_bytes;
@@ -1674,6 +2493,15 @@ segmenter_<LoggerPolicy, SegmentingPolicy>::append_to_block(
   }
 }
 
+template <typename LoggerPolicy, typename SegmentingPolicy>
+void segmenter_<LoggerPolicy, SegmentingPolicy>::rebuild_global_filter() {
+  global_filter_.clear();
+  for (auto const& b : blocks_) {
+    b.add_global_hashes_to(global_filter_);
+  }
+  ++stats_.bloom_rebuilds;
+}
+
 template <typename LoggerPolicy, typename SegmentingPolicy>
 template <bool UseSegmentQueue>
 void segmenter_<LoggerPolicy, SegmentingPolicy>::add_data(
@@ -1714,22 +2542,54 @@ template <bool UseSegmentQueue>
 DWARFS_FORCE_INLINE void
 segmenter_<LoggerPolicy, SegmentingPolicy>::segment_and_add_data(
     chunkable& chkable, extent_adapter_t<UseSegmentQueue>& data,
-    file_size_t size_in_frames) {
-  rsync_hash hasher;
+    file_off_t begin_in_frames, file_off_t end_in_frames) {
+  if constexpr (!UseSegmentQueue) {
+    // Speculative hashing only pays off for large extents that can be
+    // split across multiple workers.
+    if (delta_filter_.size() > 0 &&
+        std::cmp_greater_equal(
+            end_in_frames - begin_in_frames,
+            2 * speculative_hash_batch::kMinFramesPerWorker)) {
+      speculative_hash_cursor<extent_adapter_t<false>> hasher(
+          speculative_batch_, delta_filter_, global_filter_, stats_,
+          window_size_, end_in_frames);
+      segment_and_add_data(chkable, data, begin_in_frames, end_in_frames,
+                           hasher);
+      return;
+    }
+
+    if constexpr (GranularityPolicyT::has_byte_frames()) {
+      batched_hash_cursor<extent_adapter_t<false>> hasher(
+          rolled_hashes_, window_size_, end_in_frames);
+      segment_and_add_data(chkable, data, begin_in_frames, end_in_frames,
+                           hasher);
+      return;
+    }
+  }
+
+  serial_hash_cursor<UseSegmentQueue> hasher(window_size_);
+  segment_and_add_data(chkable, data, begin_in_frames, end_in_frames, hasher);
+}
+
+template <typename LoggerPolicy, typename SegmentingPolicy>
+template <bool UseSegmentQueue, typename HashCursor>
+DWARFS_FORCE_INLINE void
+segmenter_<LoggerPolicy, SegmentingPolicy>::segment_and_add_data(
+    chunkable& chkable, extent_adapter_t<UseSegmentQueue>& data,
+    file_off_t begin_in_frames, file_off_t end_in_frames, HashCursor& hasher) {
   file_off_t offset_in_frames = 0;
-  file_size_t frames_written = 0;
+  file_size_t frames_written = begin_in_frames;
   size_t lookback_size_in_frames = window_size_ + window_step_;
   size_t next_hash_offset_in_frames =
-      lookback_size_in_frames +
+      begin_in_frames + lookback_size_in_frames +
       (blocks_.empty() ? window_step_
                        : blocks_.back().next_hash_distance_in_frames());
 
-  DWARFS_CHECK(std::cmp_greater_equal(size_in_frames, window_size_),
+  DWARFS_CHECK(
+      std::cmp_greater_equal(end_in_frames - begin_in_frames, window_size_),
                "unexpected call to segment_and_add_data");
 
-  hash_window<UseSegmentQueue> hashwin(window_size_);
-
-  offset_in_frames = hashwin.seek(hasher, data, 0);
+  offset_in_frames = hasher.seek(data, begin_in_frames);
 
   small_vector<segment_match<LoggerPolicy, GranularityPolicyT>, 1> matches;
 
@@ -1742,7 +2602,7 @@ segmenter_<LoggerPolicy, SegmentingPolicy>::segment_and_add_data(
   // TODO: how can we reasonably update the top progress bar with
   //       multiple concurrent segmenters?
 
-  auto update_progress = [this, last_offset = static_cast<file_off_t>(0)](
+  auto update_progress = [this, last_offset = begin_in_frames](
                              file_off_t offset) mutable {
     auto bytes = frames_to_bytes(offset - last_offset);
     prog_.total_bytes_read += bytes;
@@ -1750,17 +2610,52 @@ segmenter_<LoggerPolicy, SegmentingPolicy>::segment_and_add_data(
     last_offset = offset;
   };
 
-  while (offset_in_frames < size_in_frames) {
+  while (offset_in_frames < end_in_frames) {
     ++stats_.bloom_lookups;
 
-    if (global_filter_.test(hasher())) [[unlikely]] {
+    if (hasher.test(global_filter_)) [[unlikely]] {
       ++stats_.bloom_hits;
 
       if constexpr (is_multi_block_mode()) {
-        for (auto const& block : blocks_) {
-          block.for_each_offset_filter(hasher(), [&, this](auto off) {
-            this->add_match(matches, &block, off);
-          });
+        auto const hashval = hasher();
+
+        auto probe_block = [&, this](active_block_type const& block) {
+          ++stats_.block_bloom_lookups;
+          if (block.filter().test(
+                  remix_hash(hashval, bloom_filter_tier::block))) [[unlikely]] {
+            ++stats_.block_bloom_hits;
+            auto const num_matches = matches.size();
+            block.for_each_offset(hashval, [&, this](auto off) {
+              this->add_match(matches, &block, off);
+            });
+            if (matches.size() > num_matches) {
+              ++stats_.block_bloom_true_positives;
+            }
+          }
+        };
+
+        if (groups_.empty()) {
+          for (auto const& block : blocks_) {
+            probe_block(block);
+          }
+        } else {
+          auto const first_active = next_block_index_ - blocks_.size();
+          auto const group_hashval =
+              remix_hash(hashval, bloom_filter_tier::group);
+
+          for (auto const& grp : groups_) {
+            ++stats_.group_bloom_lookups;
+            if (grp.filter.test(group_hashval)) [[unlikely]] {
+              ++stats_.group_bloom_hits;
+              auto const begin =
+                  std::max(grp.first_block, first_active) - first_active;
+              auto const end = std::min(
+                  grp.first_block + group_size_ - first_active, blocks_.size());
+              for (auto i = begin; i < end; ++i) {
+                probe_block(blocks_[i]);
+              }
+            }
+          }
         }
       } else {
         auto& block = blocks_.front();
@@ -1785,7 +2680,7 @@ segmenter_<LoggerPolicy, SegmentingPolicy>::segment_and_add_data(
                     << m.offset();
 
           m.verify_and_extend(data, offset_in_frames - window_size_,
-                              window_size_, frames_written, size_in_frames);
+                              window_size_, frames_written, end_in_frames);
 
           LOG_TRACE << cfg_.context << "    -> " << m.offset() << " -> "
                     << m.size();
@@ -1823,13 +2718,11 @@ segmenter_<LoggerPolicy, SegmentingPolicy>::segment_and_add_data(
 
           offset_in_frames = frames_written;
 
-          if (std::cmp_less(size_in_frames - frames_written, window_size_)) {
+          if (std::cmp_less(end_in_frames - frames_written, window_size_)) {
             break;
           }
 
-          hasher.clear();
-
-          offset_in_frames = hashwin.seek(hasher, data, offset_in_frames);
+          offset_in_frames = hasher.seek(data, offset_in_frames);
 
           update_progress(offset_in_frames);
 
@@ -1860,12 +2753,12 @@ segmenter_<LoggerPolicy, SegmentingPolicy>::segment_and_add_data(
       update_progress(offset_in_frames);
     }
 
-    offset_in_frames = hashwin.slide(hasher, data, offset_in_frames);
+    offset_in_frames = hasher.slide(data, offset_in_frames);
   }
 
-  update_progress(size_in_frames);
+  update_progress(end_in_frames);
 
-  add_data(chkable, data, frames_written, size_in_frames - frames_written);
+  add_data(chkable, data, frames_written, end_in_frames - frames_written);
   finish_chunk(chkable);
 }
 
@@ -1929,6 +2822,11 @@ create_segmenter(logger& lgr, progress& prog,
                  segmenter::config const& cfg,
                  compression_constraints const& cc, file_size_t total_size,
                  segmenter::block_ready_cb block_ready) {
+  if (cfg.algo == segmenter::algorithm::cdc) {
+    return create_cdc_segmenter(lgr, prog, std::move(blkmgr), cfg, cc,
+                                total_size, std::move(block_ready));
+  }
+
   if (cfg.max_active_blocks == 0 or cfg.blockhash_window_size == 0) {
     return create_segmenter2<SegmentationDisabledPolicy>(
         lgr, prog, std::move(blkmgr), cfg, cc, total_size,
@@ -1960,6 +2858,10 @@ segmenter::segmenter(logger& lgr, writer_progress& prog,
 
 uint64_t segmenter::estimate_memory_usage(config const& cfg,
                                           compression_constraints const& cc) {
+  if (cfg.algo == algorithm::cdc) {
+    return internal::estimate_cdc_segmenter_memory_usage(cfg);
+  }
+
   if (cfg.max_active_blocks == 0 or cfg.blockhash_window_size == 0) {
     return 0;
   }
@@ -1974,10 +2876,10 @@ uint64_t segmenter::estimate_memory_usage(config const& cfg,
   size_t const win_step = internal::window_step(cfg);
   size_t const max_offset_count =
       (block_size_in_frames - (win_size - win_step)) / win_step;
+  size_t const hashes_per_block = block_size_in_frames / win_step;
   size_t const bloom_filter_mem =
-      ((static_cast<size_t>(1) << cfg.bloom_filter_size) *
-       std::bit_ceil(cfg.max_active_blocks *
-                     (block_size_in_frames / win_step))) /
+      internal::bloom_filter_size_for(
+          cfg, cfg.max_active_blocks * hashes_per_block) /
       8;
 
   // Single active block uses memory for:
@@ -1986,9 +2888,31 @@ uint64_t segmenter::estimate_memory_usage(config const& cfg,
   // We do *not* consider the memory for the block data buffer here
   size_t const active_block_mem_usage =
       (max_offset_count * kWorstCaseBytesPerOffset) +
-      (cfg.max_active_blocks > 1 ? bloom_filter_mem : 0);
-
-  return cfg.max_active_blocks * active_block_mem_usage + bloom_filter_mem;
+      (cfg.max_active_blocks > 1
+           ? internal::bloom_filter_size_for(cfg, hashes_per_block) / 8
+           : 0);
+
+  // Group bloom filters, one more than needed to cover all active blocks
+  // as the oldest group may only be partially active
+  size_t const group_size = internal::bloom_filter_group_size(cfg);
+  size_t const group_filter_mem =
+      internal::bloom_filter_size_for(cfg, group_size * hashes_per_block) / 8;
+  size_t const bloom_filter_group_mem =
+      group_size > 1
+          ? (cfg.max_active_blocks / group_size + 1) * group_filter_mem
+          : 0;
+
+  // Speculative hashing keeps a 32-bit hash and a snapshot bloom filter
+  // result for each frame in a batch
+  size_t const speculative_hash_mem =
+      cfg.num_hash_workers > 1
+          ? cfg.num_hash_workers *
+                internal::speculative_hash_batch::kFramesPerWorker *
+                (sizeof(uint32_t) + sizeof(uint8_t))
+          : 0;
+
+  return cfg.max_active_blocks * active_block_mem_usage + bloom_filter_mem +
+         bloom_filter_group_mem + speculative_hash_mem;
 }
 
 } // namespace dwarfs::writer
@@ -70,6 +70,12 @@ class segmenter_factory_ final : public segmenter_factory::impl {
     cfg.bloom_filter_size = cfg_.bloom_filter_size.get(cat);
     cfg.block_size_bits = cfg_.block_size_bits;
     cfg.enable_sparse_files = cfg_.enable_sparse_files;
+    cfg.num_hash_workers = cfg_.num_hash_workers;
+    cfg.min_byte_run_size = cfg_.min_byte_run_size;
+    cfg.algo = cfg_.algo;
+    cfg.cdc_chunk_size_bits = cfg_.cdc_chunk_size_bits;
+    cfg.cdc_index_memory = cfg_.cdc_index_memory;
+    cfg.cdc_spill_dir = cfg_.cdc_spill_dir;
 
     return cfg;
   }
@@ -0,0 +1,139 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <dwarfs/error.h>
+#include <dwarfs/file_util.h>
+
+#include <dwarfs/reader/internal/block_access_trace.h>
+
+using namespace dwarfs;
+using namespace dwarfs::reader::internal;
+
+namespace {
+
+std::vector<size_t> block_numbers(block_access_trace const& trace) {
+  std::vector<size_t> blocks;
+  for (auto const& e : trace.entries) {
+    blocks.push_back(e.block_no);
+  }
+  return blocks;
+}
+
+} // namespace
+
+TEST(block_access_trace_test, roundtrip) {
+  temporary_directory const td("dwarfs");
+  auto const path = td.path() / "test.trace";
+
+  {
+    block_access_recorder rec(path, 1000);
+
+    for (size_t block_no : {17, 3, 17, 999, 3, 0, 1000, 42}) {
+      rec.record(block_no);
+    }
+
+    EXPECT_EQ(5, rec.num_recorded());
+  }
+
+  auto const trace = block_access_trace::read(path);
+
+  EXPECT_EQ(1000, trace.num_blocks);
+  EXPECT_THAT(block_numbers(trace), ::testing::ElementsAre(17, 3, 999, 0, 42));
+  EXPECT_TRUE(std::ranges::is_sorted(
+      trace.entries, std::less{}, &block_access_trace::entry::time));
+}
+
+TEST(block_access_trace_test, concurrent_recording) {
+  temporary_directory const td("dwarfs");
+  auto const path = td.path() / "test.trace";
+  static constexpr size_t kNumBlocks{10000};
+
+  {
+    block_access_recorder rec(path, kNumBlocks);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < 4; ++t) {
+      threads.emplace_back([&rec, t] {
+        for (size_t i = 0; i < kNumBlocks; ++i) {
+          rec.record((i * (t + 1)) % kNumBlocks);
+        }
+      });
+    }
+
+    for (auto& t : threads) {
+      t.join();
+    }
+
+    EXPECT_EQ(kNumBlocks, rec.num_recorded());
+  }
+
+  auto blocks = block_numbers(block_access_trace::read(path));
+  std::ranges::sort(blocks);
+
+  ASSERT_EQ(kNumBlocks, blocks.size());
+  EXPECT_EQ(0, blocks.front());
+  EXPECT_EQ(kNumBlocks - 1, blocks.back());
+  EXPECT_EQ(blocks.end(), std::ranges::adjacent_find(blocks));
+}
+
+TEST(block_access_trace_test, invalid_files) {
+  temporary_directory const td("dwarfs");
+
+  EXPECT_THAT([&] { block_access_trace::read(td.path() / "missing"); },
+              ::testing::ThrowsMessage<dwarfs::runtime_error>(
+                  ::testing::HasSubstr("cannot open trace file")));
+
+  auto const bad_magic = td.path() / "bad_magic";
+  std::ofstream{bad_magic} << "this is not a trace";
+
+  EXPECT_THAT([&] { block_access_trace::read(bad_magic); },
+              ::testing::ThrowsMessage<dwarfs::runtime_error>(
+                  ::testing::HasSubstr("is not a block access trace")));
+
+  auto const truncated = td.path() / "truncated";
+
+  {
+    block_access_recorder rec(truncated, 1000);
+    rec.record(500);
+  }
+
+  std::filesystem::resize_file(truncated,
+                               std::filesystem::file_size(truncated) - 1);
+
+  EXPECT_THAT([&] { block_access_trace::read(truncated); },
+              ::testing::ThrowsMessage<dwarfs::runtime_error>(
+                  ::testing::HasSubstr("corrupt trace file")));
+}
@@ -0,0 +1,242 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <dwarfs/reader/block_cache_arena.h>
+
+#include <dwarfs/reader/internal/block_arena.h>
+#include <dwarfs/reader/internal/cached_block.h>
+
+using namespace dwarfs::reader;
+using internal::block_arena;
+using internal::cached_block;
+
+namespace {
+
+class mock_cached_block : public cached_block {
+ public:
+  explicit mock_cached_block(size_t size)
+      : size_{size} {}
+
+  size_t range_end() const override { return size_; }
+  uint8_t const* data() const override { return nullptr; }
+  void decompress_until(size_t) override {}
+  size_t uncompressed_size() const override { return size_; }
+  void touch() override {}
+  bool last_used_before(std::chrono::steady_clock::time_point) const override {
+    return false;
+  }
+  bool any_pages_swapped_out(std::vector<uint8_t>&) const override {
+    return false;
+  }
+
+ private:
+  size_t size_;
+};
+
+std::shared_ptr<cached_block> make_block(size_t size) {
+  return std::make_shared<mock_cached_block>(size);
+}
+
+} // namespace
+
+TEST(block_arena_test, shared_budget) {
+  block_arena arena({.max_bytes = 4096, .num_shards = 2});
+
+  std::vector<size_t> evicted_a;
+  std::vector<size_t> evicted_b;
+
+  auto a = arena.attach([&](size_t block_no, std::shared_ptr<cached_block>&&) {
+    evicted_a.push_back(block_no);
+  });
+  auto b = arena.attach([&](size_t block_no, std::shared_ptr<cached_block>&&) {
+    evicted_b.push_back(block_no);
+  });
+
+  EXPECT_NE(a, b);
+  EXPECT_EQ(2, arena.num_images());
+
+  arena.set_block_size(a, 1024, 100);
+  arena.set_block_size(b, 1024, 100);
+
+  auto bytes_of = [&](uint32_t image_id) {
+    return arena.get_image_stats(image_id).cached_bytes;
+  };
+
+  EXPECT_EQ(4096, arena.max_bytes());
+
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_TRUE(arena.insert(a, i, std::nullopt, make_block(1024)));
+  }
+
+  EXPECT_FALSE(arena.insert(a, 0, std::nullopt, make_block(1024)));
+  EXPECT_EQ(4096, arena.cached_bytes());
+  EXPECT_EQ(4096, bytes_of(a));
+  EXPECT_EQ(0, bytes_of(b));
+
+  // Blocks of image `b` displace blocks of image `a`
+  for (size_t i = 0; i < 4; ++i) {
+    arena.insert(b, i, std::nullopt, make_block(1024));
+  }
+
+  EXPECT_LE(arena.cached_bytes(), arena.max_bytes());
+  EXPECT_EQ(arena.cached_bytes(), bytes_of(a) + bytes_of(b));
+  EXPECT_GT(bytes_of(b), 0);
+  EXPECT_FALSE(evicted_a.empty());
+  EXPECT_EQ(evicted_a.size() * 1024, 4096 - bytes_of(a));
+
+  // The same block number in different images refers to different blocks
+  EXPECT_NE(arena.find(a, 3, std::nullopt), arena.find(b, 3, std::nullopt));
+  EXPECT_TRUE(arena.find(b, 3, std::nullopt));
+
+  // Detaching removes all blocks without calling the hook
+  auto const evicted_b_count = evicted_b.size();
+  arena.detach(b);
+  EXPECT_EQ(evicted_b_count, evicted_b.size());
+  EXPECT_EQ(1, arena.num_images());
+  EXPECT_EQ(0, bytes_of(b));
+  EXPECT_EQ(arena.cached_bytes(), bytes_of(a));
+  EXPECT_FALSE(arena.find(b, 3, std::nullopt));
+}
+
+TEST(block_arena_test, remove_if) {
+  block_arena arena({.max_bytes = 1 << 20, .num_shards = 3});
+
+  auto a = arena.attach([](size_t, std::shared_ptr<cached_block>&&) {});
+  auto b = arena.attach([](size_t, std::shared_ptr<cached_block>&&) {});
+
+  arena.set_block_size(a, 1024, 16);
+  arena.set_block_size(b, 1024, 16);
+
+  auto bytes_of = [&](uint32_t image_id) {
+    return arena.get_image_stats(image_id).cached_bytes;
+  };
+
+  for (size_t i = 0; i < 8; ++i) {
+    arena.insert(a, i, std::nullopt, make_block(i < 4 ? 512 : 1024));
+    arena.insert(b, i, std::nullopt, make_block(512));
+  }
+
+  std::vector<size_t> removed;
+
+  arena.remove_if(
+      a, [](cached_block const& cb) { return cb.uncompressed_size() < 1024; },
+      [&](size_t block_no, std::shared_ptr<cached_block>&&) {
+        removed.push_back(block_no);
+      });
+
+  EXPECT_THAT(removed, ::testing::UnorderedElementsAre(0, 1, 2, 3));
+  EXPECT_EQ(4 * 1024, bytes_of(a));
+  EXPECT_EQ(8 * 512, bytes_of(b));
+
+  size_t visited{0};
+  arena.for_each(b, [&](size_t, cached_block const&) { ++visited; });
+  EXPECT_EQ(8, visited);
+}
+
+TEST(block_arena_test, content_dedup) {
+  block_arena arena({.max_bytes = 4096, .num_shards = 4});
+
+  std::vector<std::pair<uint32_t, size_t>> evicted;
+
+  auto hook_for = [&](uint32_t image_id) {
+    return [&evicted, image_id](size_t block_no,
+                                std::shared_ptr<cached_block>&&) {
+      evicted.emplace_back(image_id, block_no);
+    };
+  };
+
+  std::array<uint32_t, 3> images;
+
+  for (auto& image_id : images) {
+    image_id = arena.attach(hook_for(images.size()));
+    arena.set_block_size(image_id, 1024, 16);
+  }
+
+  auto content = [](uint64_t n) {
+    internal::block_content_id id{.xxh3_64 = n * 0x9e3779b97f4a7c15};
+    id.sha2_512_256[0] = static_cast<uint8_t>(n);
+    return std::optional{id};
+  };
+
+  auto const a = images[0];
+  auto const b = images[1];
+  auto const c = images[2];
+
+  // Identical blocks are only stored once
+  auto blk = make_block(1024);
+  EXPECT_TRUE(arena.insert(a, 3, content(1), blk));
+  EXPECT_FALSE(arena.insert(b, 5, content(1), make_block(1024)));
+  EXPECT_EQ(blk, arena.find(b, 5, content(1)));
+  EXPECT_EQ(blk, arena.find(c, 7, content(1)));
+  EXPECT_EQ(1024, arena.cached_bytes());
+
+  EXPECT_EQ(1024, arena.get_image_stats(a).cached_bytes);
+  EXPECT_EQ(1024, arena.get_image_stats(b).cached_bytes);
+  EXPECT_EQ(1024, arena.get_image_stats(c).cached_bytes);
+  EXPECT_EQ(0, arena.get_image_stats(a).shared_hits);
+  EXPECT_EQ(0, arena.get_image_stats(b).shared_hits);
+  EXPECT_EQ(1, arena.get_image_stats(c).shared_hits);
+
+  // A checksum collision must not return the wrong block
+  auto other = content(1);
+  other->sha2_512_256[1] = 42;
+  EXPECT_FALSE(arena.find(a, 4, other));
+  EXPECT_FALSE(arena.insert(a, 4, other, make_block(1024)));
+
+  // Dropping one reference keeps the block for the other images
+  std::vector<size_t> tidied;
+  arena.remove_if(
+      b, [](cached_block const&) { return true; },
+      [&](size_t block_no, std::shared_ptr<cached_block>&&) {
+        tidied.push_back(block_no);
+      });
+  EXPECT_THAT(tidied, ::testing::ElementsAre(5));
+  EXPECT_EQ(0, arena.get_image_stats(b).cached_bytes);
+  EXPECT_EQ(blk, arena.find(a, 3, content(1), false));
+  EXPECT_EQ(1024, arena.cached_bytes());
+
+  arena.detach(a);
+  EXPECT_EQ(1024, arena.cached_bytes());
+  arena.detach(c);
+  EXPECT_EQ(0, arena.cached_bytes());
+  EXPECT_TRUE(evicted.empty());
+}
+
+TEST(block_arena_test, public_arena) {
+  block_cache_arena arena({.max_bytes = 1 << 20});
+
+  EXPECT_EQ(1 << 20, arena.max_bytes());
+  EXPECT_EQ(0, arena.cached_bytes());
+  EXPECT_EQ(0, arena.num_images());
+  EXPECT_TRUE(arena.get_arena());
+}
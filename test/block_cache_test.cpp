@@ -23,7 +23,12 @@
 
 #include <algorithm>
 #include <array>
+#include <filesystem>
+#include <fstream>
+#include <map>
 #include <random>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include <gmock/gmock.h>
@@ -33,6 +38,10 @@
 
 #include <dwarfs/config.h>
 #include <dwarfs/error.h>
+#include <dwarfs/file_util.h>
+#include <dwarfs/fstypes.h>
+#include <dwarfs/os_access_generic.h>
+#include <dwarfs/reader/block_cache_arena.h>
 #include <dwarfs/reader/block_cache_options.h>
 #include <dwarfs/reader/cache_tidy_config.h>
 #include <dwarfs/reader/filesystem_options.h>
@@ -40,6 +49,8 @@
 #include <dwarfs/tool/main_adapter.h>
 #include <dwarfs_tool_main.h>
 
+#include <dwarfs/reader/internal/block_access_trace.h>
+
 #include "mmap_mock.h"
 #include "test_helpers.h"
 #include "test_logger.h"
@@ -51,12 +62,10 @@ class options_test
   DWARFS_SLOW_FIXTURE
 };
 
-TEST_P(options_test, cache_stress) {
-  static constexpr size_t num_threads{8};
-  static constexpr size_t num_read_reqs{1024};
-
-  auto const& cache_opts = GetParam();
+namespace {
 
+std::pair<std::shared_ptr<test::os_access_mock>, file_view>
+build_image(std::vector<std::string> const& extra_args = {}) {
   auto os = std::make_shared<test::os_access_mock>();
 
   {
@@ -91,11 +100,25 @@ TEST_P(options_test, cache_stress) {
 
     std::vector<std::string> args{"mkdwarfs", "-i",   "/",  "-o",       "-",
                                   "-l3",      "-S16", "-C", compression};
+    args.insert(args.end(), extra_args.begin(), extra_args.end());
     EXPECT_EQ(0, tool::main_adapter(tool::mkdwarfs_main)(args, iol.get()));
 
     mm = test::make_mock_file_view(iol.out());
   }
 
+  return {os, mm};
+}
+
+} // namespace
+
+TEST_P(options_test, cache_stress) {
+  static constexpr size_t num_threads{8};
+  static constexpr size_t num_read_reqs{1024};
+
+  auto const& cache_opts = GetParam();
+
+  auto [os, mm] = build_image();
+
   test::test_logger lgr(logger::TRACE);
   reader::filesystem_options opts{
       .block_cache = cache_opts,
@@ -218,9 +241,323 @@ constexpr std::array const cache_options{
     block_cache_options{.max_bytes = 512 * 1024,
                         .num_workers = 4,
                         .disable_block_integrity_check = true},
+    block_cache_options{
+        .max_bytes = 256 * 1024, .num_workers = 4, .num_shards = 1},
+    block_cache_options{
+        .max_bytes = 256 * 1024, .num_workers = 4, .num_shards = 3},
+    block_cache_options{
+        .max_bytes = 1024 * 1024, .num_workers = 7, .num_shards = 64},
+    block_cache_options{
+        .max_bytes = 256 * 1024,
+        .num_workers = 4,
+        .eviction_policy = reader::block_cache_eviction_policy::TINYLFU},
+    block_cache_options{
+        .max_bytes = 1024 * 1024,
+        .num_workers = 5,
+        .decompress_ratio = 0.5,
+        .num_shards = 2,
+        .eviction_policy = reader::block_cache_eviction_policy::TINYLFU},
 };
 
 } // namespace
 
 INSTANTIATE_TEST_SUITE_P(block_cache, options_test,
                          ::testing::ValuesIn(cache_options));
+
+TEST(block_cache, disk_cache) {
+  auto [os, mm] = build_image();
+
+  // The disk cache needs a real file system to store blocks
+  os_access_generic const real_os;
+  temporary_directory const td("dwarfs");
+
+  reader::filesystem_options const opts{
+      .block_cache = {.max_bytes = 256 * 1024, .num_workers = 2},
+      .disk_cache = {.directory = td.path(), .max_bytes = 64 * 1024 * 1024},
+  };
+
+  std::map<uint32_t, std::string> contents;
+
+  {
+    test::test_logger lgr;
+    reader::filesystem_v2 fs(lgr, real_os, mm, opts);
+
+    fs.walk([&](auto e) {
+      auto iv = e.inode();
+      if (iv.is_regular_file()) {
+        contents[iv.inode_num()] = fs.read_string(iv.inode_num());
+      }
+    });
+  }
+
+  ASSERT_FALSE(contents.empty());
+
+  size_t num_files{0};
+
+  for (auto const& e : std::filesystem::directory_iterator(td.path())) {
+    EXPECT_EQ(".blk", e.path().extension().string());
+    ++num_files;
+  }
+
+  EXPECT_GT(num_files, 0);
+
+  test::test_logger lgr(logger::VERBOSE);
+
+  {
+    reader::filesystem_v2 fs(lgr, real_os, mm, opts);
+
+    for (auto const& [inode, data] : contents) {
+      EXPECT_EQ(data, fs.read_string(inode)) << inode;
+    }
+  }
+
+  auto const& log = lgr.get_log();
+  auto it = std::ranges::find_if(log, [](auto const& e) {
+    return e.output.starts_with("blocks loaded from disk: ");
+  });
+
+  ASSERT_NE(log.end(), it) << lgr.as_string();
+  EXPECT_NE("blocks loaded from disk: 0", it->output);
+}
+
+TEST(block_cache, disk_cache_corrupt_block) {
+  auto [os, mm] = build_image();
+
+  os_access_generic const real_os;
+  temporary_directory const td("dwarfs");
+
+  reader::filesystem_options const opts{
+      .block_cache = {.max_bytes = 256 * 1024, .num_workers = 2},
+      .disk_cache = {.directory = td.path(), .max_bytes = 64 * 1024 * 1024},
+  };
+
+  std::map<uint32_t, std::string> contents;
+
+  {
+    test::test_logger lgr;
+    reader::filesystem_v2 fs(lgr, real_os, mm, opts);
+
+    fs.walk([&](auto e) {
+      auto iv = e.inode();
+      if (iv.is_regular_file()) {
+        contents[iv.inode_num()] = fs.read_string(iv.inode_num());
+      }
+    });
+  }
+
+  ASSERT_FALSE(contents.empty());
+
+  // Flip a byte in the data of each cached block
+  size_t num_files{0};
+
+  for (auto const& e : std::filesystem::directory_iterator(td.path())) {
+    std::fstream f(e.path(), std::ios::in | std::ios::out | std::ios::binary);
+    f.seekg(100);
+    auto const c = static_cast<char>(f.get() ^ 0x55);
+    f.seekp(100);
+    f.put(c);
+    ASSERT_TRUE(f.good()) << e.path();
+    ++num_files;
+  }
+
+  ASSERT_GT(num_files, 0);
+
+  test::test_logger lgr(logger::VERBOSE);
+
+  {
+    reader::filesystem_v2 fs(lgr, real_os, mm, opts);
+
+    for (auto const& [inode, data] : contents) {
+      EXPECT_EQ(data, fs.read_string(inode)) << inode;
+    }
+  }
+
+  auto const& log = lgr.get_log();
+  auto it = std::ranges::find_if(log, [](auto const& e) {
+    return e.output.starts_with("blocks loaded from disk: ");
+  });
+
+  ASSERT_NE(log.end(), it) << lgr.as_string();
+  EXPECT_EQ("blocks loaded from disk: 0", it->output);
+}
+
+TEST(block_cache, subframes) {
+  static constexpr size_t num_threads{4};
+  static constexpr size_t num_read_reqs{256};
+
+  auto [ref_os, ref_mm] = build_image();
+  auto [os, mm] = build_image({"--subframe-size=4k"});
+
+  test::test_logger lgr;
+  reader::filesystem_v2 ref_fs(lgr, *ref_os, ref_mm);
+  reader::filesystem_v2 fs(
+      lgr, *os, mm,
+      {.block_cache = {.max_bytes = 256 * 1024,
+                       .num_workers = 4,
+                       .decompress_ratio = 0.5}});
+
+  std::vector<std::pair<uint32_t, std::string>> files;
+
+  ref_fs.walk([&](auto e) {
+    auto iv = e.inode();
+    if (iv.is_regular_file()) {
+      files.emplace_back(iv.inode_num(), ref_fs.read_string(iv.inode_num()));
+    }
+  });
+
+  ASSERT_FALSE(files.empty());
+
+  // Older readers must reject images with framed blocks up front
+  EXPECT_EQ(MINOR_VERSION, ref_fs.version().minor);
+  EXPECT_EQ(MINOR_VERSION_FRAMED, fs.version().minor);
+
+  std::vector<std::thread> threads;
+  std::vector<size_t> mismatches(num_threads);
+
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937_64 rng{t};
+      for (size_t i = 0; i < num_read_reqs; ++i) {
+        auto const& [inode, data] = files[rng() % files.size()];
+        if (data.empty()) {
+          continue;
+        }
+        auto const offset = rng() % data.size();
+        auto const size = rng() % (data.size() - offset) + 1;
+        if (fs.read_string(inode, size, offset) != data.substr(offset, size)) {
+          ++mismatches[t];
+        }
+      }
+    });
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (size_t t = 0; t < num_threads; ++t) {
+    EXPECT_EQ(0, mismatches[t]) << t;
+  }
+
+  for (auto const& [inode, data] : files) {
+    EXPECT_EQ(data, fs.read_string(inode)) << inode;
+  }
+}
+
+TEST(block_cache, shared_arena) {
+  auto [os, mm] = build_image();
+
+  auto arena = std::make_shared<reader::block_cache_arena>(
+      reader::block_cache_arena_options{.max_bytes = 256 * 1024});
+
+  reader::filesystem_options const opts{
+      .block_cache = {.num_workers = 2},
+      .block_cache_arena = arena,
+  };
+
+  test::test_logger lgr;
+  std::map<uint32_t, std::string> contents;
+
+  {
+    reader::filesystem_v2 fs1(lgr, *os, mm, opts);
+    reader::filesystem_v2 fs2(lgr, *os, mm, opts);
+
+    EXPECT_EQ(2, arena->num_images());
+
+    fs1.walk([&](auto e) {
+      auto iv = e.inode();
+      if (iv.is_regular_file()) {
+        contents[iv.inode_num()] = fs1.read_string(iv.inode_num());
+      }
+    });
+
+    ASSERT_FALSE(contents.empty());
+
+    std::vector<std::thread> threads;
+
+    for (auto const* fs : {&fs1, &fs2}) {
+      threads.emplace_back([&, fs] {
+        for (auto const& [inode, data] : contents) {
+          EXPECT_EQ(data, fs->read_string(inode)) << inode;
+        }
+      });
+    }
+
+    for (auto& t : threads) {
+      t.join();
+    }
+
+    EXPECT_GT(arena->cached_bytes(), 0);
+    EXPECT_LE(arena->cached_bytes(), arena->max_bytes());
+  }
+
+  EXPECT_EQ(0, arena->num_images());
+  EXPECT_EQ(0, arena->cached_bytes());
+}
+
+TEST(block_cache, trace_replay) {
+  auto [os, mm] = build_image();
+
+  temporary_directory const td("dwarfs");
+  auto const trace_file = td.path() / "image.trace";
+
+  reader::filesystem_options const opts{
+      .block_cache = {.max_bytes = 1024 * 1024, .num_workers = 2},
+  };
+
+  std::map<uint32_t, std::string> contents;
+  size_t num_blocks{0};
+
+  {
+    test::test_logger lgr;
+    reader::filesystem_v2 fs(lgr, *os, mm, opts);
+    num_blocks = fs.num_blocks();
+
+    fs.record_block_trace(trace_file);
+
+    fs.walk([&](auto e) {
+      auto iv = e.inode();
+      if (iv.is_regular_file() && contents.size() < 20) {
+        contents[iv.inode_num()] = fs.read_string(iv.inode_num());
+      }
+    });
+  }
+
+  ASSERT_FALSE(contents.empty());
+
+  auto const trace = reader::internal::block_access_trace::read(trace_file);
+  EXPECT_EQ(num_blocks, trace.num_blocks);
+  EXPECT_FALSE(trace.entries.empty());
+  EXPECT_LE(trace.entries.size(), num_blocks);
+
+  test::test_logger lgr(logger::VERBOSE);
+
+  {
+    reader::filesystem_v2 fs(lgr, *os, mm, opts);
+
+    fs.cache_blocks_from_trace(trace_file);
+
+    for (auto const& [inode, data] : contents) {
+      EXPECT_EQ(data, fs.read_string(inode)) << inode;
+    }
+  }
+
+  auto const& log = lgr.get_log();
+  auto it = std::ranges::find_if(log, [](auto const& e) {
+    return e.output.starts_with("blocks preloaded: ");
+  });
+
+  ASSERT_NE(log.end(), it) << lgr.as_string();
+  EXPECT_NE("blocks preloaded: 0", it->output);
+
+  // A trace recorded for a different image must be rejected
+  auto const other_trace = td.path() / "other.trace";
+  reader::internal::block_access_recorder(other_trace, num_blocks + 1)
+      .record(0);
+
+  reader::filesystem_v2 fs(lgr, *os, mm, opts);
+
+  EXPECT_THAT([&] { fs.cache_blocks_from_trace(other_trace); },
+              ::testing::ThrowsMessage<dwarfs::runtime_error>(
+                  ::testing::HasSubstr("different file system")));
+}
@@ -0,0 +1,157 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include <cstddef>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <dwarfs/reader/internal/block_prefetcher.h>
+
+using namespace dwarfs::reader::internal;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace {
+
+constexpr size_t kUnlimited{1000};
+
+std::vector<size_t>
+access(block_prefetcher& pf, size_t block_no,
+       block_access_result result = block_access_result::MISS,
+       size_t capacity = kUnlimited) {
+  block_prefetcher::block_list list;
+  pf.access(block_no, result, capacity, list);
+  return {list.begin(), list.end()};
+}
+
+} // namespace
+
+TEST(block_prefetcher_test, sequential) {
+  block_prefetcher pf({.threshold = 3, .max_depth = 8});
+  pf.set_block_count(100);
+
+  EXPECT_THAT(access(pf, 10), IsEmpty());
+  EXPECT_THAT(access(pf, 10), IsEmpty());
+  EXPECT_THAT(access(pf, 11), IsEmpty());
+  EXPECT_THAT(access(pf, 12), ElementsAre(13));
+
+  // prefetched block was ready, depth stays the same
+  EXPECT_THAT(access(pf, 13, block_access_result::CACHE_HIT), ElementsAre(14));
+
+  // prefetched block was still in flight, depth is doubled
+  EXPECT_THAT(access(pf, 14, block_access_result::IN_FLIGHT),
+              ElementsAre(15, 16));
+  EXPECT_THAT(access(pf, 15, block_access_result::IN_FLIGHT),
+              ElementsAre(17, 18, 19));
+  EXPECT_THAT(access(pf, 16, block_access_result::IN_FLIGHT),
+              ElementsAre(20, 21, 22, 23, 24));
+
+  // depth is limited by max_depth
+  EXPECT_THAT(access(pf, 17, block_access_result::IN_FLIGHT), ElementsAre(25));
+
+  // prefetched block was evicted, depth is halved
+  EXPECT_THAT(access(pf, 18, block_access_result::MISS), IsEmpty());
+  EXPECT_THAT(access(pf, 19, block_access_result::CACHE_HIT), IsEmpty());
+
+  auto const st = pf.get_stats();
+  EXPECT_EQ(1, st.streams_detected);
+  EXPECT_EQ(13, st.prefetches_issued);
+  EXPECT_EQ(2, st.prefetch_hits);
+  EXPECT_EQ(4, st.late_prefetches);
+  EXPECT_EQ(1, st.evicted_prefetches);
+  EXPECT_EQ(1, st.max_depth_reached);
+}
+
+TEST(block_prefetcher_test, strided) {
+  block_prefetcher pf({.threshold = 3, .max_depth = 4});
+  pf.set_block_count(30);
+
+  EXPECT_THAT(access(pf, 0), IsEmpty());
+  EXPECT_THAT(access(pf, 5), IsEmpty());
+  EXPECT_THAT(access(pf, 10), ElementsAre(15));
+  EXPECT_THAT(access(pf, 15, block_access_result::IN_FLIGHT),
+              ElementsAre(20, 25));
+
+  // never prefetch beyond the last block
+  EXPECT_THAT(access(pf, 20, block_access_result::IN_FLIGHT), IsEmpty());
+}
+
+TEST(block_prefetcher_test, interleaved_streams) {
+  block_prefetcher pf({.threshold = 3, .max_depth = 4});
+  pf.set_block_count(100);
+
+  EXPECT_THAT(access(pf, 0), IsEmpty());
+  EXPECT_THAT(access(pf, 10), IsEmpty());
+  EXPECT_THAT(access(pf, 1), IsEmpty());
+  EXPECT_THAT(access(pf, 11), IsEmpty());
+  EXPECT_THAT(access(pf, 2), IsEmpty());
+  EXPECT_THAT(access(pf, 12), ElementsAre(13));
+  EXPECT_THAT(access(pf, 3), ElementsAre(4));
+  EXPECT_THAT(access(pf, 13, block_access_result::CACHE_HIT), ElementsAre(14));
+  EXPECT_THAT(access(pf, 4, block_access_result::CACHE_HIT), ElementsAre(5));
+
+  EXPECT_EQ(2, pf.get_stats().streams_detected);
+}
+
+TEST(block_prefetcher_test, random_access) {
+  block_prefetcher pf({.threshold = 2, .max_streams = 4});
+  pf.set_block_count(1000);
+
+  for (size_t block_no : {500, 20, 730, 110, 999, 0, 340, 260, 870, 480}) {
+    EXPECT_THAT(access(pf, block_no), IsEmpty());
+  }
+
+  EXPECT_EQ(0, pf.get_stats().streams_detected);
+}
+
+TEST(block_prefetcher_test, threshold_one) {
+  block_prefetcher pf({.threshold = 1, .max_depth = 4});
+  pf.set_block_count(100);
+
+  EXPECT_THAT(access(pf, 42), ElementsAre(43));
+  EXPECT_THAT(access(pf, 7), ElementsAre(8));
+  EXPECT_THAT(access(pf, 43, block_access_result::IN_FLIGHT),
+              ElementsAre(44, 45));
+
+  EXPECT_EQ(2, pf.get_stats().streams_detected);
+}
+
+TEST(block_prefetcher_test, limited_capacity) {
+  block_prefetcher pf({.threshold = 2, .max_depth = 8});
+  pf.set_block_count(100);
+
+  EXPECT_THAT(access(pf, 0), IsEmpty());
+  EXPECT_THAT(access(pf, 1, block_access_result::MISS, 0), IsEmpty());
+
+  // the stream overtook its prefetches, so the depth is increased
+  EXPECT_THAT(access(pf, 2, block_access_result::MISS, 1), ElementsAre(3));
+  EXPECT_THAT(access(pf, 3, block_access_result::CACHE_HIT, 8),
+              ElementsAre(4, 5));
+}
@@ -78,6 +78,14 @@ TEST(block_range, uncompressed) {
     reader::block_range range{data.data(), 10, 20};
     EXPECT_EQ(range.size(), 20);
     EXPECT_TRUE(std::equal(range.begin(), range.end(), data.begin() + 10));
+    EXPECT_FALSE(range.image_offset().has_value());
+  }
+
+  {
+    reader::block_range range{data.data(), 10, 20, 4096};
+    EXPECT_EQ(range.size(), 20);
+    EXPECT_TRUE(std::equal(range.begin(), range.end(), data.begin() + 10));
+    EXPECT_EQ(range.image_offset(), 4106);
   }
 
   EXPECT_THAT([] { reader::block_range range(nullptr, 0, 0); },
@@ -161,6 +161,24 @@ TEST(byte_buffer_test, block_cache_byte_buffer_mmap) {
   EXPECT_EQ(shared.span().size(), 12);
 }
 
+TEST(byte_buffer_test, block_cache_byte_buffer_hugepage) {
+  using namespace dwarfs::reader;
+  dwarfs::test::os_access_mock os;
+  auto factory = internal::block_cache_byte_buffer_factory::create(
+      os, block_cache_allocation_mode::HUGEPAGE);
+  auto buf = factory.create_mutable_fixed_reserve(4 << 20);
+
+  EXPECT_TRUE(buf);
+  EXPECT_TRUE(buf.empty());
+  EXPECT_EQ(buf.capacity(), 4 << 20);
+
+  buf.append("Hello, World!", 13);
+
+  EXPECT_EQ(buf.size(), 13);
+  EXPECT_EQ(std::string_view(reinterpret_cast<char const*>(buf.data()), 13),
+            "Hello, World!");
+}
+
 TEST(byte_buffer_test, mapped_byte_buffer) {
   static constexpr std::string_view test_data = "Hello, World!";
 
@@ -111,7 +111,8 @@ void PackParamsDirs(benchmark_type* b) {
 std::string
 make_filesystem(::benchmark::State const* state,
                 std::shared_ptr<os_access> os = nullptr,
-                writer::segmenter_factory::config const* segcfg = nullptr) {
+                writer::segmenter_factory::config const* segcfg = nullptr,
+                bool complete_size_cache = false) {
   writer::segmenter_factory::config cfg;
   writer::scanner_options options;
 
@@ -137,6 +138,7 @@ make_filesystem(::benchmark::State const* state,
   options.metadata.force_pack_string_tables = true;
   options.metadata.plain_names_table = state ? state->range(1) : false;
   options.metadata.plain_symlinks_table = state ? state->range(1) : false;
+  options.metadata.complete_inode_size_cache = complete_size_cache;
 
   test::test_logger lgr;
 
@@ -241,7 +243,7 @@ class filesystem : public ::benchmark::Fixture {
   static constexpr size_t NUM_ENTRIES = 8;
 
   void SetUp(::benchmark::State const& state) override {
-    image = make_filesystem(&state);
+    image = make_filesystem(&state, nullptr, nullptr, complete_size_cache_);
     mm = test::make_mock_file_view(image);
     reader::filesystem_options opts;
     opts.block_cache.max_bytes = 1 << 20;
@@ -347,6 +349,9 @@ class filesystem : public ::benchmark::Fixture {
   std::unique_ptr<reader::filesystem_v2> fs;
   std::vector<reader::inode_view> inode_views;
 
+ protected:
+  bool complete_size_cache_{false};
+
  private:
   test::test_logger lgr;
   test::os_access_mock os;
@@ -354,6 +359,11 @@ class filesystem : public ::benchmark::Fixture {
   file_view mm;
 };
 
+class filesystem_size_table : public filesystem {
+ public:
+  filesystem_size_table() { complete_size_cache_ = true; }
+};
+
 class filesystem_walk : public ::benchmark::Fixture {
  public:
   void SetUp(::benchmark::State const&) override {
@@ -547,6 +557,30 @@ BENCHMARK_DEFINE_F(filesystem, getattr_file_large_nosize)
   getattr_bench(state, {.no_size = true}, paths);
 }
 
+BENCHMARK_DEFINE_F(filesystem, getattr_file_sparse)(::benchmark::State& state) {
+  std::array<std::string_view, 1> paths{{"/sparse/file512.bin"}};
+  getattr_bench(state, paths);
+}
+
+BENCHMARK_DEFINE_F(filesystem_size_table, getattr_file)
+(::benchmark::State& state) {
+  std::array<std::string_view, 4> paths{
+      {"/foo.pl", "/bar.pl", "/baz.pl", "/somedir/ipsum.py"}};
+  getattr_bench(state, paths);
+}
+
+BENCHMARK_DEFINE_F(filesystem_size_table, getattr_file_large)
+(::benchmark::State& state) {
+  std::array<std::string_view, 1> paths{{"/ipsum.txt"}};
+  getattr_bench(state, paths);
+}
+
+BENCHMARK_DEFINE_F(filesystem_size_table, getattr_file_sparse)
+(::benchmark::State& state) {
+  std::array<std::string_view, 1> paths{{"/sparse/file512.bin"}};
+  getattr_bench(state, paths);
+}
+
 BENCHMARK_DEFINE_F(filesystem, getattr_link)(::benchmark::State& state) {
   std::array<std::string_view, 2> paths{{"/somelink", "/somedir/bad"}};
   getattr_bench(state, paths);
@@ -763,6 +797,13 @@ BENCHMARK_REGISTER_F(filesystem, getattr_file_nosize)->Apply(PackParamsNone);
 BENCHMARK_REGISTER_F(filesystem, getattr_file_large)->Apply(PackParamsNone);
 BENCHMARK_REGISTER_F(filesystem, getattr_file_large_nosize)
     ->Apply(PackParamsNone);
+BENCHMARK_REGISTER_F(filesystem, getattr_file_sparse)->Apply(PackParamsNone);
+BENCHMARK_REGISTER_F(filesystem_size_table, getattr_file)
+    ->Apply(PackParamsNone);
+BENCHMARK_REGISTER_F(filesystem_size_table, getattr_file_large)
+    ->Apply(PackParamsNone);
+BENCHMARK_REGISTER_F(filesystem_size_table, getattr_file_sparse)
+    ->Apply(PackParamsNone);
 BENCHMARK_REGISTER_F(filesystem, getattr_dev)->Apply(PackParamsNone);
 BENCHMARK_REGISTER_F(filesystem, getattr_dev_nosize)->Apply(PackParamsNone);
 BENCHMARK_REGISTER_F(filesystem, access_F_OK)->Apply(PackParamsNone);
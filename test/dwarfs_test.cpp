@@ -1911,7 +1911,10 @@ TEST(filesystem, read) {
   EXPECT_EQ(ec.value(), EINVAL);
 }
 
-TEST(filesystem, inode_size_cache) {
+class inode_size_cache_test : public testing::TestWithParam<bool> {};
+
+TEST_P(inode_size_cache_test, file_sizes) {
+  auto const complete = GetParam();
   std::mt19937_64 rng;
   constexpr size_t kNumFragments{1000};
   constexpr size_t kNumFiles{100};
@@ -1958,6 +1961,7 @@ TEST(filesystem, inode_size_cache) {
 
   writer::scanner_options options;
   options.metadata.inode_size_cache_min_chunk_count = 32;
+  options.metadata.complete_inode_size_cache = complete;
 
   writer::segmenter::config cfg;
   cfg.block_size_bits = 16;
@@ -1980,9 +1984,12 @@ TEST(filesystem, inode_size_cache) {
     auto iv = dev->inode();
     auto st = fs.getattr(iv);
     EXPECT_EQ(st.size(), size);
+    EXPECT_EQ(st.allocated_size(), size);
   }
 }
 
+INSTANTIATE_TEST_SUITE_P(filesystem, inode_size_cache_test, ::testing::Bool());
+
 TEST(filesystem, multi_image) {
   test::test_logger lgr;
   std::string data("header");
@@ -0,0 +1,118 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dwarfs/internal/elias_fano.h>
+
+using namespace dwarfs::internal;
+
+TEST(elias_fano, empty) {
+  elias_fano ef;
+
+  EXPECT_TRUE(ef.empty());
+  EXPECT_EQ(ef.size(), 0);
+  EXPECT_TRUE(ef.unpack().empty());
+
+  elias_fano ef2{std::span<uint32_t const>{}};
+  EXPECT_TRUE(ef2.empty());
+}
+
+TEST(elias_fano, basic) {
+  std::vector<uint32_t> const values{3, 3, 7, 10, 10, 10, 42, 100, 1000};
+  elias_fano ef(values);
+
+  ASSERT_EQ(ef.size(), values.size());
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(ef[i], values[i]) << i;
+  }
+
+  EXPECT_EQ(ef.unpack(), values);
+}
+
+TEST(elias_fano, constant) {
+  std::vector<uint32_t> const values(1000, 12345);
+  elias_fano ef(values);
+
+  EXPECT_EQ(ef.low_bits(), 0);
+  EXPECT_EQ(ef[0], 12345);
+  EXPECT_EQ(ef[999], 12345);
+  EXPECT_EQ(ef.unpack(), values);
+}
+
+TEST(elias_fano, builder) {
+  elias_fano::builder b(3, 10, 20);
+
+  b.push_back(10);
+  b.push_back(15);
+  b.push_back(20);
+
+  auto ef = b.build();
+
+  EXPECT_EQ(ef.unpack(), (std::vector<uint32_t>{10, 15, 20}));
+}
+
+TEST(elias_fano, random) {
+  std::mt19937_64 rng(42);
+
+  for (auto max_delta : {1U, 2U, 17U, 1000U, 1U << 20}) {
+    for (auto size : {1UL, 63UL, 64UL, 65UL, 1000UL, 100000UL}) {
+      std::uniform_int_distribution<uint32_t> dist(0, max_delta);
+      std::vector<uint32_t> values;
+      uint64_t v = dist(rng);
+
+      for (size_t i = 0; i < size && v <= UINT32_MAX; ++i) {
+        values.push_back(static_cast<uint32_t>(v));
+        v += dist(rng);
+      }
+
+      elias_fano ef(values);
+
+      ASSERT_EQ(ef.size(), values.size());
+      EXPECT_EQ(ef.unpack(), values);
+
+      for (size_t i = 0; i < values.size(); ++i) {
+        ASSERT_EQ(ef[i], values[i]) << max_delta << "/" << size << "/" << i;
+      }
+
+      EXPECT_LE(ef.size_in_bytes(),
+                values.size() * (ef.low_bits() + 4) / 8 + 64);
+    }
+  }
+}
+
+TEST(elias_fano, full_range) {
+  std::vector<uint32_t> const values{0, 1, UINT32_MAX / 2, UINT32_MAX - 1,
+                                     UINT32_MAX};
+  elias_fano ef(values);
+
+  EXPECT_EQ(ef.unpack(), values);
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(ef[i], values[i]) << i;
+  }
+}
@@ -0,0 +1,254 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <dwarfs/reader/internal/eviction_cache.h>
+
+namespace {
+
+using dwarfs::reader::block_cache_eviction_policy;
+using dwarfs::reader::internal::eviction_cache;
+using dwarfs::reader::internal::frequency_sketch;
+using dwarfs::reader::internal::make_eviction_policy;
+
+using cache_type = eviction_cache<int, std::string>;
+
+cache_type make_cache(size_t size, block_cache_eviction_policy policy) {
+  return cache_type(size, make_eviction_policy<int>(policy));
+}
+
+// Simulate a cache and return the hit ratio
+double hit_ratio(block_cache_eviction_policy policy, size_t size,
+                 std::vector<int> const& trace) {
+  eviction_cache<int, int> cache(size, make_eviction_policy<int>(policy));
+  size_t hits = 0;
+
+  for (auto key : trace) {
+    if (cache.find(key) != cache.end()) {
+      ++hits;
+    } else {
+      cache.set(key, key);
+    }
+  }
+
+  return static_cast<double>(hits) / static_cast<double>(trace.size());
+}
+
+class eviction_cache_test
+    : public ::testing::TestWithParam<block_cache_eviction_policy> {};
+
+} // namespace
+
+TEST_P(eviction_cache_test, insert_and_retrieve) {
+  auto cache = make_cache(3, GetParam());
+
+  cache.set(1, "one");
+  cache.set(2, "two");
+  cache.set(3, "three");
+
+  ASSERT_EQ(cache.size(), 3);
+  EXPECT_EQ(cache.find(1)->second, "one");
+  EXPECT_EQ(cache.find(2)->second, "two");
+  EXPECT_EQ(cache.find(3)->second, "three");
+  EXPECT_EQ(cache.find(4), cache.end());
+
+  cache.set(2, "zwei");
+  EXPECT_EQ(cache.size(), 3);
+  EXPECT_EQ(cache.find(2)->second, "zwei");
+}
+
+TEST_P(eviction_cache_test, size_is_bounded) {
+  auto cache = make_cache(10, GetParam());
+  std::vector<int> evicted;
+
+  cache.set_prune_hook(
+      [&evicted](int key, std::string&&) { evicted.push_back(key); });
+
+  for (int i = 0; i < 100; ++i) {
+    cache.set(i, std::to_string(i));
+    ASSERT_LE(cache.size(), 10);
+  }
+
+  EXPECT_EQ(evicted.size(), 90);
+
+  for (auto key : evicted) {
+    EXPECT_EQ(cache.find(key, false), cache.end()) << key;
+  }
+
+  cache.set_max_size(4);
+  EXPECT_EQ(cache.size(), 4);
+  EXPECT_EQ(evicted.size(), 96);
+}
+
+TEST_P(eviction_cache_test, erase_and_evict) {
+  auto cache = make_cache(5, GetParam());
+  std::vector<int> evicted;
+
+  for (int i = 0; i < 5; ++i) {
+    cache.set(i, std::to_string(i));
+  }
+
+  auto it = cache.erase(cache.find(2, false), [&](int key, std::string&& v) {
+    evicted.push_back(key);
+    EXPECT_EQ(v, "2");
+  });
+
+  EXPECT_EQ(cache.size(), 4);
+  EXPECT_THAT(evicted, ::testing::ElementsAre(2));
+
+  // erase() returns an iterator to the next element
+  size_t remaining = 0;
+  for (; it != cache.end(); ++it) {
+    ++remaining;
+  }
+  EXPECT_LE(remaining, 4);
+
+  while (!cache.empty()) {
+    cache.evict([&](int key, std::string&&) { evicted.push_back(key); });
+  }
+
+  EXPECT_THAT(evicted, ::testing::UnorderedElementsAre(0, 1, 2, 3, 4));
+
+  // evicting from an empty cache is a no-op
+  cache.evict();
+  EXPECT_TRUE(cache.empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    eviction_cache, eviction_cache_test,
+    ::testing::Values(block_cache_eviction_policy::LRU,
+                      block_cache_eviction_policy::TINYLFU));
+
+TEST(eviction_cache, lru_order) {
+  auto cache = make_cache(3, block_cache_eviction_policy::LRU);
+
+  EXPECT_EQ(cache.policy_name(), "lru");
+
+  cache.set(1, "one");
+  cache.set(2, "two");
+  cache.set(3, "three");
+
+  // promote key 1, so key 2 is the least recently used one
+  cache.find(1);
+  cache.set(4, "four");
+
+  EXPECT_EQ(cache.find(2, false), cache.end());
+  EXPECT_NE(cache.find(1, false), cache.end());
+  EXPECT_NE(cache.find(3, false), cache.end());
+  EXPECT_NE(cache.find(4, false), cache.end());
+}
+
+TEST(eviction_cache, tinylfu_is_scan_resistant) {
+  static constexpr int kCacheSize{100};
+  static constexpr int kHotKeys{50};
+
+  auto lru = make_cache(kCacheSize, block_cache_eviction_policy::LRU);
+  auto tlfu = make_cache(kCacheSize, block_cache_eviction_policy::TINYLFU);
+
+  EXPECT_EQ(tlfu.policy_name(), "tinylfu");
+
+  for (auto* cache : {&lru, &tlfu}) {
+    // establish a frequently used working set
+    for (int round = 0; round < 10; ++round) {
+      for (int key = 0; key < kHotKeys; ++key) {
+        if (cache->find(key) == cache->end()) {
+          cache->set(key, "hot");
+        }
+      }
+    }
+
+    // now scan through lots of keys exactly once
+    for (int key = 1000; key < 11000; ++key) {
+      cache->set(key, "scan");
+    }
+  }
+
+  auto count_hot = [](cache_type& cache) {
+    int hot = 0;
+    for (int key = 0; key < kHotKeys; ++key) {
+      if (cache.find(key, false) != cache.end()) {
+        ++hot;
+      }
+    }
+    return hot;
+  };
+
+  EXPECT_EQ(count_hot(lru), 0);
+  EXPECT_GE(count_hot(tlfu), kHotKeys * 9 / 10);
+}
+
+TEST(eviction_cache, tinylfu_improves_mixed_workload_hit_ratio) {
+  static constexpr size_t kCacheSize{200};
+
+  std::mt19937_64 rng{42};
+  std::uniform_int_distribution<int> hot_dist(0, 149);
+  std::vector<int> trace;
+  int scan_key = 100000;
+
+  // random accesses to a working set that fits in the cache,
+  // interrupted by sequential scans over cold data
+  for (int phase = 0; phase < 20; ++phase) {
+    for (int i = 0; i < 2000; ++i) {
+      trace.push_back(hot_dist(rng));
+    }
+    for (int i = 0; i < 1000; ++i) {
+      trace.push_back(scan_key++);
+    }
+  }
+
+  auto lru = hit_ratio(block_cache_eviction_policy::LRU, kCacheSize, trace);
+  auto tlfu =
+      hit_ratio(block_cache_eviction_policy::TINYLFU, kCacheSize, trace);
+
+  // at most 2/3 of all accesses can be hits
+  EXPECT_GT(tlfu, 0.65) << "tinylfu=" << tlfu;
+  EXPECT_GT(tlfu, lru + 0.03) << "lru=" << lru << ", tinylfu=" << tlfu;
+}
+
+TEST(eviction_cache, frequency_sketch) {
+  frequency_sketch<int> sketch(64);
+
+  for (int i = 0; i < 5; ++i) {
+    sketch.increment(42);
+  }
+
+  sketch.increment(43);
+
+  EXPECT_GE(sketch.frequency(42), 5);
+  EXPECT_GE(sketch.frequency(43), 1);
+  EXPECT_LT(sketch.frequency(43), sketch.frequency(42));
+
+  // counters saturate
+  for (int i = 0; i < 100; ++i) {
+    sketch.increment(7);
+  }
+
+  EXPECT_LE(sketch.frequency(7), frequency_sketch<int>::kMaxCount);
+}
@@ -21,6 +21,10 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -189,3 +193,31 @@ TEST(file_utils, file_stat_symlink) {
     EXPECT_EQ(13, st.size());
   }
 }
+
+TEST(file_utils, replace_file) {
+  using namespace dwarfs;
+
+  temporary_directory td("dwarfs");
+  auto const path = td.path() / "file";
+  std::error_code ec;
+
+  write_file(path, "old");
+
+  replace_file(path, ".tmp", [](std::ostream& os) { os << "new"; }, ec);
+  EXPECT_FALSE(ec) << ec.message();
+  EXPECT_EQ("new", read_file(path));
+
+  EXPECT_THROW(replace_file(
+                   path, ".tmp",
+                   [](std::ostream&) { throw std::runtime_error("fail"); }, ec),
+               std::runtime_error);
+  EXPECT_EQ("new", read_file(path));
+
+  replace_file(td.path() / "missing" / "file", ".tmp",
+               [](std::ostream& os) { os << "new"; }, ec);
+  EXPECT_TRUE(ec);
+
+  // no temporary files are left behind
+  EXPECT_EQ(1, std::distance(fs::directory_iterator(td.path()),
+                             fs::directory_iterator()));
+}
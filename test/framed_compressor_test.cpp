@@ -0,0 +1,189 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dwarfs/binary_literals.h>
+#include <dwarfs/block_compressor.h>
+#include <dwarfs/block_decompressor.h>
+#include <dwarfs/malloc_byte_buffer.h>
+
+#include "loremipsum.h"
+#include "test_helpers.h"
+
+using namespace dwarfs;
+using namespace dwarfs::binary_literals;
+
+namespace {
+
+constexpr size_t kSubframeSize{16_KiB};
+
+// Compressible text with a chunk of random data in the middle, so some
+// sub-frames will end up stored uncompressed. The size is deliberately
+// not a multiple of the sub-frame size.
+shared_byte_buffer make_test_data() {
+  std::mt19937_64 rng{42};
+  auto data = loremipsum(128_KiB);
+  data += test::create_random_string(64_KiB, rng);
+  data += loremipsum(64_KiB + 123);
+  return malloc_byte_buffer::create(data).share();
+}
+
+} // namespace
+
+TEST(framed_compressor, roundtrip) {
+  auto const data = make_test_data();
+  auto const bc = block_compressor("zstd:level=3").with_subframes(kSubframeSize);
+
+  EXPECT_EQ(compression_type::FRAMED, bc.type());
+
+  auto const compressed = bc.compress(data);
+
+  EXPECT_LT(compressed.size(), data.size());
+
+  auto const decompressed = block_decompressor::decompress(
+      compression_type::FRAMED, compressed.span());
+
+  EXPECT_EQ(data, decompressed);
+}
+
+TEST(framed_compressor, random_access) {
+  auto const data = make_test_data();
+  auto const compressed = block_compressor("zstd:level=3")
+                              .with_subframes(kSubframeSize)
+                              .compress(data);
+
+  block_decompressor bd(compression_type::FRAMED, compressed.span());
+
+  ASSERT_EQ((data.size() + kSubframeSize - 1) / kSubframeSize,
+            bd.num_subframes());
+  EXPECT_EQ(kSubframeSize, bd.subframe_size());
+  EXPECT_EQ(data.size(), bd.uncompressed_size());
+
+  auto const out = bd.start_decompression(malloc_byte_buffer::create());
+
+  ASSERT_EQ(data.size(), out.size());
+
+  std::vector<size_t> order(bd.num_subframes());
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::shuffle(order, std::mt19937_64{4711});
+
+  for (auto const i : order) {
+    bd.decompress_subframe(i);
+
+    auto const offset = i * kSubframeSize;
+    auto const size = std::min(kSubframeSize, data.size() - offset);
+
+    EXPECT_TRUE(std::ranges::equal(out.span().subspan(offset, size),
+                                   data.span().subspan(offset, size)))
+        << "sub-frame " << i;
+  }
+
+  EXPECT_EQ(data, out);
+}
+
+TEST(framed_compressor, parallel_decompression) {
+  auto const data = make_test_data();
+  auto const compressed = block_compressor("zstd:level=3")
+                              .with_subframes(kSubframeSize)
+                              .compress(data);
+
+  block_decompressor bd(compression_type::FRAMED, compressed.span());
+  auto const out = bd.start_decompression(malloc_byte_buffer::create());
+
+  static constexpr size_t kNumThreads{4};
+  std::vector<std::thread> threads;
+
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&bd, t] {
+      for (size_t i = t; i < bd.num_subframes(); i += kNumThreads) {
+        bd.decompress_subframe(i);
+      }
+    });
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  EXPECT_EQ(data, out);
+}
+
+TEST(framed_compressor, sequential_frames) {
+  auto const data = make_test_data();
+  auto const compressed = block_compressor("zstd:level=3")
+                              .with_subframes(kSubframeSize)
+                              .compress(data);
+
+  block_decompressor bd(compression_type::FRAMED, compressed.span());
+  auto const out = bd.start_decompression(malloc_byte_buffer::create());
+
+  while (!bd.decompress_frame(kSubframeSize)) {
+  }
+
+  EXPECT_EQ(data, out);
+}
+
+TEST(framed_compressor, invalid_options) {
+  block_compressor const bc("zstd");
+
+  EXPECT_THROW(bc.with_subframes(0), runtime_error);
+  EXPECT_THROW(bc.with_subframes(kSubframeSize).with_subframes(kSubframeSize),
+               runtime_error);
+  EXPECT_THROW(block_compressor("null").with_subframes(kSubframeSize),
+               runtime_error);
+}
+
+TEST(framed_compressor, corrupt_input) {
+  auto const data = make_test_data();
+  auto const compressed = block_compressor("zstd:level=3")
+                              .with_subframes(kSubframeSize)
+                              .compress(data);
+
+  auto const truncated = compressed.span().first(compressed.size() / 2);
+
+  EXPECT_THROW(block_decompressor(compression_type::FRAMED, truncated),
+               runtime_error);
+  EXPECT_THROW(
+      block_decompressor(compression_type::FRAMED, compressed.span().first(2)),
+      runtime_error);
+
+  auto invalid = malloc_byte_buffer::create(compressed.span());
+  invalid.data()[0] = static_cast<uint8_t>(compression_type::FRAMED);
+
+  EXPECT_THROW(block_decompressor(compression_type::FRAMED, invalid.span()),
+               runtime_error);
+}
@@ -1067,6 +1067,64 @@ TEST(fsst_test, basic) {
   }
 }
 
+TEST(fsst_test, scratch_buffer) {
+  auto const res = fsst_encoder::compress(test_strings);
+
+  ASSERT_TRUE(res.has_value());
+
+  auto const decoder = fsst_decoder{res->dictionary};
+  std::string scratch;
+
+  for (size_t i = 0; i < test_strings.size(); ++i) {
+    EXPECT_EQ(test_strings[i],
+              decoder.decompress(res->compressed_data[i], scratch));
+  }
+
+  // After the first pass, the scratch buffer is large enough for all
+  // strings and must not be reallocated again.
+  auto const* data = scratch.data();
+
+  for (size_t i = 0; i < test_strings.size(); ++i) {
+    auto const decompressed =
+        decoder.decompress(res->compressed_data[i], scratch);
+    EXPECT_EQ(test_strings[i], decompressed);
+    EXPECT_EQ(data, decompressed.data());
+  }
+}
+
+TEST(fsst_test, bulk_decompress) {
+  auto const res = fsst_encoder::compress(test_strings);
+
+  ASSERT_TRUE(res.has_value());
+
+  auto const decoder = fsst_decoder{res->dictionary};
+  std::string buffer;
+  std::vector<std::string_view> out;
+
+  decoder.decompress(res->compressed_data, buffer, out);
+
+  ASSERT_EQ(test_strings.size(), out.size());
+
+  for (size_t i = 0; i < test_strings.size(); ++i) {
+    EXPECT_EQ(test_strings[i], out[i]);
+  }
+
+  // decompress a subset, reusing the buffers
+  auto const subset = std::span(res->compressed_data).subspan(100, 50);
+
+  decoder.decompress(subset, buffer, out);
+
+  ASSERT_EQ(subset.size(), out.size());
+
+  for (size_t i = 0; i < subset.size(); ++i) {
+    EXPECT_EQ(test_strings[100 + i], out[i]);
+  }
+
+  decoder.decompress(std::span<std::string_view const>{}, buffer, out);
+
+  EXPECT_TRUE(out.empty());
+}
+
 TEST(fsst_random_test, random_strings) {
 #ifdef DWARFS_TEST_CROSS_COMPILE
   static constexpr int num_random_tests = 100;
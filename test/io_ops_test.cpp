@@ -277,6 +277,15 @@ TEST(io_ops, virtual_alloc_advise) {
   ops.advise(p, kSize, io_advice::dontneed, ec);
   EXPECT_NO_ERROR(ec);
 
+  // transparent huge pages may not be available
+  ops.advise(p, kSize, io_advice::hugepage, ec);
+  if (ec) {
+    EXPECT_TRUE(ec == std::errc::invalid_argument ||
+                ec == std::errc::operation_not_supported)
+        << ec.message();
+    ec.clear();
+  }
+
   ops.virtual_free(p, kSize, ec);
   EXPECT_NO_ERROR(ec);
 }
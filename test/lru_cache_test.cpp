@@ -163,3 +163,35 @@ TEST(lru_cache_test, clear_cache) {
   ASSERT_TRUE(cache.empty());
   ASSERT_EQ(cache.size(), 0);
 }
+
+TEST(lru_cache_test, explicit_eviction) {
+  lru_cache<int, std::string> cache(3);
+  std::vector<int> evicted_keys;
+
+  cache.set_prune_hook([&evicted_keys](int key, std::string&&) {
+    evicted_keys.push_back(key);
+  });
+
+  cache.set(1, "one");
+  cache.set(2, "two");
+  cache.set(3, "three");
+
+  // Promote key 1, so key 2 becomes the least recently used item
+  cache.find(1);
+
+  cache.evict_lru();
+
+  ASSERT_EQ(cache.size(), 2);
+  ASSERT_EQ(evicted_keys.size(), 1);
+  EXPECT_EQ(evicted_keys[0], 2);
+  EXPECT_EQ(cache.find(2), cache.end());
+
+  cache.evict_lru();
+  cache.evict_lru();
+
+  // Evicting from an empty cache is a no-op
+  cache.evict_lru();
+
+  ASSERT_TRUE(cache.empty());
+  EXPECT_THAT(evicted_keys, ::testing::ElementsAre(2, 3, 1));
+}
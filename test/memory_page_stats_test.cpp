@@ -0,0 +1,106 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <cstddef>
+#include <sstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dwarfs/internal/memory_page_stats.h>
+
+using namespace dwarfs::internal;
+
+namespace {
+
+constexpr std::string_view kSmaps = R"(00400000-00452000 r-xp 00000000 08:02 173521     /usr/bin/dbus-daemon
+Size:                328 kB
+KernelPageSize:        4 kB
+MMUPageSize:           4 kB
+Rss:                 328 kB
+AnonHugePages:         0 kB
+Locked:                0 kB
+7f0000000000-7f0000800000 rw-p 00000000 00:00 0
+Size:               8192 kB
+KernelPageSize:        4 kB
+MMUPageSize:           4 kB
+Rss:                6144 kB
+AnonHugePages:      4096 kB
+FilePmdMapped:         0 kB
+Locked:             8192 kB
+VmFlags: rd wr mr mw me ac hg
+7f0000800000-7f0000a00000 rw-p 00000000 00:00 0
+Size:               2048 kB
+KernelPageSize:        4 kB
+MMUPageSize:           4 kB
+Rss:                2048 kB
+AnonHugePages:         0 kB
+Locked:                0 kB
+)";
+
+} // namespace
+
+TEST(memory_page_stats, parse_full_mapping) {
+  std::istringstream iss{std::string{kSmaps}};
+  auto st = parse_memory_page_stats(iss, 0x7f0000000000, 0x7f0000800000,
+                                    2 << 20);
+
+  ASSERT_TRUE(st);
+  EXPECT_EQ(st->size, 8 << 20);
+  EXPECT_EQ(st->resident, 6 << 20);
+  EXPECT_EQ(st->huge, 4 << 20);
+  EXPECT_EQ(st->locked, 8 << 20);
+  EXPECT_EQ(st->page_size, 4096);
+  EXPECT_EQ(st->huge_page_size, 2 << 20);
+  EXPECT_EQ(st->tlb_entries(), 2 + 512);
+}
+
+TEST(memory_page_stats, parse_partial_mappings) {
+  std::istringstream iss{std::string{kSmaps}};
+  auto st = parse_memory_page_stats(iss, 0x7f0000400000, 0x7f0000900000,
+                                    2 << 20);
+
+  ASSERT_TRUE(st);
+  EXPECT_EQ(st->size, 5 << 20);
+  EXPECT_EQ(st->resident, (3 << 20) + (1 << 20));
+  EXPECT_EQ(st->huge, 2 << 20);
+  EXPECT_EQ(st->locked, 4 << 20);
+}
+
+TEST(memory_page_stats, parse_no_overlap) {
+  std::istringstream iss{std::string{kSmaps}};
+  EXPECT_FALSE(parse_memory_page_stats(iss, 0x1000, 0x2000, 2 << 20));
+}
+
+#ifdef __linux__
+TEST(memory_page_stats, self) {
+  std::vector<std::byte> data(1 << 20, std::byte{1});
+  auto st = get_memory_page_stats(data);
+
+  ASSERT_TRUE(st);
+  EXPECT_GE(st->size, data.size());
+  EXPECT_GT(st->resident, 0);
+  EXPECT_GT(st->page_size, 0);
+  EXPECT_GT(st->tlb_entries(), 0);
+}
+#endif
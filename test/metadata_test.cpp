@@ -21,9 +21,12 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>
 #include <array>
 #include <string_view>
 
+#include <boost/algorithm/string/case_conv.hpp>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -32,12 +35,15 @@
 #include <dwarfs/config.h>
 
 #include <dwarfs/block_compressor.h>
+#include <dwarfs/file_util.h>
 #include <dwarfs/file_view.h>
+#include <dwarfs/os_access_generic.h>
 #include <dwarfs/reader/filesystem_v2.h>
 #include <dwarfs/reader/fsinfo_options.h>
 #include <dwarfs/reader/metadata_options.h>
 #include <dwarfs/thread_pool.h>
 #include <dwarfs/thrift_lite/debug_writer.h>
+#include <dwarfs/vfs_stat.h>
 #include <dwarfs/writer/entry_factory.h>
 #include <dwarfs/writer/filesystem_writer.h>
 #include <dwarfs/writer/filesystem_writer_options.h>
@@ -85,6 +91,38 @@ auto rebuild_metadata(logger& lgr, thrift::metadata::metadata const& md,
       metadata_builder(lgr, md, fs_options, fs_version, options).build());
 }
 
+file_view build_image(logger& lgr, os_access const& os,
+                      writer::metadata_options const& metadata = {}) {
+  writer::writer_progress prog;
+
+  writer::segmenter_factory::config sf_cfg;
+  sf_cfg.blockhash_window_size.set_default(9);
+  sf_cfg.window_increment_shift.set_default(1);
+  sf_cfg.max_active_blocks.set_default(1);
+  sf_cfg.bloom_filter_size.set_default(4);
+  sf_cfg.block_size_bits = 12;
+  writer::segmenter_factory sf(lgr, prog, sf_cfg);
+
+  writer::entry_factory ef;
+
+  thread_pool pool(lgr, os, "worker", 4);
+
+  writer::scanner_options options;
+  options.metadata = metadata;
+  options.metadata.no_create_timestamp = true;
+  writer::scanner s(lgr, pool, sf, ef, os, options);
+
+  block_compressor bc("null");
+  std::ostringstream oss;
+
+  writer::filesystem_writer fsw(oss, lgr, pool, prog, {});
+  fsw.add_default_compressor(bc);
+
+  s.scan(fsw, std::filesystem::path("/"), prog);
+
+  return test::make_mock_file_view(oss.str());
+}
+
 template <typename T>
 std::string debug(T const& t) {
   std::ostringstream oss;
@@ -112,33 +150,7 @@ class metadata_test : public ::testing::Test {
              static_cast<file_stat::off_type>(libc.size()), 0, 100, 200, 300},
             libc);
 
-    writer::writer_progress prog;
-
-    writer::segmenter_factory::config sf_cfg;
-    sf_cfg.blockhash_window_size.set_default(9);
-    sf_cfg.window_increment_shift.set_default(1);
-    sf_cfg.max_active_blocks.set_default(1);
-    sf_cfg.bloom_filter_size.set_default(4);
-    sf_cfg.block_size_bits = 12;
-    writer::segmenter_factory sf(lgr, prog, sf_cfg);
-
-    writer::entry_factory ef;
-
-    thread_pool pool(lgr, *os, "worker", 4);
-
-    writer::scanner_options options;
-    options.metadata.no_create_timestamp = true;
-    writer::scanner s(lgr, pool, sf, ef, *os, options);
-
-    block_compressor bc("null");
-    std::ostringstream oss;
-
-    writer::filesystem_writer fsw(oss, lgr, pool, prog, {});
-    fsw.add_default_compressor(bc);
-
-    s.scan(fsw, std::filesystem::path("/"), prog);
-
-    mm = test::make_mock_file_view(oss.str());
+    mm = build_image(lgr, *os);
   }
 
   void TearDown() override {}
@@ -197,6 +209,449 @@ TEST_F(metadata_test, basic) {
   }
 }
 
+class lookup_index_test
+    : public ::testing::TestWithParam<std::tuple<size_t, bool>> {};
+
+TEST_P(lookup_index_test, find) {
+  auto const [min_entries, case_insensitive] = GetParam();
+  static constexpr size_t num_files{1000};
+
+  test::test_logger lgr;
+  auto os = test::os_access_mock::create_test_instance();
+
+  os->add_dir("big");
+
+  for (size_t i = 0; i < num_files; ++i) {
+    os->add_file(fmt::format("big/File{}", i), fmt::format("{}", i));
+  }
+
+  auto const mm = build_image(lgr, *os);
+
+  reader::filesystem_v2 fs(
+      lgr, *os, mm,
+      {.metadata = {.case_insensitive_lookup = case_insensitive,
+                    .lookup_index_min_entries = min_entries}});
+
+  std::string scratch;
+
+  for (size_t i = 0; i < num_files; i += 7) {
+    auto const name = fmt::format("File{}", i);
+    auto const dev = fs.find("/big/" + name);
+    ASSERT_TRUE(dev) << name;
+    EXPECT_EQ(name, dev->name());
+    EXPECT_EQ(name, dev->name(scratch));
+
+    auto const folded = fmt::format("/big/file{}", i);
+    EXPECT_EQ(case_insensitive, fs.find(folded).has_value()) << folded;
+  }
+
+  EXPECT_FALSE(fs.find("/big/File1000"));
+  EXPECT_FALSE(fs.find("/big/File"));
+  EXPECT_FALSE(fs.find("/big/File01"));
+}
+
+INSTANTIATE_TEST_SUITE_P(metadata_test, lookup_index_test,
+                         ::testing::Combine(::testing::Values(0, 1, 64, 5000),
+                                            ::testing::Bool()));
+
+class path_cache_test : public ::testing::TestWithParam<size_t> {};
+
+TEST_P(path_cache_test, find) {
+  auto const cache_size = GetParam();
+
+  test::test_logger lgr;
+  auto os = test::os_access_mock::create_test_instance();
+
+  std::vector<std::string> paths;
+  std::string dir;
+
+  for (int depth = 0; depth < 8; ++depth) {
+    dir += fmt::format("{}d{}", dir.empty() ? "" : "/", depth);
+    os->add_dir(dir);
+    for (int i = 0; i < 5; ++i) {
+      auto path = fmt::format("{}/f{}", dir, i);
+      os->add_file(path, path);
+      paths.push_back(path);
+    }
+  }
+
+  auto const mm = build_image(lgr, *os);
+
+  reader::filesystem_v2 ref(lgr, *os, mm);
+  reader::filesystem_v2 fs(lgr, *os, mm,
+                           {.metadata = {.path_cache_size = cache_size}});
+
+  for (auto const& extra :
+       {"", "/", "d0", "d0/", "d0//", "/d0/d1/", "d0//d1", "d0/d1//f0",
+        "d0/f0/", "d0/f0/x", "d0/f0//", "d0/d1/nope", "nope/f0",
+        "somedir/ipsum.py", "//somedir//ipsum.py", "somedir/ipsum.py/"}) {
+    paths.emplace_back(extra);
+  }
+
+  auto inode_of = [](auto const& dev) {
+    return dev ? std::make_optional(dev->inode().inode_num()) : std::nullopt;
+  };
+
+  for (int pass = 0; pass < 3; ++pass) {
+    for (auto const& path : paths) {
+      EXPECT_EQ(inode_of(ref.find(path)), inode_of(fs.find(path)))
+          << path << " (pass " << pass << ")";
+    }
+  }
+
+  auto dev = fs.find("/d0/d1/d2/d3/d4/d5/d6/d7/f3");
+  ASSERT_TRUE(dev);
+  EXPECT_EQ("f3", dev->name());
+}
+
+INSTANTIATE_TEST_SUITE_P(metadata_test, path_cache_test,
+                         ::testing::Values(0, 1, 3, 100));
+
+class batched_names_test : public ::testing::TestWithParam<bool> {};
+
+TEST_P(batched_names_test, walk_and_readdir) {
+  auto const pack_names = GetParam();
+
+  test::test_logger lgr;
+  auto os = test::os_access_mock::create_test_instance();
+
+  // large enough to span multiple name batches
+  os->add_dir("big");
+
+  for (size_t i = 0; i < 1000; ++i) {
+    os->add_file(fmt::format("big/entry{:04}", i), fmt::format("{}", i));
+  }
+
+  writer::metadata_options md_opts;
+  md_opts.pack_names = pack_names;
+  md_opts.pack_names_index = pack_names;
+  md_opts.force_pack_string_tables = pack_names;
+
+  auto const mm = build_image(lgr, *os, md_opts);
+
+  reader::filesystem_v2 fs(lgr, *os, mm);
+
+  {
+    std::vector<std::string> expected;
+    std::vector<std::string> actual;
+
+    fs.walk([&](auto const& de) { expected.push_back(de.unix_path()); });
+    fs.walk_with_path([&](auto const& de, std::string_view path) {
+      EXPECT_EQ(de.unix_path(), path);
+      actual.emplace_back(path);
+    });
+
+    EXPECT_GT(expected.size(), 1000);
+    EXPECT_EQ(expected, actual);
+  }
+
+  {
+    std::vector<std::string> expected;
+    std::vector<std::string> actual;
+
+    fs.walk_data_order(
+        [&](auto const& de) { expected.push_back(de.unix_path()); });
+    fs.walk_data_order_with_path([&](auto const& de, std::string_view path) {
+      EXPECT_EQ(de.unix_path(), path);
+      actual.emplace_back(path);
+    });
+
+    EXPECT_EQ(expected, actual);
+  }
+
+  size_t num_dirs = 0;
+
+  fs.walk([&](auto const& de) {
+    auto dir = fs.opendir(de.inode());
+
+    if (!dir) {
+      return;
+    }
+
+    ++num_dirs;
+
+    auto const size = fs.dirsize(*dir);
+    std::vector<std::string> expected;
+    std::vector<std::string> actual;
+
+    for (size_t off = 0; off < size; ++off) {
+      expected.push_back(fs.readdir(*dir, off)->name());
+    }
+
+    fs.readdir(*dir, 0, [&](auto const& e, std::string_view name) {
+      EXPECT_EQ(e.name(), name);
+      actual.emplace_back(name);
+      return true;
+    });
+
+    EXPECT_EQ(expected, actual) << de.unix_path();
+
+    // resume at an offset and stop early
+    for (size_t off : {size_t{1}, size_t{2}, size - 1}) {
+      std::vector<std::string> partial;
+
+      fs.readdir(*dir, off, [&](auto const&, std::string_view name) {
+        partial.emplace_back(name);
+        return partial.size() < 200;
+      });
+
+      ASSERT_EQ(std::min<size_t>(size - off, 200), partial.size());
+
+      for (size_t i = 0; i < partial.size(); ++i) {
+        EXPECT_EQ(expected[off + i], partial[i]);
+      }
+    }
+
+    std::vector<std::string> plus;
+    std::error_code ec;
+
+    fs.readdirplus(
+        *dir, 0,
+        [&](auto const& e, std::string_view name, file_stat const& st) {
+          auto const ref = fs.getattr(e.inode());
+          EXPECT_EQ(e.name(), name);
+          EXPECT_EQ(ref.ino(), st.ino()) << name;
+          EXPECT_EQ(ref.mode(), st.mode()) << name;
+          EXPECT_EQ(ref.size(), st.size()) << name;
+          EXPECT_EQ(ref.nlink(), st.nlink()) << name;
+          EXPECT_EQ(ref.mtime(), st.mtime()) << name;
+          plus.emplace_back(name);
+          return true;
+        },
+        ec);
+
+    EXPECT_FALSE(ec) << ec.message();
+    EXPECT_EQ(expected, plus) << de.unix_path();
+  });
+
+  EXPECT_GT(num_dirs, 1);
+}
+
+INSTANTIATE_TEST_SUITE_P(metadata_test, batched_names_test, ::testing::Bool());
+
+class lazy_init_test : public ::testing::TestWithParam<bool> {};
+
+TEST_P(lazy_init_test, matches_eager_init) {
+  auto const case_insensitive = GetParam();
+
+  test::test_logger lgr;
+  auto os = test::os_access_mock::create_test_instance();
+
+  // enough files for the unpacked tables to span multiple blocks, with
+  // lots of duplicates to populate the shared files table
+  os->add_dir("many");
+
+  for (size_t i = 0; i < 10000; ++i) {
+    os->add_file(fmt::format("many/File{}", i), fmt::format("{}", i % 3000));
+  }
+
+  writer::metadata_options md_opts;
+  md_opts.pack_chunk_table = true;
+  md_opts.pack_shared_files_table = true;
+
+  auto const mm = build_image(lgr, *os, md_opts);
+
+  reader::filesystem_v2 eager(
+      lgr, *os, mm,
+      {.metadata = {.case_insensitive_lookup = case_insensitive}});
+  reader::filesystem_v2 lazy(
+      lgr, *os, mm,
+      {.metadata = {.case_insensitive_lookup = case_insensitive,
+                    .lazy_init = true}});
+
+  // look up in reverse order so the last blocks are unpacked first
+  std::vector<std::string> paths;
+  eager.walk([&](auto const& de) { paths.push_back(de.unix_path()); });
+  std::ranges::reverse(paths);
+
+  EXPECT_GT(paths.size(), 10000);
+
+  for (auto const& path : paths) {
+    auto const lookup =
+        case_insensitive ? boost::algorithm::to_upper_copy(path) : path;
+    auto const e = eager.find(lookup);
+    auto const l = lazy.find(lookup);
+    ASSERT_TRUE(e) << lookup;
+    ASSERT_TRUE(l) << lookup;
+
+    auto const est = eager.getattr(e->inode());
+    auto const lst = lazy.getattr(l->inode());
+    EXPECT_EQ(est.ino(), lst.ino()) << path;
+    EXPECT_EQ(est.mode(), lst.mode()) << path;
+    EXPECT_EQ(est.nlink(), lst.nlink()) << path;
+    EXPECT_EQ(est.size(), lst.size()) << path;
+
+    if (est.is_regular_file()) {
+      EXPECT_EQ(eager.read_string(est.ino()), lazy.read_string(lst.ino()))
+          << path;
+    }
+  }
+
+  vfs_stat evs;
+  vfs_stat lvs;
+  eager.statvfs(&evs);
+  lazy.statvfs(&lvs);
+  EXPECT_EQ(evs.total_fs_size, lvs.total_fs_size);
+  EXPECT_EQ(evs.total_hardlink_size, lvs.total_hardlink_size);
+}
+
+INSTANTIATE_TEST_SUITE_P(metadata_test, lazy_init_test, ::testing::Bool());
+
+TEST(metadata_test, metadata_cache) {
+  test::test_logger lgr;
+  auto os = test::os_access_mock::create_test_instance();
+
+  os->add_dir("many");
+
+  for (size_t i = 0; i < 5000; ++i) {
+    os->add_file(fmt::format("many/File{}", i), fmt::format("{}", i % 1000));
+  }
+
+  writer::metadata_options md_opts;
+  md_opts.pack_chunk_table = true;
+  md_opts.pack_shared_files_table = true;
+
+  auto const mm = build_image(lgr, *os, md_opts);
+
+  // The metadata cache needs a real file system
+  os_access_generic const real_os;
+  temporary_directory const td("dwarfs");
+  auto const cache_file = td.path() / "metadata.cache";
+
+  reader::filesystem_options const opts{
+      .metadata = {.case_insensitive_lookup = true},
+      .metadata_cache_file = cache_file,
+  };
+
+  reader::filesystem_v2 ref(lgr, *os, mm,
+                            {.metadata = {.case_insensitive_lookup = true}});
+
+  auto check_fs = [&](reader::filesystem_v2 const& fs) {
+    ref.walk([&](auto const& de) {
+      auto const path = boost::algorithm::to_upper_copy(de.unix_path());
+      auto const e = ref.find(path);
+      auto const c = fs.find(path);
+      ASSERT_TRUE(e) << path;
+      ASSERT_TRUE(c) << path;
+
+      auto const est = ref.getattr(e->inode());
+      auto const cst = fs.getattr(c->inode());
+      EXPECT_EQ(est.ino(), cst.ino()) << path;
+      EXPECT_EQ(est.nlink(), cst.nlink()) << path;
+      EXPECT_EQ(est.size(), cst.size()) << path;
+
+      if (est.is_regular_file()) {
+        EXPECT_EQ(ref.read_string(est.ino()), fs.read_string(cst.ino()))
+            << path;
+      }
+    });
+  };
+
+  auto log_contains = [](test::test_logger const& tl, std::string_view str) {
+    return std::ranges::any_of(tl.get_log(), [&](auto const& e) {
+      return e.output.find(str) != std::string::npos;
+    });
+  };
+
+  {
+    // the cache is written in the background and the file system waits
+    // for it on destruction
+    test::test_logger vlgr(logger::VERBOSE);
+    {
+      reader::filesystem_v2 fs(vlgr, real_os, mm, opts);
+      check_fs(fs);
+    }
+    EXPECT_TRUE(log_contains(vlgr, "wrote metadata cache")) << vlgr.as_string();
+  }
+
+  ASSERT_TRUE(std::filesystem::exists(cache_file));
+
+  {
+    test::test_logger vlgr(logger::VERBOSE);
+    reader::filesystem_v2 fs(vlgr, real_os, mm, opts);
+    EXPECT_TRUE(log_contains(vlgr, "loaded metadata cache"))
+        << vlgr.as_string();
+    EXPECT_FALSE(log_contains(vlgr, "wrote metadata cache"))
+        << vlgr.as_string();
+    check_fs(fs);
+  }
+
+  auto expect_rebuilt = [&] {
+    test::test_logger vlgr(logger::VERBOSE);
+    {
+      reader::filesystem_v2 fs(vlgr, real_os, mm, opts);
+      EXPECT_TRUE(log_contains(vlgr, "does not match")) << vlgr.as_string();
+      check_fs(fs);
+    }
+    EXPECT_TRUE(log_contains(vlgr, "wrote metadata cache"))
+        << vlgr.as_string();
+  };
+
+  // a cache file that doesn't match is rebuilt
+  write_file(cache_file, std::string(4096, 'x'));
+  expect_rebuilt();
+
+  // a damaged cache file is rebuilt
+  {
+    auto data = read_file(cache_file);
+    data[data.size() / 2] ^= 0x01;
+    write_file(cache_file, data);
+  }
+  expect_rebuilt();
+
+  // a cache file that cannot be written is not retried
+  reader::filesystem_options const bad_opts{
+      .metadata = {.case_insensitive_lookup = true},
+      .metadata_cache_file = td.path() / "missing" / "metadata.cache",
+  };
+
+  for (auto const retry : {false, true}) {
+    test::test_logger vlgr(logger::VERBOSE);
+    {
+      reader::filesystem_v2 fs(vlgr, real_os, mm, bad_opts);
+      check_fs(fs);
+    }
+    EXPECT_EQ(!retry, log_contains(vlgr, "failed to write metadata cache"))
+        << vlgr.as_string();
+  }
+}
+
+TEST(metadata_test, metadata_memory_options) {
+  test::test_logger lgr;
+  auto os = test::os_access_mock::create_test_instance();
+  auto const mm = build_image(lgr, *os);
+
+  reader::filesystem_v2 ref(lgr, *os, mm);
+
+  for (auto const hugepages : {false, true}) {
+    for (auto const lock_mode : {reader::mlock_mode::NONE,
+                                 reader::mlock_mode::TRY}) {
+      test::test_logger vlgr(logger::VERBOSE);
+      reader::filesystem_v2 fs(
+          vlgr, *os, mm,
+          {.lock_mode = lock_mode, .metadata_hugepages = hugepages});
+
+      EXPECT_TRUE(std::ranges::any_of(vlgr.get_log(), [](auto const& e) {
+        return e.output.starts_with("metadata pages: ");
+      })) << vlgr.as_string();
+
+      ref.walk([&](auto const& de) {
+        auto const path = de.unix_path();
+        auto const e = ref.find(path);
+        auto const c = fs.find(path);
+        ASSERT_TRUE(e) << path;
+        ASSERT_TRUE(c) << path;
+
+        auto const est = ref.getattr(e->inode());
+        auto const cst = fs.getattr(c->inode());
+        EXPECT_EQ(est.ino(), cst.ino()) << path;
+        EXPECT_EQ(est.size(), cst.size()) << path;
+        EXPECT_EQ(est.mode(), cst.mode()) << path;
+      });
+    }
+  }
+}
+
 TEST(metadata_options, output_stream) {
   using namespace dwarfs::writer;
 
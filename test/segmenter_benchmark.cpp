@@ -22,6 +22,7 @@
  */
 
 #include <random>
+#include <string>
 #include <vector>
 
 #include <benchmark/benchmark.h>
@@ -32,6 +33,7 @@
 
 #include <dwarfs/writer/internal/block_manager.h>
 #include <dwarfs/writer/internal/chunkable.h>
+#include <dwarfs/writer/internal/cyclic_hash.h>
 
 #include "loremipsum.h"
 #include "mmap_mock.h"
@@ -126,13 +128,14 @@ build_data(size_t total_size, size_t granularity, double dupe_fraction,
 void run_segmenter_benchmark(::benchmark::State& state, unsigned granularity,
                              unsigned window_size, unsigned block_size,
                              unsigned bloom_filter_size, unsigned lookback,
-                             double dupe_fraction) {
+                             double dupe_fraction, size_t hash_workers = 0) {
   dwarfs::writer::segmenter::config cfg;
   cfg.blockhash_window_size = window_size;
   cfg.window_increment_shift = 1;
   cfg.max_active_blocks = lookback;
   cfg.bloom_filter_size = bloom_filter_size;
   cfg.block_size_bits = block_size;
+  cfg.num_hash_workers = hash_workers;
 
   dwarfs::compression_constraints cc;
   cc.granularity = granularity;
@@ -221,6 +224,14 @@ void lookback(::benchmark::State& state) {
                           kDefaultDupeFraction);
 }
 
+// Use small blocks so the lookback covers a large part of the input
+template <unsigned Lookback>
+void long_lookback(::benchmark::State& state) {
+  run_segmenter_benchmark(state, kDefaultGranularity, kDefaultWindowSize, 20,
+                          kDefaultBloomFilterSize, Lookback,
+                          kDefaultDupeFraction);
+}
+
 template <unsigned DupeFraction>
 void dupe_fraction(::benchmark::State& state) {
   run_segmenter_benchmark(state, kDefaultGranularity, kDefaultWindowSize,
@@ -228,8 +239,70 @@ void dupe_fraction(::benchmark::State& state) {
                           kDefaultLookback, 0.01 * DupeFraction);
 }
 
+template <unsigned HashWorkers>
+void hash_workers(::benchmark::State& state) {
+  run_segmenter_benchmark(state, kDefaultGranularity, kDefaultWindowSize,
+                          kDefaultBlockSize, kDefaultBloomFilterSize,
+                          kDefaultLookback, kDefaultDupeFraction, HashWorkers);
+}
+
+std::vector<uint8_t> random_bytes(size_t size) {
+  std::mt19937_64 rng{42};
+  std::uniform_int_distribution<int> dist{0, 255};
+  std::vector<uint8_t> data(size);
+  for (auto& b : data) {
+    b = static_cast<uint8_t>(dist(rng));
+  }
+  return data;
+}
+
+constexpr size_t kRollWindowSize{4096};
+constexpr size_t kRollDataSize{static_cast<size_t>(16) << 20};
+
+void rsync_hash_update(::benchmark::State& state) {
+  auto const data = random_bytes(kRollDataSize);
+  std::vector<uint32_t> hashes(data.size() - kRollWindowSize);
+
+  for (auto _ : state) {
+    dwarfs::writer::internal::rsync_hash h;
+    for (size_t i = 0; i < kRollWindowSize; ++i) {
+      h.update(data[i]);
+    }
+    for (size_t i = 0; i < hashes.size(); ++i) {
+      h.update(data[i], data[i + kRollWindowSize]);
+      hashes[i] = h();
+    }
+    ::benchmark::DoNotOptimize(hashes.data());
+  }
+
+  state.SetBytesProcessed(state.iterations() * hashes.size());
+}
+
+void rsync_hash_roll(::benchmark::State& state) {
+  using dwarfs::writer::internal::rsync_hash;
+
+  auto const data = random_bytes(kRollDataSize);
+  std::vector<uint32_t> hashes(data.size() - kRollWindowSize);
+
+  state.SetLabel(std::string(rsync_hash::roll_implementation()));
+
+  for (auto _ : state) {
+    rsync_hash h;
+    for (size_t i = 0; i < kRollWindowSize; ++i) {
+      h.update(data[i]);
+    }
+    h.roll(data.data() + kRollWindowSize, hashes.size(), hashes.data());
+    ::benchmark::DoNotOptimize(hashes.data());
+  }
+
+  state.SetBytesProcessed(state.iterations() * hashes.size());
+}
+
 } // namespace
 
+BENCHMARK(rsync_hash_update)->Unit(benchmark::kMillisecond);
+BENCHMARK(rsync_hash_roll)->Unit(benchmark::kMillisecond);
+
 BENCHMARK(granularity<1>)->Unit(benchmark::kMillisecond);
 BENCHMARK(granularity<2>)->Unit(benchmark::kMillisecond);
 BENCHMARK(granularity<3>)->Unit(benchmark::kMillisecond);
@@ -262,10 +335,20 @@ BENCHMARK(lookback<4>)->Unit(benchmark::kMillisecond);
 BENCHMARK(lookback<8>)->Unit(benchmark::kMillisecond);
 BENCHMARK(lookback<16>)->Unit(benchmark::kMillisecond);
 
+BENCHMARK(long_lookback<16>)->Unit(benchmark::kMillisecond);
+BENCHMARK(long_lookback<64>)->Unit(benchmark::kMillisecond);
+BENCHMARK(long_lookback<256>)->Unit(benchmark::kMillisecond);
+BENCHMARK(long_lookback<512>)->Unit(benchmark::kMillisecond);
+
 BENCHMARK(dupe_fraction<0>)->Unit(benchmark::kMillisecond);
 BENCHMARK(dupe_fraction<20>)->Unit(benchmark::kMillisecond);
 BENCHMARK(dupe_fraction<40>)->Unit(benchmark::kMillisecond);
 BENCHMARK(dupe_fraction<60>)->Unit(benchmark::kMillisecond);
 BENCHMARK(dupe_fraction<80>)->Unit(benchmark::kMillisecond);
 
+BENCHMARK(hash_workers<0>)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(hash_workers<2>)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(hash_workers<4>)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(hash_workers<8>)->Unit(benchmark::kMillisecond)->UseRealTime();
+
 BENCHMARK_MAIN();
@@ -0,0 +1,472 @@
+/* vim:set ts=2 sw=2 sts=2 et: */
+/**
+ * \author     Marcus Holland-Moritz (github@mhxnet.de)
+ * \copyright  Copyright (c) Marcus Holland-Moritz
+ *
+ * This file is part of dwarfs.
+ *
+ * dwarfs is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dwarfs is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dwarfs.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dwarfs/compression_constraints.h>
+#include <dwarfs/file_util.h>
+#include <dwarfs/writer/segmenter.h>
+#include <dwarfs/writer/writer_progress.h>
+
+#include <dwarfs/writer/internal/block_manager.h>
+#include <dwarfs/writer/internal/chunkable.h>
+#include <dwarfs/writer/internal/cyclic_hash.h>
+#include <dwarfs/writer/internal/fingerprint_index.h>
+
+#include "mmap_mock.h"
+#include "test_logger.h"
+
+using namespace dwarfs;
+
+namespace {
+
+struct chunk_info {
+  size_t block;
+  size_t offset;
+  size_t size;
+  bool hole{false};
+
+  auto operator<=>(chunk_info const&) const = default;
+};
+
+class test_chunkable : public writer::internal::chunkable {
+ public:
+  explicit test_chunkable(std::string data)
+      : mm_{test::make_mock_file_view(
+            std::move(data),
+            test::mock_file_view_options{.support_raw_bytes = true})} {}
+
+  writer::internal::file const* get_file() const override { return nullptr; }
+
+  file_size_t size() const override { return mm_.size(); }
+
+  std::string description() const override { return std::string(); }
+
+  file_extents_iterable extents() const override { return mm_.extents(); }
+
+  void add_chunk(size_t block, size_t offset, size_t size) override {
+    chunks_.push_back({block, offset, size});
+  }
+
+  void add_hole(file_size_t size) override {
+    chunks_.push_back({0, 0, static_cast<size_t>(size), true});
+  }
+
+  std::vector<chunk_info> const& chunks() const { return chunks_; }
+
+ private:
+  file_view mm_;
+  std::vector<chunk_info> chunks_;
+};
+
+std::string random_string(std::mt19937_64& rng, size_t len) {
+  std::uniform_int_distribution<int> byte_dist(0, 255);
+  std::string s(len, '\0');
+  std::ranges::generate(s, [&] { return static_cast<char>(byte_dist(rng)); });
+  return s;
+}
+
+std::string make_data(size_t size, size_t granularity) {
+  std::mt19937_64 rng{42};
+  std::uniform_int_distribution<size_t> len_dist(1, 64 * 1024);
+
+  std::vector<std::string> dupes;
+  for (size_t i = 0; i < 8; ++i) {
+    dupes.push_back(random_string(rng, len_dist(rng)));
+  }
+
+  std::string data;
+  data.reserve(size);
+
+  while (data.size() < size) {
+    data += random_string(rng, len_dist(rng));
+    data += dupes[rng() % dupes.size()];
+  }
+
+  data.resize(size - size % granularity);
+
+  return data;
+}
+
+struct segmenter_result {
+  std::vector<chunk_info> chunks;
+  std::vector<std::string> blocks;
+};
+
+segmenter_result
+run_segmenter(std::string const& data, writer::segmenter::config const& cfg,
+              compression_constraints const& cc) {
+  test::test_logger lgr;
+  writer::writer_progress prog;
+  auto blkmgr = std::make_shared<writer::internal::block_manager>();
+  segmenter_result res;
+
+  writer::segmenter seg(
+      lgr, prog, blkmgr, cfg, cc, data.size(),
+      [&res, blkmgr](shared_byte_buffer blk, auto logical_block_num) {
+        blkmgr->set_written_block(logical_block_num, logical_block_num, {});
+        if (res.blocks.size() <= logical_block_num) {
+          res.blocks.resize(logical_block_num + 1);
+        }
+        res.blocks[logical_block_num].assign(
+            reinterpret_cast<char const*>(blk.data()), blk.size());
+      });
+
+  test_chunkable tc(data);
+  seg.add_chunkable(tc);
+  seg.finish();
+
+  res.chunks = tc.chunks();
+
+  return res;
+}
+
+std::string reassemble(segmenter_result const& res) {
+  std::string data;
+
+  for (auto const& c : res.chunks) {
+    if (c.hole) {
+      data.append(c.size, '\0');
+    } else {
+      data.append(res.blocks.at(c.block), c.offset, c.size);
+    }
+  }
+
+  return data;
+}
+
+size_t total_block_size(segmenter_result const& res) {
+  size_t size{0};
+  for (auto const& blk : res.blocks) {
+    size += blk.size();
+  }
+  return size;
+}
+
+class segmenter_hash_workers_test
+    : public ::testing::TestWithParam<std::tuple<size_t, unsigned>> {};
+
+class segmenter_byte_run_test
+    : public ::testing::TestWithParam<std::tuple<unsigned, bool>> {};
+
+class segmenter_lookback_test : public ::testing::TestWithParam<size_t> {};
+
+class segmenter_cdc_test : public ::testing::TestWithParam<unsigned> {};
+
+} // namespace
+
+TEST(rsync_hash, roll_matches_update) {
+  std::mt19937_64 rng{42};
+  auto const str = random_string(rng, 100'000);
+  auto const* data = reinterpret_cast<uint8_t const*>(str.data());
+
+  for (size_t window_size : {1, 7, 16, 100, 4096, 70'000}) {
+    for (size_t count : {0, 1, 15, 16, 17, 1000, 29'999}) {
+      writer::internal::rsync_hash ref;
+      writer::internal::rsync_hash h;
+
+      for (size_t i = 0; i < window_size; ++i) {
+        ref.update(data[i]);
+        h.update(data[i]);
+      }
+
+      std::vector<uint32_t> hashes(count);
+      h.roll(data + window_size, count, hashes.data());
+
+      for (size_t i = 0; i < count; ++i) {
+        ref.update(data[i], data[window_size + i]);
+        ASSERT_EQ(ref(), hashes[i])
+            << "window_size=" << window_size << ", count=" << count
+            << ", i=" << i << " ("
+            << writer::internal::rsync_hash::roll_implementation() << ")";
+      }
+
+      EXPECT_EQ(ref(), h());
+    }
+  }
+}
+
+TEST_P(segmenter_hash_workers_test, output_is_reproducible) {
+  auto const [max_active_blocks, granularity] = GetParam();
+
+  writer::segmenter::config cfg;
+  cfg.blockhash_window_size = 10;
+  cfg.max_active_blocks = max_active_blocks;
+  cfg.block_size_bits = 20;
+
+  compression_constraints cc;
+  cc.granularity = granularity;
+
+  auto const data = make_data(12 * 1024 * 1024, granularity);
+
+  auto const ref = run_segmenter(data, cfg, cc);
+
+  ASSERT_GT(ref.chunks.size(), 1);
+  EXPECT_EQ(data, reassemble(ref));
+
+  // make sure we actually exercise the segmenter
+  EXPECT_LT(total_block_size(ref), data.size());
+
+  for (size_t workers : {2, 3, 8}) {
+    cfg.num_hash_workers = workers;
+    auto const res = run_segmenter(data, cfg, cc);
+    EXPECT_EQ(ref.chunks, res.chunks) << "workers=" << workers;
+    EXPECT_EQ(ref.blocks, res.blocks) << "workers=" << workers;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(dwarfs, segmenter_hash_workers_test,
+                         ::testing::Combine(::testing::Values(1, 4),
+                                            ::testing::Values(1u, 3u)));
+
+TEST_P(segmenter_byte_run_test, runs_are_not_segmented) {
+  auto const [granularity, sparse] = GetParam();
+
+  std::mt19937_64 rng{42};
+  std::string data;
+
+  data += random_string(rng, 300'000);
+  data += std::string(5'000'000, '\0');
+  data += random_string(rng, 200'000);
+  data += std::string(3'000'000, '\xff');
+  data += random_string(rng, 100'000);
+  data += std::string(1'000, '\0');
+  data += random_string(rng, 50'000);
+  data += std::string(2'000'000, '\xff');
+  data += random_string(rng, 10'000);
+  data.resize(data.size() - data.size() % granularity);
+
+  writer::segmenter::config cfg;
+  cfg.blockhash_window_size = 10;
+  cfg.block_size_bits = 20;
+  cfg.enable_sparse_files = sparse;
+
+  compression_constraints cc;
+  cc.granularity = granularity;
+
+  auto const plain = run_segmenter(data, cfg, cc);
+
+  cfg.min_byte_run_size = 64 * 1024;
+
+  auto const res = run_segmenter(data, cfg, cc);
+
+  EXPECT_EQ(data, reassemble(plain));
+  EXPECT_EQ(data, reassemble(res));
+
+  auto const num_holes = std::ranges::count_if(
+      res.chunks, [](auto const& c) { return c.hole; });
+
+  if (sparse) {
+    EXPECT_EQ(1, num_holes);
+  } else {
+    EXPECT_EQ(0, num_holes);
+  }
+
+  // Each run is represented by a few references to a canonical run rather
+  // than one chunk per window size.
+  EXPECT_LT(res.chunks.size(), 50);
+  EXPECT_LT(res.chunks.size(), plain.chunks.size());
+
+  // At most one canonical run per byte value needs to be stored.
+  EXPECT_LT(total_block_size(res), 1'500'000);
+
+  cfg.num_hash_workers = 4;
+
+  auto const par = run_segmenter(data, cfg, cc);
+
+  EXPECT_EQ(res.chunks, par.chunks);
+  EXPECT_EQ(res.blocks, par.blocks);
+}
+
+INSTANTIATE_TEST_SUITE_P(dwarfs, segmenter_byte_run_test,
+                         ::testing::Combine(::testing::Values(1u, 3u),
+                                            ::testing::Bool()));
+
+TEST_P(segmenter_lookback_test, matches_span_all_active_blocks) {
+  auto const lookback = GetParam();
+  size_t const block_size = 64 * 1024;
+
+  std::mt19937_64 rng{42};
+  auto const dupe = random_string(rng, 4 * block_size);
+  std::string data;
+
+  // The second copy is within the lookback, the third one is not.
+  data += dupe;
+  data += random_string(rng, (lookback - 6) * block_size);
+  data += dupe;
+  data += random_string(rng, 2 * lookback * block_size);
+  data += dupe;
+
+  writer::segmenter::config cfg;
+  cfg.blockhash_window_size = 10;
+  cfg.block_size_bits = 16;
+  cfg.max_active_blocks = lookback;
+
+  compression_constraints cc;
+
+  auto const res = run_segmenter(data, cfg, cc);
+
+  EXPECT_EQ(data, reassemble(res));
+  EXPECT_NEAR(data.size() - dupe.size(), total_block_size(res), 4096);
+
+  cfg.num_hash_workers = 3;
+
+  auto const par = run_segmenter(data, cfg, cc);
+
+  EXPECT_EQ(res.chunks, par.chunks);
+  EXPECT_EQ(res.blocks, par.blocks);
+}
+
+INSTANTIATE_TEST_SUITE_P(dwarfs, segmenter_lookback_test,
+                         ::testing::Values(8, 16, 100));
+
+TEST_P(segmenter_cdc_test, finds_distant_duplicates) {
+  auto const granularity = GetParam();
+  size_t const block_size = 1024 * 1024;
+
+  std::mt19937_64 rng{42};
+  auto frames = [&](size_t size) {
+    return random_string(rng, size - size % granularity);
+  };
+  auto const dupe = frames(block_size + 12'345);
+  std::string data;
+
+  // Far beyond any lookback of the rolling hash segmenter
+  data += dupe;
+  data += frames(8 * block_size + 999);
+  data += dupe;
+  data += frames(3 * block_size);
+  data += dupe;
+
+  writer::segmenter::config cfg;
+  cfg.block_size_bits = 20;
+  cfg.algo = writer::segmenter::algorithm::cdc;
+  cfg.cdc_chunk_size_bits = 12;
+
+  compression_constraints cc;
+  cc.granularity = granularity;
+
+  auto const res = run_segmenter(data, cfg, cc);
+
+  EXPECT_EQ(data, reassemble(res));
+  EXPECT_NEAR(data.size() - 2 * dupe.size(), total_block_size(res),
+              128 * 1024);
+
+  for (auto const& c : res.chunks) {
+    EXPECT_EQ(0, c.offset % granularity);
+    EXPECT_EQ(0, c.size % granularity);
+  }
+
+  // Spilling the index to disk must not change the result
+  cfg.cdc_index_memory =
+      64 * writer::internal::fingerprint_index::kMemoryPerEntry;
+
+  auto const spilled = run_segmenter(data, cfg, cc);
+
+  EXPECT_EQ(res.chunks, spilled.chunks);
+  EXPECT_EQ(res.blocks, spilled.blocks);
+}
+
+INSTANTIATE_TEST_SUITE_P(dwarfs, segmenter_cdc_test,
+                         ::testing::Values(1u, 3u));
+
+TEST(fingerprint_index, spills_to_disk) {
+  using writer::internal::fingerprint_index;
+
+  static constexpr size_t kCount{20'000};
+
+  std::mt19937_64 rng{42};
+  std::vector<fingerprint_index::fingerprint> fps(kCount);
+
+  for (auto& fp : fps) {
+    fp = {rng(), rng()};
+  }
+
+  fingerprint_index index(1000 * fingerprint_index::kMemoryPerEntry);
+
+  for (size_t i = 0; i < kCount; ++i) {
+    ASSERT_FALSE(index.find(fps[i]).has_value());
+    index.insert(fps[i], {static_cast<uint32_t>(i),
+                          static_cast<uint32_t>(2 * i),
+                          static_cast<uint32_t>(3 * i)});
+  }
+
+  auto const& st = index.get_stats();
+
+  EXPECT_EQ(kCount, st.entries);
+  // spilled runs count against the memory limit, so later runs are smaller
+  EXPECT_GT(st.spills, 20);
+  EXPECT_GT(st.merges, 0);
+  EXPECT_GT(index.run_memory_usage(), 0);
+
+  for (size_t i = 0; i < kCount; ++i) {
+    auto const loc = index.find(fps[i]);
+    ASSERT_TRUE(loc.has_value()) << i;
+    EXPECT_EQ(i, loc->block);
+    EXPECT_EQ(2 * i, loc->offset);
+    EXPECT_EQ(3 * i, loc->size);
+  }
+
+  for (size_t i = 0; i < kCount; ++i) {
+    EXPECT_FALSE(index.find({rng(), rng()}).has_value());
+  }
+
+  // Missing fingerprints rarely need to read from disk
+  EXPECT_LT(st.bloom_false_positives, kCount / 20);
+}
+
+TEST(fingerprint_index, spill_dir) {
+  using writer::internal::fingerprint_index;
+
+  temporary_directory const td("dwarfs");
+  std::mt19937_64 rng{42};
+
+  auto count_files = [&] {
+    return std::distance(
+        std::filesystem::recursive_directory_iterator(td.path()),
+        std::filesystem::recursive_directory_iterator());
+  };
+
+  {
+    fingerprint_index index(100 * fingerprint_index::kMemoryPerEntry,
+                            td.path());
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+      index.insert({rng(), rng()}, {i, i, i});
+    }
+
+    ASSERT_GT(index.get_stats().spills, 0);
+    // one temporary directory plus the run files
+    EXPECT_GT(count_files(), 1);
+  }
+
+  EXPECT_EQ(0, count_files());
+}
@@ -602,19 +602,19 @@ TEST(block_cache, sequential_access_detector) {
     }
 
     auto log = test_lgr->get_log();
-    std::optional<size_t> sequential_prefetches;
+    std::optional<size_t> prefetches;
     for (auto const& ent : log) {
-      if (ent.output.starts_with("sequential prefetches: ")) {
-        sequential_prefetches = std::stoul(ent.output.substr(23));
+      if (ent.output.starts_with("prefetches: ")) {
+        prefetches = std::stoul(ent.output.substr(12));
         break;
       }
     }
 
-    ASSERT_TRUE(sequential_prefetches);
+    ASSERT_TRUE(prefetches);
     if (thresh == 0) {
-      EXPECT_EQ(0, sequential_prefetches.value());
+      EXPECT_EQ(0, prefetches.value());
     } else {
-      EXPECT_EQ(sequential_prefetches.value(), block_count - thresh);
+      EXPECT_EQ(prefetches.value(), block_count - thresh);
     }
   }
 }
@@ -21,6 +21,10 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <future>
+#include <mutex>
+#include <vector>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -51,3 +55,48 @@ TEST(worker_group_test, set_thread_affinity_env) {
   internal::worker_group wg_apple(lgr, os, "apple", {.num_workers = 1});
   EXPECT_EQ(0, os.set_affinity_calls.size());
 }
+
+TEST(worker_group_test, job_priorities) {
+  using internal::job_priority;
+
+  test::test_logger lgr;
+  test::os_access_mock os;
+
+  internal::worker_group wg(lgr, os, "prio", {.num_workers = 1});
+
+  std::promise<void> release;
+  std::mutex mx;
+  std::vector<int> order;
+
+  // Keep the only worker busy until all jobs have been queued
+  wg.add_job([f = release.get_future().share()] { f.wait(); });
+
+  auto add = [&](job_priority prio, int id) {
+    wg.add_job(prio, [&, id] {
+      std::lock_guard lock(mx);
+      order.push_back(id);
+    });
+  };
+
+  add(job_priority::PRELOAD, 1);
+  add(job_priority::PREFETCH, 2);
+  add(job_priority::PRELOAD, 3);
+  add(job_priority::READAHEAD, 4);
+  add(job_priority::DEMAND, 5);
+  add(job_priority::PREFETCH, 6);
+  add(job_priority::DEMAND, 7);
+
+  release.set_value();
+  wg.wait();
+
+  EXPECT_THAT(order, ::testing::ElementsAre(5, 7, 4, 2, 6, 1, 3));
+
+  EXPECT_EQ(3, wg.get_queue_stats(job_priority::DEMAND).jobs);
+  EXPECT_EQ(1, wg.get_queue_stats(job_priority::READAHEAD).jobs);
+  EXPECT_EQ(2, wg.get_queue_stats(job_priority::PREFETCH).jobs);
+  EXPECT_EQ(2, wg.get_queue_stats(job_priority::PRELOAD).jobs);
+
+  auto const qs = wg.get_queue_stats(job_priority::PRELOAD);
+  EXPECT_GT(qs.max_wait.count(), 0);
+  EXPECT_LE(qs.max_wait, qs.total_wait);
+}
@@ -237,6 +237,17 @@ struct inode_size_cache {
    // only used if the inode is sparse
    3: map<UInt32, UInt64>  allocated_size_lookup
 
+  //==========================================================//
+  // fields added with dwarfs-0.16.0, file system version 2.5 //
+  //==========================================================//
+
+   // complete list of sizes, indexed by chunk table index; if
+   // this is present, the lookup maps above will be empty
+   4: optional list<UInt64> size_table
+
+   // complete list of allocated sizes, indexed by chunk table
+   // index; only present if at least one inode is sparse
+   5: optional list<UInt64> allocated_size_table
 }
 
 /*
@@ -26,6 +26,8 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <atomic>
+#include <chrono>
 #include <csignal>
 #include <expected>
 #include <filesystem>
@@ -97,6 +99,15 @@
 #define DWARFS_FUSE_HAS_LSEEK
 #endif
 
+#if DWARFS_FUSE_LOWLEVEL && defined(__linux__)
+#define DWARFS_FUSE_HAS_SPLICE
+#include <unistd.h>
+#endif
+
+#if DWARFS_FUSE_LOWLEVEL && FUSE_USE_VERSION >= 30 && !defined(_WIN32)
+#define DWARFS_FUSE_HAS_READDIRPLUS
+#endif
+
 #include <dwarfs/binary_literals.h>
 #include <dwarfs/conv.h>
 #include <dwarfs/decompressor_registry.h>
@@ -180,6 +191,7 @@ struct options {
   char const* cachesize_str{nullptr};           // TODO: const?? -> use string?
   char const* blocksize_str{nullptr};           // TODO: const?? -> use string?
   char const* readahead_str{nullptr};           // TODO: const?? -> use string?
+  char const* readahead_max_str{nullptr};       // TODO: const?? -> use string?
   char const* preload_category_str{nullptr};    // TODO: const?? -> use string?
   char const* debuglevel_str{nullptr};          // TODO: const?? -> use string?
   char const* workers_str{nullptr};             // TODO: const?? -> use string?
@@ -191,8 +203,15 @@ struct options {
   char const* cache_tidy_interval_str{nullptr}; // TODO: const?? -> use string?
   char const* cache_tidy_max_age_str{nullptr};  // TODO: const?? -> use string?
   char const* block_alloc_mode_str{nullptr};    // TODO: const?? -> use string?
+  char const* cache_policy_str{nullptr};        // TODO: const?? -> use string?
   char const* seq_detector_thresh_str{nullptr}; // TODO: const?? -> use string?
+  char const* prefetch_depth_str{nullptr};      // TODO: const?? -> use string?
   char const* analysis_file_str{nullptr};       // TODO: const?? -> use string?
+  char const* record_trace_str{nullptr};        // TODO: const?? -> use string?
+  char const* preload_trace_str{nullptr};       // TODO: const?? -> use string?
+  char const* disk_cache_str{nullptr};          // TODO: const?? -> use string?
+  char const* disk_cache_size_str{nullptr};     // TODO: const?? -> use string?
+  char const* metadata_cache_str{nullptr};      // TODO: const?? -> use string?
 #ifndef _WIN32
   char const* uid_str{nullptr}; // TODO: const?? -> use string?
   char const* gid_str{nullptr}; // TODO: const?? -> use string?
@@ -205,14 +224,20 @@ struct options {
   int enable_nlink{0}; // TODO: this is obsolete; remove in v0.16.0
   int readonly{0};
   int case_insensitive{0};
+  int metadata_hugepages{0};
   int cache_image{0}; // TODO: this is obsolete; remove in v0.16.0
   int cache_files{1};
 #ifdef DWARFS_FUSE_HAS_LSEEK
   int cache_sparse{0};
+#endif
+#ifdef DWARFS_FUSE_HAS_SPLICE
+  int splice_read{0};
 #endif
   size_t cachesize{0};
+  size_t disk_cache_size{0};
   size_t blocksize{0};
   size_t readahead{0};
+  size_t readahead_max{0};
   size_t workers{0};
   reader::mlock_mode lock_mode{reader::mlock_mode::NONE};
   double decompress_ratio{0.0};
@@ -223,7 +248,10 @@ struct options {
   std::chrono::nanoseconds block_cache_tidy_max_age{std::chrono::minutes{10}};
   reader::block_cache_allocation_mode block_allocator{
       reader::block_cache_allocation_mode::MALLOC};
+  reader::block_cache_eviction_policy cache_policy{
+      reader::block_cache_eviction_policy::LRU};
   size_t seq_detector_threshold{kDefaultSeqDetectorThreshold};
+  size_t prefetch_depth{0};
 #ifndef _WIN32
   std::optional<file_stat::uid_type> fs_uid;
   std::optional<file_stat::gid_type> fs_gid;
@@ -282,10 +310,16 @@ struct dwarfs_userdata {
   reader::filesystem_v2_lite fs;
   iolayer const& iol;
   std::optional<dwarfs_analysis> analysis;
+  std::optional<std::filesystem::path> preload_trace;
   std::shared_ptr<performance_monitor> perfmon;
+  std::chrono::steady_clock::time_point load_start;
+  std::atomic<bool> first_lookup_reported{false};
 #ifdef DWARFS_FUSE_HAS_LSEEK
   bool fs_has_sparse_files{false};
 #endif
+#ifdef DWARFS_FUSE_HAS_SPLICE
+  int image_fd{-1};
+#endif
 #ifndef _WIN32
   std::optional<std::filesystem::path> auto_mountpoint;
 #endif
@@ -300,12 +334,20 @@ struct dwarfs_userdata {
 #endif
   PERFMON_EXT_TIMER_DECL(op_read)
   PERFMON_EXT_TIMER_DECL(op_readdir)
+#ifdef DWARFS_FUSE_HAS_READDIRPLUS
+  PERFMON_EXT_TIMER_DECL(op_readdirplus)
+#endif
   PERFMON_EXT_TIMER_DECL(op_statfs)
   PERFMON_EXT_TIMER_DECL(op_getxattr)
   PERFMON_EXT_TIMER_DECL(op_listxattr)
 };
 
 dwarfs_userdata::~dwarfs_userdata() {
+#ifdef DWARFS_FUSE_HAS_SPLICE
+  if (image_fd >= 0) {
+    ::close(image_fd);
+  }
+#endif
 #ifndef _WIN32
   if (auto_mountpoint.has_value()) {
     std::error_code ec;
@@ -330,6 +372,7 @@ constexpr std::array dwarfs_opts{
     DWARFS_OPT("cachesize=%s", cachesize_str, 0),
     DWARFS_OPT("blocksize=%s", blocksize_str, 0),
     DWARFS_OPT("readahead=%s", readahead_str, 0),
+    DWARFS_OPT("readahead_max=%s", readahead_max_str, 0),
     DWARFS_OPT("debuglevel=%s", debuglevel_str, 0),
     DWARFS_OPT("workers=%s", workers_str, 0),
 #ifndef _WIN32
@@ -344,13 +387,21 @@ constexpr std::array dwarfs_opts{
     DWARFS_OPT("tidy_interval=%s", cache_tidy_interval_str, 0),
     DWARFS_OPT("tidy_max_age=%s", cache_tidy_max_age_str, 0),
     DWARFS_OPT("block_allocator=%s", block_alloc_mode_str, 0),
+    DWARFS_OPT("cache_policy=%s", cache_policy_str, 0),
     DWARFS_OPT("seq_detector=%s", seq_detector_thresh_str, 0),
+    DWARFS_OPT("prefetch_depth=%s", prefetch_depth_str, 0),
     DWARFS_OPT("analysis_file=%s", analysis_file_str, 0),
+    DWARFS_OPT("record_trace=%s", record_trace_str, 0),
+    DWARFS_OPT("preload_trace=%s", preload_trace_str, 0),
+    DWARFS_OPT("disk_cache=%s", disk_cache_str, 0),
+    DWARFS_OPT("disk_cache_size=%s", disk_cache_size_str, 0),
+    DWARFS_OPT("metadata_cache=%s", metadata_cache_str, 0),
     DWARFS_OPT("preload_category=%s", preload_category_str, 0),
     DWARFS_OPT("preload_all", preload_all, 1),
     DWARFS_OPT("enable_nlink", enable_nlink, 1),
     DWARFS_OPT("readonly", readonly, 1),
     DWARFS_OPT("case_insensitive", case_insensitive, 1),
+    DWARFS_OPT("metadata_hugepages", metadata_hugepages, 1),
     DWARFS_OPT("cache_image", cache_image, 1),
     DWARFS_OPT("no_cache_image", cache_image, 2),
     DWARFS_OPT("cache_files", cache_files, 1),
@@ -359,6 +410,9 @@ constexpr std::array dwarfs_opts{
     DWARFS_OPT("cache_sparse", cache_sparse, 1),
     DWARFS_OPT("no_cache_sparse", cache_sparse, 0),
 #endif
+#ifdef DWARFS_FUSE_HAS_SPLICE
+    DWARFS_OPT("splice_read", splice_read, 1),
+#endif
 #if DWARFS_PERFMON_ENABLED
     DWARFS_OPT("perfmon=%s", perfmon_enabled_str, 0),
     DWARFS_OPT("perfmon_trace=%s", perfmon_trace_file_str, 0),
@@ -373,10 +427,16 @@ constexpr sorted_array_map cache_tidy_strategy_map{
 };
 
 constexpr sorted_array_map block_allocator_map{
+    std::pair{"hugepage"sv, reader::block_cache_allocation_mode::HUGEPAGE},
     std::pair{"malloc"sv, reader::block_cache_allocation_mode::MALLOC},
     std::pair{"mmap"sv, reader::block_cache_allocation_mode::MMAP},
 };
 
+constexpr sorted_array_map cache_policy_map{
+    std::pair{"lru"sv, reader::block_cache_eviction_policy::LRU},
+    std::pair{"tinylfu"sv, reader::block_cache_eviction_policy::TINYLFU},
+};
+
 constexpr std::string_view pid_xattr{"user.dwarfs.driver.pid"};
 constexpr std::string_view perfmon_xattr{"user.dwarfs.driver.perfmon"};
 constexpr std::string_view inodeinfo_xattr{"user.dwarfs.inodeinfo"};
@@ -487,7 +547,13 @@ void op_init_common(void* data) {
   // we must do this *after* the fuse driver has forked into background
   userdata.fs.set_cache_tidy_config(tidy);
 
-  if (userdata.opts.preload_category_str) {
+  if (userdata.preload_trace) {
+    try {
+      userdata.fs.cache_blocks_from_trace(*userdata.preload_trace);
+    } catch (std::exception const& e) {
+      LOG_ERROR << "cannot preload from trace: " << exception_str(e);
+    }
+  } else if (userdata.opts.preload_category_str) {
     userdata.fs.cache_blocks_by_category(userdata.opts.preload_category_str);
   } else if (userdata.opts.preload_all) {
     userdata.fs.cache_all_blocks();
@@ -500,7 +566,34 @@ void op_init_common(void* data) {
 
 #if DWARFS_FUSE_LOWLEVEL
 template <typename LoggerPolicy>
-void op_init(void* data, struct fuse_conn_info* /*conn*/) {
+void op_init(void* data, struct fuse_conn_info* conn [[maybe_unused]]) {
+#ifdef DWARFS_FUSE_HAS_SPLICE
+  auto& userdata = *reinterpret_cast<dwarfs_userdata*>(data);
+
+  if (userdata.image_fd >= 0) {
+    LOG_PROXY(LoggerPolicy, userdata.lgr);
+
+    static constexpr unsigned kSpliceCaps{FUSE_CAP_SPLICE_WRITE |
+                                          FUSE_CAP_SPLICE_MOVE};
+
+    if ((conn->capable & kSpliceCaps) == kSpliceCaps) {
+      conn->want |= kSpliceCaps;
+    } else {
+      LOG_WARN << "kernel does not support splice, disabling splice_read";
+      ::close(userdata.image_fd);
+      userdata.image_fd = -1;
+    }
+  }
+#endif
+
+#ifdef DWARFS_FUSE_HAS_READDIRPLUS
+  if (reinterpret_cast<dwarfs_userdata*>(data)->analysis) {
+    // entries returned by readdirplus don't go through lookup, so they
+    // would be missing from the analysis
+    conn->want &= ~(FUSE_CAP_READDIRPLUS | FUSE_CAP_READDIRPLUS_AUTO);
+  }
+#endif
+
   op_init_common<LoggerPolicy>(data);
 }
 #else
@@ -513,6 +606,18 @@ void* op_init(struct fuse_conn_info* /*conn*/, struct fuse_config* /*cfg*/) {
 }
 #endif
 
+template <typename LogProxy>
+void report_first_lookup(LogProxy& log_, dwarfs_userdata& userdata) {
+  if (!userdata.first_lookup_reported.load(std::memory_order_relaxed))
+      [[unlikely]] {
+    if (!userdata.first_lookup_reported.exchange(true)) {
+      LOG_INFO << "time to first lookup: "
+               << time_with_unit(std::chrono::steady_clock::now() -
+                                 userdata.load_start);
+    }
+  }
+}
+
 #if DWARFS_FUSE_LOWLEVEL
 template <typename LoggerPolicy>
 void op_lookup(fuse_req_t req, fuse_ino_t parent, char const* name) {
@@ -526,6 +631,8 @@ void op_lookup(fuse_req_t req, fuse_ino_t parent, char const* name) {
   checked_reply_err(log_, req, [&] {
     auto dev = userdata.fs.find(parent, name);
 
+    report_first_lookup(log_, userdata);
+
     if (!dev) {
       return ENOENT;
     }
@@ -613,7 +720,9 @@ int op_getattr(char const* path, native_stat* st, struct fuse_file_info*) {
   LOG_DEBUG << __func__ << "(" << path << ")" << get_caller_context();
 
   return -op_getattr_common(log_, userdata, st, [&] {
-    return find_inode(PERFMON_SECTION_ARG_ userdata.fs, path);
+    auto iv = find_inode(PERFMON_SECTION_ARG_ userdata.fs, path);
+    report_first_lookup(log_, userdata);
+    return iv;
   });
 }
 #endif
@@ -864,6 +973,60 @@ off_t op_lseek(char const* path, off_t off, int whence,
 #endif
 #endif
 
+#ifdef DWARFS_FUSE_HAS_SPLICE
+// Reply with buffers that reference the image file wherever the data is
+// stored uncompressed, so libfuse can splice it from the page cache into
+// the fuse device without copying it to user space. All other ranges,
+// including everything from the block cache, are passed as memory buffers.
+// libfuse write()s those into its pipe, so they are still copied once, just
+// like with fuse_reply_iov. `buf` keeps them alive until the reply has been
+// sent. Returns std::nullopt if not enough data is backed by the image file
+// for splicing to pay off; libfuse would fall back to copying.
+std::optional<int> reply_data_spliced(fuse_req_t req, int image_fd,
+                                      reader::iovec_read_buf const& buf) {
+  static size_t const min_splice_size = 2 * ::sysconf(_SC_PAGESIZE);
+
+  size_t image_bytes{0};
+
+  for (auto const& br : buf.ranges) {
+    if (br.image_offset()) {
+      image_bytes += br.size();
+    }
+  }
+
+  if (image_bytes < min_splice_size) {
+    return std::nullopt;
+  }
+
+  // fuse_bufvec ends in a one-element array of buffers
+  std::vector<std::byte> storage(sizeof(fuse_bufvec) +
+                                 (buf.ranges.size() - 1) * sizeof(fuse_buf));
+  auto* bufv = new (storage.data()) fuse_bufvec{};
+  bufv->count = buf.ranges.size();
+
+  for (size_t i = 0; i < buf.ranges.size(); ++i) {
+    auto const& br = buf.ranges[i];
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+    auto& fb = bufv->buf[i];
+
+    fb = fuse_buf{};
+    fb.size = br.size();
+
+    if (auto const pos = br.image_offset()) {
+      fb.flags =
+          static_cast<fuse_buf_flags>(FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK);
+      fb.fd = image_fd;
+      fb.pos = *pos;
+    } else {
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+      fb.mem = const_cast<uint8_t*>(br.data());
+    }
+  }
+
+  return fuse_reply_data(req, bufv, FUSE_BUF_SPLICE_MOVE);
+}
+#endif
+
 #if DWARFS_FUSE_LOWLEVEL
 template <typename LoggerPolicy>
 void op_read(fuse_req_t req, fuse_ino_t ino, size_t size, file_off_t off,
@@ -892,6 +1055,14 @@ void op_read(fuse_req_t req, fuse_ino_t ino, size_t size, file_off_t off,
       return ec.value();
     }
 
+#ifdef DWARFS_FUSE_HAS_SPLICE
+    if (userdata.image_fd >= 0) {
+      if (auto rv = reply_data_spliced(req, userdata.image_fd, buf)) {
+        return -*rv;
+      }
+    }
+#endif
+
     return -fuse_reply_iov(req, buf.buf.empty() ? nullptr : buf.buf.data(),
                            buf.buf.size());
   });
@@ -922,9 +1093,11 @@ int op_read(char const* path, char* buf, size_t size, native_off_t off,
 #if DWARFS_FUSE_LOWLEVEL
 class readdir_lowlevel_policy {
  public:
-  readdir_lowlevel_policy(fuse_req_t req, fuse_ino_t ino, size_t size)
+  readdir_lowlevel_policy(fuse_req_t req, fuse_ino_t ino, size_t size,
+                          bool plus = false)
       : req_{req}
-      , ino_{ino} {
+      , ino_{ino}
+      , plus_{plus} {
     buf_.resize(size);
   }
 
@@ -935,9 +1108,26 @@ class readdir_lowlevel_policy {
   bool
   add_entry(std::string const& name, native_stat const& st, file_off_t off) {
     assert(written_ < buf_.size());
-    auto needed =
-        fuse_add_direntry(req_, &buf_[written_], buf_.size() - written_,
-                          name.c_str(), &st, off + 1);
+    size_t needed;
+#ifdef DWARFS_FUSE_HAS_READDIRPLUS
+    if (plus_) {
+      struct ::fuse_entry_param e;
+
+      e.attr = st;
+      e.generation = 1;
+      e.ino = e.attr.st_ino;
+      e.attr_timeout = std::numeric_limits<double>::max();
+      e.entry_timeout = std::numeric_limits<double>::max();
+
+      needed =
+          fuse_add_direntry_plus(req_, &buf_[written_], buf_.size() - written_,
+                                 name.c_str(), &e, off + 1);
+    } else
+#endif
+    {
+      needed = fuse_add_direntry(req_, &buf_[written_], buf_.size() - written_,
+                                 name.c_str(), &st, off + 1);
+    }
     if (written_ + needed > buf_.size()) {
       return false;
     }
@@ -952,6 +1142,7 @@ class readdir_lowlevel_policy {
  private:
   fuse_req_t req_;
   fuse_ino_t ino_;
+  bool plus_;
   std::vector<char> buf_;
   size_t written_{0};
 };
@@ -1004,29 +1195,39 @@ int op_readdir_common(reader::filesystem_v2_lite& fs, Policy& policy,
     return ENOTDIR;
   }
 
-  file_off_t lastoff = fs.dirsize(*dir);
   native_stat st;
 
   st = {};
 
-  while (off < lastoff && policy.keep_going()) {
-    auto dev = fs.readdir(*dir, off);
-    assert(dev);
+  // Reused across entries so that NUL-terminating names does not allocate
+  // for each directory entry.
+  std::string name;
+  std::error_code ec;
+
+  fs.readdirplus(
+      *dir, off,
+      [&](reader::dir_entry_view const&, std::string_view dname,
+          file_stat const& stbuf) {
+        if (!policy.keep_going()) {
+          return false;
+        }
 
-    std::error_code ec;
-    auto stbuf = fs.getattr(dev->inode(), ec);
+        stbuf.copy_to(&st);
 
-    if (ec) {
-      return ec.value();
-    }
+        name.assign(dname);
 
-    stbuf.copy_to(&st);
+        if (!policy.add_entry(name, st, off)) {
+          return false;
+        }
 
-    if (!policy.add_entry(dev->name(), st, off)) {
-      break;
-    }
+        ++off;
+
+        return true;
+      },
+      ec);
 
-    ++off;
+  if (ec) {
+    return ec.value();
   }
 
   policy.finalize();
@@ -1048,9 +1249,32 @@ void op_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, file_off_t off,
 
   checked_reply_err(log_, req, [&] {
     readdir_lowlevel_policy policy{req, ino, size};
-    return op_readdir_common(userdata.fs, policy, off, [](auto const&) {});
+    return op_readdir_common(userdata.fs, policy, off, [&](auto const&) {
+      report_first_lookup(log_, userdata);
+    });
+  });
+}
+
+#ifdef DWARFS_FUSE_HAS_READDIRPLUS
+template <typename LoggerPolicy>
+void op_readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size,
+                    file_off_t off, struct fuse_file_info* /*fi*/) {
+  dUSERDATA;
+  PERFMON_EXT_SCOPED_SECTION(userdata, op_readdirplus)
+  LOG_PROXY(LoggerPolicy, userdata.lgr);
+
+  LOG_DEBUG << __func__ << "(" << ino << ", " << size << ", " << off << ")"
+            << get_caller_context(req);
+  PERFMON_SET_CONTEXT(ino, size)
+
+  checked_reply_err(log_, req, [&] {
+    readdir_lowlevel_policy policy{req, ino, size, true};
+    return op_readdir_common(userdata.fs, policy, off, [&](auto const&) {
+      report_first_lookup(log_, userdata);
+    });
   });
 }
+#endif
 #else
 template <typename LoggerPolicy>
 int op_readdir(char const* path, void* buf, fuse_fill_dir_t filler,
@@ -1067,6 +1291,7 @@ int op_readdir(char const* path, void* buf, fuse_fill_dir_t filler,
     readdir_policy policy{path, buf, filler};
     return op_readdir_common(userdata.fs, policy, off, [&](auto e) {
       PERFMON_SET_CONTEXT(e.inode_num())
+      report_first_lookup(log_, userdata);
     });
   });
 }
@@ -1605,12 +1830,14 @@ void usage(std::ostream& os, safe_fuse_args const& args) {
      << "    -o cachesize=SIZE      set size of block cache (512M)\n"
      << "    -o blocksize=SIZE      set file I/O block size (512K)\n"
      << "    -o readahead=SIZE      set readahead size (0)\n"
+     << "    -o readahead_max=SIZE  grow readahead up to this size (0)\n"
      << "    -o workers=NUM         number of worker threads (2)\n"
 #ifndef _WIN32
      << "    -o uid=NUM             override user ID for file system\n"
      << "    -o gid=NUM             override group ID for file system\n"
 #endif
      << "    -o mlock=NAME          mlock mode: (none), try, must\n"
+     << "    -o metadata_hugepages  back metadata with huge pages\n"
      << "    -o decratio=NUM        ratio for full decompression (0.8)\n"
      << "    -o offset=NUM|auto     filesystem image offset in bytes (0)\n"
      << "    -o imagesize=NUM       filesystem image size in bytes\n"
@@ -1621,14 +1848,24 @@ void usage(std::ostream& os, safe_fuse_args const& args) {
      << "    -o (no_)cache_files    (don't) keep files in kernel cache\n"
 #ifdef DWARFS_FUSE_HAS_LSEEK
      << "    -o (no_)cache_sparse   (don't) keep sparse files in kernel cache\n"
+#endif
+#ifdef DWARFS_FUSE_HAS_SPLICE
+     << "    -o splice_read         splice uncompressed data from image\n"
 #endif
      << "    -o debuglevel=NAME     " << logger::all_level_names() << "\n"
      << "    -o analysis_file=FILE  write accessed files to this file\n"
+     << "    -o record_trace=FILE   record block access trace to this file\n"
+     << "    -o preload_trace=FILE  preload blocks recorded in this trace\n"
      << "    -o tidy_strategy=NAME  (none)|time|swap\n"
      << "    -o tidy_interval=TIME  interval for cache tidying (5m)\n"
      << "    -o tidy_max_age=TIME   tidy blocks after this time (10m)\n"
-     << "    -o block_allocator=NAME  (malloc)|mmap\n"
+     << "    -o block_allocator=NAME  (malloc)|mmap|hugepage\n"
+     << "    -o cache_policy=NAME   (lru)|tinylfu\n"
+     << "    -o disk_cache=DIR      keep decompressed blocks in this directory\n"
+     << "    -o disk_cache_size=SIZE  size limit for disk cache (1G)\n"
+     << "    -o metadata_cache=FILE  keep derived metadata tables in this file\n"
      << "    -o seq_detector=NUM    sequential access detector threshold (4)\n"
+     << "    -o prefetch_depth=NUM  max. blocks to prefetch per stream (auto)\n"
 #if DWARFS_PERFMON_ENABLED
      << "    -o perfmon=name[+...]  enable performance monitor\n"
      << "    -o perfmon_trace=FILE  write performance monitor trace file\n"
@@ -1842,11 +2079,17 @@ bool materialize_and_validate_dwarfs_options(dwarfs_userdata& userdata,
 
     opts.cachesize =
         opts.cachesize_str ? parse_size_with_unit(opts.cachesize_str) : 512_MiB;
+    opts.disk_cache_size = opts.disk_cache_size_str
+                               ? parse_size_with_unit(opts.disk_cache_size_str)
+                               : 1_GiB;
     opts.blocksize = opts.blocksize_str
                          ? parse_size_with_unit(opts.blocksize_str)
                          : kDefaultBlockSize;
     opts.readahead =
         opts.readahead_str ? parse_size_with_unit(opts.readahead_str) : 0;
+    opts.readahead_max = opts.readahead_max_str
+                             ? parse_size_with_unit(opts.readahead_max_str)
+                             : 0;
     opts.workers = opts.workers_str ? to<size_t>(opts.workers_str) : 2;
     opts.lock_mode = opts.mlock_str ? reader::parse_mlock_mode(opts.mlock_str)
                                     : reader::mlock_mode::NONE;
@@ -1906,9 +2149,22 @@ bool materialize_and_validate_dwarfs_options(dwarfs_userdata& userdata,
     opts.block_allocator = reader::block_cache_allocation_mode::MALLOC;
   }
 
+  if (opts.cache_policy_str) {
+    if (auto it = cache_policy_map.find(opts.cache_policy_str);
+        it != cache_policy_map.end()) {
+      opts.cache_policy = it->second;
+    } else {
+      iol.err << "error: no such cache policy: " << opts.cache_policy_str
+              << "\n";
+      return false;
+    }
+  }
+
   opts.seq_detector_threshold = opts.seq_detector_thresh_str
                                     ? to<size_t>(opts.seq_detector_thresh_str)
                                     : kDefaultSeqDetectorThreshold;
+  opts.prefetch_depth =
+      opts.prefetch_depth_str ? to<size_t>(opts.prefetch_depth_str) : 0;
 
   return true;
 }
@@ -1926,6 +2182,9 @@ void init_fuse_ops(struct fuse_lowlevel_ops& ops) {
 #endif
   ops.read = &op_read<LoggerPolicy>;
   ops.readdir = &op_readdir<LoggerPolicy>;
+#ifdef DWARFS_FUSE_HAS_READDIRPLUS
+  ops.readdirplus = &op_readdirplus<LoggerPolicy>;
+#endif
   ops.statfs = &op_statfs<LoggerPolicy>;
   ops.getxattr = &op_getxattr<LoggerPolicy>;
   ops.listxattr = &op_listxattr<LoggerPolicy>;
@@ -2417,18 +2676,35 @@ void load_filesystem(dwarfs_userdata& userdata) {
 #endif
       ;
 
+  userdata.load_start = std::chrono::steady_clock::now();
+
   auto ti = LOG_TIMED_INFO;
   auto& opts = userdata.opts;
 
   reader::filesystem_options fsopts;
   fsopts.lock_mode = opts.lock_mode;
+  fsopts.metadata_hugepages = opts.metadata_hugepages != 0;
   fsopts.block_cache.max_bytes = opts.cachesize;
   fsopts.block_cache.num_workers = opts.workers;
   fsopts.block_cache.decompress_ratio = opts.decompress_ratio;
   fsopts.block_cache.sequential_access_detector_threshold =
       opts.seq_detector_threshold;
+  fsopts.block_cache.max_prefetch_depth = opts.prefetch_depth;
   fsopts.block_cache.allocation_mode = opts.block_allocator;
+  fsopts.block_cache.eviction_policy = opts.cache_policy;
+  if (opts.disk_cache_str) {
+    fsopts.disk_cache.directory =
+        std::filesystem::absolute(std::filesystem::path(
+            reinterpret_cast<char8_t const*>(opts.disk_cache_str)));
+    fsopts.disk_cache.max_bytes = opts.disk_cache_size;
+  }
+  if (opts.metadata_cache_str) {
+    fsopts.metadata_cache_file =
+        std::filesystem::absolute(std::filesystem::path(
+            reinterpret_cast<char8_t const*>(opts.metadata_cache_str)));
+  }
   fsopts.inode_reader.readahead = opts.readahead;
+  fsopts.inode_reader.max_readahead = opts.readahead_max;
   fsopts.metadata.enable_sparse_files =
 #ifdef DWARFS_FUSE_HAS_LSEEK
       true
@@ -2440,6 +2716,7 @@ void load_filesystem(dwarfs_userdata& userdata) {
   fsopts.metadata.case_insensitive_lookup =
       static_cast<bool>(opts.case_insensitive);
   fsopts.metadata.block_size = opts.blocksize;
+  fsopts.metadata.lazy_init = true;
 #ifndef _WIN32
   fsopts.metadata.fs_uid = opts.fs_uid;
   fsopts.metadata.fs_gid = opts.fs_gid;
@@ -2479,6 +2756,9 @@ void load_filesystem(dwarfs_userdata& userdata) {
 #endif
   PERFMON_EXT_TIMER_SETUP(userdata, op_read, "inode", "size")
   PERFMON_EXT_TIMER_SETUP(userdata, op_readdir, "inode", "size")
+#ifdef DWARFS_FUSE_HAS_READDIRPLUS
+  PERFMON_EXT_TIMER_SETUP(userdata, op_readdirplus, "inode", "size")
+#endif
   PERFMON_EXT_TIMER_SETUP(userdata, op_statfs)
   PERFMON_EXT_TIMER_SETUP(userdata, op_getxattr, "inode")
   PERFMON_EXT_TIMER_SETUP(userdata, op_listxattr, "inode")
@@ -2498,6 +2778,31 @@ void load_filesystem(dwarfs_userdata& userdata) {
   userdata.fs = reader::filesystem_v2_lite(userdata.lgr, *userdata.iol.os,
                                            fsimage, fsopts, userdata.perfmon);
 
+#ifdef DWARFS_FUSE_HAS_SPLICE
+  if (opts.splice_read) {
+    // Uncompressed data is spliced directly from the image file, so we
+    // need a file descriptor in addition to the memory mapping
+    userdata.image_fd = ::open(fsimage.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (userdata.image_fd < 0) {
+      LOG_WARN << "cannot open " << fsimage
+               << " for splicing: " << std::strerror(errno);
+    }
+  }
+#endif
+
+  if (opts.record_trace_str) {
+    userdata.fs.record_block_trace(
+        std::filesystem::absolute(std::filesystem::path(
+            reinterpret_cast<char8_t const*>(opts.record_trace_str))));
+  }
+
+  if (opts.preload_trace_str) {
+    userdata.preload_trace =
+        userdata.iol.os->canonical(std::filesystem::path(
+            reinterpret_cast<char8_t const*>(opts.preload_trace_str)));
+  }
+
   ti << "file system initialized";
 }
 
@@ -90,8 +90,8 @@ void do_list_files(reader::filesystem_v2& fs, iolayer const& iol,
     inode_size_width = fmt::format("{:L}", max_inode_size).size();
   }
 
-  fs.walk([&](auto const& de) {
-    auto name = de.unix_path();
+  fs.walk_with_path([&](auto const& de, std::string_view path) {
+    std::string name{path};
     utf8_sanitize(name);
 
     if (verbose) {
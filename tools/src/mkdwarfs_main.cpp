@@ -23,6 +23,7 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cerrno>
 #include <cstdio>
 #include <ctime>
@@ -131,6 +132,11 @@ constexpr sorted_array_map debug_filter_modes{
     std::pair{"all"sv, writer::debug_filter_mode::ALL},
 };
 
+constexpr sorted_array_map segmenter_algorithms{
+    std::pair{"cdc"sv, writer::segmenter::algorithm::cdc},
+    std::pair{"rolling-hash"sv, writer::segmenter::algorithm::rolling_hash},
+};
+
 constexpr size_t min_block_size_bits{10};
 constexpr size_t max_block_size_bits{30};
 
@@ -449,11 +455,14 @@ int mkdwarfs_main(int argc, sys_char** argv, iolayer const& iol) {
   }()};
 
   writer::segmenter_factory::config sf_config;
-  sys_string path_str, input_list_str, output_str, header_str;
+  sys_string path_str, input_list_str, output_str, header_str,
+      cdc_spill_dir_str;
   std::string memory_limit, schema_compression, metadata_compression, timestamp,
       time_resolution, progress_mode, recompress_opts, pack_metadata,
       file_hash_algo, debug_filter, max_similarity_size, chmod_str,
-      history_compression, recompress_categories;
+      history_compression, recompress_categories, subframe_size_str,
+      byte_run_threshold, segmenter_algorithm, cdc_chunk_size,
+      cdc_index_memory;
   std::vector<sys_string> filter;
   std::vector<std::string> order, max_lookback_blocks, window_size, window_step,
       bloom_filter_size, compression;
@@ -488,6 +497,10 @@ int mkdwarfs_main(int argc, sys_char** argv, iolayer const& iol) {
       fmt::format("show effect of filter rules without producing an image ({})",
                   fmt::join(ranges::views::keys(debug_filter_modes), ", "));
 
+  auto segmenter_algorithm_desc =
+      fmt::format("segmenter algorithm ({})",
+                  fmt::join(ranges::views::keys(segmenter_algorithms), ", "));
+
   auto hash_list = checksum::available_algorithms();
 
   auto file_hash_desc = fmt::format(
@@ -660,6 +673,25 @@ int mkdwarfs_main(int argc, sys_char** argv, iolayer const& iol) {
           ->value_name(cat_def_val(kDefaultBloomFilterSize))
           ->multitoken()->composing(),
         "bloom filter size (2^N*values bits)")
+    ("segmenter-hash-workers",
+        po::value<size_t>(&sf_config.num_hash_workers)->default_value(0),
+        "speculative hashing threads per segmenter")
+    ("byte-run-threshold",
+        po::value<std::string>(&byte_run_threshold),
+        "minimum size of identical byte runs to store separately")
+    ("segmenter-algorithm",
+        po::value<std::string>(&segmenter_algorithm)
+          ->default_value("rolling-hash"),
+        segmenter_algorithm_desc.c_str())
+    ("cdc-chunk-size",
+        po::value<std::string>(&cdc_chunk_size)->default_value("64k"),
+        "average chunk size for content-defined chunking")
+    ("cdc-index-memory",
+        po::value<std::string>(&cdc_index_memory)->default_value("256m"),
+        "in-memory fingerprint index size for content-defined chunking")
+    ("cdc-spill-dir",
+        po_sys_value<sys_string>(&cdc_spill_dir_str),
+        "directory for spilled fingerprint index runs")
     ;
 
   po::options_description compressor_opts("Compressor options");
@@ -681,6 +713,9 @@ int mkdwarfs_main(int argc, sys_char** argv, iolayer const& iol) {
         po::value<std::string>(&history_compression)
           ->value_name(lvl_def_val(&level_defaults::schema_history_compression)),
         "history compression algorithm")
+    ("subframe-size",
+        po::value<std::string>(&subframe_size_str),
+        "split blocks into independently decompressible sub-frames")
     ;
 
   po::options_description filter_opts("Filter options");
@@ -729,6 +764,10 @@ int mkdwarfs_main(int argc, sys_char** argv, iolayer const& iol) {
     ("no-hardlink-table",
         po::value<bool>(&options.metadata.no_hardlink_table)->zero_tokens(),
         "don't add hardlink count table to file system")
+    ("complete-size-cache",
+        po::value<bool>(&options.metadata.complete_inode_size_cache)
+            ->zero_tokens(),
+        "store sizes of all regular files in metadata")
     ("pack-metadata,P",
         po::value<std::string>(&pack_metadata)->default_value("auto"),
         "pack certain metadata elements (auto, all, none, chunk_table, "
@@ -1363,6 +1402,7 @@ int mkdwarfs_main(int argc, sys_char** argv, iolayer const& iol) {
   }
 
   size_t mem_limit = 0;
+  size_t subframe_size = 0;
 
   {
     auto const output_block_size = recompress && !change_block_size
@@ -1386,6 +1426,18 @@ int mkdwarfs_main(int argc, sys_char** argv, iolayer const& iol) {
                << size_with_unit(output_block_size) << " blocks with "
                << num_workers << " threads";
     }
+
+    if (!subframe_size_str.empty()) {
+      subframe_size = parse_size_with_unit(subframe_size_str);
+
+      if (subframe_size >= output_block_size) {
+        LOG_WARN << "sub-frame size (" << size_with_unit(subframe_size)
+                 << ") is not smaller than the block size ("
+                 << size_with_unit(output_block_size)
+                 << "), not using sub-frames";
+        subframe_size = 0;
+      }
+    }
   }
 
   std::unordered_set<std::string_view> accepted_categories;
@@ -1449,6 +1501,48 @@ int mkdwarfs_main(int argc, sys_char** argv, iolayer const& iol) {
       categorizer_list.add_implicit_defaults(cop);
       LOG_VERBOSE << cop.as_string();
     }
+
+    if (vm.contains("byte-run-threshold")) {
+      sf_config.min_byte_run_size = parse_size_with_unit(byte_run_threshold);
+    }
+
+    if (auto it = segmenter_algorithms.find(segmenter_algorithm);
+        it != segmenter_algorithms.end()) {
+      sf_config.algo = it->second;
+    } else {
+      LOG_ERROR << "invalid segmenter algorithm: " << segmenter_algorithm;
+      return 1;
+    }
+
+    {
+      auto const size =
+          static_cast<uint64_t>(parse_size_with_unit(cdc_chunk_size));
+      auto const max_size = (UINT64_C(1) << sf_config.block_size_bits) / 16;
+
+      if (!std::has_single_bit(size) || size < 1_KiB || size > max_size) {
+        LOG_ERROR << "--cdc-chunk-size must be a power of two between "
+                  << size_with_unit(1_KiB) << " and "
+                  << size_with_unit(max_size) << " (1/16 of the block size)";
+        return 1;
+      }
+
+      sf_config.cdc_chunk_size_bits = std::countr_zero(size);
+    }
+
+    sf_config.cdc_index_memory = parse_size_with_unit(cdc_index_memory);
+
+    if (!cdc_spill_dir_str.empty()) {
+      std::filesystem::path const spill_dir(cdc_spill_dir_str);
+      std::error_code ec;
+
+      if (!std::filesystem::is_directory(spill_dir, ec)) {
+        LOG_ERROR << "--cdc-spill-dir '" << spill_dir
+                  << "' is not a directory";
+        return 1;
+      }
+
+      sf_config.cdc_spill_dir = spill_dir;
+    }
   } catch (std::exception const& e) {
     LOG_ERROR << e.what();
     return 1;
@@ -1470,6 +1564,7 @@ int mkdwarfs_main(int argc, sys_char** argv, iolayer const& iol) {
   fswopts.worst_case_block_size = UINT64_C(1) << sf_config.block_size_bits;
   fswopts.remove_header = remove_header;
   fswopts.no_section_index = no_section_index;
+  fswopts.subframe_size = subframe_size;
 
   std::optional<writer::filesystem_writer> fsw;
 